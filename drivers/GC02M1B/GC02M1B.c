@@ -35,13 +35,19 @@ CREATE_TRACER( GC02M1B_REG_DEBUG, "GC02M1B: ", INFO, 0);
 #define GC02M1B_MIN_GAIN_STEP    ( 1.0f/16.0f )  /**< min gain step size used by GUI (hardware min = 1/16; 1/16..32/16 depending on actual gain ) */
 #define GC02M1B_MAX_GAIN_AEC     ( 32.0f )       /**< max. gain used by the AEC (arbitrarily chosen, hardware limit = 62.0, driver limit = 32.0 ) */
 #define GC02M1B_VS_MAX_INTEGRATION_TIME (0.0018)
+#define GC02M1B_VTS_MAX 0x3fff
 
 /*****************************************************************************
  *Sensor Info
 *****************************************************************************/
 static const char SensorName[16] = "GC02M1B";
 
-static struct vvcam_mode_info pgc02m1b_mode_info[] = {
+/* frames until a shutter, gain and VTS write is in force; unverified: the
+   datasheet gives no latencies, these are the usual 2/1/2 of sensors with a
+   double-buffered shutter and not measured on the GC02M1B */
+static const SensorLatency_t GC02M1B_Latency = { .exposure = 2, .gain = 1, .vts = 2 };
+
+static const struct vvcam_mode_info pgc02m1b_mode_info[] = {
     {
         .index     = 0,
         .width     = 1600,
@@ -269,11 +275,29 @@ static RESULT GC02M1B_IsiGetSensorModeIss(IsiSensorHandle_t handle,void *mode)
     return ( RET_SUCCESS );
 }
 
+static RESULT GC02M1B_IsiGetRegCfgIss(const char *registerFileName, struct vvcam_sccb_array *arry);
+static RESULT GC02M1B_IsiCheckSensorConnectionIss(IsiSensorHandle_t handle);
+
+/* written at runtime, never a warm restart signature */
+static const uint32_t GC02M1B_WarmVolatileRegs[] = {
+    0x0003, 0x0004, 0x003e, 0x0041, 0x0042, 0x00b1, 0x00b2, 0x00b6,
+    0x30a0, 0x30a1, 0x30a2, 0x30a3, 0x30a4, 0x30a5, 0x30a6, 0x30a7,
+};
+
+static const SensorWarmOps_t GC02M1B_WarmOps = {
+    .read          = GC02M1B_IsiRegisterReadIss,
+    .write         = GC02M1B_IsiRegisterWriteIss,
+    .pageReg       = 0xfe,
+    .pVolatile     = GC02M1B_WarmVolatileRegs,
+    .volatileCount = sizeof(GC02M1B_WarmVolatileRegs) / sizeof(GC02M1B_WarmVolatileRegs[0]),
+};
+
 static RESULT GC02M1B_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     RESULT result = RET_SUCCESS;
     GC02M1B_Context_t *pGC02M1BCtx;
 
     TRACE(GC02M1B_INFO, "%s (enter)\n", __func__);
+    uint64_t createSpan = SensorTraceBegin();
 
     if (!pConfig || !pConfig->pSensor)
         return (RET_NULL_POINTER);
@@ -293,6 +317,15 @@ static RESULT GC02M1B_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         return (result);
     }
 
+    /* 1x..16x, AecMaxGain of every mode */
+    result = SensorGainLutInit(&pGC02M1BCtx->GainLut, SENSOR_GAIN_LUT_ONE, 16 * SENSOR_GAIN_LUT_ONE, GC02M1B_QuantizeGain);
+    if (result != RET_SUCCESS) {
+        (void)HalDelRef(pConfig->HalHandle);
+        free(pGC02M1BCtx);
+        return (result);
+    }
+
+    SensorLatencySchedInit(&pGC02M1BCtx->LatencySched, &GC02M1B_Latency);
     pGC02M1BCtx->IsiCtx.HalHandle = pConfig->HalHandle;
     pGC02M1BCtx->IsiCtx.pSensor = pConfig->pSensor;
     pGC02M1BCtx->GroupHold = BOOL_FALSE;
@@ -305,7 +338,7 @@ static RESULT GC02M1B_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     pGC02M1BCtx->SensorMode.index = pConfig->SensorModeIndex;
     pConfig->hSensor = (IsiSensorHandle_t) pGC02M1BCtx;
 #ifdef SUBDEV_CHAR
-    struct vvcam_mode_info *SensorDefaultMode = NULL;
+    const struct vvcam_mode_info *SensorDefaultMode = NULL;
     for (int i=0; i < sizeof(pgc02m1b_mode_info)/ sizeof(struct vvcam_mode_info); i++)
     {
         if (pgc02m1b_mode_info[i].index == pGC02M1BCtx->SensorMode.index)
@@ -328,9 +361,16 @@ static RESULT GC02M1B_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
                 break;
         }
 
-        if (access(pGC02M1BCtx->SensorRegCfgFile, F_OK) == 0) {
+        if (SensorBundleOpen(SensorName, SensorDefaultMode->index, &pGC02M1BCtx->ModeBundle) == RET_SUCCESS ||
+            access(pGC02M1BCtx->SensorRegCfgFile, F_OK) == 0) {
             pGC02M1BCtx->KernelDriverFlag = 0;
             memcpy(&(pGC02M1BCtx->SensorMode),SensorDefaultMode,sizeof(struct vvcam_mode_info));
+            /* read the mode data while the sensor powers up */
+            (void)SensorPrefetchStart(&pGC02M1BCtx->Prefetch, &pGC02M1BCtx->ModeBundle, pGC02M1BCtx->SensorRegCfgFile, GC02M1B_IsiGetRegCfgIss);
+            if (SensorBundleIsOpen(&pGC02M1BCtx->ModeBundle)) {
+                (void)SensorProfileSetInit(&pGC02M1BCtx->TuningProfiles, &pGC02M1BCtx->ModeBundle);
+                (void)SensorGainLutCalibrate(&pGC02M1BCtx->GainLut, &pGC02M1BCtx->ModeBundle);
+            }
         } else {
             pGC02M1BCtx->KernelDriverFlag = 1;
         }
@@ -339,9 +379,12 @@ static RESULT GC02M1B_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         pGC02M1BCtx->KernelDriverFlag = 1;
     }
 
+    uint64_t span = SensorTraceBegin();
     result = GC02M1B_IsiSensorSetPowerIss(pGC02M1BCtx, BOOL_TRUE);
+    SensorTraceEnd(SensorName, "power", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
+    span = SensorTraceBegin();
     uint32_t SensorClkIn = 0;
     if (pGC02M1BCtx->KernelDriverFlag) {
         result = GC02M1B_IsiSensorGetClkIss(pGC02M1BCtx, &SensorClkIn);
@@ -349,19 +392,33 @@ static RESULT GC02M1B_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     }
 
     result = GC02M1B_IsiSensorSetClkIss(pGC02M1BCtx, SensorClkIn);
+    SensorTraceEnd(SensorName, "clk", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
-    result = GC02M1B_IsiResetSensorIss(pGC02M1BCtx);
-    RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
-
-    pGC02M1BCtx->pattern = ISI_BPAT_BGBGGRGR;
-
     if (!pGC02M1BCtx->KernelDriverFlag) {
+        span = SensorTraceBegin();
         result = GC02M1B_IsiConfigSensorSCCBIss(pGC02M1BCtx);
+        SensorTraceEnd(SensorName, "sccb", span);
         RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
     }
+
+    span = SensorTraceBegin();
+    /* a sensor a previous process left in this mode still holds its registers */
+    if (pGC02M1BCtx->KernelDriverFlag ||
+        SensorWarmOpen(&pGC02M1BCtx->Warm, SensorName, ((HalContext_t *)pGC02M1BCtx->IsiCtx.HalHandle)->sensor_fd,
+                       &GC02M1B_WarmOps, pGC02M1BCtx) != RET_SUCCESS ||
+        GC02M1B_IsiCheckSensorConnectionIss(pGC02M1BCtx) != RET_SUCCESS ||
+        SensorWarmProbe(&pGC02M1BCtx->Warm, pGC02M1BCtx->SensorMode.index) != RET_SUCCESS) {
+        SensorWarmInvalidate(&pGC02M1BCtx->Warm);
+        result = GC02M1B_IsiResetSensorIss(pGC02M1BCtx);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+    SensorTraceEnd(SensorName, "reset", span);
+
+    pGC02M1BCtx->pattern = ISI_BPAT_BGBGGRGR;
 #endif
 
+    SensorTraceEnd(SensorName, "create", createSpan);
     TRACE(GC02M1B_INFO, "%s (exit pConfig->hSensor = %p)\n", __func__, pConfig->hSensor);
     return (result);
 }
@@ -417,42 +474,98 @@ static RESULT GC02M1B_IsiGetRegCfgIss(const char *registerFileName,
     return 0;
 }
 
+static uint32_t GC02M1B_MaxFrameLengthLines(GC02M1B_Context_t *pGC02M1BCtx)
+{
+    if (!pGC02M1BCtx->AutoFrameLength || pGC02M1BCtx->MinFps == 0) {
+        return pGC02M1BCtx->FrameLengthLines;
+    }
+
+    return MIN((uint32_t)pGC02M1BCtx->FrameLengthLines * pGC02M1BCtx->MaxFps / pGC02M1BCtx->MinFps, GC02M1B_VTS_MAX);
+}
+
+static void GC02M1B_SetExposureTiming(GC02M1B_Context_t *pGC02M1BCtx, uint32_t lineTimePs)
+{
+    SensorExposureTiming_t *pTiming = &pGC02M1BCtx->ExpTiming;
+
+    /* with auto frame length the frame end moves out, the margin to it stays */
+    SensorExposureTimingSet(pTiming, lineTimePs, pGC02M1BCtx->MinIntegrationLine,
+                            pGC02M1BCtx->MaxIntegrationLine + GC02M1B_MaxFrameLengthLines(pGC02M1BCtx) - pGC02M1BCtx->FrameLengthLines);
+    pGC02M1BCtx->one_line_exp_time           = (float)lineTimePs / 1e12f;
+    pGC02M1BCtx->AecIntegrationTimeIncrement = SensorExposureLinesToTime(pTiming, 1);
+    pGC02M1BCtx->AecMinIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->minLines);
+    pGC02M1BCtx->AecMaxIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->maxLines);
+}
+
 static RESULT GC02M1B_IsiInitSensorIss(IsiSensorHandle_t handle) {
     RESULT result = RET_SUCCESS;
 
     int ret = 0;
+    uint32_t lineTimePs = 0;
     GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
 
     HalContext_t *pHalCtx = (HalContext_t *) pGC02M1BCtx->IsiCtx.HalHandle;
     TRACE(GC02M1B_INFO, "%s (enter handle = %p)\n", __func__, handle);
+    uint64_t initSpan = SensorTraceBegin();
 
     if (pGC02M1BCtx == NULL) {
         return (RET_WRONG_HANDLE);
     }
 	TRACE(GC02M1B_INFO, "%s (pGC02M1BCtx->KernelDriverFlag = %d)\n", __func__, pGC02M1BCtx->KernelDriverFlag);
     if (pGC02M1BCtx->KernelDriverFlag) {
-        ;
+        /* the kernel driver set the mode up, its frame rate is the one in force */
+        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pGC02M1BCtx->SensorMode));
+        if (ret != 0) {
+            TRACE(GC02M1B_ERROR, "%s:sensor get mode info error!\n",
+                  __func__);
+            return (RET_FAILURE);
+        }
+        pGC02M1BCtx->MaxFps  = pGC02M1BCtx->SensorMode.fps;
+        pGC02M1BCtx->MinFps  = 1;
+        pGC02M1BCtx->CurrFps = pGC02M1BCtx->MaxFps;
     } else {
 		TRACE(GC02M1B_INFO, "%s (001)\n", __func__);
         struct vvcam_sccb_array arry;
-        result = GC02M1B_IsiGetRegCfgIss(pGC02M1BCtx->SensorRegCfgFile, &arry);
+        uint64_t span = SensorTraceBegin();
+        SensorPrefetchWait(&pGC02M1BCtx->Prefetch);
+        if (SensorBundleIsOpen(&pGC02M1BCtx->ModeBundle)) {
+            result = SensorBundleGetRegArray(&pGC02M1BCtx->ModeBundle, &arry);
+        } else if (SensorPrefetchTakeRegs(&pGC02M1BCtx->Prefetch, &arry) != RET_SUCCESS) {
+            result = GC02M1B_IsiGetRegCfgIss(pGC02M1BCtx->SensorRegCfgFile, &arry);
+        }
+        SensorTraceEnd(SensorName, "load", span);
         if (result != 0) {
             TRACE(GC02M1B_ERROR,
                   "%s:GC02M1B_IsiGetRegCfgIss error!\n", __func__);
             return (RET_FAILURE);
         }
 
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &arry);
-        if (ret != 0) {
-            TRACE(GC02M1B_ERROR, "%s:Sensor Write Reg arry error!\n",
-                  __func__);
-            return (RET_FAILURE);
+        bool_t warm = pGC02M1BCtx->Warm.resumed;
+        uint64_t regHash = SensorBundleHash(arry.sccb_data, arry.count * sizeof(struct vvcam_sccb_data),
+                                            SENSOR_BUNDLE_FNV_SEED);
+        if (SensorWarmResume(&pGC02M1BCtx->Warm, regHash)) {
+            TRACE(GC02M1B_INFO, "%s: warm restart, register set skipped\n", __func__);
+        } else {
+            if (warm) {
+                /* create skipped the reset, but the register set changed since */
+                result = GC02M1B_IsiResetSensorIss(pGC02M1BCtx);
+                RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+            }
+
+            span = SensorTraceBegin();
+            ret = SensorInitWriteRegs(&pGC02M1BCtx->InitAsync, pHalCtx->sensor_fd, &arry);
+            SensorTraceEnd(SensorName, "write", span);
+            if (ret != 0) {
+                TRACE(GC02M1B_ERROR, "%s:Sensor Write Reg arry error!\n",
+                      __func__);
+                return (RET_FAILURE);
+            }
+            (void)SensorWarmCommit(&pGC02M1BCtx->Warm, pGC02M1BCtx->SensorMode.index, regHash, &arry);
         }
 		TRACE(GC02M1B_INFO, "%s (pGC02M1BCtx->SensorMode.index = %d)\n", __func__, pGC02M1BCtx->SensorMode.index);
         switch(pGC02M1BCtx->SensorMode.index)
         {
             case 0:
-                pGC02M1BCtx->one_line_exp_time = 0.00002609; // line_time = line_length / pclk =1460/87.6mhz = 0.0000167
+                lineTimePs = 26090000; // line_time = line_length / pclk =1460/87.6mhz = 0.0000167
                 pGC02M1BCtx->FrameLengthLines = 0x4FE; //framelength=1278=0x4FE
                 pGC02M1BCtx->CurFrameLengthLines = pGC02M1BCtx->FrameLengthLines;
                 pGC02M1BCtx->MaxIntegrationLine = pGC02M1BCtx->CurFrameLengthLines - 16;
@@ -463,17 +576,29 @@ static RESULT GC02M1B_IsiInitSensorIss(IsiSensorHandle_t handle) {
             default:
                 return (RET_FAILURE);
         }
-		pGC02M1BCtx->AecIntegrationTimeIncrement = pGC02M1BCtx->one_line_exp_time;
-		pGC02M1BCtx->AecMinIntegrationTime =
-			pGC02M1BCtx->one_line_exp_time * pGC02M1BCtx->MinIntegrationLine;
-		pGC02M1BCtx->AecMaxIntegrationTime =
-			pGC02M1BCtx->one_line_exp_time * pGC02M1BCtx->MaxIntegrationLine;
+        GC02M1B_SetExposureTiming(pGC02M1BCtx, lineTimePs);
 
 
         pGC02M1BCtx->MaxFps  = pGC02M1BCtx->SensorMode.fps;
         pGC02M1BCtx->MinFps  = 1;
         pGC02M1BCtx->CurrFps = pGC02M1BCtx->MaxFps;
     }
+
+    /* the tuning may allow the sensor less gain than the mode can do */
+    pGC02M1BCtx->AecMaxGain = SensorGainArbiterInit(&pGC02M1BCtx->GainArbiter, &pGC02M1BCtx->TuningProfiles, pGC02M1BCtx->AecMaxGain);
+
+    if (pGC02M1BCtx->Warm.resumed) {
+        float gain, integrationTime, hdrRatio, setGain, setIntegrationTime;
+        uint8_t skip;
+
+        /* carry on with the exposure the sensor streamed with */
+        if (SensorWarmLastExposure(&pGC02M1BCtx->Warm, &gain, &integrationTime, &hdrRatio)) {
+            (void)GC02M1B_IsiExposureControlIss(handle, gain, integrationTime, &skip,
+                                                &setGain, &setIntegrationTime, &hdrRatio);
+        }
+    }
+
+    SensorTraceEnd(SensorName, "init", initSpan);
     TRACE(GC02M1B_INFO, "%s (pGC02M1BCtx->one_line_exp_time = %f)\n", __func__, pGC02M1BCtx->one_line_exp_time);
     TRACE(GC02M1B_INFO, "%s (pGC02M1BCtx->MinIntegrationLine = %d, pGC02M1BCtx->MaxIntegrationLine = %d)\n", __func__, pGC02M1BCtx->MinIntegrationLine, pGC02M1BCtx->MaxIntegrationLine);
     return (result);
@@ -487,10 +612,20 @@ static RESULT GC02M1B_IsiReleaseSensorIss(IsiSensorHandle_t handle) {
     if (pGC02M1BCtx == NULL)
         return (RET_WRONG_HANDLE);
 
+    /* an initialization still running in the background uses the context */
+    (void)SensorInitAsyncWait(&pGC02M1BCtx->InitAsync);
+
     (void)GC02M1B_IsiSensorSetStreamingIss(pGC02M1BCtx, BOOL_FALSE);
     (void)GC02M1B_IsiSensorSetPowerIss(pGC02M1BCtx, BOOL_FALSE);
     (void)HalDelRef(pGC02M1BCtx->IsiCtx.HalHandle);
 
+    SensorWarmClose(&pGC02M1BCtx->Warm, BOOL_TRUE);
+
+    SensorPrefetchRelease(&pGC02M1BCtx->Prefetch);
+    SensorLatencySchedRelease(&pGC02M1BCtx->LatencySched);
+    (void)SensorBundleClose(&pGC02M1BCtx->ModeBundle);
+    SensorGainLutRelease(&pGC02M1BCtx->GainLut);
+
     MEMSET(pGC02M1BCtx, 0, sizeof(GC02M1B_Context_t));
     free(pGC02M1BCtx);
     TRACE(GC02M1B_INFO, "%s (exit)\n", __func__);
@@ -512,6 +647,7 @@ static RESULT GC02M1B_IsiSetupSensorIss
     RESULT result = RET_SUCCESS;
 
     TRACE(GC02M1B_INFO, "%s: (enter)\n", __func__);
+    uint64_t setupSpan = SensorTraceBegin();
 
     if (!pGC02M1BCtx) {
         TRACE(GC02M1B_ERROR,
@@ -535,7 +671,9 @@ static RESULT GC02M1B_IsiSetupSensorIss
 
     /* 1.) SW reset of image sensor (via I2C register interface)  be careful, bits 6..0 are reserved, reset bit is not sticky */
     TRACE(GC02M1B_DEBUG, "%s: GC02M1B System-Reset executed\n", __func__);
+    uint64_t span = SensorTraceBegin();
     osSleep(100);
+    SensorTraceEnd(SensorName, "settle", span);
 
     //GC02M1B_AecSetModeParameters not defined yet as of 2021/8/9.
     //result = GC02M1B_AecSetModeParameters(pGC02M1BCtx, pConfig);
@@ -552,6 +690,7 @@ static RESULT GC02M1B_IsiSetupSensorIss
     ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);//result = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);
 #endif
     pGC02M1BCtx->Configured = BOOL_TRUE;
+    SensorTraceEnd(SensorName, "setup", setupSpan);
     TRACE(GC02M1B_INFO, "%s: (exit) ret=0x%x \n", __func__, result);
     return result;
 }
@@ -574,6 +713,7 @@ static RESULT GC02M1B_IsiSensorSetStreamingIss
     RESULT result = RET_SUCCESS;
     int ret = 0;
     TRACE(GC02M1B_INFO, "%s (enter)\n", __func__);
+    uint64_t streamSpan = SensorTraceBegin();
 
     GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
     if (pGC02M1BCtx == NULL || pGC02M1BCtx->IsiCtx.HalHandle == NULL) {
@@ -603,6 +743,7 @@ static RESULT GC02M1B_IsiSensorSetStreamingIss
 
     pGC02M1BCtx->Streaming = on;
 
+    SensorTraceEnd(SensorName, on ? "stream on" : "stream off", streamSpan);
     TRACE(GC02M1B_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -727,7 +868,7 @@ static RESULT GC02M1B_IsiGetIntegrationTimeLimitsIss
     }
 
     *pMinIntegrationTime = pGC02M1BCtx->AecMinIntegrationTime;
-    *pMaxIntegrationTime = pGC02M1BCtx->AecMaxIntegrationTime;
+    *pMaxIntegrationTime = SensorAntiFlickerSnapTime(&pGC02M1BCtx->AntiFlicker, pGC02M1BCtx->AecMaxIntegrationTime);
 
     TRACE(GC02M1B_INFO, "%s: (exit)\n", __func__);
     return (result);
@@ -823,7 +964,7 @@ RESULT GC02M1B_IsiGetGainIncrementIss(IsiSensorHandle_t handle, float *pIncr) {
     return (result);
 }
 
-uint32_t gainLevelTable[17] = {
+static const uint32_t gainLevelTable[17] = {
 								 64,
 								 96,
 								127,
@@ -843,6 +984,21 @@ uint32_t gainLevelTable[17] = {
 								0xffffffff,
 };
 
+static void GC02M1B_QuantizeGain(uint32_t gain, SensorGainCode_t *pCode)
+{
+    uint32_t SensorGain = gain >> 2;    /* gainLevelTable is in 1/64 */
+    int Analog_Index;
+
+    for (Analog_Index = 0; Analog_Index < 16; Analog_Index++) {
+        if (SensorGain < gainLevelTable[Analog_Index + 1])
+            break;
+    }
+
+    pCode->again = Analog_Index;
+    pCode->dgain = SensorGain * 1024 / gainLevelTable[Analog_Index];
+    pCode->gain  = gainLevelTable[Analog_Index] * pCode->dgain / 256;
+}
+
 RESULT GC02M1B_IsiSetGainIss
     (IsiSensorHandle_t handle,
      float NewGain, float *pSetGain, float *hdr_ratio) {
@@ -857,47 +1013,31 @@ RESULT GC02M1B_IsiSetGainIss
     }
 
     HalContext_t *pHalCtx = (HalContext_t *) pGC02M1BCtx->IsiCtx.HalHandle;
-    //GC02M1B specific
-    int Analog_Index;
-    uint32_t tol_dig_gain = 0, SensorGain;	    
-    int total;	
-    total = sizeof(gainLevelTable) / sizeof(uint32_t);
-	
-    SensorGain = NewGain * 64;
-    if (SensorGain < 64) {
-        SensorGain = 64;
-    }
-
-    for(Analog_Index = 0; Analog_Index < total; Analog_Index++)
-    {
-        if((gainLevelTable[Analog_Index] <= SensorGain)&&(SensorGain < gainLevelTable[Analog_Index+1]))
-            break;
-    }	    
-
-    tol_dig_gain = SensorGain*1024/gainLevelTable[Analog_Index];	 
+    //GC02M1B specific, 1x..16x
+    const SensorGainCode_t *pCode = SensorGainLutLookup(&pGC02M1BCtx->GainLut, NewGain);
 
     ret = GC02M1B_IsiRegisterWriteIss(handle, 0xfe, 0x00);
     if (ret != 0) {
         return (RET_FAILURE);
     }
-    ret = GC02M1B_IsiRegisterWriteIss(handle, 0xb6, Analog_Index);
+    ret = GC02M1B_IsiRegisterWriteIss(handle, 0xb6, pCode->again);
     if (ret != 0) {
         return (RET_FAILURE);
     }
 
-    ret = GC02M1B_IsiRegisterWriteIss(handle, 0xb1,(tol_dig_gain>>8));
+    ret = GC02M1B_IsiRegisterWriteIss(handle, 0xb1,(pCode->dgain>>8));
     if (ret != 0) {
         return (RET_FAILURE);
     }
-    ret = GC02M1B_IsiRegisterWriteIss(handle, 0xb2, (tol_dig_gain&0xff));
+    ret = GC02M1B_IsiRegisterWriteIss(handle, 0xb2, (pCode->dgain&0xff));
     if (ret != 0) {
         return (RET_FAILURE);
     }
 
     volatile int32_t reg;
-    TRACE(GC02M1B_DEBUG, "%s NewGain=%f SensorGain=%d Analog_Index=%d,gainLevelTable[Analog_Index]=%d,tol_dig_gain=%u b1=0x%x b2=0x%x\n",__func__, 
-        NewGain, SensorGain, Analog_Index, gainLevelTable[Analog_Index], tol_dig_gain, (tol_dig_gain>>8), (tol_dig_gain&0xff));
-    TRACE(GC02M1B_DEBUG, "%s 0xb6 write=0x%x,0xb1 write 0x%x,0xb2 write 0x%x\n",__func__, Analog_Index,(tol_dig_gain>>8), (tol_dig_gain&0xff));
+    TRACE(GC02M1B_DEBUG, "%s NewGain=%f again=%u,dgain=%u,gain=%u\n",__func__, 
+        NewGain, pCode->again, pCode->dgain, pCode->gain);
+    TRACE(GC02M1B_DEBUG, "%s 0xb6 write=0x%x,0xb1 write 0x%x,0xb2 write 0x%x\n",__func__, pCode->again,(pCode->dgain>>8), (pCode->dgain&0xff));
     GC02M1B_IsiRegisterReadIss(handle, 0xb6, &reg);
     TRACE(GC02M1B_DEBUG, "%s 0xb6 read 0x0%x\n",__func__, reg);
     GC02M1B_IsiRegisterReadIss(handle, 0xb1, &reg);
@@ -905,7 +1045,7 @@ RESULT GC02M1B_IsiSetGainIss
     GC02M1B_IsiRegisterReadIss(handle, 0xb2, &reg);
     TRACE(GC02M1B_DEBUG, "%s 0xb2 read 0x0%x\n",__func__, reg);
 
-    pGC02M1BCtx->AecCurGain = ((float)(NewGain));
+    pGC02M1BCtx->AecCurGain = (float)pCode->gain / SENSOR_GAIN_LUT_ONE;
     *pSetGain = pGC02M1BCtx->AecCurGain;
     TRACE(GC02M1B_DEBUG, "%s: g=%f\n", __func__, *pSetGain);
     return (result);
@@ -1161,7 +1301,6 @@ RESULT GC02M1B_IsiSetIntegrationTimeIss
     HalContext_t *pHalCtx = (HalContext_t *) pGC02M1BCtx->IsiCtx.HalHandle;
 
     uint32_t exp_line = 0;
-    uint32_t exp_line_old = 0;
     int ret = 0;
 
     TRACE(GC02M1B_INFO, "%s: (enter handle = %p)\n", __func__, handle);
@@ -1179,11 +1318,7 @@ RESULT GC02M1B_IsiSetIntegrationTimeIss
               __func__);
         return (RET_NULL_POINTER);
     }
-    exp_line = NewIntegrationTime / pGC02M1BCtx->one_line_exp_time;
-    exp_line_old = exp_line;
-    exp_line =
-        MIN(pGC02M1BCtx->MaxIntegrationLine,
-        MAX(pGC02M1BCtx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pGC02M1BCtx->ExpTiming, NewIntegrationTime);
 
     TRACE(GC02M1B_DEBUG, "%s: set AEC_PK_EXPO=0x%05x min_exp_line = %d, max_exp_line = %d\n", __func__, exp_line, pGC02M1BCtx->MinIntegrationLine, pGC02M1BCtx->MaxIntegrationLine);
 
@@ -1193,16 +1328,13 @@ RESULT GC02M1B_IsiSetIntegrationTimeIss
         //ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_EXP, &exp_line);
         pGC02M1BCtx->OldIntegrationTime = exp_line;    // remember current integration time
         pGC02M1BCtx->AecCurIntegrationTime =
-            exp_line * pGC02M1BCtx->one_line_exp_time;
+            SensorExposureLinesToTime(&pGC02M1BCtx->ExpTiming, exp_line);
 
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
         *pNumberOfFramesToSkip = 0U;    //no frame skip
     }
 
-    if (NewIntegrationTime > pGC02M1BCtx->MaxIntegrationLine * pGC02M1BCtx->one_line_exp_time)
-        NewIntegrationTime = pGC02M1BCtx->MaxIntegrationLine * pGC02M1BCtx->one_line_exp_time;
-    
     // GC02M1B specific
      int vts = exp_line + 16;
 
@@ -1241,11 +1373,7 @@ RESULT GC02M1B_IsiSetIntegrationTimeIss
     GC02M1B_IsiRegisterReadIss(handle, 0x04, &reg);
     TRACE(GC02M1B_DEBUG, "%s 0x04 read 0x0%x\n",__func__, reg);
 
-    if (exp_line_old != exp_line) {
-        *pSetIntegrationTime = pGC02M1BCtx->AecCurIntegrationTime;
-    } else {
-        *pSetIntegrationTime = NewIntegrationTime;
-    }
+    *pSetIntegrationTime = pGC02M1BCtx->AecCurIntegrationTime;
 
     TRACE(GC02M1B_DEBUG, "%s: Ti=%f\n", __func__, *pSetIntegrationTime);
     TRACE(GC02M1B_INFO, "%s: (exit)\n", __func__);
@@ -1266,8 +1394,7 @@ RESULT GC02M1B_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integ
     HalContext_t *pHalCtx = (HalContext_t *) pGC02M1BCtx->IsiCtx.HalHandle;
 
     uint32_t exp_line = 0;
-    exp_line = IntegrationTime / pGC02M1BCtx->one_line_exp_time;
-    exp_line = MIN(pGC02M1BCtx->MaxIntegrationLine, MAX(pGC02M1BCtx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pGC02M1BCtx->ExpTiming, IntegrationTime);
 
     if (exp_line != pGC02M1BCtx->LastLongExpLine)
     {
@@ -1282,7 +1409,7 @@ RESULT GC02M1B_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integ
         }
 
         pGC02M1BCtx->LastLongExpLine = exp_line;
-        pGC02M1BCtx->AecCurLongIntegrationTime =  pGC02M1BCtx->LastLongExpLine*pGC02M1BCtx->one_line_exp_time;
+        pGC02M1BCtx->AecCurLongIntegrationTime =  SensorExposureLinesToTime(&pGC02M1BCtx->ExpTiming, pGC02M1BCtx->LastLongExpLine);
     }
 
 
@@ -1322,10 +1449,7 @@ RESULT GC02M1B_IsiSetVSIntegrationTimeIss
           pGC02M1BCtx->AecMinIntegrationTime);
 
 
-    exp_line = NewIntegrationTime / pGC02M1BCtx->one_line_exp_time;
-    exp_line =
-        MIN(pGC02M1BCtx->MaxIntegrationLine,
-        MAX(pGC02M1BCtx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pGC02M1BCtx->ExpTiming, NewIntegrationTime);
 
     if (exp_line != pGC02M1BCtx->OldVsIntegrationTime) {
     /*TODO*/
@@ -1333,7 +1457,7 @@ RESULT GC02M1B_IsiSetVSIntegrationTimeIss
     } else if (1){
 
         pGC02M1BCtx->OldVsIntegrationTime = exp_line;
-        pGC02M1BCtx->AecCurVSIntegrationTime = exp_line * pGC02M1BCtx->one_line_exp_time;    //remember current integration time
+        pGC02M1BCtx->AecCurVSIntegrationTime = SensorExposureLinesToTime(&pGC02M1BCtx->ExpTiming, exp_line);    //remember current integration time
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
         *pNumberOfFramesToSkip = 0U;    //no frame skip
@@ -1347,6 +1471,60 @@ RESULT GC02M1B_IsiSetVSIntegrationTimeIss
     return (result);
 }
 
+static RESULT GC02M1B_ApplyExposureSplit(GC02M1B_Context_t *pGC02M1BCtx, const SensorExposureSplit_t *pSplit,
+                                         uint32_t *pFrame, uint32_t *pValidFrame)
+{
+    HalContext_t *pHalCtx = (HalContext_t *) pGC02M1BCtx->IsiCtx.HalHandle;
+    uint32_t vts = MIN(MAX(pSplit->lines + pGC02M1BCtx->FrameLengthLines - pGC02M1BCtx->MaxIntegrationLine,
+                           (uint32_t)pGC02M1BCtx->FrameLengthLines), GC02M1B_MaxFrameLengthLines(pGC02M1BCtx));
+    struct vvcam_sccb_data shutter[] = {
+        { 0xfe, 0x00 },
+        { 0x41, (vts >> 8) & 0xff },
+        { 0x42, vts & 0xff },
+        { 0x03, pSplit->lines >> 8 },
+        { 0x04, pSplit->lines & 0xff },
+    };
+    struct vvcam_sccb_data gain[] = {
+        { 0xfe, 0x00 },
+        { 0xb6, pSplit->code.again },
+        { 0xb1, pSplit->code.dgain >> 8 },
+        { 0xb2, pSplit->code.dgain & 0xff },
+    };
+    struct vvcam_sccb_data *pShutter = shutter;
+    uint32_t shutterCount = sizeof(shutter) / sizeof(shutter[0]);
+    RESULT result;
+
+    if (vts == 0) {
+        TRACE(GC02M1B_ERROR, "%s: no frame length yet\n", __func__);
+        return (RET_WRONG_STATE);
+    }
+
+    /* VTS moves only when the shutter needs more than the frame has, or no
+       longer needs what an earlier exposure raised it to */
+    if (vts == pGC02M1BCtx->CurFrameLengthLines) {
+        /* the frame length stays as it is: page select and shutter only */
+        shutter[2] = shutter[0];
+        pShutter   = &shutter[2];
+        shutterCount -= 2;
+    }
+
+    /* timed so shutter and gain are in force on the same frame */
+    result = SensorLatencySubmit(&pGC02M1BCtx->LatencySched, pHalCtx->sensor_fd,
+                                 pShutter, shutterCount,
+                                 gain, sizeof(gain) / sizeof(gain[0]), pFrame, pValidFrame);
+    if (result != RET_SUCCESS) {
+        TRACE(GC02M1B_ERROR, "%s: write exposure registers error!\n", __func__);
+        return (result);
+    }
+
+    pGC02M1BCtx->OldIntegrationTime    = pSplit->lines;
+    pGC02M1BCtx->AecCurIntegrationTime = pSplit->integrationTime;
+    pGC02M1BCtx->AecCurGain            = pSplit->gain;
+    pGC02M1BCtx->CurFrameLengthLines   = vts;
+    pGC02M1BCtx->CurrFps               = pGC02M1BCtx->MaxFps * pGC02M1BCtx->FrameLengthLines / vts;
+    return (RET_SUCCESS);
+}
+
 RESULT GC02M1B_IsiExposureControlIss
     (IsiSensorHandle_t handle,
      float NewGain,
@@ -1356,8 +1534,9 @@ RESULT GC02M1B_IsiExposureControlIss
 {
     GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
     RESULT result = RET_SUCCESS;
-    int TmpGain;
-    /*TODO*/
+    SensorExposureSplit_t split;
+    SensorFrameMeta_t meta;
+    uint32_t frame, validFrame;
 
     TRACE(GC02M1B_INFO, "%s: (enter)\n", __func__);
 
@@ -1379,16 +1558,56 @@ RESULT GC02M1B_IsiExposureControlIss
     TRACE(GC02M1B_ERROR, "%s: g=%f, Ti=%f\n", __func__, NewGain,
           NewIntegrationTime);
 
-    result = GC02M1B_IsiSetIntegrationTimeIss(handle, NewIntegrationTime,
-                        pSetIntegrationTime,
-                        pNumberOfFramesToSkip, hdr_ratio);
-    result = GC02M1B_IsiSetGainIss(handle, NewGain, pSetGain, hdr_ratio);
+    if (pGC02M1BCtx->KernelDriverFlag) {
+        /* the kernel driver owns the sensor and its frame timing */
+        result = GC02M1B_IsiSetIntegrationTimeIss(handle, NewIntegrationTime, pSetIntegrationTime,
+                                                pNumberOfFramesToSkip, hdr_ratio);
+        if (result != RET_SUCCESS) {
+            return (result);
+        }
+        result = GC02M1B_IsiSetGainIss(handle, NewGain, pSetGain, hdr_ratio);
+        if (result != RET_SUCCESS) {
+            return (result);
+        }
+        pGC02M1BCtx->CurHdrRatio = *hdr_ratio;
+        return (RET_SUCCESS);
+    }
+
+    result = SensorExposureSolve(&pGC02M1BCtx->ExpTiming, &pGC02M1BCtx->GainLut, 1, pGC02M1BCtx->AntiFlicker.bandNs,
+                                 NewGain * NewIntegrationTime, &split);
+    if (result != RET_SUCCESS) {
+        TRACE(GC02M1B_ERROR, "%s: no exposure timing yet\n", __func__);
+        return (result);
+    }
+    TRACE(GC02M1B_DEBUG, "%s: lines=%u again=0x%x dgain=0x%x residual=%f\n", __func__,
+          split.lines, split.code.again, split.code.dgain, split.residual);
+
+    result = GC02M1B_ApplyExposureSplit(pGC02M1BCtx, &split, &frame, &validFrame);
+    if (result != RET_SUCCESS) {
+        TRACE(GC02M1B_ERROR, "%s: write exposure error!\n", __func__);
+        return (result);
+    }
+
+    *pNumberOfFramesToSkip = validFrame - frame;
+    *pSetGain = pGC02M1BCtx->AecCurGain;
+    *pSetIntegrationTime = pGC02M1BCtx->AecCurIntegrationTime;
 
     pGC02M1BCtx->CurHdrRatio = *hdr_ratio;
 
+    meta.frame           = validFrame;
+    meta.lines           = split.lines;
+    meta.again           = split.code.again;
+    meta.dgain           = split.code.dgain;
+    meta.vts             = pGC02M1BCtx->CurFrameLengthLines;
+    meta.gain            = *pSetGain;
+    meta.integrationTime = *pSetIntegrationTime;
+    meta.hdrRatio        = pGC02M1BCtx->CurHdrRatio;
+    SensorFrameMetaRecord(&pGC02M1BCtx->FrameMeta, &meta);
+    SensorWarmNoteExposure(&pGC02M1BCtx->Warm, meta.gain, meta.integrationTime, meta.hdrRatio);
+
     TRACE(GC02M1B_INFO, "%s: (exit)\n", __func__);
 
-    return result;
+    return (RET_SUCCESS);
 }
 
 RESULT GC02M1B_IsiGetCurrentExposureIss
@@ -1436,6 +1655,226 @@ RESULT GC02M1B_IsiGetResolutionIss(IsiSensorHandle_t handle, uint16_t *pwidth, u
     return (result);
 }
 
+RESULT GC02M1B_IsiGetModeBundleIss(IsiSensorHandle_t handle, const SensorBundle_t **ppBundle)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (!SensorBundleIsOpen(&pGC02M1BCtx->ModeBundle)) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    *ppBundle = &pGC02M1BCtx->ModeBundle;
+    return (RET_SUCCESS);
+}
+
+RESULT GC02M1B_IsiSetTuningProfileIss(IsiSensorHandle_t handle, const char *pName)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+    int32_t index;
+
+    TRACE(GC02M1B_INFO, "%s: (enter)\n", __func__);
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pName == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    index = SensorProfileFind(&pGC02M1BCtx->TuningProfiles, pName);
+    if (index < 0) {
+        TRACE(GC02M1B_ERROR, "%s: no tuning profile %s\n", __func__, pName);
+        return (RET_NOTAVAILABLE);
+    }
+
+    TRACE(GC02M1B_INFO, "%s: (exit)\n", __func__);
+    return SensorProfileRequest(&pGC02M1BCtx->TuningProfiles, index);
+}
+
+RESULT GC02M1B_IsiLatchTuningProfileIss(IsiSensorHandle_t handle, const SensorTuningProfile_t **ppProfile, bool_t *pChanged)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+    bool_t changed;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppProfile == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (pGC02M1BCtx->TuningProfiles.count == 0) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    changed = SensorProfileFrameBoundary(&pGC02M1BCtx->TuningProfiles, ppProfile);
+    if (changed) {
+        pGC02M1BCtx->AecMaxGain = SensorGainArbiterUpdate(&pGC02M1BCtx->GainArbiter, &pGC02M1BCtx->TuningProfiles);
+    }
+    if (pChanged != NULL) {
+        *pChanged = changed;
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT GC02M1B_IsiGetExposureStateIss(IsiSensorHandle_t handle, SensorExposureState_t *pState)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pState == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    pState->minGain                  = pGC02M1BCtx->AecMinGain;
+    pState->maxGain                  = pGC02M1BCtx->AecMaxGain;
+    pState->gainIncrement            = pGC02M1BCtx->AecGainIncrement;
+    pState->minIntegrationTime       = pGC02M1BCtx->AecMinIntegrationTime;
+    pState->maxIntegrationTime       = SensorAntiFlickerSnapTime(&pGC02M1BCtx->AntiFlicker, pGC02M1BCtx->AecMaxIntegrationTime);
+    pState->integrationTimeIncrement = pGC02M1BCtx->AecIntegrationTimeIncrement;
+    pState->curGain                  = pGC02M1BCtx->AecCurGain;
+    pState->curIntegrationTime       = pGC02M1BCtx->AecCurIntegrationTime;
+    pState->curHdrRatio              = pGC02M1BCtx->CurHdrRatio;
+    pState->curFps                   = pGC02M1BCtx->CurrFps;
+    pState->minFps                   = pGC02M1BCtx->MinFps;
+    pState->maxFps                   = pGC02M1BCtx->MaxFps;
+    pState->frameLengthLines         = pGC02M1BCtx->FrameLengthLines;
+    pState->curFrameLengthLines      = pGC02M1BCtx->CurFrameLengthLines;
+    pState->minIntegrationLine       = pGC02M1BCtx->MinIntegrationLine;
+    pState->maxIntegrationLine       = pGC02M1BCtx->MaxIntegrationLine;
+
+    SensorExposureStatePublish(&pGC02M1BCtx->ExposureState, pState);
+    return (RET_SUCCESS);
+}
+
+RESULT GC02M1B_IsiSetAntiFlickerIss(IsiSensorHandle_t handle, SensorAntiFlickerMode_t mode, uint32_t detectedHz)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    TRACE(GC02M1B_INFO, "%s: mode=%d detected=%uHz\n", __func__, mode, detectedHz);
+    return SensorAntiFlickerSet(&pGC02M1BCtx->AntiFlicker, mode, detectedHz);
+}
+
+RESULT GC02M1B_IsiFrameStartIss(IsiSensorHandle_t handle, uint32_t frame)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL || pGC02M1BCtx->IsiCtx.HalHandle == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    HalContext_t *pHalCtx = (HalContext_t *) pGC02M1BCtx->IsiCtx.HalHandle;
+    return SensorLatencyFrameStart(&pGC02M1BCtx->LatencySched, pHalCtx->sensor_fd, frame);
+}
+
+RESULT GC02M1B_IsiGetExposureValidFrameIss(IsiSensorHandle_t handle, uint32_t *pFrame)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pFrame == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    *pFrame = SensorLatencyValidFrame(&pGC02M1BCtx->LatencySched);
+    return (RET_SUCCESS);
+}
+
+RESULT GC02M1B_IsiGetFrameExposureIss(IsiSensorHandle_t handle, uint32_t frame, SensorFrameMeta_t *pMeta)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorFrameMetaLookup(&pGC02M1BCtx->FrameMeta, frame, pMeta);
+}
+
+RESULT GC02M1B_IsiSetAutoFrameLengthIss(IsiSensorHandle_t handle, bool_t enable)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    pGC02M1BCtx->AutoFrameLength = enable;
+    /* before init there is no timing yet, init picks the flag up */
+    if (pGC02M1BCtx->ExpTiming.lineTimePs != 0) {
+        GC02M1B_SetExposureTiming(pGC02M1BCtx, pGC02M1BCtx->ExpTiming.lineTimePs);
+    }
+
+    TRACE(GC02M1B_INFO, "%s: %d, max integration %fs\n", __func__, enable, pGC02M1BCtx->AecMaxIntegrationTime);
+    return (RET_SUCCESS);
+}
+
+RESULT GC02M1B_IsiGetGainSplitIss(IsiSensorHandle_t handle, float gain, SensorGainSplit_t *pSplit)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pSplit == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorGainArbitrate(&pGC02M1BCtx->GainArbiter, &pGC02M1BCtx->GainLut, pGC02M1BCtx->AecCurGain, gain, pSplit);
+
+    return (RET_SUCCESS);
+}
+
+RESULT GC02M1B_IsiInitSensorAsyncIss(IsiSensorHandle_t handle, SensorInitDone_t done, void *pUser)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorInitAsyncStart(&pGC02M1BCtx->InitAsync, GC02M1B_IsiInitSensorIss, handle, done, pUser);
+}
+
+RESULT GC02M1B_IsiGetInitStatusIss(IsiSensorHandle_t handle, SensorInitStatus_t *pStatus)
+{
+    GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
+
+    if (pGC02M1BCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pStatus == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorInitAsyncQuery(&pGC02M1BCtx->InitAsync, pStatus);
+
+    return (RET_SUCCESS);
+}
+
 RESULT GC02M1B_IsiGetSensorFpsIss(IsiSensorHandle_t handle, uint32_t * pfps)
 {
     GC02M1B_Context_t *pGC02M1BCtx = (GC02M1B_Context_t *) handle;
@@ -1500,11 +1939,15 @@ RESULT GC02M1B_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
+        pGC02M1BCtx->CurrFps = fps;
 
         ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pGC02M1BCtx->SensorMode));
-        {
+        if (ret == 0) {
             pGC02M1BCtx->MaxIntegrationLine = pGC02M1BCtx->SensorMode.ae_info.max_integration_time;
-            pGC02M1BCtx->AecMaxIntegrationTime = pGC02M1BCtx->MaxIntegrationLine * pGC02M1BCtx->one_line_exp_time;
+            /* the line time comes with the AE info only, unknown it stays 0 */
+            if (pGC02M1BCtx->ExpTiming.lineTimePs != 0) {
+                GC02M1B_SetExposureTiming(pGC02M1BCtx, pGC02M1BCtx->ExpTiming.lineTimePs);
+            }
         }
 #ifdef SUBDEV_CHAR
         struct vvcam_ae_info_s ae_info;
@@ -1515,12 +1958,8 @@ RESULT GC02M1B_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
-        pGC02M1BCtx->one_line_exp_time =
-            (float)ae_info.one_line_exp_time_ns / 1000000000;
         pGC02M1BCtx->MaxIntegrationLine = ae_info.max_integration_time;
-        pGC02M1BCtx->AecMaxIntegrationTime =
-            pGC02M1BCtx->MaxIntegrationLine *
-            pGC02M1BCtx->one_line_exp_time;
+        GC02M1B_SetExposureTiming(pGC02M1BCtx, ae_info.one_line_exp_time_ns * SENSOR_EXPOSURE_PS_PER_NS);
 #endif
     }
 
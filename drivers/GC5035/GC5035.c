@@ -35,13 +35,19 @@ CREATE_TRACER( GC5035_REG_DEBUG, "GC5035: ", INFO, 0);
 #define GC5035_MIN_GAIN_STEP    ( 1.0f/16.0f )  /**< min gain step size used by GUI (hardware min = 1/16; 1/16..32/16 depending on actual gain ) */
 #define GC5035_MAX_GAIN_AEC     ( 32.0f )       /**< max. gain used by the AEC (arbitrarily chosen, hardware limit = 62.0, driver limit = 32.0 ) */
 #define GC5035_VS_MAX_INTEGRATION_TIME (0.0018)
+#define GC5035_VTS_MAX 0x3fff
 
 /*****************************************************************************
  *Sensor Info
 *****************************************************************************/
 static const char SensorName[16] = "GC5035";
 
-static struct vvcam_mode_info pgc5035_mode_info[] = {
+/* frames until a shutter, gain and VTS write is in force; unverified: the
+   datasheet gives no latencies, these are the usual 2/1/2 of sensors with a
+   double-buffered shutter and not measured on the GC5035 */
+static const SensorLatency_t GC5035_Latency = { .exposure = 2, .gain = 1, .vts = 2 };
+
+static const struct vvcam_mode_info pgc5035_mode_info[] = {
     {
         .index     = 0,
         .width     = 640,
@@ -337,11 +343,29 @@ static RESULT GC5035_IsiGetSensorModeIss(IsiSensorHandle_t handle,void *mode)
     return ( RET_SUCCESS );
 }
 
+static RESULT GC5035_IsiGetRegCfgIss(const char *registerFileName, struct vvcam_sccb_array *arry);
+static RESULT GC5035_IsiCheckSensorConnectionIss(IsiSensorHandle_t handle);
+
+/* written at runtime, never a warm restart signature */
+static const uint32_t GC5035_WarmVolatileRegs[] = {
+    0x0003, 0x0004, 0x003e, 0x0041, 0x0042, 0x00b1, 0x00b2, 0x00b6,
+    0x30a0, 0x30a1, 0x30a2, 0x30a3, 0x30a4, 0x30a5, 0x30a6, 0x30a7,
+};
+
+static const SensorWarmOps_t GC5035_WarmOps = {
+    .read          = GC5035_IsiRegisterReadIss,
+    .write         = GC5035_IsiRegisterWriteIss,
+    .pageReg       = 0xfe,
+    .pVolatile     = GC5035_WarmVolatileRegs,
+    .volatileCount = sizeof(GC5035_WarmVolatileRegs) / sizeof(GC5035_WarmVolatileRegs[0]),
+};
+
 static RESULT GC5035_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     RESULT result = RET_SUCCESS;
     GC5035_Context_t *pGC5035Ctx;
 
     TRACE(GC5035_INFO, "%s (enter)\n", __func__);
+    uint64_t createSpan = SensorTraceBegin();
 
     if (!pConfig || !pConfig->pSensor)
         return (RET_NULL_POINTER);
@@ -361,6 +385,15 @@ static RESULT GC5035_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         return (result);
     }
 
+    /* 1x..16x, AecMaxGain of every mode */
+    result = SensorGainLutInit(&pGC5035Ctx->GainLut, SENSOR_GAIN_LUT_ONE, 16 * SENSOR_GAIN_LUT_ONE, GC5035_QuantizeGain);
+    if (result != RET_SUCCESS) {
+        (void)HalDelRef(pConfig->HalHandle);
+        free(pGC5035Ctx);
+        return (result);
+    }
+
+    SensorLatencySchedInit(&pGC5035Ctx->LatencySched, &GC5035_Latency);
     pGC5035Ctx->IsiCtx.HalHandle = pConfig->HalHandle;
     pGC5035Ctx->IsiCtx.pSensor = pConfig->pSensor;
     pGC5035Ctx->GroupHold = BOOL_FALSE;
@@ -370,10 +403,11 @@ static RESULT GC5035_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     pGC5035Ctx->Streaming = BOOL_FALSE;
     pGC5035Ctx->TestPattern = BOOL_FALSE;
     pGC5035Ctx->isAfpsRun = BOOL_FALSE;
+    pGC5035Ctx->DgainRatio = 256;
     pGC5035Ctx->SensorMode.index = pConfig->SensorModeIndex;
     pConfig->hSensor = (IsiSensorHandle_t) pGC5035Ctx;
 #ifdef SUBDEV_CHAR
-    struct vvcam_mode_info *SensorDefaultMode = NULL;
+    const struct vvcam_mode_info *SensorDefaultMode = NULL;
     for (int i=0; i < sizeof(pgc5035_mode_info)/ sizeof(struct vvcam_mode_info); i++)
     {
         if (pgc5035_mode_info[i].index == pGC5035Ctx->SensorMode.index)
@@ -416,9 +450,16 @@ static RESULT GC5035_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
                 break;
         }
 
-        if (access(pGC5035Ctx->SensorRegCfgFile, F_OK) == 0) {
+        if (SensorBundleOpen(SensorName, SensorDefaultMode->index, &pGC5035Ctx->ModeBundle) == RET_SUCCESS ||
+            access(pGC5035Ctx->SensorRegCfgFile, F_OK) == 0) {
             pGC5035Ctx->KernelDriverFlag = 0;
             memcpy(&(pGC5035Ctx->SensorMode),SensorDefaultMode,sizeof(struct vvcam_mode_info));
+            /* read the mode data while the sensor powers up */
+            (void)SensorPrefetchStart(&pGC5035Ctx->Prefetch, &pGC5035Ctx->ModeBundle, pGC5035Ctx->SensorRegCfgFile, GC5035_IsiGetRegCfgIss);
+            if (SensorBundleIsOpen(&pGC5035Ctx->ModeBundle)) {
+                (void)SensorProfileSetInit(&pGC5035Ctx->TuningProfiles, &pGC5035Ctx->ModeBundle);
+                (void)SensorGainLutCalibrate(&pGC5035Ctx->GainLut, &pGC5035Ctx->ModeBundle);
+            }
         } else {
             pGC5035Ctx->KernelDriverFlag = 1;
         }
@@ -427,9 +468,12 @@ static RESULT GC5035_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         pGC5035Ctx->KernelDriverFlag = 1;
     }
 
+    uint64_t span = SensorTraceBegin();
     result = GC5035_IsiSensorSetPowerIss(pGC5035Ctx, BOOL_TRUE);
+    SensorTraceEnd(SensorName, "power", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
+    span = SensorTraceBegin();
     uint32_t SensorClkIn = 0;
     if (pGC5035Ctx->KernelDriverFlag) {
         result = GC5035_IsiSensorGetClkIss(pGC5035Ctx, &SensorClkIn);
@@ -437,19 +481,33 @@ static RESULT GC5035_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     }
 
     result = GC5035_IsiSensorSetClkIss(pGC5035Ctx, SensorClkIn);
+    SensorTraceEnd(SensorName, "clk", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
-    result = GC5035_IsiResetSensorIss(pGC5035Ctx);
-    RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
-
-    pGC5035Ctx->pattern = ISI_BPAT_BGBGGRGR;
-
     if (!pGC5035Ctx->KernelDriverFlag) {
+        span = SensorTraceBegin();
         result = GC5035_IsiConfigSensorSCCBIss(pGC5035Ctx);
+        SensorTraceEnd(SensorName, "sccb", span);
         RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
     }
+
+    span = SensorTraceBegin();
+    /* a sensor a previous process left in this mode still holds its registers */
+    if (pGC5035Ctx->KernelDriverFlag ||
+        SensorWarmOpen(&pGC5035Ctx->Warm, SensorName, ((HalContext_t *)pGC5035Ctx->IsiCtx.HalHandle)->sensor_fd,
+                       &GC5035_WarmOps, pGC5035Ctx) != RET_SUCCESS ||
+        GC5035_IsiCheckSensorConnectionIss(pGC5035Ctx) != RET_SUCCESS ||
+        SensorWarmProbe(&pGC5035Ctx->Warm, pGC5035Ctx->SensorMode.index) != RET_SUCCESS) {
+        SensorWarmInvalidate(&pGC5035Ctx->Warm);
+        result = GC5035_IsiResetSensorIss(pGC5035Ctx);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+    SensorTraceEnd(SensorName, "reset", span);
+
+    pGC5035Ctx->pattern = ISI_BPAT_BGBGGRGR;
 #endif
 
+    SensorTraceEnd(SensorName, "create", createSpan);
     TRACE(GC5035_INFO, "%s (exit pConfig->hSensor = %p)\n", __func__, pConfig->hSensor);
     return (result);
 }
@@ -505,42 +563,98 @@ static RESULT GC5035_IsiGetRegCfgIss(const char *registerFileName,
     return 0;
 }
 
+static uint32_t GC5035_MaxFrameLengthLines(GC5035_Context_t *pGC5035Ctx)
+{
+    if (!pGC5035Ctx->AutoFrameLength || pGC5035Ctx->MinFps == 0) {
+        return pGC5035Ctx->FrameLengthLines;
+    }
+
+    return MIN((uint32_t)pGC5035Ctx->FrameLengthLines * pGC5035Ctx->MaxFps / pGC5035Ctx->MinFps, GC5035_VTS_MAX);
+}
+
+static void GC5035_SetExposureTiming(GC5035_Context_t *pGC5035Ctx, uint32_t lineTimePs)
+{
+    SensorExposureTiming_t *pTiming = &pGC5035Ctx->ExpTiming;
+
+    /* with auto frame length the frame end moves out, the margin to it stays */
+    SensorExposureTimingSet(pTiming, lineTimePs, pGC5035Ctx->MinIntegrationLine,
+                            pGC5035Ctx->MaxIntegrationLine + GC5035_MaxFrameLengthLines(pGC5035Ctx) - pGC5035Ctx->FrameLengthLines);
+    pGC5035Ctx->one_line_exp_time           = (float)lineTimePs / 1e12f;
+    pGC5035Ctx->AecIntegrationTimeIncrement = SensorExposureLinesToTime(pTiming, 1);
+    pGC5035Ctx->AecMinIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->minLines);
+    pGC5035Ctx->AecMaxIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->maxLines);
+}
+
 static RESULT GC5035_IsiInitSensorIss(IsiSensorHandle_t handle) {
     RESULT result = RET_SUCCESS;
 
     int ret = 0;
+    uint32_t lineTimePs = 0;
     GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
 
     HalContext_t *pHalCtx = (HalContext_t *) pGC5035Ctx->IsiCtx.HalHandle;
     TRACE(GC5035_INFO, "%s (enter handle = %p)\n", __func__, handle);
+    uint64_t initSpan = SensorTraceBegin();
 
     if (pGC5035Ctx == NULL) {
         return (RET_WRONG_HANDLE);
     }
 	TRACE(GC5035_INFO, "%s (pGC5035Ctx->KernelDriverFlag = %d)\n", __func__, pGC5035Ctx->KernelDriverFlag);
     if (pGC5035Ctx->KernelDriverFlag) {
-        ;
+        /* the kernel driver set the mode up, its frame rate is the one in force */
+        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pGC5035Ctx->SensorMode));
+        if (ret != 0) {
+            TRACE(GC5035_ERROR, "%s:sensor get mode info error!\n",
+                  __func__);
+            return (RET_FAILURE);
+        }
+        pGC5035Ctx->MaxFps  = pGC5035Ctx->SensorMode.fps;
+        pGC5035Ctx->MinFps  = 1;
+        pGC5035Ctx->CurrFps = pGC5035Ctx->MaxFps;
     } else {
 		TRACE(GC5035_INFO, "%s (001)\n", __func__);
         struct vvcam_sccb_array arry;
-        result = GC5035_IsiGetRegCfgIss(pGC5035Ctx->SensorRegCfgFile, &arry);
+        uint64_t span = SensorTraceBegin();
+        SensorPrefetchWait(&pGC5035Ctx->Prefetch);
+        if (SensorBundleIsOpen(&pGC5035Ctx->ModeBundle)) {
+            result = SensorBundleGetRegArray(&pGC5035Ctx->ModeBundle, &arry);
+        } else if (SensorPrefetchTakeRegs(&pGC5035Ctx->Prefetch, &arry) != RET_SUCCESS) {
+            result = GC5035_IsiGetRegCfgIss(pGC5035Ctx->SensorRegCfgFile, &arry);
+        }
+        SensorTraceEnd(SensorName, "load", span);
         if (result != 0) {
             TRACE(GC5035_ERROR,
                   "%s:GC5035_IsiGetRegCfgIss error!\n", __func__);
             return (RET_FAILURE);
         }
 
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &arry);
-        if (ret != 0) {
-            TRACE(GC5035_ERROR, "%s:Sensor Write Reg arry error!\n",
-                  __func__);
-            return (RET_FAILURE);
+        bool_t warm = pGC5035Ctx->Warm.resumed;
+        uint64_t regHash = SensorBundleHash(arry.sccb_data, arry.count * sizeof(struct vvcam_sccb_data),
+                                            SENSOR_BUNDLE_FNV_SEED);
+        if (SensorWarmResume(&pGC5035Ctx->Warm, regHash)) {
+            TRACE(GC5035_INFO, "%s: warm restart, register set skipped\n", __func__);
+        } else {
+            if (warm) {
+                /* create skipped the reset, but the register set changed since */
+                result = GC5035_IsiResetSensorIss(pGC5035Ctx);
+                RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+            }
+
+            span = SensorTraceBegin();
+            ret = SensorInitWriteRegs(&pGC5035Ctx->InitAsync, pHalCtx->sensor_fd, &arry);
+            SensorTraceEnd(SensorName, "write", span);
+            if (ret != 0) {
+                TRACE(GC5035_ERROR, "%s:Sensor Write Reg arry error!\n",
+                      __func__);
+                return (RET_FAILURE);
+            }
+            (void)SensorWarmCommit(&pGC5035Ctx->Warm, pGC5035Ctx->SensorMode.index, regHash, &arry);
         }
 		TRACE(GC5035_INFO, "%s (pGC5035Ctx->SensorMode.index = %d)\n", __func__, pGC5035Ctx->SensorMode.index);
         switch(pGC5035Ctx->SensorMode.index)
         {
             case 0: // 480p
-                pGC5035Ctx->one_line_exp_time = 0.0000167; // line_time = line_length / pclk =1460/87.6mhz = 0.0000167
+                lineTimePs = 16700000; // line_time = line_length / pclk =1460/87.6mhz = 0.0000167
                 pGC5035Ctx->FrameLengthLines = 0x7cc; //framelength=1996=0x7cc
                 pGC5035Ctx->CurFrameLengthLines = pGC5035Ctx->FrameLengthLines;
                 pGC5035Ctx->MaxIntegrationLine = pGC5035Ctx->CurFrameLengthLines - 8;
@@ -549,7 +663,7 @@ static RESULT GC5035_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pGC5035Ctx->AecMinGain = 1;
                 break;
             case 1: // 1080p
-                pGC5035Ctx->one_line_exp_time = 0.0000167; // line_time = line_length / pclk =2920/175.2mhz = 0.00001667
+                lineTimePs = 16700000; // line_time = line_length / pclk =2920/175.2mhz = 0.00001667
                 pGC5035Ctx->FrameLengthLines = 0x7D8; //framelength=2008=0x7D8
                 pGC5035Ctx->CurFrameLengthLines = pGC5035Ctx->FrameLengthLines;
                 pGC5035Ctx->MaxIntegrationLine = pGC5035Ctx->CurFrameLengthLines - 8;
@@ -558,7 +672,7 @@ static RESULT GC5035_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pGC5035Ctx->AecMinGain = 1;
                 break;
             case 2: // full size
-                pGC5035Ctx->one_line_exp_time = 0.0000167; // line_time = line_length / pclk =2920/175.2mhz = 0.00001667
+                lineTimePs = 16700000; // line_time = line_length / pclk =2920/175.2mhz = 0.00001667
                 pGC5035Ctx->FrameLengthLines = 0x7D8; //framelength=2008=0x7D8
                 pGC5035Ctx->CurFrameLengthLines = pGC5035Ctx->FrameLengthLines;
                 pGC5035Ctx->MaxIntegrationLine = pGC5035Ctx->CurFrameLengthLines - 8;
@@ -567,7 +681,7 @@ static RESULT GC5035_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pGC5035Ctx->AecMinGain = 1;
                 break;
             case 3: // 1296x972
-                pGC5035Ctx->one_line_exp_time = 0.0000167; // line_time = line_length / pclk =2920/175.2mhz = 0.00001667
+                lineTimePs = 16700000; // line_time = line_length / pclk =2920/175.2mhz = 0.00001667
                 pGC5035Ctx->FrameLengthLines = 0x7D8; //framelength=2008=0x7D8
                 pGC5035Ctx->CurFrameLengthLines = pGC5035Ctx->FrameLengthLines;
                 pGC5035Ctx->MaxIntegrationLine = pGC5035Ctx->CurFrameLengthLines - 8;
@@ -577,7 +691,7 @@ static RESULT GC5035_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 break;
             case 4: // 720p@30fps
             case 5: // 720p@60fps
-                pGC5035Ctx->one_line_exp_time = 0.0000167; // line_time = line_length / pclk =2920/175.2mhz = 0.00001667
+                lineTimePs = 16700000; // line_time = line_length / pclk =2920/175.2mhz = 0.00001667
                 pGC5035Ctx->FrameLengthLines = 0x7D8; //framelength=2008=0x7D8
                 pGC5035Ctx->CurFrameLengthLines = pGC5035Ctx->FrameLengthLines;
                 pGC5035Ctx->MaxIntegrationLine = pGC5035Ctx->CurFrameLengthLines - 8;
@@ -588,17 +702,29 @@ static RESULT GC5035_IsiInitSensorIss(IsiSensorHandle_t handle) {
             default:
                 return (RET_FAILURE);
         }
-		pGC5035Ctx->AecIntegrationTimeIncrement = pGC5035Ctx->one_line_exp_time;
-		pGC5035Ctx->AecMinIntegrationTime =
-			pGC5035Ctx->one_line_exp_time * pGC5035Ctx->MinIntegrationLine;
-		pGC5035Ctx->AecMaxIntegrationTime =
-			pGC5035Ctx->one_line_exp_time * pGC5035Ctx->MaxIntegrationLine;
+        GC5035_SetExposureTiming(pGC5035Ctx, lineTimePs);
 
 
         pGC5035Ctx->MaxFps  = pGC5035Ctx->SensorMode.fps;
         pGC5035Ctx->MinFps  = 1;
         pGC5035Ctx->CurrFps = pGC5035Ctx->MaxFps;
     }
+
+    /* the tuning may allow the sensor less gain than the mode can do */
+    pGC5035Ctx->AecMaxGain = SensorGainArbiterInit(&pGC5035Ctx->GainArbiter, &pGC5035Ctx->TuningProfiles, pGC5035Ctx->AecMaxGain);
+
+    if (pGC5035Ctx->Warm.resumed) {
+        float gain, integrationTime, hdrRatio, setGain, setIntegrationTime;
+        uint8_t skip;
+
+        /* carry on with the exposure the sensor streamed with */
+        if (SensorWarmLastExposure(&pGC5035Ctx->Warm, &gain, &integrationTime, &hdrRatio)) {
+            (void)GC5035_IsiExposureControlIss(handle, gain, integrationTime, &skip,
+                                               &setGain, &setIntegrationTime, &hdrRatio);
+        }
+    }
+
+    SensorTraceEnd(SensorName, "init", initSpan);
     TRACE(GC5035_INFO, "%s (pGC5035Ctx->one_line_exp_time = %f)\n", __func__, pGC5035Ctx->one_line_exp_time);
     TRACE(GC5035_INFO, "%s (pGC5035Ctx->MinIntegrationLine = %d, pGC5035Ctx->MaxIntegrationLine = %d)\n", __func__, pGC5035Ctx->MinIntegrationLine, pGC5035Ctx->MaxIntegrationLine);
     return (result);
@@ -612,10 +738,20 @@ static RESULT GC5035_IsiReleaseSensorIss(IsiSensorHandle_t handle) {
     if (pGC5035Ctx == NULL)
         return (RET_WRONG_HANDLE);
 
+    /* an initialization still running in the background uses the context */
+    (void)SensorInitAsyncWait(&pGC5035Ctx->InitAsync);
+
     (void)GC5035_IsiSensorSetStreamingIss(pGC5035Ctx, BOOL_FALSE);
     (void)GC5035_IsiSensorSetPowerIss(pGC5035Ctx, BOOL_FALSE);
     (void)HalDelRef(pGC5035Ctx->IsiCtx.HalHandle);
 
+    SensorWarmClose(&pGC5035Ctx->Warm, BOOL_TRUE);
+
+    SensorPrefetchRelease(&pGC5035Ctx->Prefetch);
+    SensorLatencySchedRelease(&pGC5035Ctx->LatencySched);
+    (void)SensorBundleClose(&pGC5035Ctx->ModeBundle);
+    SensorGainLutRelease(&pGC5035Ctx->GainLut);
+
     MEMSET(pGC5035Ctx, 0, sizeof(GC5035_Context_t));
     free(pGC5035Ctx);
     TRACE(GC5035_INFO, "%s (exit)\n", __func__);
@@ -637,6 +773,7 @@ static RESULT GC5035_IsiSetupSensorIss
     RESULT result = RET_SUCCESS;
 
     TRACE(GC5035_INFO, "%s: (enter)\n", __func__);
+    uint64_t setupSpan = SensorTraceBegin();
 
     if (!pGC5035Ctx) {
         TRACE(GC5035_ERROR,
@@ -660,7 +797,9 @@ static RESULT GC5035_IsiSetupSensorIss
 
     /* 1.) SW reset of image sensor (via I2C register interface)  be careful, bits 6..0 are reserved, reset bit is not sticky */
     TRACE(GC5035_DEBUG, "%s: GC5035 System-Reset executed\n", __func__);
+    uint64_t span = SensorTraceBegin();
     osSleep(100);
+    SensorTraceEnd(SensorName, "settle", span);
 
     //GC5035_AecSetModeParameters not defined yet as of 2021/8/9.
     //result = GC5035_AecSetModeParameters(pGC5035Ctx, pConfig);
@@ -677,6 +816,7 @@ static RESULT GC5035_IsiSetupSensorIss
     ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);//result = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);
 #endif
     pGC5035Ctx->Configured = BOOL_TRUE;
+    SensorTraceEnd(SensorName, "setup", setupSpan);
     TRACE(GC5035_INFO, "%s: (exit) ret=0x%x \n", __func__, result);
     return result;
 }
@@ -699,6 +839,7 @@ static RESULT GC5035_IsiSensorSetStreamingIss
     RESULT result = RET_SUCCESS;
     int ret = 0;
     TRACE(GC5035_INFO, "%s (enter)\n", __func__);
+    uint64_t streamSpan = SensorTraceBegin();
 
     GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
     if (pGC5035Ctx == NULL || pGC5035Ctx->IsiCtx.HalHandle == NULL) {
@@ -728,6 +869,7 @@ static RESULT GC5035_IsiSensorSetStreamingIss
 
     pGC5035Ctx->Streaming = on;
 
+    SensorTraceEnd(SensorName, on ? "stream on" : "stream off", streamSpan);
     TRACE(GC5035_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -853,7 +995,7 @@ static RESULT GC5035_IsiGetIntegrationTimeLimitsIss
     }
 
     *pMinIntegrationTime = pGC5035Ctx->AecMinIntegrationTime;
-    *pMaxIntegrationTime = pGC5035Ctx->AecMaxIntegrationTime;
+    *pMaxIntegrationTime = SensorAntiFlickerSnapTime(&pGC5035Ctx->AntiFlicker, pGC5035Ctx->AecMaxIntegrationTime);
 
     TRACE(GC5035_INFO, "%s: (exit)\n", __func__);
     return (result);
@@ -949,7 +1091,7 @@ RESULT GC5035_IsiGetGainIncrementIss(IsiSensorHandle_t handle, float *pIncr) {
     return (result);
 }
 
-uint16_t GC5035_AGC_Param[17][2] = {
+static const uint16_t GC5035_AGC_Param[17][2] = {
 	{  256,  0 },
 	{  302,  1 },
 	{  358,  2 },
@@ -968,7 +1110,21 @@ uint16_t GC5035_AGC_Param[17][2] = {
 	{ 3318, 19 },
 	{ 3994, 20 },
 };
-static uint32_t Dgain_ratio = 256;
+
+static void GC5035_QuantizeGain(uint32_t gain, SensorGainCode_t *pCode)
+{
+    int gain_index;
+
+    for (gain_index = 16; gain_index > 0; gain_index--) {
+        if (gain >= GC5035_AGC_Param[gain_index][0])
+            break;
+    }
+
+    pCode->again = GC5035_AGC_Param[gain_index][1];
+    pCode->dgain = gain * 256 / GC5035_AGC_Param[gain_index][0];
+    /* 0xb1/0xb2 drop the two lsbs of the digital gain */
+    pCode->gain  = GC5035_AGC_Param[gain_index][0] * (pCode->dgain & 0xffc) / 256;
+}
 
 RESULT GC5035_IsiSetGainIss
     (IsiSensorHandle_t handle,
@@ -976,54 +1132,37 @@ RESULT GC5035_IsiSetGainIss
 
     RESULT result = RET_SUCCESS;
     int32_t ret = 0;
-    uint32_t temp_gain;
-    uint16_t gain_index;
+    const SensorGainCode_t *pCode;
 
     GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
     if (pGC5035Ctx == NULL || pGC5035Ctx->IsiCtx.HalHandle == NULL) {
         return RET_NULL_POINTER;
     }
 
-    if (NewGain >= 16) { // More than 16 will not take effect
-        NewGain = 16;
-    }
-
     HalContext_t *pHalCtx = (HalContext_t *) pGC5035Ctx->IsiCtx.HalHandle;
-    //GC5035 specific
-    uint32_t SensorGain = 0;
-    SensorGain = NewGain * 256; // pGC5035Ctx->gain_accuracy;
-	if (SensorGain < 256) {     //min gain=1x
-		SensorGain = 256;
-        NewGain = 1;
-    } else if (SensorGain > 16*256)  {   //max gain=16x
-        SensorGain = 16*256;
-        NewGain = 16;
-    }
-	for (gain_index = 16; gain_index >= 0; gain_index--) {
-		if (SensorGain >= GC5035_AGC_Param[gain_index][0])
-			break;
-    }
+    //GC5035 specific, 1x..16x; the shutter rounding compensation goes into the lookup, not onto the codes
+    pCode = SensorGainLutLookup(&pGC5035Ctx->GainLut, NewGain * pGC5035Ctx->DgainRatio / 256.0f);
+
     ret = GC5035_IsiRegisterWriteIss(handle, 0xfe, 0x00);
     if (ret != 0) {
         return (RET_FAILURE);
     }
-    ret = GC5035_IsiRegisterWriteIss(handle, 0xb6, GC5035_AGC_Param[gain_index][1]);
+    ret = GC5035_IsiRegisterWriteIss(handle, 0xb6, pCode->again);
     if (ret != 0) {
         return (RET_FAILURE);
     }
-	temp_gain = SensorGain*Dgain_ratio / GC5035_AGC_Param[gain_index][0];
-    ret = GC5035_IsiRegisterWriteIss(handle, 0xb1, (temp_gain >> 8) & 0x0f);
+    ret = GC5035_IsiRegisterWriteIss(handle, 0xb1, (pCode->dgain >> 8) & 0x0f);
     if (ret != 0) {
         return (RET_FAILURE);
     }
-    ret = GC5035_IsiRegisterWriteIss(handle, 0xb2, temp_gain & 0xfc);
+    ret = GC5035_IsiRegisterWriteIss(handle, 0xb2, pCode->dgain & 0xfc);
     if (ret != 0) {
         return (RET_FAILURE);
     }
 
     volatile int32_t reg;
-    TRACE(GC5035_DEBUG, "%s gain_index=%d,[gain_index][0]=%d,Dgain_ratio=%u\n",__func__, gain_index, GC5035_AGC_Param[gain_index][0], Dgain_ratio);
-    TRACE(GC5035_DEBUG, "%s temp_gain=0x%x,0xb1 write 0x%x,0xb2 write 0x%x\n",__func__, temp_gain, (temp_gain >> 8) & 0x0f, temp_gain & 0xfc);
+    TRACE(GC5035_DEBUG, "%s again=%u,dgain=%u,gain=%u,Dgain_ratio=%u\n",__func__, pCode->again, pCode->dgain, pCode->gain, pGC5035Ctx->DgainRatio);
+    TRACE(GC5035_DEBUG, "%s dgain=0x%x,0xb1 write 0x%x,0xb2 write 0x%x\n",__func__, pCode->dgain, (pCode->dgain >> 8) & 0x0f, pCode->dgain & 0xfc);
     GC5035_IsiRegisterReadIss(handle, 0xb6, &reg);
     TRACE(GC5035_DEBUG, "%s 0xb6 read 0x0%x\n",__func__, reg);
     GC5035_IsiRegisterReadIss(handle, 0xb1, &reg);
@@ -1031,7 +1170,7 @@ RESULT GC5035_IsiSetGainIss
     GC5035_IsiRegisterReadIss(handle, 0xb2, &reg);
     TRACE(GC5035_DEBUG, "%s 0xb2 read 0x0%x\n",__func__, reg);
 
-    pGC5035Ctx->AecCurGain = ((float)(NewGain));
+    pGC5035Ctx->AecCurGain = (float)pCode->gain / SENSOR_GAIN_LUT_ONE;
     *pSetGain = pGC5035Ctx->AecCurGain;
     TRACE(GC5035_DEBUG, "%s: g=%f\n", __func__, *pSetGain);
     return (result);
@@ -1288,7 +1427,6 @@ RESULT GC5035_IsiSetIntegrationTimeIss
 
     uint32_t exp_line = 0;
     uint32_t cal_shutter = 0;
-    uint32_t exp_line_old = 0;
     int ret = 0;
 
     TRACE(GC5035_INFO, "%s: (enter handle = %p)\n", __func__, handle);
@@ -1306,35 +1444,30 @@ RESULT GC5035_IsiSetIntegrationTimeIss
               __func__);
         return (RET_NULL_POINTER);
     }
-    exp_line = NewIntegrationTime / pGC5035Ctx->one_line_exp_time;
-    exp_line_old = exp_line;
-    exp_line =
-        MIN(pGC5035Ctx->MaxIntegrationLine,
-        MAX(pGC5035Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pGC5035Ctx->ExpTiming, NewIntegrationTime);
 
     TRACE(GC5035_DEBUG, "%s: set AEC_PK_EXPO=0x%05x min_exp_line = %d, max_exp_line = %d\n", __func__, exp_line, pGC5035Ctx->MinIntegrationLine, pGC5035Ctx->MaxIntegrationLine);
 
+    // GC5035 specific
+    cal_shutter = exp_line >> 2;
+    cal_shutter = cal_shutter << 2;//保证为4的整数倍
+
     if (exp_line != pGC5035Ctx->OldIntegrationTime) {
 
         /*TODO*/
         //ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_EXP, &exp_line);
         pGC5035Ctx->OldIntegrationTime = exp_line;    // remember current integration time
+        /* the shutter written, the rest is made up by DgainRatio in SetGain */
         pGC5035Ctx->AecCurIntegrationTime =
-            exp_line * pGC5035Ctx->one_line_exp_time;
+            SensorExposureLinesToTime(&pGC5035Ctx->ExpTiming, cal_shutter);
 
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
         *pNumberOfFramesToSkip = 0U;    //no frame skip
     }
 
-    if (NewIntegrationTime > pGC5035Ctx->MaxIntegrationLine * pGC5035Ctx->one_line_exp_time)
-        NewIntegrationTime = pGC5035Ctx->MaxIntegrationLine * pGC5035Ctx->one_line_exp_time;
-    
-    // GC5035 specific
-    cal_shutter = exp_line >> 2;
-    cal_shutter = cal_shutter << 2;//保证为4的整数倍
     if (cal_shutter != 0) {
-        Dgain_ratio = 256 * exp_line / cal_shutter;
+        pGC5035Ctx->DgainRatio = 256 * exp_line / cal_shutter;
     }
     ret = GC5035_IsiRegisterWriteIss(handle, 0xfe, 0x00);
     if (ret != 0) {
@@ -1351,18 +1484,14 @@ RESULT GC5035_IsiSetIntegrationTimeIss
 
     volatile int32_t reg;
     TRACE(GC5035_DEBUG, "%s exp_line = %fs / %fs = %d\n",__func__, NewIntegrationTime,  pGC5035Ctx->one_line_exp_time, exp_line);
-    TRACE(GC5035_DEBUG, "%s cal_shutter=%d,Dgain_ratio=%u\n", __func__, cal_shutter, Dgain_ratio);
+    TRACE(GC5035_DEBUG, "%s cal_shutter=%d,Dgain_ratio=%u\n", __func__, cal_shutter, pGC5035Ctx->DgainRatio);
     TRACE(GC5035_DEBUG, "%s 0x03 write 0x%x, 0x04 write 0x%x\n", __func__, (cal_shutter >> 8) & 0x3F, cal_shutter & 0xFF);
     GC5035_IsiRegisterReadIss(handle, 0x03, &reg);
     TRACE(GC5035_DEBUG, "%s 0x03 read 0x0%x\n",__func__, reg);
     GC5035_IsiRegisterReadIss(handle, 0x04, &reg);
     TRACE(GC5035_DEBUG, "%s 0x04 read 0x0%x\n",__func__, reg);
 
-    if (exp_line_old != exp_line) {
-        *pSetIntegrationTime = pGC5035Ctx->AecCurIntegrationTime;
-    } else {
-        *pSetIntegrationTime = NewIntegrationTime;
-    }
+    *pSetIntegrationTime = pGC5035Ctx->AecCurIntegrationTime;
 
     TRACE(GC5035_DEBUG, "%s: Ti=%f\n", __func__, *pSetIntegrationTime);
     TRACE(GC5035_INFO, "%s: (exit)\n", __func__);
@@ -1383,8 +1512,7 @@ RESULT GC5035_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integr
     HalContext_t *pHalCtx = (HalContext_t *) pGC5035Ctx->IsiCtx.HalHandle;
 
     uint32_t exp_line = 0;
-    exp_line = IntegrationTime / pGC5035Ctx->one_line_exp_time;
-    exp_line = MIN(pGC5035Ctx->MaxIntegrationLine, MAX(pGC5035Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pGC5035Ctx->ExpTiming, IntegrationTime);
 
     if (exp_line != pGC5035Ctx->LastLongExpLine)
     {
@@ -1399,7 +1527,7 @@ RESULT GC5035_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integr
         }
 
         pGC5035Ctx->LastLongExpLine = exp_line;
-        pGC5035Ctx->AecCurLongIntegrationTime =  pGC5035Ctx->LastLongExpLine*pGC5035Ctx->one_line_exp_time;
+        pGC5035Ctx->AecCurLongIntegrationTime =  SensorExposureLinesToTime(&pGC5035Ctx->ExpTiming, pGC5035Ctx->LastLongExpLine);
     }
 
 
@@ -1439,10 +1567,7 @@ RESULT GC5035_IsiSetVSIntegrationTimeIss
           pGC5035Ctx->AecMinIntegrationTime);
 
 
-    exp_line = NewIntegrationTime / pGC5035Ctx->one_line_exp_time;
-    exp_line =
-        MIN(pGC5035Ctx->MaxIntegrationLine,
-        MAX(pGC5035Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pGC5035Ctx->ExpTiming, NewIntegrationTime);
 
     if (exp_line != pGC5035Ctx->OldVsIntegrationTime) {
     /*TODO*/
@@ -1450,7 +1575,7 @@ RESULT GC5035_IsiSetVSIntegrationTimeIss
     } else if (1){
 
         pGC5035Ctx->OldVsIntegrationTime = exp_line;
-        pGC5035Ctx->AecCurVSIntegrationTime = exp_line * pGC5035Ctx->one_line_exp_time;    //remember current integration time
+        pGC5035Ctx->AecCurVSIntegrationTime = SensorExposureLinesToTime(&pGC5035Ctx->ExpTiming, exp_line);    //remember current integration time
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
         *pNumberOfFramesToSkip = 0U;    //no frame skip
@@ -1464,6 +1589,61 @@ RESULT GC5035_IsiSetVSIntegrationTimeIss
     return (result);
 }
 
+static RESULT GC5035_ApplyExposureSplit(GC5035_Context_t *pGC5035Ctx, const SensorExposureSplit_t *pSplit,
+                                        uint32_t *pFrame, uint32_t *pValidFrame)
+{
+    HalContext_t *pHalCtx = (HalContext_t *) pGC5035Ctx->IsiCtx.HalHandle;
+    uint32_t vts = MIN(MAX(pSplit->lines + pGC5035Ctx->FrameLengthLines - pGC5035Ctx->MaxIntegrationLine,
+                           (uint32_t)pGC5035Ctx->FrameLengthLines), GC5035_MaxFrameLengthLines(pGC5035Ctx));
+    struct vvcam_sccb_data shutter[] = {
+        { 0xfe, 0x00 },
+        { 0x41, (vts >> 8) & 0x3f },
+        { 0x42, vts & 0xff },
+        { 0x03, (pSplit->lines >> 8) & 0x3f },
+        { 0x04, pSplit->lines & 0xff },
+    };
+    struct vvcam_sccb_data gain[] = {
+        { 0xfe, 0x00 },
+        { 0xb6, pSplit->code.again },
+        { 0xb1, (pSplit->code.dgain >> 8) & 0x0f },
+        { 0xb2, pSplit->code.dgain & 0xfc },
+    };
+    struct vvcam_sccb_data *pShutter = shutter;
+    uint32_t shutterCount = sizeof(shutter) / sizeof(shutter[0]);
+    RESULT result;
+
+    if (vts == 0) {
+        TRACE(GC5035_ERROR, "%s: no frame length yet\n", __func__);
+        return (RET_WRONG_STATE);
+    }
+
+    /* VTS moves only when the shutter needs more than the frame has, or no
+       longer needs what an earlier exposure raised it to */
+    if (vts == pGC5035Ctx->CurFrameLengthLines) {
+        /* the frame length stays as it is: page select and shutter only */
+        shutter[2] = shutter[0];
+        pShutter   = &shutter[2];
+        shutterCount -= 2;
+    }
+
+    /* timed so shutter and gain are in force on the same frame */
+    result = SensorLatencySubmit(&pGC5035Ctx->LatencySched, pHalCtx->sensor_fd,
+                                 pShutter, shutterCount,
+                                 gain, sizeof(gain) / sizeof(gain[0]), pFrame, pValidFrame);
+    if (result != RET_SUCCESS) {
+        TRACE(GC5035_ERROR, "%s: write exposure registers error!\n", __func__);
+        return (result);
+    }
+
+    pGC5035Ctx->OldIntegrationTime    = pSplit->lines;
+    pGC5035Ctx->AecCurIntegrationTime = pSplit->integrationTime;
+    pGC5035Ctx->AecCurGain            = pSplit->gain;
+    pGC5035Ctx->CurFrameLengthLines   = vts;
+    pGC5035Ctx->CurrFps               = pGC5035Ctx->MaxFps * pGC5035Ctx->FrameLengthLines / vts;
+    pGC5035Ctx->DgainRatio            = 256;     /* lines is a multiple of 4 already */
+    return (RET_SUCCESS);
+}
+
 RESULT GC5035_IsiExposureControlIss
     (IsiSensorHandle_t handle,
      float NewGain,
@@ -1473,8 +1653,9 @@ RESULT GC5035_IsiExposureControlIss
 {
     GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
     RESULT result = RET_SUCCESS;
-    int TmpGain;
-    /*TODO*/
+    SensorExposureSplit_t split;
+    SensorFrameMeta_t meta;
+    uint32_t frame, validFrame;
 
     TRACE(GC5035_INFO, "%s: (enter)\n", __func__);
 
@@ -1496,16 +1677,56 @@ RESULT GC5035_IsiExposureControlIss
     TRACE(GC5035_ERROR, "%s: g=%f, Ti=%f\n", __func__, NewGain,
           NewIntegrationTime);
 
-    result = GC5035_IsiSetIntegrationTimeIss(handle, NewIntegrationTime,
-                        pSetIntegrationTime,
-                        pNumberOfFramesToSkip, hdr_ratio);
-    result = GC5035_IsiSetGainIss(handle, NewGain, pSetGain, hdr_ratio);
+    if (pGC5035Ctx->KernelDriverFlag) {
+        /* the kernel driver owns the sensor and its frame timing */
+        result = GC5035_IsiSetIntegrationTimeIss(handle, NewIntegrationTime, pSetIntegrationTime,
+                                                pNumberOfFramesToSkip, hdr_ratio);
+        if (result != RET_SUCCESS) {
+            return (result);
+        }
+        result = GC5035_IsiSetGainIss(handle, NewGain, pSetGain, hdr_ratio);
+        if (result != RET_SUCCESS) {
+            return (result);
+        }
+        pGC5035Ctx->CurHdrRatio = *hdr_ratio;
+        return (RET_SUCCESS);
+    }
+
+    result = SensorExposureSolve(&pGC5035Ctx->ExpTiming, &pGC5035Ctx->GainLut, 4, pGC5035Ctx->AntiFlicker.bandNs,
+                                 NewGain * NewIntegrationTime, &split);
+    if (result != RET_SUCCESS) {
+        TRACE(GC5035_ERROR, "%s: no exposure timing yet\n", __func__);
+        return (result);
+    }
+    TRACE(GC5035_DEBUG, "%s: lines=%u again=0x%x dgain=0x%x residual=%f\n", __func__,
+          split.lines, split.code.again, split.code.dgain, split.residual);
+
+    result = GC5035_ApplyExposureSplit(pGC5035Ctx, &split, &frame, &validFrame);
+    if (result != RET_SUCCESS) {
+        TRACE(GC5035_ERROR, "%s: write exposure error!\n", __func__);
+        return (result);
+    }
+
+    *pNumberOfFramesToSkip = validFrame - frame;
+    *pSetGain = pGC5035Ctx->AecCurGain;
+    *pSetIntegrationTime = pGC5035Ctx->AecCurIntegrationTime;
 
     pGC5035Ctx->CurHdrRatio = *hdr_ratio;
 
+    meta.frame           = validFrame;
+    meta.lines           = split.lines;
+    meta.again           = split.code.again;
+    meta.dgain           = split.code.dgain;
+    meta.vts             = pGC5035Ctx->CurFrameLengthLines;
+    meta.gain            = *pSetGain;
+    meta.integrationTime = *pSetIntegrationTime;
+    meta.hdrRatio        = pGC5035Ctx->CurHdrRatio;
+    SensorFrameMetaRecord(&pGC5035Ctx->FrameMeta, &meta);
+    SensorWarmNoteExposure(&pGC5035Ctx->Warm, meta.gain, meta.integrationTime, meta.hdrRatio);
+
     TRACE(GC5035_INFO, "%s: (exit)\n", __func__);
 
-    return result;
+    return (RET_SUCCESS);
 }
 
 RESULT GC5035_IsiGetCurrentExposureIss
@@ -1553,6 +1774,226 @@ RESULT GC5035_IsiGetResolutionIss(IsiSensorHandle_t handle, uint16_t *pwidth, ui
     return (result);
 }
 
+RESULT GC5035_IsiGetModeBundleIss(IsiSensorHandle_t handle, const SensorBundle_t **ppBundle)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (!SensorBundleIsOpen(&pGC5035Ctx->ModeBundle)) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    *ppBundle = &pGC5035Ctx->ModeBundle;
+    return (RET_SUCCESS);
+}
+
+RESULT GC5035_IsiSetTuningProfileIss(IsiSensorHandle_t handle, const char *pName)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+    int32_t index;
+
+    TRACE(GC5035_INFO, "%s: (enter)\n", __func__);
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pName == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    index = SensorProfileFind(&pGC5035Ctx->TuningProfiles, pName);
+    if (index < 0) {
+        TRACE(GC5035_ERROR, "%s: no tuning profile %s\n", __func__, pName);
+        return (RET_NOTAVAILABLE);
+    }
+
+    TRACE(GC5035_INFO, "%s: (exit)\n", __func__);
+    return SensorProfileRequest(&pGC5035Ctx->TuningProfiles, index);
+}
+
+RESULT GC5035_IsiLatchTuningProfileIss(IsiSensorHandle_t handle, const SensorTuningProfile_t **ppProfile, bool_t *pChanged)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+    bool_t changed;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppProfile == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (pGC5035Ctx->TuningProfiles.count == 0) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    changed = SensorProfileFrameBoundary(&pGC5035Ctx->TuningProfiles, ppProfile);
+    if (changed) {
+        pGC5035Ctx->AecMaxGain = SensorGainArbiterUpdate(&pGC5035Ctx->GainArbiter, &pGC5035Ctx->TuningProfiles);
+    }
+    if (pChanged != NULL) {
+        *pChanged = changed;
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT GC5035_IsiGetExposureStateIss(IsiSensorHandle_t handle, SensorExposureState_t *pState)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pState == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    pState->minGain                  = pGC5035Ctx->AecMinGain;
+    pState->maxGain                  = pGC5035Ctx->AecMaxGain;
+    pState->gainIncrement            = pGC5035Ctx->AecGainIncrement;
+    pState->minIntegrationTime       = pGC5035Ctx->AecMinIntegrationTime;
+    pState->maxIntegrationTime       = SensorAntiFlickerSnapTime(&pGC5035Ctx->AntiFlicker, pGC5035Ctx->AecMaxIntegrationTime);
+    pState->integrationTimeIncrement = pGC5035Ctx->AecIntegrationTimeIncrement;
+    pState->curGain                  = pGC5035Ctx->AecCurGain;
+    pState->curIntegrationTime       = pGC5035Ctx->AecCurIntegrationTime;
+    pState->curHdrRatio              = pGC5035Ctx->CurHdrRatio;
+    pState->curFps                   = pGC5035Ctx->CurrFps;
+    pState->minFps                   = pGC5035Ctx->MinFps;
+    pState->maxFps                   = pGC5035Ctx->MaxFps;
+    pState->frameLengthLines         = pGC5035Ctx->FrameLengthLines;
+    pState->curFrameLengthLines      = pGC5035Ctx->CurFrameLengthLines;
+    pState->minIntegrationLine       = pGC5035Ctx->MinIntegrationLine;
+    pState->maxIntegrationLine       = pGC5035Ctx->MaxIntegrationLine;
+
+    SensorExposureStatePublish(&pGC5035Ctx->ExposureState, pState);
+    return (RET_SUCCESS);
+}
+
+RESULT GC5035_IsiSetAntiFlickerIss(IsiSensorHandle_t handle, SensorAntiFlickerMode_t mode, uint32_t detectedHz)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    TRACE(GC5035_INFO, "%s: mode=%d detected=%uHz\n", __func__, mode, detectedHz);
+    return SensorAntiFlickerSet(&pGC5035Ctx->AntiFlicker, mode, detectedHz);
+}
+
+RESULT GC5035_IsiFrameStartIss(IsiSensorHandle_t handle, uint32_t frame)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL || pGC5035Ctx->IsiCtx.HalHandle == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    HalContext_t *pHalCtx = (HalContext_t *) pGC5035Ctx->IsiCtx.HalHandle;
+    return SensorLatencyFrameStart(&pGC5035Ctx->LatencySched, pHalCtx->sensor_fd, frame);
+}
+
+RESULT GC5035_IsiGetExposureValidFrameIss(IsiSensorHandle_t handle, uint32_t *pFrame)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pFrame == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    *pFrame = SensorLatencyValidFrame(&pGC5035Ctx->LatencySched);
+    return (RET_SUCCESS);
+}
+
+RESULT GC5035_IsiGetFrameExposureIss(IsiSensorHandle_t handle, uint32_t frame, SensorFrameMeta_t *pMeta)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorFrameMetaLookup(&pGC5035Ctx->FrameMeta, frame, pMeta);
+}
+
+RESULT GC5035_IsiSetAutoFrameLengthIss(IsiSensorHandle_t handle, bool_t enable)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    pGC5035Ctx->AutoFrameLength = enable;
+    /* before init there is no timing yet, init picks the flag up */
+    if (pGC5035Ctx->ExpTiming.lineTimePs != 0) {
+        GC5035_SetExposureTiming(pGC5035Ctx, pGC5035Ctx->ExpTiming.lineTimePs);
+    }
+
+    TRACE(GC5035_INFO, "%s: %d, max integration %fs\n", __func__, enable, pGC5035Ctx->AecMaxIntegrationTime);
+    return (RET_SUCCESS);
+}
+
+RESULT GC5035_IsiGetGainSplitIss(IsiSensorHandle_t handle, float gain, SensorGainSplit_t *pSplit)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pSplit == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorGainArbitrate(&pGC5035Ctx->GainArbiter, &pGC5035Ctx->GainLut, pGC5035Ctx->AecCurGain, gain, pSplit);
+
+    return (RET_SUCCESS);
+}
+
+RESULT GC5035_IsiInitSensorAsyncIss(IsiSensorHandle_t handle, SensorInitDone_t done, void *pUser)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorInitAsyncStart(&pGC5035Ctx->InitAsync, GC5035_IsiInitSensorIss, handle, done, pUser);
+}
+
+RESULT GC5035_IsiGetInitStatusIss(IsiSensorHandle_t handle, SensorInitStatus_t *pStatus)
+{
+    GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
+
+    if (pGC5035Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pStatus == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorInitAsyncQuery(&pGC5035Ctx->InitAsync, pStatus);
+
+    return (RET_SUCCESS);
+}
+
 RESULT GC5035_IsiGetSensorFpsIss(IsiSensorHandle_t handle, uint32_t * pfps)
 {
     GC5035_Context_t *pGC5035Ctx = (GC5035_Context_t *) handle;
@@ -1617,11 +2058,15 @@ RESULT GC5035_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
+        pGC5035Ctx->CurrFps = fps;
 
         ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pGC5035Ctx->SensorMode));
-        {
+        if (ret == 0) {
             pGC5035Ctx->MaxIntegrationLine = pGC5035Ctx->SensorMode.ae_info.max_integration_time;
-            pGC5035Ctx->AecMaxIntegrationTime = pGC5035Ctx->MaxIntegrationLine * pGC5035Ctx->one_line_exp_time;
+            /* the line time comes with the AE info only, unknown it stays 0 */
+            if (pGC5035Ctx->ExpTiming.lineTimePs != 0) {
+                GC5035_SetExposureTiming(pGC5035Ctx, pGC5035Ctx->ExpTiming.lineTimePs);
+            }
         }
 #ifdef SUBDEV_CHAR
         struct vvcam_ae_info_s ae_info;
@@ -1632,12 +2077,8 @@ RESULT GC5035_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
-        pGC5035Ctx->one_line_exp_time =
-            (float)ae_info.one_line_exp_time_ns / 1000000000;
         pGC5035Ctx->MaxIntegrationLine = ae_info.max_integration_time;
-        pGC5035Ctx->AecMaxIntegrationTime =
-            pGC5035Ctx->MaxIntegrationLine *
-            pGC5035Ctx->one_line_exp_time;
+        GC5035_SetExposureTiming(pGC5035Ctx, ae_info.one_line_exp_time_ns * SENSOR_EXPOSURE_PS_PER_NS);
 #endif
     }
 
@@ -35,13 +35,18 @@ CREATE_TRACER( IMX219_REG_DEBUG, "IMX219: ", INFO, 0);
 #define IMX219_MIN_GAIN_STEP    ( 1.0f/16.0f )  /**< min gain step size used by GUI (hardware min = 1/16; 1/16..32/16 depending on actual gain ) */
 #define IMX219_MAX_GAIN_AEC     ( 32.0f )       /**< max. gain used by the AEC (arbitrarily chosen, hardware limit = 62.0, driver limit = 32.0 ) */
 #define IMX219_VS_MAX_INTEGRATION_TIME (0.0018)
+#define IMX219_VTS_MAX 0xffff
 
 /*****************************************************************************
  *Sensor Info
 *****************************************************************************/
 static const char SensorName[16] = "IMX219";
 
-static struct vvcam_mode_info pimx219_mode_info[] = {
+/* frames until a shutter, gain and VTS write is in force; unverified against
+   the datasheet, the same 2/1/2 the Raspberry Pi camera helpers use for it */
+static const SensorLatency_t IMX219_Latency = { .exposure = 2, .gain = 1, .vts = 2 };
+
+static const struct vvcam_mode_info pimx219_mode_info[] = {
     {
         .index     = 0,
         .width     = 1920,
@@ -270,11 +275,30 @@ static RESULT IMX219_IsiGetSensorModeIss(IsiSensorHandle_t handle,void *mode)
     return ( RET_SUCCESS );
 }
 
+static RESULT IMX219_IsiGetRegCfgIss(const char *registerFileName, struct vvcam_sccb_array *arry);
+static RESULT IMX219_IsiCheckSensorConnectionIss(IsiSensorHandle_t handle);
+
+/* written at runtime, never a warm restart signature */
+static const uint32_t IMX219_WarmVolatileRegs[] = {
+    0x0100, 0x0157, 0x0158, 0x0159, 0x015a, 0x015b, 0x0160, 0x0161,
+    0x0601, 0x0603, 0x0605, 0x0607, 0x0609,
+    0x30a0, 0x30a1, 0x30a2, 0x30a3, 0x30a4, 0x30a5, 0x30a6, 0x30a7,
+};
+
+static const SensorWarmOps_t IMX219_WarmOps = {
+    .read          = IMX219_IsiRegisterReadIss,
+    .write         = IMX219_IsiRegisterWriteIss,
+    .pageReg       = SENSOR_WARM_NO_PAGE,
+    .pVolatile     = IMX219_WarmVolatileRegs,
+    .volatileCount = sizeof(IMX219_WarmVolatileRegs) / sizeof(IMX219_WarmVolatileRegs[0]),
+};
+
 static RESULT IMX219_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     RESULT result = RET_SUCCESS;
     IMX219_Context_t *pIMX219Ctx;
 
     TRACE(IMX219_INFO, "%s (enter) v1.6\n", __func__);
+    uint64_t createSpan = SensorTraceBegin();
 
     if (!pConfig || !pConfig->pSensor)
         return (RET_NULL_POINTER);
@@ -294,6 +318,15 @@ static RESULT IMX219_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         return (result);
     }
 
+    /* 1x..16x, AecMaxGain of every mode */
+    result = SensorGainLutInit(&pIMX219Ctx->GainLut, SENSOR_GAIN_LUT_ONE, 16 * SENSOR_GAIN_LUT_ONE, IMX219_QuantizeGain);
+    if (result != RET_SUCCESS) {
+        (void)HalDelRef(pConfig->HalHandle);
+        free(pIMX219Ctx);
+        return (result);
+    }
+
+    SensorLatencySchedInit(&pIMX219Ctx->LatencySched, &IMX219_Latency);
     pIMX219Ctx->IsiCtx.HalHandle = pConfig->HalHandle;
     pIMX219Ctx->IsiCtx.pSensor = pConfig->pSensor;
     pIMX219Ctx->GroupHold = BOOL_FALSE;
@@ -306,7 +339,7 @@ static RESULT IMX219_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     pIMX219Ctx->SensorMode.index = pConfig->SensorModeIndex;
     pConfig->hSensor = (IsiSensorHandle_t) pIMX219Ctx;
 #ifdef SUBDEV_CHAR
-    struct vvcam_mode_info *SensorDefaultMode = NULL;
+    const struct vvcam_mode_info *SensorDefaultMode = NULL;
     for (int i=0; i < sizeof(pimx219_mode_info)/ sizeof(struct vvcam_mode_info); i++)
     {
         if (pimx219_mode_info[i].index == pIMX219Ctx->SensorMode.index)
@@ -329,9 +362,16 @@ static RESULT IMX219_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
                 break;
         }
 
-        if (access(pIMX219Ctx->SensorRegCfgFile, F_OK) == 0) {
+        if (SensorBundleOpen(SensorName, SensorDefaultMode->index, &pIMX219Ctx->ModeBundle) == RET_SUCCESS ||
+            access(pIMX219Ctx->SensorRegCfgFile, F_OK) == 0) {
             pIMX219Ctx->KernelDriverFlag = 0;
             memcpy(&(pIMX219Ctx->SensorMode),SensorDefaultMode,sizeof(struct vvcam_mode_info));
+            /* read the mode data while the sensor powers up */
+            (void)SensorPrefetchStart(&pIMX219Ctx->Prefetch, &pIMX219Ctx->ModeBundle, pIMX219Ctx->SensorRegCfgFile, IMX219_IsiGetRegCfgIss);
+            if (SensorBundleIsOpen(&pIMX219Ctx->ModeBundle)) {
+                (void)SensorProfileSetInit(&pIMX219Ctx->TuningProfiles, &pIMX219Ctx->ModeBundle);
+                (void)SensorGainLutCalibrate(&pIMX219Ctx->GainLut, &pIMX219Ctx->ModeBundle);
+            }
         } else {
             pIMX219Ctx->KernelDriverFlag = 1;
         }
@@ -340,9 +380,12 @@ static RESULT IMX219_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         pIMX219Ctx->KernelDriverFlag = 1;
     }
 
+    uint64_t span = SensorTraceBegin();
     result = IMX219_IsiSensorSetPowerIss(pIMX219Ctx, BOOL_TRUE);
+    SensorTraceEnd(SensorName, "power", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
+    span = SensorTraceBegin();
     uint32_t SensorClkIn = 0;
     if (pIMX219Ctx->KernelDriverFlag) {
         result = IMX219_IsiSensorGetClkIss(pIMX219Ctx, &SensorClkIn);
@@ -350,19 +393,33 @@ static RESULT IMX219_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     }
 
     result = IMX219_IsiSensorSetClkIss(pIMX219Ctx, SensorClkIn);
+    SensorTraceEnd(SensorName, "clk", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
-    result = IMX219_IsiResetSensorIss(pIMX219Ctx);
-    RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
-
-    pIMX219Ctx->pattern = ISI_BPAT_BGBGGRGR;
-
     if (!pIMX219Ctx->KernelDriverFlag) {
+        span = SensorTraceBegin();
         result = IMX219_IsiConfigSensorSCCBIss(pIMX219Ctx);
+        SensorTraceEnd(SensorName, "sccb", span);
         RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
     }
+
+    span = SensorTraceBegin();
+    /* a sensor a previous process left in this mode still holds its registers */
+    if (pIMX219Ctx->KernelDriverFlag ||
+        SensorWarmOpen(&pIMX219Ctx->Warm, SensorName, ((HalContext_t *)pIMX219Ctx->IsiCtx.HalHandle)->sensor_fd,
+                       &IMX219_WarmOps, pIMX219Ctx) != RET_SUCCESS ||
+        IMX219_IsiCheckSensorConnectionIss(pIMX219Ctx) != RET_SUCCESS ||
+        SensorWarmProbe(&pIMX219Ctx->Warm, pIMX219Ctx->SensorMode.index) != RET_SUCCESS) {
+        SensorWarmInvalidate(&pIMX219Ctx->Warm);
+        result = IMX219_IsiResetSensorIss(pIMX219Ctx);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+    SensorTraceEnd(SensorName, "reset", span);
+
+    pIMX219Ctx->pattern = ISI_BPAT_BGBGGRGR;
 #endif
 
+    SensorTraceEnd(SensorName, "create", createSpan);
     TRACE(IMX219_INFO, "%s (exit pConfig->hSensor = %p)\n", __func__, pConfig->hSensor);
     return (result);
 }
@@ -418,21 +475,54 @@ static RESULT IMX219_IsiGetRegCfgIss(const char *registerFileName,
     return 0;
 }
 
+static uint32_t IMX219_MaxFrameLengthLines(IMX219_Context_t *pIMX219Ctx)
+{
+    if (!pIMX219Ctx->AutoFrameLength || pIMX219Ctx->MinFps == 0) {
+        return pIMX219Ctx->FrameLengthLines;
+    }
+
+    return MIN((uint32_t)pIMX219Ctx->FrameLengthLines * pIMX219Ctx->MaxFps / pIMX219Ctx->MinFps, IMX219_VTS_MAX);
+}
+
+static void IMX219_SetExposureTiming(IMX219_Context_t *pIMX219Ctx, uint32_t lineTimePs)
+{
+    SensorExposureTiming_t *pTiming = &pIMX219Ctx->ExpTiming;
+
+    /* with auto frame length the frame end moves out, the margin to it stays */
+    SensorExposureTimingSet(pTiming, lineTimePs, pIMX219Ctx->MinIntegrationLine,
+                            pIMX219Ctx->MaxIntegrationLine + IMX219_MaxFrameLengthLines(pIMX219Ctx) - pIMX219Ctx->FrameLengthLines);
+    pIMX219Ctx->one_line_exp_time           = (float)lineTimePs / 1e12f;
+    pIMX219Ctx->AecIntegrationTimeIncrement = SensorExposureLinesToTime(pTiming, 1);
+    pIMX219Ctx->AecMinIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->minLines);
+    pIMX219Ctx->AecMaxIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->maxLines);
+}
+
 static RESULT IMX219_IsiInitSensorIss(IsiSensorHandle_t handle) {
     RESULT result = RET_SUCCESS;
 
     int ret = 0;
+    uint32_t lineTimePs = 0;
     IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
 
     HalContext_t *pHalCtx = (HalContext_t *) pIMX219Ctx->IsiCtx.HalHandle;
     TRACE(IMX219_INFO, "%s (enter handle = %p)\n", __func__, handle);
+    uint64_t initSpan = SensorTraceBegin();
 
     if (pIMX219Ctx == NULL) {
         return (RET_WRONG_HANDLE);
     }
 	TRACE(IMX219_INFO, "%s (pIMX219Ctx->KernelDriverFlag = %d)\n", __func__, pIMX219Ctx->KernelDriverFlag);
     if (pIMX219Ctx->KernelDriverFlag) {
-        ;
+        /* the kernel driver set the mode up, its frame rate is the one in force */
+        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pIMX219Ctx->SensorMode));
+        if (ret != 0) {
+            TRACE(IMX219_ERROR, "%s:sensor get mode info error!\n",
+                  __func__);
+            return (RET_FAILURE);
+        }
+        pIMX219Ctx->MaxFps  = pIMX219Ctx->SensorMode.fps;
+        pIMX219Ctx->MinFps  = 1;
+        pIMX219Ctx->CurrFps = pIMX219Ctx->MaxFps;
     } else {
         /* sensor doesn't enter LP-11 state upon power up until and unless
         * streaming is started, so upon power up switch the modes to:
@@ -450,24 +540,47 @@ static RESULT IMX219_IsiInitSensorIss(IsiSensorHandle_t handle) {
 
 		TRACE(IMX219_INFO, "%s (001)\n", __func__);
         struct vvcam_sccb_array arry;
-        result = IMX219_IsiGetRegCfgIss(pIMX219Ctx->SensorRegCfgFile, &arry);
+        uint64_t span = SensorTraceBegin();
+        SensorPrefetchWait(&pIMX219Ctx->Prefetch);
+        if (SensorBundleIsOpen(&pIMX219Ctx->ModeBundle)) {
+            result = SensorBundleGetRegArray(&pIMX219Ctx->ModeBundle, &arry);
+        } else if (SensorPrefetchTakeRegs(&pIMX219Ctx->Prefetch, &arry) != RET_SUCCESS) {
+            result = IMX219_IsiGetRegCfgIss(pIMX219Ctx->SensorRegCfgFile, &arry);
+        }
+        SensorTraceEnd(SensorName, "load", span);
         if (result != 0) {
             TRACE(IMX219_ERROR,
                   "%s:IMX219_IsiGetRegCfgIss error!\n", __func__);
             return (RET_FAILURE);
         }
 
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &arry);
-        if (ret != 0) {
-            TRACE(IMX219_ERROR, "%s:Sensor Write Reg arry error!\n",
-                  __func__);
-            return (RET_FAILURE);
+        bool_t warm = pIMX219Ctx->Warm.resumed;
+        uint64_t regHash = SensorBundleHash(arry.sccb_data, arry.count * sizeof(struct vvcam_sccb_data),
+                                            SENSOR_BUNDLE_FNV_SEED);
+        if (SensorWarmResume(&pIMX219Ctx->Warm, regHash)) {
+            TRACE(IMX219_INFO, "%s: warm restart, register set skipped\n", __func__);
+        } else {
+            if (warm) {
+                /* create skipped the reset, but the register set changed since */
+                result = IMX219_IsiResetSensorIss(pIMX219Ctx);
+                RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+            }
+
+            span = SensorTraceBegin();
+            ret = SensorInitWriteRegs(&pIMX219Ctx->InitAsync, pHalCtx->sensor_fd, &arry);
+            SensorTraceEnd(SensorName, "write", span);
+            if (ret != 0) {
+                TRACE(IMX219_ERROR, "%s:Sensor Write Reg arry error!\n",
+                      __func__);
+                return (RET_FAILURE);
+            }
+            (void)SensorWarmCommit(&pIMX219Ctx->Warm, pIMX219Ctx->SensorMode.index, regHash, &arry);
         }
 		TRACE(IMX219_INFO, "%s (pIMX219Ctx->SensorMode.index = %d)\n", __func__, pIMX219Ctx->SensorMode.index);
         switch(pIMX219Ctx->SensorMode.index)
         {
             case 0:
-                pIMX219Ctx->one_line_exp_time = 0.00001890; // line_time = line_length / pclk
+                lineTimePs = 18900000; // line_time = line_length / pclk
                 pIMX219Ctx->FrameLengthLines = 0xAA8;
                 pIMX219Ctx->CurFrameLengthLines = pIMX219Ctx->FrameLengthLines;
                 pIMX219Ctx->MaxIntegrationLine = pIMX219Ctx->CurFrameLengthLines - 16;
@@ -478,17 +591,29 @@ static RESULT IMX219_IsiInitSensorIss(IsiSensorHandle_t handle) {
             default:
                 return (RET_FAILURE);
         }
-		pIMX219Ctx->AecIntegrationTimeIncrement = pIMX219Ctx->one_line_exp_time;
-		pIMX219Ctx->AecMinIntegrationTime =
-			pIMX219Ctx->one_line_exp_time * pIMX219Ctx->MinIntegrationLine;
-		pIMX219Ctx->AecMaxIntegrationTime =
-			pIMX219Ctx->one_line_exp_time * pIMX219Ctx->MaxIntegrationLine;
+        IMX219_SetExposureTiming(pIMX219Ctx, lineTimePs);
 
 
         pIMX219Ctx->MaxFps  = pIMX219Ctx->SensorMode.fps;
         pIMX219Ctx->MinFps  = 1;
         pIMX219Ctx->CurrFps = pIMX219Ctx->MaxFps;
     }
+
+    /* the tuning may allow the sensor less gain than the mode can do */
+    pIMX219Ctx->AecMaxGain = SensorGainArbiterInit(&pIMX219Ctx->GainArbiter, &pIMX219Ctx->TuningProfiles, pIMX219Ctx->AecMaxGain);
+
+    if (pIMX219Ctx->Warm.resumed) {
+        float gain, integrationTime, hdrRatio, setGain, setIntegrationTime;
+        uint8_t skip;
+
+        /* carry on with the exposure the sensor streamed with */
+        if (SensorWarmLastExposure(&pIMX219Ctx->Warm, &gain, &integrationTime, &hdrRatio)) {
+            (void)IMX219_IsiExposureControlIss(handle, gain, integrationTime, &skip,
+                                               &setGain, &setIntegrationTime, &hdrRatio);
+        }
+    }
+
+    SensorTraceEnd(SensorName, "init", initSpan);
     TRACE(IMX219_INFO, "%s (pIMX219Ctx->one_line_exp_time = %f)\n", __func__, pIMX219Ctx->one_line_exp_time);
     TRACE(IMX219_INFO, "%s (pIMX219Ctx->MinIntegrationLine = %d, pIMX219Ctx->MaxIntegrationLine = %d)\n", __func__, pIMX219Ctx->MinIntegrationLine, pIMX219Ctx->MaxIntegrationLine);
     return (result);
@@ -502,10 +627,20 @@ static RESULT IMX219_IsiReleaseSensorIss(IsiSensorHandle_t handle) {
     if (pIMX219Ctx == NULL)
         return (RET_WRONG_HANDLE);
 
+    /* an initialization still running in the background uses the context */
+    (void)SensorInitAsyncWait(&pIMX219Ctx->InitAsync);
+
     (void)IMX219_IsiSensorSetStreamingIss(pIMX219Ctx, BOOL_FALSE);
     (void)IMX219_IsiSensorSetPowerIss(pIMX219Ctx, BOOL_FALSE);
     (void)HalDelRef(pIMX219Ctx->IsiCtx.HalHandle);
 
+    SensorWarmClose(&pIMX219Ctx->Warm, BOOL_TRUE);
+
+    SensorPrefetchRelease(&pIMX219Ctx->Prefetch);
+    SensorLatencySchedRelease(&pIMX219Ctx->LatencySched);
+    (void)SensorBundleClose(&pIMX219Ctx->ModeBundle);
+    SensorGainLutRelease(&pIMX219Ctx->GainLut);
+
     MEMSET(pIMX219Ctx, 0, sizeof(IMX219_Context_t));
     free(pIMX219Ctx);
     TRACE(IMX219_INFO, "%s (exit)\n", __func__);
@@ -527,6 +662,7 @@ static RESULT IMX219_IsiSetupSensorIss
     RESULT result = RET_SUCCESS;
 
     TRACE(IMX219_INFO, "%s: (enter)\n", __func__);
+    uint64_t setupSpan = SensorTraceBegin();
 
     if (!pIMX219Ctx) {
         TRACE(IMX219_ERROR,
@@ -550,7 +686,9 @@ static RESULT IMX219_IsiSetupSensorIss
 
     /* 1.) SW reset of image sensor (via I2C register interface)  be careful, bits 6..0 are reserved, reset bit is not sticky */
     TRACE(IMX219_DEBUG, "%s: IMX219 System-Reset executed\n", __func__);
+    uint64_t span = SensorTraceBegin();
     osSleep(100);
+    SensorTraceEnd(SensorName, "settle", span);
 
     //IMX219_AecSetModeParameters not defined yet as of 2021/8/9.
     //result = IMX219_AecSetModeParameters(pIMX219Ctx, pConfig);
@@ -567,6 +705,7 @@ static RESULT IMX219_IsiSetupSensorIss
     ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);//result = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);
 #endif
     pIMX219Ctx->Configured = BOOL_TRUE;
+    SensorTraceEnd(SensorName, "setup", setupSpan);
     TRACE(IMX219_INFO, "%s: (exit) ret=0x%x \n", __func__, result);
     return result;
 }
@@ -589,6 +728,7 @@ static RESULT IMX219_IsiSensorSetStreamingIss
     RESULT result = RET_SUCCESS;
     int ret = 0;
     TRACE(IMX219_INFO, "%s (enter)\n", __func__);
+    uint64_t streamSpan = SensorTraceBegin();
 
     IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
     if (pIMX219Ctx == NULL || pIMX219Ctx->IsiCtx.HalHandle == NULL) {
@@ -622,6 +762,7 @@ static RESULT IMX219_IsiSensorSetStreamingIss
 
     pIMX219Ctx->Streaming = on;
 
+    SensorTraceEnd(SensorName, on ? "stream on" : "stream off", streamSpan);
     TRACE(IMX219_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -746,7 +887,7 @@ static RESULT IMX219_IsiGetIntegrationTimeLimitsIss
     }
 
     *pMinIntegrationTime = pIMX219Ctx->AecMinIntegrationTime;
-    *pMaxIntegrationTime = pIMX219Ctx->AecMaxIntegrationTime;
+    *pMaxIntegrationTime = SensorAntiFlickerSnapTime(&pIMX219Ctx->AntiFlicker, pIMX219Ctx->AecMaxIntegrationTime);
 
     TRACE(IMX219_INFO, "%s: (exit)\n", __func__);
     return (result);
@@ -842,13 +983,31 @@ RESULT IMX219_IsiGetGainIncrementIss(IsiSensorHandle_t handle, float *pIncr) {
     return (result);
 }
 
+static void IMX219_QuantizeGain(uint32_t gain, SensorGainCode_t *pCode)
+{
+    uint32_t again, dgain;
+
+    again = 256 - (65536 + gain - 1) / gain;    /* 256-256/gain, truncated */
+    if (again >= 232) {
+        again = 232;
+    }
+    dgain = gain * (256 - again) / 256;         /* what's left after again, 4.8 */
+    if (dgain > 0xfff) {
+        dgain = 0xfff;
+    }
+
+    pCode->again = again;
+    pCode->dgain = dgain;
+    pCode->gain  = dgain * 256 / (256 - again);
+}
+
 RESULT IMX219_IsiSetGainIss
     (IsiSensorHandle_t handle,
      float NewGain, float *pSetGain, float *hdr_ratio) {
 
     RESULT result = RET_SUCCESS;
-    int32_t again = 0, dgain = 0, ret = 0;
-    float gain_left;
+    int32_t ret = 0;
+    const SensorGainCode_t *pCode;
 
 
     IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
@@ -857,31 +1016,27 @@ RESULT IMX219_IsiSetGainIss
     }
 
     HalContext_t *pHalCtx = (HalContext_t *) pIMX219Ctx->IsiCtx.HalHandle;
-    //IMX219 specific
-    again = 256-256/NewGain;
-    if (again >=232) {
-        again = 232;
-    }
-    gain_left = NewGain / (256.0 / (256.0 - (float)again)); // what's left after again
-    TRACE(IMX219_INFO, "%s: NewGain=%f again=%d, gain_left=%f dgain integer=%d dgain float=%f dgain float reg=%u\n"
-        , __func__, NewGain, again, gain_left, (unsigned int)gain_left, (gain_left - (unsigned int)gain_left), (unsigned int)((float)(gain_left - (unsigned int)gain_left) * 256.0));
+    //IMX219 specific, 1x..16x
+    pCode = SensorGainLutLookup(&pIMX219Ctx->GainLut, NewGain);
+    TRACE(IMX219_INFO, "%s: NewGain=%f again=%u, dgain=0x%x, gain=%u\n"
+        , __func__, NewGain, pCode->again, pCode->dgain, pCode->gain);
 
-    ret = IMX219_IsiRegisterWriteIss(handle, 0x157, again);
+    ret = IMX219_IsiRegisterWriteIss(handle, 0x157, pCode->again);
     if (ret != 0) {
         return (RET_FAILURE);
     }
 
-    ret = IMX219_IsiRegisterWriteIss(handle, 0x158, ((unsigned int)gain_left > 15 ) ? 15 : (unsigned int)gain_left);
+    ret = IMX219_IsiRegisterWriteIss(handle, 0x158, pCode->dgain >> 8);
     if (ret != 0) {
         return (RET_FAILURE);
     }
 
-    ret = IMX219_IsiRegisterWriteIss(handle, 0x159,  (unsigned int)((float)(gain_left - (unsigned int)gain_left) * 256.0));
+    ret = IMX219_IsiRegisterWriteIss(handle, 0x159, pCode->dgain & 0xff);
     if (ret != 0) {
         return (RET_FAILURE);
     }
 
-    pIMX219Ctx->AecCurGain = ((float)(NewGain));
+    pIMX219Ctx->AecCurGain = (float)pCode->gain / SENSOR_GAIN_LUT_ONE;
     *pSetGain = pIMX219Ctx->AecCurGain;
     TRACE(IMX219_DEBUG, "%s: g=%f\n", __func__, *pSetGain);
     return (result);
@@ -1137,7 +1292,6 @@ RESULT IMX219_IsiSetIntegrationTimeIss
     HalContext_t *pHalCtx = (HalContext_t *) pIMX219Ctx->IsiCtx.HalHandle;
 
     uint32_t exp_line = 0;
-    uint32_t exp_line_old = 0;
     int ret = 0;
 
     TRACE(IMX219_INFO, "%s: (enter handle = %p)\n", __func__, handle);
@@ -1155,11 +1309,7 @@ RESULT IMX219_IsiSetIntegrationTimeIss
               __func__);
         return (RET_NULL_POINTER);
     }
-    exp_line = NewIntegrationTime / pIMX219Ctx->one_line_exp_time;
-    exp_line_old = exp_line;
-    exp_line =
-        MIN(pIMX219Ctx->MaxIntegrationLine,
-        MAX(pIMX219Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pIMX219Ctx->ExpTiming, NewIntegrationTime);
 
     TRACE(IMX219_DEBUG, "%s: set AEC_PK_EXPO=0x%05x min_exp_line = %d, max_exp_line = %d\n", __func__, exp_line, pIMX219Ctx->MinIntegrationLine, pIMX219Ctx->MaxIntegrationLine);
 
@@ -1169,16 +1319,13 @@ RESULT IMX219_IsiSetIntegrationTimeIss
         //ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_EXP, &exp_line);
         pIMX219Ctx->OldIntegrationTime = exp_line;    // remember current integration time
         pIMX219Ctx->AecCurIntegrationTime =
-            exp_line * pIMX219Ctx->one_line_exp_time;
+            SensorExposureLinesToTime(&pIMX219Ctx->ExpTiming, exp_line);
 
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
         *pNumberOfFramesToSkip = 0U;    //no frame skip
     }
 
-    if (NewIntegrationTime > pIMX219Ctx->MaxIntegrationLine * pIMX219Ctx->one_line_exp_time)
-        NewIntegrationTime = pIMX219Ctx->MaxIntegrationLine * pIMX219Ctx->one_line_exp_time;
-    
     // IMX219 specific
     // int vts = exp_line + 16;
 
@@ -1191,11 +1338,7 @@ RESULT IMX219_IsiSetIntegrationTimeIss
         return (RET_FAILURE);
     }
 
-    if (exp_line_old != exp_line) {
-        *pSetIntegrationTime = pIMX219Ctx->AecCurIntegrationTime;
-    } else {
-        *pSetIntegrationTime = NewIntegrationTime;
-    }
+    *pSetIntegrationTime = pIMX219Ctx->AecCurIntegrationTime;
 
     TRACE(IMX219_DEBUG, "%s: Ti=%f\n", __func__, *pSetIntegrationTime);
     TRACE(IMX219_INFO, "%s: (exit)\n", __func__);
@@ -1216,8 +1359,7 @@ RESULT IMX219_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integr
     HalContext_t *pHalCtx = (HalContext_t *) pIMX219Ctx->IsiCtx.HalHandle;
 
     uint32_t exp_line = 0;
-    exp_line = IntegrationTime / pIMX219Ctx->one_line_exp_time;
-    exp_line = MIN(pIMX219Ctx->MaxIntegrationLine, MAX(pIMX219Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pIMX219Ctx->ExpTiming, IntegrationTime);
 
     if (exp_line != pIMX219Ctx->LastLongExpLine)
     {
@@ -1232,7 +1374,7 @@ RESULT IMX219_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integr
         }
 
         pIMX219Ctx->LastLongExpLine = exp_line;
-        pIMX219Ctx->AecCurLongIntegrationTime =  pIMX219Ctx->LastLongExpLine*pIMX219Ctx->one_line_exp_time;
+        pIMX219Ctx->AecCurLongIntegrationTime =  SensorExposureLinesToTime(&pIMX219Ctx->ExpTiming, pIMX219Ctx->LastLongExpLine);
     }
 
 
@@ -1272,10 +1414,7 @@ RESULT IMX219_IsiSetVSIntegrationTimeIss
           pIMX219Ctx->AecMinIntegrationTime);
 
 
-    exp_line = NewIntegrationTime / pIMX219Ctx->one_line_exp_time;
-    exp_line =
-        MIN(pIMX219Ctx->MaxIntegrationLine,
-        MAX(pIMX219Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pIMX219Ctx->ExpTiming, NewIntegrationTime);
 
     if (exp_line != pIMX219Ctx->OldVsIntegrationTime) {
     /*TODO*/
@@ -1283,7 +1422,7 @@ RESULT IMX219_IsiSetVSIntegrationTimeIss
     } else if (1){
 
         pIMX219Ctx->OldVsIntegrationTime = exp_line;
-        pIMX219Ctx->AecCurVSIntegrationTime = exp_line * pIMX219Ctx->one_line_exp_time;    //remember current integration time
+        pIMX219Ctx->AecCurVSIntegrationTime = SensorExposureLinesToTime(&pIMX219Ctx->ExpTiming, exp_line);    //remember current integration time
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
         *pNumberOfFramesToSkip = 0U;    //no frame skip
@@ -1297,6 +1436,57 @@ RESULT IMX219_IsiSetVSIntegrationTimeIss
     return (result);
 }
 
+static RESULT IMX219_ApplyExposureSplit(IMX219_Context_t *pIMX219Ctx, const SensorExposureSplit_t *pSplit,
+                                        uint32_t *pFrame, uint32_t *pValidFrame)
+{
+    HalContext_t *pHalCtx = (HalContext_t *) pIMX219Ctx->IsiCtx.HalHandle;
+    uint32_t vts = MIN(MAX(pSplit->lines + pIMX219Ctx->FrameLengthLines - pIMX219Ctx->MaxIntegrationLine,
+                           (uint32_t)pIMX219Ctx->FrameLengthLines), IMX219_MaxFrameLengthLines(pIMX219Ctx));
+    struct vvcam_sccb_data shutter[] = {
+        { 0x0160, vts >> 8 },
+        { 0x0161, vts & 0xff },
+        { 0x015a, pSplit->lines >> 8 },
+        { 0x015b, pSplit->lines & 0xff },
+    };
+    struct vvcam_sccb_data gain[] = {
+        { 0x0157, pSplit->code.again },
+        { 0x0158, pSplit->code.dgain >> 8 },
+        { 0x0159, pSplit->code.dgain & 0xff },
+    };
+    struct vvcam_sccb_data *pShutter = shutter;
+    uint32_t shutterCount = sizeof(shutter) / sizeof(shutter[0]);
+    RESULT result;
+
+    if (vts == 0) {
+        TRACE(IMX219_ERROR, "%s: no frame length yet\n", __func__);
+        return (RET_WRONG_STATE);
+    }
+
+    /* VTS moves only when the shutter needs more than the frame has, or no
+       longer needs what an earlier exposure raised it to */
+    if (vts == pIMX219Ctx->CurFrameLengthLines) {
+        /* the frame length stays as it is: shutter only */
+        pShutter   = &shutter[2];
+        shutterCount -= 2;
+    }
+
+    /* timed so shutter and gain are in force on the same frame */
+    result = SensorLatencySubmit(&pIMX219Ctx->LatencySched, pHalCtx->sensor_fd,
+                                 pShutter, shutterCount,
+                                 gain, sizeof(gain) / sizeof(gain[0]), pFrame, pValidFrame);
+    if (result != RET_SUCCESS) {
+        TRACE(IMX219_ERROR, "%s: write exposure registers error!\n", __func__);
+        return (result);
+    }
+
+    pIMX219Ctx->OldIntegrationTime    = pSplit->lines;
+    pIMX219Ctx->AecCurIntegrationTime = pSplit->integrationTime;
+    pIMX219Ctx->AecCurGain            = pSplit->gain;
+    pIMX219Ctx->CurFrameLengthLines   = vts;
+    pIMX219Ctx->CurrFps               = pIMX219Ctx->MaxFps * pIMX219Ctx->FrameLengthLines / vts;
+    return (RET_SUCCESS);
+}
+
 RESULT IMX219_IsiExposureControlIss
     (IsiSensorHandle_t handle,
      float NewGain,
@@ -1306,8 +1496,9 @@ RESULT IMX219_IsiExposureControlIss
 {
     IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
     RESULT result = RET_SUCCESS;
-    int TmpGain;
-    /*TODO*/
+    SensorExposureSplit_t split;
+    SensorFrameMeta_t meta;
+    uint32_t frame, validFrame;
 
     TRACE(IMX219_INFO, "%s: (enter)\n", __func__);
 
@@ -1329,16 +1520,56 @@ RESULT IMX219_IsiExposureControlIss
     TRACE(IMX219_ERROR, "%s: g=%f, Ti=%f\n", __func__, NewGain,
           NewIntegrationTime);
 
-    result = IMX219_IsiSetIntegrationTimeIss(handle, NewIntegrationTime,
-                        pSetIntegrationTime,
-                        pNumberOfFramesToSkip, hdr_ratio);
-    result = IMX219_IsiSetGainIss(handle, NewGain, pSetGain, hdr_ratio);
+    if (pIMX219Ctx->KernelDriverFlag) {
+        /* the kernel driver owns the sensor and its frame timing */
+        result = IMX219_IsiSetIntegrationTimeIss(handle, NewIntegrationTime, pSetIntegrationTime,
+                                                pNumberOfFramesToSkip, hdr_ratio);
+        if (result != RET_SUCCESS) {
+            return (result);
+        }
+        result = IMX219_IsiSetGainIss(handle, NewGain, pSetGain, hdr_ratio);
+        if (result != RET_SUCCESS) {
+            return (result);
+        }
+        pIMX219Ctx->CurHdrRatio = *hdr_ratio;
+        return (RET_SUCCESS);
+    }
+
+    result = SensorExposureSolve(&pIMX219Ctx->ExpTiming, &pIMX219Ctx->GainLut, 1, pIMX219Ctx->AntiFlicker.bandNs,
+                                 NewGain * NewIntegrationTime, &split);
+    if (result != RET_SUCCESS) {
+        TRACE(IMX219_ERROR, "%s: no exposure timing yet\n", __func__);
+        return (result);
+    }
+    TRACE(IMX219_DEBUG, "%s: lines=%u again=0x%x dgain=0x%x residual=%f\n", __func__,
+          split.lines, split.code.again, split.code.dgain, split.residual);
+
+    result = IMX219_ApplyExposureSplit(pIMX219Ctx, &split, &frame, &validFrame);
+    if (result != RET_SUCCESS) {
+        TRACE(IMX219_ERROR, "%s: write exposure error!\n", __func__);
+        return (result);
+    }
+
+    *pNumberOfFramesToSkip = validFrame - frame;
+    *pSetGain = pIMX219Ctx->AecCurGain;
+    *pSetIntegrationTime = pIMX219Ctx->AecCurIntegrationTime;
 
     pIMX219Ctx->CurHdrRatio = *hdr_ratio;
 
+    meta.frame           = validFrame;
+    meta.lines           = split.lines;
+    meta.again           = split.code.again;
+    meta.dgain           = split.code.dgain;
+    meta.vts             = pIMX219Ctx->CurFrameLengthLines;
+    meta.gain            = *pSetGain;
+    meta.integrationTime = *pSetIntegrationTime;
+    meta.hdrRatio        = pIMX219Ctx->CurHdrRatio;
+    SensorFrameMetaRecord(&pIMX219Ctx->FrameMeta, &meta);
+    SensorWarmNoteExposure(&pIMX219Ctx->Warm, meta.gain, meta.integrationTime, meta.hdrRatio);
+
     TRACE(IMX219_INFO, "%s: (exit)\n", __func__);
 
-    return result;
+    return (RET_SUCCESS);
 }
 
 RESULT IMX219_IsiGetCurrentExposureIss
@@ -1386,6 +1617,226 @@ RESULT IMX219_IsiGetResolutionIss(IsiSensorHandle_t handle, uint16_t *pwidth, ui
     return (result);
 }
 
+RESULT IMX219_IsiGetModeBundleIss(IsiSensorHandle_t handle, const SensorBundle_t **ppBundle)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (!SensorBundleIsOpen(&pIMX219Ctx->ModeBundle)) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    *ppBundle = &pIMX219Ctx->ModeBundle;
+    return (RET_SUCCESS);
+}
+
+RESULT IMX219_IsiSetTuningProfileIss(IsiSensorHandle_t handle, const char *pName)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+    int32_t index;
+
+    TRACE(IMX219_INFO, "%s: (enter)\n", __func__);
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pName == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    index = SensorProfileFind(&pIMX219Ctx->TuningProfiles, pName);
+    if (index < 0) {
+        TRACE(IMX219_ERROR, "%s: no tuning profile %s\n", __func__, pName);
+        return (RET_NOTAVAILABLE);
+    }
+
+    TRACE(IMX219_INFO, "%s: (exit)\n", __func__);
+    return SensorProfileRequest(&pIMX219Ctx->TuningProfiles, index);
+}
+
+RESULT IMX219_IsiLatchTuningProfileIss(IsiSensorHandle_t handle, const SensorTuningProfile_t **ppProfile, bool_t *pChanged)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+    bool_t changed;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppProfile == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (pIMX219Ctx->TuningProfiles.count == 0) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    changed = SensorProfileFrameBoundary(&pIMX219Ctx->TuningProfiles, ppProfile);
+    if (changed) {
+        pIMX219Ctx->AecMaxGain = SensorGainArbiterUpdate(&pIMX219Ctx->GainArbiter, &pIMX219Ctx->TuningProfiles);
+    }
+    if (pChanged != NULL) {
+        *pChanged = changed;
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT IMX219_IsiGetExposureStateIss(IsiSensorHandle_t handle, SensorExposureState_t *pState)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pState == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    pState->minGain                  = pIMX219Ctx->AecMinGain;
+    pState->maxGain                  = pIMX219Ctx->AecMaxGain;
+    pState->gainIncrement            = pIMX219Ctx->AecGainIncrement;
+    pState->minIntegrationTime       = pIMX219Ctx->AecMinIntegrationTime;
+    pState->maxIntegrationTime       = SensorAntiFlickerSnapTime(&pIMX219Ctx->AntiFlicker, pIMX219Ctx->AecMaxIntegrationTime);
+    pState->integrationTimeIncrement = pIMX219Ctx->AecIntegrationTimeIncrement;
+    pState->curGain                  = pIMX219Ctx->AecCurGain;
+    pState->curIntegrationTime       = pIMX219Ctx->AecCurIntegrationTime;
+    pState->curHdrRatio              = pIMX219Ctx->CurHdrRatio;
+    pState->curFps                   = pIMX219Ctx->CurrFps;
+    pState->minFps                   = pIMX219Ctx->MinFps;
+    pState->maxFps                   = pIMX219Ctx->MaxFps;
+    pState->frameLengthLines         = pIMX219Ctx->FrameLengthLines;
+    pState->curFrameLengthLines      = pIMX219Ctx->CurFrameLengthLines;
+    pState->minIntegrationLine       = pIMX219Ctx->MinIntegrationLine;
+    pState->maxIntegrationLine       = pIMX219Ctx->MaxIntegrationLine;
+
+    SensorExposureStatePublish(&pIMX219Ctx->ExposureState, pState);
+    return (RET_SUCCESS);
+}
+
+RESULT IMX219_IsiSetAntiFlickerIss(IsiSensorHandle_t handle, SensorAntiFlickerMode_t mode, uint32_t detectedHz)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    TRACE(IMX219_INFO, "%s: mode=%d detected=%uHz\n", __func__, mode, detectedHz);
+    return SensorAntiFlickerSet(&pIMX219Ctx->AntiFlicker, mode, detectedHz);
+}
+
+RESULT IMX219_IsiFrameStartIss(IsiSensorHandle_t handle, uint32_t frame)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL || pIMX219Ctx->IsiCtx.HalHandle == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    HalContext_t *pHalCtx = (HalContext_t *) pIMX219Ctx->IsiCtx.HalHandle;
+    return SensorLatencyFrameStart(&pIMX219Ctx->LatencySched, pHalCtx->sensor_fd, frame);
+}
+
+RESULT IMX219_IsiGetExposureValidFrameIss(IsiSensorHandle_t handle, uint32_t *pFrame)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pFrame == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    *pFrame = SensorLatencyValidFrame(&pIMX219Ctx->LatencySched);
+    return (RET_SUCCESS);
+}
+
+RESULT IMX219_IsiGetFrameExposureIss(IsiSensorHandle_t handle, uint32_t frame, SensorFrameMeta_t *pMeta)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorFrameMetaLookup(&pIMX219Ctx->FrameMeta, frame, pMeta);
+}
+
+RESULT IMX219_IsiSetAutoFrameLengthIss(IsiSensorHandle_t handle, bool_t enable)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    pIMX219Ctx->AutoFrameLength = enable;
+    /* before init there is no timing yet, init picks the flag up */
+    if (pIMX219Ctx->ExpTiming.lineTimePs != 0) {
+        IMX219_SetExposureTiming(pIMX219Ctx, pIMX219Ctx->ExpTiming.lineTimePs);
+    }
+
+    TRACE(IMX219_INFO, "%s: %d, max integration %fs\n", __func__, enable, pIMX219Ctx->AecMaxIntegrationTime);
+    return (RET_SUCCESS);
+}
+
+RESULT IMX219_IsiGetGainSplitIss(IsiSensorHandle_t handle, float gain, SensorGainSplit_t *pSplit)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pSplit == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorGainArbitrate(&pIMX219Ctx->GainArbiter, &pIMX219Ctx->GainLut, pIMX219Ctx->AecCurGain, gain, pSplit);
+
+    return (RET_SUCCESS);
+}
+
+RESULT IMX219_IsiInitSensorAsyncIss(IsiSensorHandle_t handle, SensorInitDone_t done, void *pUser)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorInitAsyncStart(&pIMX219Ctx->InitAsync, IMX219_IsiInitSensorIss, handle, done, pUser);
+}
+
+RESULT IMX219_IsiGetInitStatusIss(IsiSensorHandle_t handle, SensorInitStatus_t *pStatus)
+{
+    IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
+
+    if (pIMX219Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pStatus == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorInitAsyncQuery(&pIMX219Ctx->InitAsync, pStatus);
+
+    return (RET_SUCCESS);
+}
+
 RESULT IMX219_IsiGetSensorFpsIss(IsiSensorHandle_t handle, uint32_t * pfps)
 {
     IMX219_Context_t *pIMX219Ctx = (IMX219_Context_t *) handle;
@@ -1450,11 +1901,15 @@ RESULT IMX219_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
+        pIMX219Ctx->CurrFps = fps;
 
         ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pIMX219Ctx->SensorMode));
-        {
+        if (ret == 0) {
             pIMX219Ctx->MaxIntegrationLine = pIMX219Ctx->SensorMode.ae_info.max_integration_time;
-            pIMX219Ctx->AecMaxIntegrationTime = pIMX219Ctx->MaxIntegrationLine * pIMX219Ctx->one_line_exp_time;
+            /* the line time comes with the AE info only, unknown it stays 0 */
+            if (pIMX219Ctx->ExpTiming.lineTimePs != 0) {
+                IMX219_SetExposureTiming(pIMX219Ctx, pIMX219Ctx->ExpTiming.lineTimePs);
+            }
         }
 #ifdef SUBDEV_CHAR
         struct vvcam_ae_info_s ae_info;
@@ -1465,12 +1920,8 @@ RESULT IMX219_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
-        pIMX219Ctx->one_line_exp_time =
-            (float)ae_info.one_line_exp_time_ns / 1000000000;
         pIMX219Ctx->MaxIntegrationLine = ae_info.max_integration_time;
-        pIMX219Ctx->AecMaxIntegrationTime =
-            pIMX219Ctx->MaxIntegrationLine *
-            pIMX219Ctx->one_line_exp_time;
+        IMX219_SetExposureTiming(pIMX219Ctx, ae_info.one_line_exp_time_ns * SENSOR_EXPOSURE_PS_PER_NS);
 #endif
     }
 
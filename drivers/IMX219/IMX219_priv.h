@@ -34,6 +34,17 @@
 #include <hal/hal_api.h>
 #include <isi/isi_common.h>
 #include "vvsensor.h"
+#include "sensor_bundle.h"
+#include "sensor_profile.h"
+#include "sensor_exposure.h"
+#include "sensor_latency.h"
+#include "sensor_frame_meta.h"
+#include "sensor_gain_split.h"
+#include "sensor_init_async.h"
+#include "sensor_prefetch.h"
+#include "sensor_warm.h"
+#include "sensor_trace.h"
+#include "sensor_gain_lut.h"
 
 
 
@@ -71,6 +82,8 @@ typedef struct IMX219_Context_s
     struct vvcam_mode_info SensorMode;
     uint32_t            KernelDriverFlag;
     char                SensorRegCfgFile[128];
+    SensorBundle_t      ModeBundle;             /**< mapped per-mode bundle, preferred over SensorRegCfgFile */
+    SensorProfileSet_t  TuningProfiles;         /**< 3A tuning profiles preloaded from ModeBundle */
 
     uint32_t              HdrMode;
     uint32_t              Resolution;
@@ -87,6 +100,7 @@ typedef struct IMX219_Context_s
     bool_t              isAfpsRun;              /**< if true, just do anything required for Afps parameter calculation, but DON'T access SensorHW! */
 
     float               one_line_exp_time;
+    SensorExposureTiming_t ExpTiming;         /**< integer line timing, see sensor_exposure.h */
     uint16_t            MaxIntegrationLine;
     uint16_t            MinIntegrationLine;
     uint32_t            gain_accuracy;
@@ -130,6 +144,16 @@ typedef struct IMX219_Context_s
     uint8_t             pattern;
 
     float               CurHdrRatio;
+    SensorExposureState_t ExposureState;      /**< last published exposure snapshot */
+    SensorGainLut_t     GainLut;                /**< gain to register codes, built at create */
+    SensorAntiFlicker_t AntiFlicker;            /**< off unless set */
+    SensorLatencySched_t LatencySched;        /**< frame tagging of exposure writes */
+    SensorFrameMetaRing_t FrameMeta;          /**< exposures in force, by frame */
+    bool_t              AutoFrameLength;        /**< stretch VTS for long exposures, down to MinFps */
+    SensorGainArbiter_t GainArbiter;            /**< sensor/ISP gain limits from the tuning */
+    SensorInitAsync_t   InitAsync;              /**< background InitSensorIss */
+    SensorPrefetch_t    Prefetch;               /**< mode data loading from create to init */
+    SensorWarm_t        Warm;                   /**< record for a warm restart */
 } IMX219_Context_t;
 
 static RESULT IMX219_IsiCreateSensorIss(IsiSensorInstanceConfig_t *
@@ -228,6 +252,32 @@ static RESULT IMX219_IsiSetVSIntegrationTimeIss(IsiSensorHandle_t
 
 RESULT IMX219_IsiGetResolutionIss(IsiSensorHandle_t handle, uint16_t *pwidth, uint16_t *pheight);
 
+RESULT IMX219_IsiGetModeBundleIss(IsiSensorHandle_t handle, const SensorBundle_t **ppBundle);
+
+RESULT IMX219_IsiSetTuningProfileIss(IsiSensorHandle_t handle, const char *pName);
+
+RESULT IMX219_IsiLatchTuningProfileIss(IsiSensorHandle_t handle, const SensorTuningProfile_t **ppProfile, bool_t *pChanged);
+
+RESULT IMX219_IsiGetExposureStateIss(IsiSensorHandle_t handle, SensorExposureState_t *pState);
+
+RESULT IMX219_IsiSetAntiFlickerIss(IsiSensorHandle_t handle, SensorAntiFlickerMode_t mode, uint32_t detectedHz);
+
+RESULT IMX219_IsiFrameStartIss(IsiSensorHandle_t handle, uint32_t frame);
+
+RESULT IMX219_IsiGetExposureValidFrameIss(IsiSensorHandle_t handle, uint32_t *pFrame);
+
+RESULT IMX219_IsiGetFrameExposureIss(IsiSensorHandle_t handle, uint32_t frame, SensorFrameMeta_t *pMeta);
+
+RESULT IMX219_IsiSetAutoFrameLengthIss(IsiSensorHandle_t handle, bool_t enable);
+
+RESULT IMX219_IsiGetGainSplitIss(IsiSensorHandle_t handle, float gain, SensorGainSplit_t *pSplit);
+
+RESULT IMX219_IsiInitSensorAsyncIss(IsiSensorHandle_t handle, SensorInitDone_t done, void *pUser);
+
+RESULT IMX219_IsiGetInitStatusIss(IsiSensorHandle_t handle, SensorInitStatus_t *pStatus);
+
+static void IMX219_QuantizeGain(uint32_t gain, SensorGainCode_t *pCode);
+
 static RESULT IMX219_IsiResetSensorIss(IsiSensorHandle_t handle);
 
 
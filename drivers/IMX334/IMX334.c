@@ -46,6 +46,22 @@ CREATE_TRACER( IMX334_REG_DEBUG, "IMX334: ", INFO, 1);
 #define IMX334_PLL_PCLK         74250000
 #define IMX334_HMAX             0xaec
 #define IMX334_VMAX             0xac4
+#define IMX334_LINE_TIME_PS     ((uint32_t)((uint64_t)IMX334_HMAX * 1000000000000ULL / IMX334_PLL_PCLK))
+
+#define IMX334_REGHOLD          0x3001
+#define IMX334_SHR_MIN          5
+#define IMX334_LINEAR_EXP_END   2201    /**< linear mode: integration = IMX334_LINEAR_EXP_END - SHR0 */
+#define IMX334_DOL_FRAMES       3       /**< long, SEF1, SEF2 */
+#define IMX334_DOL_MARGIN       9       /**< lines between a readout and the next shutter */
+#define IMX334_WDMODE           0x3048  /**< [0] DOL */
+#define IMX334_WDSEL            0x3049  /**< [1:0] 1 DOL 2 frames, 2 DOL 3 frames */
+#define IMX334_WD_SET2          0x304b  /**< [1] one virtual channel per exposure, else line information */
+#define IMX334_OPB_SIZE_V       0x304c  /**< [5:0] optical black lines ahead of each exposure */
+#define IMX334_GAIN_STEP_DB     0.3f
+#define IMX334_GAIN_CODE_MAX    240     /**< 72 dB, analog up to 30 dB */
+#define IMX334_DOL_RATIO        16.0f   /**< default long/SEF1 and SEF1/SEF2 ratio */
+#define IMX334_LINEAR_MODE      0       /**< mode indices of the linear/3DOL pair the sensor can switch between */
+#define IMX334_DOL_MODE         1
 
 extern const IsiRegDescription_t IMX334_g_aRegDescription[];
 //const IsiSensorCaps_t IMX334_g_IsiSensorDefaultConfig;
@@ -55,7 +71,12 @@ extern const IsiRegDescription_t IMX334_g_aRegDescription[];
 *****************************************************************************/
 static const char SensorName[16] = "IMX334";
 
-static struct vvcam_mode_info pIMX334_mode_info[] = {
+/* frames until a shutter, gain and VTS write is in force; unverified: not
+   from the IMX334 datasheet nor measured, 2 for every group writes all of them
+   on the same frame as before */
+static const SensorLatency_t IMX334_Latency = { .exposure = 2, .gain = 2, .vts = 2 };
+
+static const struct vvcam_mode_info pIMX334_mode_info[] = {
 	{
 		.index     = 0,
 		.width     = 3864,
@@ -83,7 +104,6 @@ static struct vvcam_mode_info pIMX334_mode_info[] = {
         .preg_data = (void *)"imx334 3840x2160",
 	},
     */
-    /*
 	{
 		.index     = 1,
 		.width     = 3840,
@@ -95,8 +115,10 @@ static struct vvcam_mode_info pIMX334_mode_info[] = {
 		.bayer_pattern = BAYER_GBRG,
         .mipi_phy_freq = 800, //mbps
         .mipi_line_num = 4,
+        .config_file_3a = "IMX334_3840x2160_raw12", //3aconfig_IMX334_3840x2160_raw12.json
         .preg_data = (void *)"imx334 3840x2160",
 	},
+    /*
 	{
 		.index     = 2,
 		.width    = 1280,
@@ -363,11 +385,43 @@ static RESULT IMX334_IsiGetSensorModeIss(IsiSensorHandle_t handle,void *mode)
     return ( RET_SUCCESS );
 }
 
+static const char *IMX334_RegCfgFileName(uint32_t index)
+{
+    switch (index) {
+        case 0:
+            return "IMX334_mipi4lane_3864_2180_raw12_800mbps_init.txt";
+        case 1: //3Dol mode
+            return "IMX334_mipi4lane_3840_2160_raw12_800mbps_3dol_init.txt";
+        default:
+            return "";
+    }
+}
+
+static RESULT IMX334_IsiGetRegCfgIss(const char *registerFileName, struct vvcam_sccb_array *arry);
+static RESULT IMX334_IsiCheckSensorConnectionIss(IsiSensorHandle_t handle);
+
+/* written at runtime, never a warm restart signature */
+static const uint32_t IMX334_WarmVolatileRegs[] = {
+    0x3000, 0x3001, 0x3002, 0x3030, 0x3031, 0x3032, 0x3058, 0x3059, 0x305a, 0x305c, 0x305d, 0x305e,
+    0x3060, 0x3061, 0x3062, 0x3068, 0x3069, 0x306a, 0x306c, 0x306d, 0x306e, 0x30b2, 0x30b3,
+    0x30e8, 0x30e9, 0x30ea, 0x30eb, 0x30ec, 0x30ed,
+    0x30a0, 0x30a1, 0x30a2, 0x30a3, 0x30a4, 0x30a5, 0x30a6, 0x30a7,
+};
+
+static const SensorWarmOps_t IMX334_WarmOps = {
+    .read          = IMX334_IsiRegisterReadIss,
+    .write         = IMX334_IsiRegisterWriteIss,
+    .pageReg       = SENSOR_WARM_NO_PAGE,
+    .pVolatile     = IMX334_WarmVolatileRegs,
+    .volatileCount = sizeof(IMX334_WarmVolatileRegs) / sizeof(IMX334_WarmVolatileRegs[0]),
+};
+
 static RESULT IMX334_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     RESULT result = RET_SUCCESS;
     IMX334_Context_t *pIMX334Ctx;
 
     TRACE(IMX334_INFO, "%s (enter)\n", __func__);
+    uint64_t createSpan = SensorTraceBegin();
 
     if (!pConfig || !pConfig->pSensor)
         return (RET_NULL_POINTER);
@@ -387,11 +441,14 @@ static RESULT IMX334_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         return (result);
     }
 
+    SensorLatencySchedInit(&pIMX334Ctx->LatencySched, &IMX334_Latency);
     pIMX334Ctx->IsiCtx.HalHandle = pConfig->HalHandle;
     pIMX334Ctx->IsiCtx.pSensor = pConfig->pSensor;
     pIMX334Ctx->GroupHold = BOOL_FALSE;
     pIMX334Ctx->OldGain = 1.0;
     pIMX334Ctx->OldIntegrationTime = 0.01;
+    pIMX334Ctx->DolRatio[0] = IMX334_DOL_RATIO;
+    pIMX334Ctx->DolRatio[1] = IMX334_DOL_RATIO;
     pIMX334Ctx->Configured = BOOL_FALSE;
     pIMX334Ctx->Streaming = BOOL_FALSE;
     pIMX334Ctx->TestPattern = BOOL_FALSE;
@@ -399,7 +456,7 @@ static RESULT IMX334_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     pIMX334Ctx->SensorMode.index = pConfig->SensorModeIndex;
     pConfig->hSensor = (IsiSensorHandle_t) pIMX334Ctx;
 #ifdef SUBDEV_CHAR
-    struct vvcam_mode_info *SensorDefaultMode = NULL;
+    const struct vvcam_mode_info *SensorDefaultMode = NULL;
     for (int i=0; i < sizeof(pIMX334_mode_info)/ sizeof(struct vvcam_mode_info); i++)
     {
         if (pIMX334_mode_info[i].index == pIMX334Ctx->SensorMode.index)
@@ -412,25 +469,17 @@ static RESULT IMX334_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     if (SensorDefaultMode != NULL)
     {
         strcpy(pIMX334Ctx->SensorRegCfgFile, get_vi_config_path());
-        switch(SensorDefaultMode->index)
-        {
-            case 0:
-                strcat(pIMX334Ctx->SensorRegCfgFile,
-                    "IMX334_mipi4lane_3864_2180_raw12_800mbps_init.txt");
-                break;
-                /*
-            case 1: //3Dol mode
-                strcat(pIMX334Ctx->SensorRegCfgFile,
-                    "IMX334_mipi4lane_3840_2160_raw12_800mbps_3dol_init.txt");
-                break;
-            */
-            default:
-                break;
-        }
+        strcat(pIMX334Ctx->SensorRegCfgFile, IMX334_RegCfgFileName(SensorDefaultMode->index));
 
-        if (access(pIMX334Ctx->SensorRegCfgFile, F_OK) == 0) {
+        if (SensorBundleOpen(SensorName, SensorDefaultMode->index, &pIMX334Ctx->ModeBundle) == RET_SUCCESS ||
+            access(pIMX334Ctx->SensorRegCfgFile, F_OK) == 0) {
             pIMX334Ctx->KernelDriverFlag = 0;
             memcpy(&(pIMX334Ctx->SensorMode),SensorDefaultMode,sizeof(struct vvcam_mode_info));
+            /* read the mode data while the sensor powers up */
+            (void)SensorPrefetchStart(&pIMX334Ctx->Prefetch, &pIMX334Ctx->ModeBundle, pIMX334Ctx->SensorRegCfgFile, IMX334_IsiGetRegCfgIss);
+            if (SensorBundleIsOpen(&pIMX334Ctx->ModeBundle)) {
+                (void)SensorProfileSetInit(&pIMX334Ctx->TuningProfiles, &pIMX334Ctx->ModeBundle);
+            }
         } else {
             TRACE(IMX334_ERROR, "%s, %d, load %s: error\n", __func__, __LINE__, pIMX334Ctx->SensorRegCfgFile);
             return -1;
@@ -440,9 +489,12 @@ static RESULT IMX334_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         pIMX334Ctx->KernelDriverFlag = 1;
     }
 
+    uint64_t span = SensorTraceBegin();
     result = IMX334_IsiSensorSetPowerIss(pIMX334Ctx, BOOL_TRUE);
+    SensorTraceEnd(SensorName, "power", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
+    span = SensorTraceBegin();
     uint32_t SensorClkIn;
     if (pIMX334Ctx->KernelDriverFlag) {
         result = IMX334_IsiSensorGetClkIss(pIMX334Ctx, &SensorClkIn);
@@ -450,16 +502,29 @@ static RESULT IMX334_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     }
 
     result = IMX334_IsiSensorSetClkIss(pIMX334Ctx, SensorClkIn);
-    RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
-
-    result = IMX334_IsiResetSensorIss(pIMX334Ctx);
+    SensorTraceEnd(SensorName, "clk", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
     if (!pIMX334Ctx->KernelDriverFlag) {
+        span = SensorTraceBegin();
         result = IMX334_IsiConfigSensorSCCBIss(pIMX334Ctx);
+        SensorTraceEnd(SensorName, "sccb", span);
         RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
     }
 
+    span = SensorTraceBegin();
+    /* a sensor a previous process left in this mode still holds its registers */
+    if (pIMX334Ctx->KernelDriverFlag ||
+        SensorWarmOpen(&pIMX334Ctx->Warm, SensorName, ((HalContext_t *)pIMX334Ctx->IsiCtx.HalHandle)->sensor_fd,
+                       &IMX334_WarmOps, pIMX334Ctx) != RET_SUCCESS ||
+        IMX334_IsiCheckSensorConnectionIss(pIMX334Ctx) != RET_SUCCESS ||
+        SensorWarmProbe(&pIMX334Ctx->Warm, pIMX334Ctx->SensorMode.index) != RET_SUCCESS) {
+        SensorWarmInvalidate(&pIMX334Ctx->Warm);
+        result = IMX334_IsiResetSensorIss(pIMX334Ctx);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+    SensorTraceEnd(SensorName, "reset", span);
+
     pIMX334Ctx->pattern = 3;
 #endif
 
@@ -468,6 +533,7 @@ static RESULT IMX334_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     pIMX334Ctx->subdev = HalGetFdHandle(pConfig->HalHandle, HAL_MODULE_SENSOR);
     pIMX334Ctx->KernelDriverFlag = 1;
 #endif
+    SensorTraceEnd(SensorName, "create", createSpan);
     TRACE(IMX334_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -549,6 +615,389 @@ static RESULT IMX334_IsiGetPicSize(uint32_t Resolution, uint32_t * pwidth,
 }
 #endif
 
+static void IMX334_SetExposureTiming(IMX334_Context_t *pIMX334Ctx, uint32_t lineTimePs)
+{
+    SensorExposureTiming_t *pTiming = &pIMX334Ctx->ExpTiming;
+
+    SensorExposureTimingSet(pTiming, lineTimePs, pIMX334Ctx->MinIntegrationLine, pIMX334Ctx->MaxIntegrationLine);
+    pIMX334Ctx->one_line_exp_time           = (float)lineTimePs / 1e12f;
+    pIMX334Ctx->AecIntegrationTimeIncrement = SensorExposureLinesToTime(pTiming, 1);
+    pIMX334Ctx->AecMinIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->minLines);
+    pIMX334Ctx->AecMaxIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->maxLines);
+}
+
+/* readout layout the 3DOL register set programmed, exposures are placed inside it */
+static RESULT IMX334_ReadDolLayout(IMX334_Context_t *pIMX334Ctx)
+{
+    static const uint32_t base[3] = { 0x3030, 0x3068, 0x306c };     /* VMAX, RHS1, RHS2 */
+    static const uint32_t wdAddr[4] = { IMX334_WDMODE, IMX334_WDSEL, IMX334_WD_SET2, IMX334_OPB_SIZE_V };
+    SensorDolLayout_t *layout;
+    uint32_t value[3], wd[4];
+
+    for (uint32_t i = 0; i < 3; i++) {
+        uint32_t lo = 0, mid = 0, hi = 0;
+        RESULT result = IMX334_IsiRegisterReadIss(pIMX334Ctx, base[i], &lo);
+
+        result |= IMX334_IsiRegisterReadIss(pIMX334Ctx, base[i] + 1, &mid);
+        result |= IMX334_IsiRegisterReadIss(pIMX334Ctx, base[i] + 2, &hi);
+        if (result != RET_SUCCESS) {
+            return (RET_FAILURE);
+        }
+        value[i] = (lo & 0xff) | ((mid & 0xff) << 8) | ((hi & 0x0f) << 16);
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        if (IMX334_IsiRegisterReadIss(pIMX334Ctx, wdAddr[i], &wd[i]) != RET_SUCCESS) {
+            return (RET_FAILURE);
+        }
+    }
+
+    if ((wd[0] & 0x01) == 0 || (wd[1] & 0x03) != 2) {
+        TRACE(IMX334_ERROR, "%s: not a 3DOL register set, WDMODE 0x%02x WDSEL 0x%02x\n", __func__, wd[0], wd[1]);
+        return (RET_FAILURE);
+    }
+    pIMX334Ctx->DolDemux         = (wd[2] & 0x02) ? SENSOR_DOL_DEMUX_VC : SENSOR_DOL_DEMUX_LINE_INFO;
+    pIMX334Ctx->DolEmbeddedLines = wd[3] & 0x3f;
+
+    pIMX334Ctx->DolFsc  = value[0] * IMX334_DOL_FRAMES;
+    pIMX334Ctx->DolRhs1 = value[1];
+    pIMX334Ctx->DolRhs2 = value[2];
+
+    if (pIMX334Ctx->DolRhs1 < 2 * IMX334_DOL_MARGIN ||
+        pIMX334Ctx->DolRhs2 < pIMX334Ctx->DolRhs1 + 2 * IMX334_DOL_MARGIN ||
+        pIMX334Ctx->DolFsc < pIMX334Ctx->DolRhs2 + 2 * IMX334_DOL_MARGIN) {
+        TRACE(IMX334_ERROR, "%s: bad 3DOL layout, FSC %u RHS1 %u RHS2 %u\n", __func__,
+              pIMX334Ctx->DolFsc, pIMX334Ctx->DolRhs1, pIMX334Ctx->DolRhs2);
+        return (RET_FAILURE);
+    }
+
+    /* same windows as IMX334_ExposureWindow(), as line counts */
+    layout = &pIMX334Ctx->DolLayout;
+    layout->count = IMX334_DOL_FRAMES;
+    layout->window[0].maxLines = pIMX334Ctx->DolFsc - pIMX334Ctx->DolRhs2 - IMX334_DOL_MARGIN;
+    layout->window[1].maxLines = pIMX334Ctx->DolRhs1 - IMX334_DOL_MARGIN;
+    layout->window[2].maxLines = pIMX334Ctx->DolRhs2 - pIMX334Ctx->DolRhs1 - IMX334_DOL_MARGIN;
+    for (uint32_t i = 0; i < IMX334_DOL_FRAMES; i++) {
+        layout->window[i].minLines = MAX(pIMX334Ctx->MinIntegrationLine, 1);
+    }
+
+    TRACE(IMX334_INFO, "%s: FSC %u RHS1 %u RHS2 %u, %s, %u OB lines\n", __func__,
+          pIMX334Ctx->DolFsc, pIMX334Ctx->DolRhs1, pIMX334Ctx->DolRhs2,
+          (pIMX334Ctx->DolDemux == SENSOR_DOL_DEMUX_VC) ? "VC" : "LI", pIMX334Ctx->DolEmbeddedLines);
+    return (RET_SUCCESS);
+}
+
+/* last value a register array writes to addr */
+static bool_t IMX334_RegArrayValue(const struct vvcam_sccb_array *pArry, uint32_t addr, uint32_t *pValue)
+{
+    for (uint32_t i = pArry->count; i-- > 0; ) {
+        if (pArry->sccb_data[i].addr == addr) {
+            *pValue = pArry->sccb_data[i].data;
+            return BOOL_TRUE;
+        }
+    }
+
+    return BOOL_FALSE;
+}
+
+/* line period from the HMAX a mode's register set programs */
+static uint32_t IMX334_RegArrayLineTimePs(const struct vvcam_sccb_array *pArry)
+{
+    uint32_t lo, hi;
+
+    if (!IMX334_RegArrayValue(pArry, 0x3034, &lo) || !IMX334_RegArrayValue(pArry, 0x3035, &hi)) {
+        return IMX334_LINE_TIME_PS;
+    }
+
+    return (uint32_t)((uint64_t)((hi << 8) | lo) * 1000000000000ULL / IMX334_PLL_PCLK);
+}
+
+/* exposure limits of SensorMode once its registers are written */
+static RESULT IMX334_SetModeLimits(IMX334_Context_t *pIMX334Ctx, uint32_t lineTimePs)
+{
+    RESULT result;
+
+    switch(pIMX334Ctx->SensorMode.index)
+    {
+        case 0:
+            pIMX334Ctx->FrameLengthLines = 0xac4;
+            pIMX334Ctx->CurFrameLengthLines = pIMX334Ctx->FrameLengthLines;
+            pIMX334Ctx->MaxIntegrationLine = pIMX334Ctx->CurFrameLengthLines - 3;
+            pIMX334Ctx->MinIntegrationLine = 1;
+            pIMX334Ctx->AecMaxGain = 24;
+            pIMX334Ctx->AecMinGain = 3;
+            break;
+        case 1:
+            pIMX334Ctx->FrameLengthLines =  0xac4;
+            pIMX334Ctx->CurFrameLengthLines = pIMX334Ctx->FrameLengthLines;
+            pIMX334Ctx->MaxIntegrationLine = pIMX334Ctx->CurFrameLengthLines - 3;
+            pIMX334Ctx->MinIntegrationLine = 1;
+            pIMX334Ctx->AecMaxGain = 21;
+            pIMX334Ctx->AecMinGain = 3;
+            break;
+        default:
+            return ( RET_NOTAVAILABLE );
+            break;
+    }
+    pIMX334Ctx->enableHdr = (pIMX334Ctx->SensorMode.hdr_mode != SENSOR_MODE_LINEAR);
+    if (pIMX334Ctx->enableHdr) {
+        result = IMX334_ReadDolLayout(pIMX334Ctx);
+        if (result != RET_SUCCESS) {
+            return (result);
+        }
+        /* the long frame integrates from SHR0 to the end of the frame set */
+        pIMX334Ctx->MaxIntegrationLine = pIMX334Ctx->DolLayout.window[0].maxLines;
+    }
+    IMX334_SetExposureTiming(pIMX334Ctx, lineTimePs);
+    pIMX334Ctx->MaxFps  = pIMX334Ctx->SensorMode.fps;
+    pIMX334Ctx->MinFps  = 1;
+    pIMX334Ctx->CurrFps = pIMX334Ctx->MaxFps;
+
+    return (RET_SUCCESS);
+}
+
+static const struct vvcam_mode_info *IMX334_FindMode(uint32_t index)
+{
+    for (uint32_t i = 0; i < sizeof(pIMX334_mode_info) / sizeof(struct vvcam_mode_info); i++) {
+        if (pIMX334_mode_info[i].index == index) {
+            return &pIMX334_mode_info[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* register set of another mode, release with IMX334_ReleaseModeRegs() */
+static RESULT IMX334_LoadModeRegs(uint32_t index, SensorBundle_t *pBundle, struct vvcam_sccb_array *pArry)
+{
+    char fileName[FILENAME_MAX];
+
+    MEMSET(pArry, 0, sizeof(*pArry));
+    if (SensorBundleOpen(SensorName, index, pBundle) == RET_SUCCESS) {
+        return SensorBundleGetRegArray(pBundle, pArry);
+    }
+
+    snprintf(fileName, sizeof(fileName), "%s%s", get_vi_config_path(), IMX334_RegCfgFileName(index));
+    return IMX334_IsiGetRegCfgIss(fileName, pArry);
+}
+
+static void IMX334_ReleaseModeRegs(SensorBundle_t *pBundle, struct vvcam_sccb_array *pArry)
+{
+    if (SensorBundleIsOpen(pBundle)) {
+        (void)SensorBundleClose(pBundle);
+    } else {
+        free(pArry->sccb_data);
+    }
+    MEMSET(pArry, 0, sizeof(*pArry));
+}
+
+/* streaming is controlled by the switch itself */
+static bool_t IMX334_IsStreamReg(uint32_t addr)
+{
+    return (addr == 0x3000 || addr == 0x3002);
+}
+
+/*
+ * Registers that take the sensor from the from mode to the to mode without a
+ * reset: reset values for what only from programs, then the writes of to
+ * that change a value. pDefaults holds the reset values of the registers
+ * only one of the two sets programs.
+ */
+static uint32_t IMX334_ModeDelta(const struct vvcam_sccb_array *pFrom, const struct vvcam_sccb_array *pTo,
+                                 const struct vvcam_sccb_array *pDefaults, struct vvcam_sccb_data *pDelta)
+{
+    uint32_t count = 0, value;
+
+    for (uint32_t i = 0; i < pDefaults->count; i++) {
+        if (!IMX334_RegArrayValue(pTo, pDefaults->sccb_data[i].addr, &value)) {
+            pDelta[count++] = pDefaults->sccb_data[i];
+        }
+    }
+
+    for (uint32_t i = 0; i < pTo->count; i++) {
+        const struct vvcam_sccb_data *pReg = &pTo->sccb_data[i];
+
+        if (IMX334_IsStreamReg(pReg->addr)) {
+            continue;
+        }
+        if (IMX334_RegArrayValue(pFrom, pReg->addr, &value) && value == pReg->data) {
+            continue;
+        }
+        pDelta[count++] = *pReg;
+    }
+
+    return count;
+}
+
+/*
+ * Register deltas between the linear and the 3DOL mode, so that the switches
+ * after the first change over without a reset and a full register load. pCur
+ * is the set of SensorMode, pPeer the one of its counterpart. The sensor must
+ * hold its reset values: the registers only one of the two sets programs are
+ * read from it.
+ */
+static RESULT IMX334_BuildHdrSwitch(IMX334_Context_t *pIMX334Ctx, const struct vvcam_sccb_array *pCur,
+                                    const struct vvcam_sccb_array *pPeer)
+{
+    struct vvcam_sccb_array defaults;
+    uint32_t curHdr, value;
+    RESULT result = RET_SUCCESS;
+
+    curHdr = (pIMX334Ctx->SensorMode.hdr_mode != SENSOR_MODE_LINEAR) ? 1 : 0;
+
+    defaults.count     = 0;
+    defaults.sccb_data = malloc((pCur->count + pPeer->count) * sizeof(struct vvcam_sccb_data));
+    pIMX334Ctx->HdrSwitchRegs[0] = malloc((pCur->count + pPeer->count) * sizeof(struct vvcam_sccb_data));
+    pIMX334Ctx->HdrSwitchRegs[1] = malloc((pCur->count + pPeer->count) * sizeof(struct vvcam_sccb_data));
+    if (defaults.sccb_data == NULL || pIMX334Ctx->HdrSwitchRegs[0] == NULL || pIMX334Ctx->HdrSwitchRegs[1] == NULL) {
+        result = RET_OUTOFMEM;
+        goto out;
+    }
+
+    /* reset values of what only one of the two sets programs */
+    for (uint32_t n = 0; n < 2 && result == RET_SUCCESS; n++) {
+        const struct vvcam_sccb_array *pA = n ? pPeer : pCur;
+        const struct vvcam_sccb_array *pB = n ? pCur : pPeer;
+
+        for (uint32_t i = 0; i < pA->count && result == RET_SUCCESS; i++) {
+            uint32_t addr = pA->sccb_data[i].addr;
+
+            if (IMX334_IsStreamReg(addr) || IMX334_RegArrayValue(pB, addr, &value) ||
+                IMX334_RegArrayValue(&defaults, addr, &value)) {
+                continue;
+            }
+            result = IMX334_IsiRegisterReadIss(pIMX334Ctx, addr, &value);
+            defaults.sccb_data[defaults.count].addr   = addr;
+            defaults.sccb_data[defaults.count++].data = value;
+        }
+    }
+    if (result != RET_SUCCESS) {
+        goto out;
+    }
+
+    pIMX334Ctx->HdrSwitchCount[curHdr] =
+        IMX334_ModeDelta(pPeer, pCur, &defaults, pIMX334Ctx->HdrSwitchRegs[curHdr]);
+    pIMX334Ctx->HdrSwitchCount[!curHdr] =
+        IMX334_ModeDelta(pCur, pPeer, &defaults, pIMX334Ctx->HdrSwitchRegs[!curHdr]);
+    pIMX334Ctx->HdrSwitchLineTimePs[curHdr]  = IMX334_RegArrayLineTimePs(pCur);
+    pIMX334Ctx->HdrSwitchLineTimePs[!curHdr] = IMX334_RegArrayLineTimePs(pPeer);
+
+    TRACE(IMX334_INFO, "%s: %u registers to linear, %u to 3DOL\n", __func__,
+          pIMX334Ctx->HdrSwitchCount[0], pIMX334Ctx->HdrSwitchCount[1]);
+
+out:
+    free(defaults.sccb_data);
+    if (result != RET_SUCCESS) {
+        for (uint32_t i = 0; i < 2; i++) {
+            free(pIMX334Ctx->HdrSwitchRegs[i]);
+            pIMX334Ctx->HdrSwitchRegs[i]  = NULL;
+            pIMX334Ctx->HdrSwitchCount[i] = 0;
+        }
+    }
+    return (result);
+}
+
+/*
+ * Write what takes the sensor into the linear (target 0) or the 3DOL (1)
+ * mode. The first switch resets the sensor, builds the deltas from the reset
+ * values and writes the new mode in full; later ones write only the delta.
+ */
+static RESULT IMX334_WriteHdrSwitch(IMX334_Context_t *pIMX334Ctx, uint32_t target)
+{
+    HalContext_t *pHalCtx = (HalContext_t *) pIMX334Ctx->IsiCtx.HalHandle;
+    uint32_t peer = target ? IMX334_DOL_MODE : IMX334_LINEAR_MODE;
+    struct vvcam_sccb_array curArry, peerArry, arry;
+    SensorBundle_t curBundle, peerBundle;
+    RESULT result;
+
+    if (pIMX334Ctx->HdrSwitchRegs[target] != NULL) {
+        arry.count     = pIMX334Ctx->HdrSwitchCount[target];
+        arry.sccb_data = pIMX334Ctx->HdrSwitchRegs[target];
+        if (ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &arry) != 0) {
+            TRACE(IMX334_ERROR, "%s: write mode delta error!\n", __func__);
+            return (RET_FAILURE);
+        }
+        return (RET_SUCCESS);
+    }
+
+    MEMSET(&curBundle, 0, sizeof(curBundle));
+    MEMSET(&peerBundle, 0, sizeof(peerBundle));
+    MEMSET(&curArry, 0, sizeof(curArry));
+    MEMSET(&peerArry, 0, sizeof(peerArry));
+    result = IMX334_LoadModeRegs(pIMX334Ctx->SensorMode.index, &curBundle, &curArry);
+    if (result == RET_SUCCESS) {
+        result = IMX334_LoadModeRegs(peer, &peerBundle, &peerArry);
+    }
+    if (result == RET_SUCCESS) {
+        result = IMX334_IsiResetSensorIss(pIMX334Ctx);
+    }
+    if (result == RET_SUCCESS) {
+        result = IMX334_BuildHdrSwitch(pIMX334Ctx, &curArry, &peerArry);
+    }
+    if (result == RET_SUCCESS && ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &peerArry) != 0) {
+        TRACE(IMX334_ERROR, "%s: write mode registers error!\n", __func__);
+        result = RET_FAILURE;
+    }
+
+    IMX334_ReleaseModeRegs(&peerBundle, &peerArry);
+    IMX334_ReleaseModeRegs(&curBundle, &curArry);
+    return (result);
+}
+
+/* mode and exposure limits the kernel driver reports for the mode in force */
+static RESULT IMX334_KernelModeLimits(IMX334_Context_t *pIMX334Ctx)
+{
+    HalContext_t *pHalCtx = (HalContext_t *) pIMX334Ctx->IsiCtx.HalHandle;
+    int ret;
+
+    ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pIMX334Ctx->SensorMode));
+    if (ret != 0) {
+        TRACE(IMX334_ERROR, "%s:sensor get mode info error!\n",
+              __func__);
+        return (RET_FAILURE);
+    }
+
+#ifdef SUBDEV_CHAR
+    struct vvcam_ae_info_s ae_info;
+    ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_AE_INFO, &ae_info);
+    if (ret != 0) {
+        TRACE(IMX334_ERROR, "%s:sensor get ae info error!\n",
+              __func__);
+        return (RET_FAILURE);
+    }
+    pIMX334Ctx->MaxIntegrationLine = ae_info.max_integration_time;
+    pIMX334Ctx->MinIntegrationLine = ae_info.min_integration_time;
+    IMX334_SetExposureTiming(pIMX334Ctx, ae_info.one_line_exp_time_ns * SENSOR_EXPOSURE_PS_PER_NS);
+    pIMX334Ctx->gain_accuracy = ae_info.gain_accuracy;
+    pIMX334Ctx->AecMinGain =  1.0;
+    pIMX334Ctx->AecMaxGain = 36;
+
+    pIMX334Ctx->MaxFps  = pIMX334Ctx->SensorMode.fps;
+    pIMX334Ctx->MinFps  = 1;
+    pIMX334Ctx->CurrFps = pIMX334Ctx->MaxFps;
+#endif
+
+#ifdef SUBDEV_V4L2
+    pIMX334Ctx->FrameLengthLines = 0xac4;
+    pIMX334Ctx->CurFrameLengthLines = pIMX334Ctx->FrameLengthLines;
+    pIMX334Ctx->MaxIntegrationLine = pIMX334Ctx->CurFrameLengthLines - 3;
+    pIMX334Ctx->MinIntegrationLine = 1;
+    IMX334_SetExposureTiming(pIMX334Ctx, IMX334_LINE_TIME_PS);
+    pIMX334Ctx->AecMaxGain = 24;
+    pIMX334Ctx->AecMinGain = 3;
+    pIMX334Ctx->MaxFps  = pIMX334Ctx->SensorMode.fps;
+    pIMX334Ctx->MinFps  = 1;
+    pIMX334Ctx->CurrFps = pIMX334Ctx->MaxFps;
+    pIMX334Ctx->gain_accuracy = 1024;
+
+    if (pIMX334Ctx->SensorMode.hdr_mode != SENSOR_MODE_LINEAR)
+    {
+        pIMX334Ctx->enableHdr = 1;
+    }
+#endif
+
+    return (RET_SUCCESS);
+}
+
 static RESULT IMX334_IsiInitSensorIss(IsiSensorHandle_t handle) {
     RESULT result = RET_SUCCESS;
     int ret = 0;
@@ -557,6 +1006,7 @@ static RESULT IMX334_IsiInitSensorIss(IsiSensorHandle_t handle) {
     HalContext_t *pHalCtx = (HalContext_t *) pIMX334Ctx->IsiCtx.HalHandle;
 
     TRACE(IMX334_INFO, "%s (enter)\n", __func__);
+    uint64_t initSpan = SensorTraceBegin();
     if (pIMX334Ctx == NULL) {
         return (RET_WRONG_HANDLE);
     }
@@ -569,102 +1019,70 @@ static RESULT IMX334_IsiInitSensorIss(IsiSensorHandle_t handle) {
                   __func__);
             return (RET_FAILURE);
         }
-
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pIMX334Ctx->SensorMode));
-        if (ret != 0) {
-            TRACE(IMX334_ERROR, "%s:sensor get mode info error!\n",
-                  __func__);
-            return (RET_FAILURE);
-        }
-
-        struct vvcam_ae_info_s ae_info;
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_AE_INFO, &ae_info);
-        if (ret != 0) {
-            TRACE(IMX334_ERROR, "%s:sensor get ae info error!\n",
-                  __func__);
-            return (RET_FAILURE);
-        }
-        pIMX334Ctx->one_line_exp_time  = IMX334_HMAX/IMX334_PLL_PCLK;
-        pIMX334Ctx->MaxIntegrationLine = ae_info.max_integration_time;
-        pIMX334Ctx->MinIntegrationLine = ae_info.min_integration_time;
-        pIMX334Ctx->gain_accuracy = ae_info.gain_accuracy;
-        pIMX334Ctx->AecMinGain =  1.0;
-        pIMX334Ctx->AecMaxGain = 36;
-
-        pIMX334Ctx->MaxFps  = pIMX334Ctx->SensorMode.fps;
-        pIMX334Ctx->MinFps  = 1;
-        pIMX334Ctx->CurrFps = pIMX334Ctx->MaxFps;
-#endif
-
-#ifdef SUBDEV_V4L2
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pIMX334Ctx->SensorMode));
-        if (ret != 0) {
-            TRACE(IMX334_ERROR, "%s:sensor get mode info error!\n",
-                  __func__);
-            return (RET_FAILURE);
-        }
-        pIMX334Ctx->one_line_exp_time = IMX334_HMAX/IMX334_PLL_PCLK;
-        pIMX334Ctx->FrameLengthLines = 0xac4;
-        pIMX334Ctx->CurFrameLengthLines = pIMX334Ctx->FrameLengthLines;
-        pIMX334Ctx->MaxIntegrationLine = pIMX334Ctx->CurFrameLengthLines - 3;
-        pIMX334Ctx->MinIntegrationLine = 1;
-        pIMX334Ctx->AecMaxGain = 24;
-        pIMX334Ctx->AecMinGain = 3;
-        pIMX334Ctx->CurrFps = pIMX334Ctx->MaxFps;
-        pIMX334Ctx->gain_accuracy = 1024;
-
-        if (pIMX334Ctx->SensorMode.hdr_mode != SENSOR_MODE_LINEAR)
-        {
-            pIMX334Ctx->enableHdr = 1;
-        }
 #endif
-
+        result = IMX334_KernelModeLimits(pIMX334Ctx);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
     } else {
         struct vvcam_sccb_array arry;
-        result = IMX334_IsiGetRegCfgIss(pIMX334Ctx->SensorRegCfgFile, &arry);
+        uint64_t span = SensorTraceBegin();
+        SensorPrefetchWait(&pIMX334Ctx->Prefetch);
+        if (SensorBundleIsOpen(&pIMX334Ctx->ModeBundle)) {
+            result = SensorBundleGetRegArray(&pIMX334Ctx->ModeBundle, &arry);
+        } else if (SensorPrefetchTakeRegs(&pIMX334Ctx->Prefetch, &arry) != RET_SUCCESS) {
+            result = IMX334_IsiGetRegCfgIss(pIMX334Ctx->SensorRegCfgFile, &arry);
+        }
+        SensorTraceEnd(SensorName, "load", span);
         if (result != 0) {
             TRACE(IMX334_ERROR,
                   "%s:IMX334_IsiGetRegCfgIss error!\n", __func__);
             return (RET_FAILURE);
         }
 
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &arry);
-        if (ret != 0) {
-            TRACE(IMX334_ERROR, "%s:Sensor Write Reg arry error!\n",
-                  __func__);
-            return (RET_FAILURE);
+        bool_t warm = pIMX334Ctx->Warm.resumed;
+        uint64_t regHash = SensorBundleHash(arry.sccb_data, arry.count * sizeof(struct vvcam_sccb_data),
+                                            SENSOR_BUNDLE_FNV_SEED);
+        bool_t resume = SensorWarmResume(&pIMX334Ctx->Warm, regHash);
+        if (warm && !resume) {
+            /* create skipped the reset, but the register set changed since */
+            result = IMX334_IsiResetSensorIss(pIMX334Ctx);
+            RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
         }
 
-        switch(pIMX334Ctx->SensorMode.index)
-        {
-            case 0:
-                pIMX334Ctx->one_line_exp_time = IMX334_HMAX/IMX334_PLL_PCLK;
-                pIMX334Ctx->FrameLengthLines = 0xac4;
-                pIMX334Ctx->CurFrameLengthLines = pIMX334Ctx->FrameLengthLines;
-                pIMX334Ctx->MaxIntegrationLine = pIMX334Ctx->CurFrameLengthLines - 3;
-                pIMX334Ctx->MinIntegrationLine = 1;
-                pIMX334Ctx->AecMaxGain = 24;
-                pIMX334Ctx->AecMinGain = 3;
-                break;
-            case 1:
-                pIMX334Ctx->one_line_exp_time = IMX334_HMAX/IMX334_PLL_PCLK;
-                pIMX334Ctx->FrameLengthLines =  0xac4;
-                pIMX334Ctx->CurFrameLengthLines = pIMX334Ctx->FrameLengthLines;
-                pIMX334Ctx->MaxIntegrationLine = pIMX334Ctx->CurFrameLengthLines - 3;
-                pIMX334Ctx->MinIntegrationLine = 1;
-                pIMX334Ctx->AecMaxGain = 21;
-                pIMX334Ctx->AecMinGain = 3;
-                break;
-            default:
-                return ( RET_NOTAVAILABLE );
-                break;
+        if (resume) {
+            TRACE(IMX334_INFO, "%s: warm restart, register set skipped\n", __func__);
+        } else {
+            span = SensorTraceBegin();
+            ret = SensorInitWriteRegs(&pIMX334Ctx->InitAsync, pHalCtx->sensor_fd, &arry);
+            SensorTraceEnd(SensorName, "write", span);
+            if (ret != 0) {
+                TRACE(IMX334_ERROR, "%s:Sensor Write Reg arry error!\n",
+                      __func__);
+                return (RET_FAILURE);
+            }
+            (void)SensorWarmCommit(&pIMX334Ctx->Warm, pIMX334Ctx->SensorMode.index, regHash, &arry);
+        }
+
+        result = IMX334_SetModeLimits(pIMX334Ctx, IMX334_RegArrayLineTimePs(&arry));
+        if (result != RET_SUCCESS) {
+            return (result);
         }
-        pIMX334Ctx->MaxFps  = pIMX334Ctx->SensorMode.fps;
-        pIMX334Ctx->MinFps  = 1;
-        pIMX334Ctx->CurrFps = pIMX334Ctx->MaxFps;
     }
 
+    /* the tuning may allow the sensor less gain than the mode can do */
+    pIMX334Ctx->AecMaxGain = SensorGainArbiterInit(&pIMX334Ctx->GainArbiter, &pIMX334Ctx->TuningProfiles, pIMX334Ctx->AecMaxGain);
+
+    if (pIMX334Ctx->Warm.resumed) {
+        float gain, integrationTime, hdrRatio, setGain, setIntegrationTime;
+        uint8_t skip;
+
+        /* carry on with the exposure the sensor streamed with */
+        if (SensorWarmLastExposure(&pIMX334Ctx->Warm, &gain, &integrationTime, &hdrRatio)) {
+            (void)IMX334_IsiExposureControlIss(handle, gain, integrationTime, &skip,
+                                               &setGain, &setIntegrationTime, &hdrRatio);
+        }
+    }
 
+    SensorTraceEnd(SensorName, "init", initSpan);
     TRACE(IMX334_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -677,10 +1095,21 @@ static RESULT IMX334_IsiReleaseSensorIss(IsiSensorHandle_t handle) {
     if (pIMX334Ctx == NULL)
         return (RET_WRONG_HANDLE);
 
+    /* an initialization still running in the background uses the context */
+    (void)SensorInitAsyncWait(&pIMX334Ctx->InitAsync);
+
     (void)IMX334_IsiSensorSetStreamingIss(pIMX334Ctx, BOOL_FALSE);
     (void)IMX334_IsiSensorSetPowerIss(pIMX334Ctx, BOOL_FALSE);
     (void)HalDelRef(pIMX334Ctx->IsiCtx.HalHandle);
 
+    SensorWarmClose(&pIMX334Ctx->Warm, BOOL_TRUE);
+
+    SensorPrefetchRelease(&pIMX334Ctx->Prefetch);
+    SensorLatencySchedRelease(&pIMX334Ctx->LatencySched);
+    (void)SensorBundleClose(&pIMX334Ctx->ModeBundle);
+    free(pIMX334Ctx->HdrSwitchRegs[0]);
+    free(pIMX334Ctx->HdrSwitchRegs[1]);
+
     MEMSET(pIMX334Ctx, 0, sizeof(IMX334_Context_t));
     free(pIMX334Ctx);
     TRACE(IMX334_INFO, "%s (exit)\n", __func__);
@@ -778,7 +1207,7 @@ static RESULT IMX334_AecSetModeParameters
     TRACE(IMX334_INFO, "%s%s: (enter)\n", __func__,
           pIMX334Ctx->isAfpsRun ? "(AFPS)" : "");
 
-    pIMX334Ctx->AecIntegrationTimeIncrement = pIMX334Ctx->one_line_exp_time;
+    pIMX334Ctx->AecIntegrationTimeIncrement = SensorExposureLinesToTime(&pIMX334Ctx->ExpTiming, 1);
     pIMX334Ctx->AecMinIntegrationTime = 0.001;
     pIMX334Ctx->AecMaxIntegrationTime = 0.033;
 
@@ -824,6 +1253,7 @@ static RESULT IMX334_IsiSetupSensorIss
     RESULT result = RET_SUCCESS;
 
     TRACE(IMX334_INFO, "%s (enter)\n", __func__);
+    uint64_t setupSpan = SensorTraceBegin();
 
     if (!pIMX334Ctx) {
         TRACE(IMX334_ERROR,
@@ -847,7 +1277,9 @@ static RESULT IMX334_IsiSetupSensorIss
 
     /* 1.) SW reset of image sensor (via I2C register interface)  be careful, bits 6..0 are reserved, reset bit is not sticky */
     TRACE(IMX334_DEBUG, "%s: IMX334 System-Reset executed\n", __func__);
+    uint64_t span = SensorTraceBegin();
     osSleep(100);
+    SensorTraceEnd(SensorName, "settle", span);
 
     result = IMX334_AecSetModeParameters(pIMX334Ctx, pConfig);
     if (result != RET_SUCCESS) {
@@ -863,6 +1295,7 @@ static RESULT IMX334_IsiSetupSensorIss
 #endif
 
     pIMX334Ctx->Configured = BOOL_TRUE;
+    SensorTraceEnd(SensorName, "setup", setupSpan);
     TRACE(IMX334_INFO, "%s: (exit)\n", __func__);
     return 0;
 }
@@ -1055,6 +1488,7 @@ static RESULT IMX334_IsiSensorSetStreamingIss
     RESULT result = RET_SUCCESS;
     int ret = 0;
     TRACE(IMX334_INFO, "%s (enter)\n", __func__);
+    uint64_t streamSpan = SensorTraceBegin();
 
     IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
     if (pIMX334Ctx == NULL || pIMX334Ctx->IsiCtx.HalHandle == NULL) {
@@ -1079,6 +1513,7 @@ static RESULT IMX334_IsiSensorSetStreamingIss
 
     pIMX334Ctx->Streaming = on;
 
+    SensorTraceEnd(SensorName, on ? "stream on" : "stream off", streamSpan);
     TRACE(IMX334_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -1224,7 +1659,7 @@ static RESULT IMX334_IsiGetIntegrationTimeLimitsIss
     }
 
     *pMinIntegrationTime = pIMX334Ctx->AecMinIntegrationTime;
-    *pMaxIntegrationTime = pIMX334Ctx->AecMaxIntegrationTime;
+    *pMaxIntegrationTime = SensorAntiFlickerSnapTime(&pIMX334Ctx->AntiFlicker, pIMX334Ctx->AecMaxIntegrationTime);
 
     TRACE(IMX334_INFO, "%s: (enter)\n", __func__);
     return (result);
@@ -1298,12 +1733,24 @@ RESULT IMX334_IsiGetGainIncrementIss(IsiSensorHandle_t handle, float *pIncr) {
     return (result);
 }
 
+/* GAIN registers count 0.3 dB steps */
+static uint32_t IMX334_GainToCode(float gain)
+{
+    float db = 20.0f * log10f(MAX(gain, 1.0f));
+
+    return MIN((uint32_t)(db / IMX334_GAIN_STEP_DB + 0.5f), IMX334_GAIN_CODE_MAX);
+}
+
+static float IMX334_CodeToGain(uint32_t code)
+{
+    return powf(10.0f, (float)code * IMX334_GAIN_STEP_DB / 20.0f);
+}
+
 RESULT IMX334_IsiSetGainIss
     (IsiSensorHandle_t handle,
      float NewGain, float *pSetGain, float *hdr_ratio) {
 
     RESULT result = RET_SUCCESS;
-    return result;
     int32_t ret = 0;
 
     IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
@@ -1330,13 +1777,13 @@ RESULT IMX334_IsiSetGainIss
             return RET_FAILURE;
         }
     } else {
-		uint32_t Gain = 0;
-		Gain = (uint32_t)(20*log10(NewGain)*(10/3)) ;
+		uint32_t Gain = IMX334_GainToCode(NewGain);
                 result = IMX334_IsiRegisterWriteIss(handle, 0x3001, 0x01);
                 result =IMX334_IsiRegisterWriteIss(handle, 0x30e8,(Gain & 0x00ff));
                 result =IMX334_IsiRegisterWriteIss(handle, 0x30e9,(Gain & 0x0700)>>8);
                 result = IMX334_IsiRegisterWriteIss(handle, 0x3001, 0x00);
-		pIMX334Ctx->OldGain = NewGain;
+		pIMX334Ctx->OldGain = Gain;
+		NewGain = IMX334_CodeToGain(Gain);
         }
 
 
@@ -1369,13 +1816,13 @@ RESULT IMX334_IsiSetSEF1GainIss(IsiSensorHandle_t handle,float NewIntegrationTim
         SensorGain = NewGain * pIMX334Ctx->gain_accuracy;
         ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_VSGAIN, &SensorGain);
     } else {
-	    uint32_t Gain = 0;
-            Gain = (uint32_t)(20*log10(NewGain)*(10/3)) ;
+	    uint32_t Gain = IMX334_GainToCode(NewGain);
             result = IMX334_IsiRegisterWriteIss(handle, 0x3001, 0x01);
             result =IMX334_IsiRegisterWriteIss(handle, 0x30EA, (Gain & 0x00FF));
             result =IMX334_IsiRegisterWriteIss(handle, 0x30EB, (Gain & 0x0700)>>8);
 	    result = IMX334_IsiRegisterWriteIss(handle, 0x3001, 0x00);
-            pIMX334Ctx->OldGainSEF1 = NewGain;
+            pIMX334Ctx->OldGainSEF1 = Gain;
+            NewGain = IMX334_CodeToGain(Gain);
     }
 
     pIMX334Ctx->AecCurGainSEF1 = NewGain;
@@ -1551,27 +1998,27 @@ RESULT IMX334_IsiSetIntegrationTimeIss
         return (RET_NULL_POINTER);
     }
 
-    exp = NewIntegrationTime / pIMX334Ctx->one_line_exp_time;
+    exp = SensorExposureTimeToLines(&pIMX334Ctx->ExpTiming, NewIntegrationTime);
 
     TRACE(IMX334_DEBUG, "%s: set AEC_PK_EXPO=0x%05x\n", __func__, exp);
 
-    if (NewIntegrationTime != pIMX334Ctx->OldIntegrationTime) {
+    if (exp != pIMX334Ctx->OldIntegrationTime) {
+        pIMX334Ctx->OldIntegrationTime = exp;
         if (pIMX334Ctx->KernelDriverFlag) {
             ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_EXP, &exp);
         } else {
-
-            exp = 2200 - exp +1;
-            exp = exp > 5?exp:5;
-            exp = exp <IMX334_VMAX - 1 ? exp:IMX334_VMAX - 1;
+            int32_t shr = 2200 - (int32_t)exp + 1;
+            shr = shr > 5 ? shr : 5;
+            shr = shr < IMX334_VMAX - 1 ? shr : IMX334_VMAX - 1;
             result = IMX334_IsiRegisterWriteIss(handle, 0x3001, 0x01);
-            result = IMX334_IsiRegisterWriteIss(handle, 0x3058, (exp & 0x0000FF));
-            result = IMX334_IsiRegisterWriteIss(handle, 0x3059, (exp & 0x00FF00)>>8);
-            result = IMX334_IsiRegisterWriteIss(handle, 0x305a, (exp & 0x070000)>>16);
+            result = IMX334_IsiRegisterWriteIss(handle, 0x3058, (shr & 0x0000FF));
+            result = IMX334_IsiRegisterWriteIss(handle, 0x3059, (shr & 0x00FF00)>>8);
+            result = IMX334_IsiRegisterWriteIss(handle, 0x305a, (shr & 0x070000)>>16);
             result = IMX334_IsiRegisterWriteIss(handle, 0x3001, 0x00);
+            exp = MAX(2200 - shr + 1, 0);   // lines actually applied
         }
 
-        pIMX334Ctx->OldIntegrationTime = NewIntegrationTime ;
-        pIMX334Ctx->AecCurIntegrationTime = NewIntegrationTime;
+        pIMX334Ctx->AecCurIntegrationTime = SensorExposureLinesToTime(&pIMX334Ctx->ExpTiming, exp);
 
         *pNumberOfFramesToSkip = 1U;
     } else {
@@ -1608,24 +2055,25 @@ RESULT IMX334_IsiSetSEF1IntegrationTimeIss(IsiSensorHandle_t handle, float NewIn
           pIMX334Ctx->AecMaxIntegrationTime, pIMX334Ctx->AecMinIntegrationTime);
 
 
-    exp = NewIntegrationTime / pIMX334Ctx->one_line_exp_time;
+    exp = SensorExposureTimeToLines(&pIMX334Ctx->ExpTiming, NewIntegrationTime);
 
-    if (NewIntegrationTime != pIMX334Ctx->OldIntegrationTimeSEF1) {
+    if (exp != pIMX334Ctx->OldIntegrationTimeSEF1) {
+        pIMX334Ctx->OldIntegrationTimeSEF1 = exp;
         if (pIMX334Ctx->KernelDriverFlag) {
             ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_VSEXP, &exp);
         } else {
-            exp = 2200- exp +1;
-	    exp = exp > 5 ? exp : 5;
-            exp = exp < IMX334_VMAX - 1 ? exp : IMX334_VMAX - 1;
+            int32_t shr = 2200 - (int32_t)exp + 1;
+            shr = shr > 5 ? shr : 5;
+            shr = shr < IMX334_VMAX - 1 ? shr : IMX334_VMAX - 1;
 	    result = IMX334_IsiRegisterWriteIss(handle, 0x3001, 0x01);
-	    result = IMX334_IsiRegisterWriteIss(handle, 0x305c,(exp & 0x0000ff));
-            result = IMX334_IsiRegisterWriteIss(handle, 0x305D,(exp & 0x00ff00)>>8);
-            result = IMX334_IsiRegisterWriteIss(handle, 0x305e,(exp & 0x070000)>>16);
+	    result = IMX334_IsiRegisterWriteIss(handle, 0x305c,(shr & 0x0000ff));
+            result = IMX334_IsiRegisterWriteIss(handle, 0x305D,(shr & 0x00ff00)>>8);
+            result = IMX334_IsiRegisterWriteIss(handle, 0x305e,(shr & 0x070000)>>16);
 	    result = IMX334_IsiRegisterWriteIss(handle, 0x3001, 0x00);
+            exp = MAX(2200 - shr + 1, 0);   // lines actually applied
         }
 
-        pIMX334Ctx->OldIntegrationTimeSEF1 = NewIntegrationTime;
-        pIMX334Ctx->AecCurIntegrationTimeSEF1 = NewIntegrationTime;
+        pIMX334Ctx->AecCurIntegrationTimeSEF1 = SensorExposureLinesToTime(&pIMX334Ctx->ExpTiming, exp);
         *pNumberOfFramesToSkip = 1U;
     } else {
         *pNumberOfFramesToSkip = 0U;
@@ -1639,14 +2087,97 @@ RESULT IMX334_IsiSetSEF1IntegrationTimeIss(IsiSensorHandle_t handle, float NewIn
     return (result);
 }
 
+/* shutter window of exposure frame n: integration = end - SHR, SHR from lo */
+static void IMX334_ExposureWindow(const IMX334_Context_t *pIMX334Ctx, uint32_t n, uint32_t *pLo, uint32_t *pEnd)
+{
+    if (!pIMX334Ctx->enableHdr) {
+        *pLo  = IMX334_SHR_MIN;
+        *pEnd = IMX334_LINEAR_EXP_END;
+        return;
+    }
+
+    switch (n) {
+        case 0:     /* long, after the SEF2 readout up to the end of the frame set */
+            *pLo  = pIMX334Ctx->DolRhs2 + IMX334_DOL_MARGIN;
+            *pEnd = pIMX334Ctx->DolFsc;
+            break;
+        case 1:
+            *pLo  = IMX334_DOL_MARGIN;
+            *pEnd = pIMX334Ctx->DolRhs1;
+            break;
+        default:
+            *pLo  = pIMX334Ctx->DolRhs1 + IMX334_DOL_MARGIN;
+            *pEnd = pIMX334Ctx->DolRhs2;
+            break;
+    }
+}
+
+/*
+ * Shutter and gain of count exposure frames (1 linear, 3 in 3DOL) as one
+ * register array under REGHOLD, so they all latch on the same frame.
+ * pLines and pCode receive what was applied.
+ */
+static RESULT IMX334_WriteExposure(IMX334_Context_t *pIMX334Ctx, uint32_t count,
+                                   uint32_t *pLines, const float *pGain, uint32_t *pCode)
+{
+    static const uint32_t shrAddr[IMX334_DOL_FRAMES]  = { 0x3058, 0x305c, 0x3060 };
+    static const uint32_t gainAddr[IMX334_DOL_FRAMES] = { 0x30e8, 0x30ea, 0x30ec };
+    HalContext_t *pHalCtx = (HalContext_t *) pIMX334Ctx->IsiCtx.HalHandle;
+    struct vvcam_sccb_data regs[2 + 5 * IMX334_DOL_FRAMES];
+    struct vvcam_sccb_array arry;
+    uint32_t n = 0;
+
+    regs[n].addr = IMX334_REGHOLD;
+    regs[n++].data = 0x01;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t lo, end, shr;
+
+        IMX334_ExposureWindow(pIMX334Ctx, i, &lo, &end);
+        shr = (end > pLines[i]) ? end - pLines[i] : 0;
+        shr = MIN(MAX(shr, lo), end - MAX(pIMX334Ctx->MinIntegrationLine, 1));
+        pLines[i] = end - shr;
+        pCode[i]  = IMX334_GainToCode(pGain[i]);
+
+        regs[n].addr = shrAddr[i];
+        regs[n++].data = shr & 0xff;
+        regs[n].addr = shrAddr[i] + 1;
+        regs[n++].data = (shr >> 8) & 0xff;
+        regs[n].addr = shrAddr[i] + 2;
+        regs[n++].data = (shr >> 16) & 0x0f;
+        regs[n].addr = gainAddr[i];
+        regs[n++].data = pCode[i] & 0xff;
+        regs[n].addr = gainAddr[i] + 1;
+        regs[n++].data = (pCode[i] >> 8) & 0x07;
+    }
+
+    regs[n].addr = IMX334_REGHOLD;
+    regs[n++].data = 0x00;
+
+    arry.count     = n;
+    arry.sccb_data = regs;
+    if (ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &arry) != 0) {
+        TRACE(IMX334_ERROR, "%s: write exposure registers error!\n", __func__);
+        return (RET_FAILURE);
+    }
+
+    return (RET_SUCCESS);
+}
+
 RESULT IMX334_IsiExposureControlIss(IsiSensorHandle_t handle,float NewGain,float NewIntegrationTime,
  				    uint8_t * pNumberOfFramesToSkip,float *pSetGain, float *pSetIntegrationTime, float *hdr_ratio)
 {
     IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
     RESULT result = RET_SUCCESS;
+    SensorFrameMeta_t meta;
+    uint32_t frame, validFrame;
+    uint32_t lines[IMX334_DOL_FRAMES], code[IMX334_DOL_FRAMES] = { 0 };
+    float gain[IMX334_DOL_FRAMES];
+    uint32_t count = 1;
+    SensorDolSolution_t dol;
+
     TRACE(IMX334_INFO, "%s: (enter)\n", __func__);
 
-    return result;
     if (pIMX334Ctx == NULL) {
         TRACE(IMX334_ERROR,
               "%s: Invalid sensor handle (NULL pointer detected)\n",
@@ -1662,14 +2193,102 @@ RESULT IMX334_IsiExposureControlIss(IsiSensorHandle_t handle,float NewGain,float
         return (RET_NULL_POINTER);
     }
 
+    SensorAntiFlickerApply(&pIMX334Ctx->AntiFlicker, &NewGain, &NewIntegrationTime);
+    NewGain = MIN(MAX(NewGain, pIMX334Ctx->AecMinGain), pIMX334Ctx->AecMaxGain);
 
-    if (pIMX334Ctx->enableHdr)
-    {
-        result = IMX334_IsiSetSEF1IntegrationTimeIss(handle, NewIntegrationTime,pSetIntegrationTime,pNumberOfFramesToSkip,hdr_ratio);
-        result = IMX334_IsiSetSEF1GainIss(handle, NewIntegrationTime, NewGain,pSetGain, hdr_ratio);
-    }
-    result = IMX334_IsiSetIntegrationTimeIss(handle, NewIntegrationTime,pSetIntegrationTime,pNumberOfFramesToSkip, hdr_ratio);
-    result =  IMX334_IsiSetGainIss(handle, NewGain,  pSetGain,  hdr_ratio);
+    if (pIMX334Ctx->KernelDriverFlag) {
+        /* the kernel driver sequences its own writes */
+        if (pIMX334Ctx->enableHdr)
+        {
+            result = IMX334_IsiSetSEF1IntegrationTimeIss(handle, NewIntegrationTime,pSetIntegrationTime,pNumberOfFramesToSkip,hdr_ratio);
+            if (result == RET_SUCCESS) {
+                result = IMX334_IsiSetSEF1GainIss(handle, NewIntegrationTime, NewGain,pSetGain, hdr_ratio);
+            }
+        }
+        if (result == RET_SUCCESS) {
+            result = IMX334_IsiSetIntegrationTimeIss(handle, NewIntegrationTime,pSetIntegrationTime,pNumberOfFramesToSkip, hdr_ratio);
+        }
+        if (result == RET_SUCCESS) {
+            result = IMX334_IsiSetGainIss(handle, NewGain,  pSetGain,  hdr_ratio);
+        }
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+        if (hdr_ratio != NULL) {
+            pIMX334Ctx->CurHdrRatio = *hdr_ratio;
+        }
+    } else {
+        lines[0] = SensorExposureTimeToLines(&pIMX334Ctx->ExpTiming, NewIntegrationTime);
+        gain[0]  = NewGain;
+        if (pIMX334Ctx->enableHdr) {
+            /* hdr_ratio[0] is long / SEF1, hdr_ratio[1] SEF1 / SEF2; AE internal calls pass 1 */
+            const float *ratio = (hdr_ratio != NULL && hdr_ratio[0] > 1.0f) ? hdr_ratio : pIMX334Ctx->DolRatio;
+            SensorDolLayout_t layout = pIMX334Ctx->DolLayout;
+            SensorDolWindow_t *pLong = &layout.window[0];
+
+            /* the long exposure may only move as far as the gain can make up for */
+            pLong->minLines = MAX(pLong->minLines, (uint32_t)ceilf(lines[0] * NewGain / pIMX334Ctx->AecMaxGain));
+            pLong->maxLines = MIN(pLong->maxLines, (uint32_t)(lines[0] * NewGain / pIMX334Ctx->AecMinGain));
+            pLong->maxLines = MAX(pLong->maxLines, pLong->minLines);
+
+            result = SensorDolSolve(&layout, lines[0], ratio, &dol);
+            if (result != RET_SUCCESS) {
+                TRACE(IMX334_ERROR, "%s: no DOL layout to fit the exposures into\n", __func__);
+                return (result);
+            }
+            if (!dol.exact) {
+                TRACE(IMX334_DEBUG, "%s: ratio %.2f/%.2f does not fit, %.2f/%.2f applied\n", __func__,
+                      ratio[0], ratio[1], dol.ratio[0], dol.ratio[1]);
+            }
+            /* the long exposure moved to keep the ratio, gain makes up for it */
+            if (dol.lines[0] != lines[0]) {
+                NewGain = MIN(MAX(NewGain * (float)lines[0] / (float)dol.lines[0],
+                                  pIMX334Ctx->AecMinGain), pIMX334Ctx->AecMaxGain);
+            }
+            for (uint32_t i = 0; i < IMX334_DOL_FRAMES; i++) {
+                lines[i] = dol.lines[i];
+                gain[i]  = NewGain;
+            }
+            count = IMX334_DOL_FRAMES;
+        }
+
+        result = IMX334_WriteExposure(pIMX334Ctx, count, lines, gain, code);
+        if (result != RET_SUCCESS) {
+            return (result);
+        }
+
+        pIMX334Ctx->OldIntegrationTime    = lines[0];
+        pIMX334Ctx->OldGain               = code[0];
+        pIMX334Ctx->AecCurIntegrationTime = SensorExposureLinesToTime(&pIMX334Ctx->ExpTiming, lines[0]);
+        pIMX334Ctx->AecCurGain            = IMX334_CodeToGain(code[0]);
+        if (count == IMX334_DOL_FRAMES) {
+            pIMX334Ctx->OldIntegrationTimeSEF1    = lines[1];
+            pIMX334Ctx->OldIntegrationTimeSEF2    = lines[2];
+            pIMX334Ctx->OldGainSEF1               = code[1];
+            pIMX334Ctx->AecCurIntegrationTimeSEF1 = SensorExposureLinesToTime(&pIMX334Ctx->ExpTiming, lines[1]);
+            pIMX334Ctx->AecCurIntegrationTimeSEF2 = SensorExposureLinesToTime(&pIMX334Ctx->ExpTiming, lines[2]);
+            pIMX334Ctx->AecCurGainSEF1            = IMX334_CodeToGain(code[1]);
+            pIMX334Ctx->AecCurGainSEF2            = IMX334_CodeToGain(code[2]);
+            pIMX334Ctx->CurHdrRatio               = (float)lines[0] / (float)lines[1];
+        }
+
+        *pSetGain            = pIMX334Ctx->AecCurGain;
+        *pSetIntegrationTime = pIMX334Ctx->AecCurIntegrationTime;
+    }
+    validFrame = SensorLatencyWritten(&pIMX334Ctx->LatencySched, &frame);
+    *pNumberOfFramesToSkip = validFrame - frame;
+
+    meta.frame           = validFrame;
+    meta.lines           = SensorExposureTimeToLines(&pIMX334Ctx->ExpTiming, *pSetIntegrationTime);
+    meta.again           = code[0];
+    meta.dgain           = 0;
+    meta.vts             = pIMX334Ctx->CurFrameLengthLines;
+    meta.gain            = *pSetGain;
+    meta.integrationTime = *pSetIntegrationTime;
+    meta.hdrRatio        = pIMX334Ctx->CurHdrRatio;
+    SensorFrameMetaRecord(&pIMX334Ctx->FrameMeta, &meta);
+    SensorWarmNoteExposure(&pIMX334Ctx->Warm, meta.gain, meta.integrationTime, meta.hdrRatio);
+
+    TRACE(IMX334_DEBUG, "%s: lines %u/%u/%u gain codes %u/%u/%u\n", __func__, lines[0],
+          count > 1 ? lines[1] : 0, count > 2 ? lines[2] : 0, code[0], code[1], code[2]);
     TRACE(IMX334_INFO, "%s: (exit)\n", __func__);
 
     return result;
@@ -1720,6 +2339,358 @@ RESULT IMX334_IsiGetResolutionIss
     return (result);
 }
 
+RESULT IMX334_IsiGetModeBundleIss(IsiSensorHandle_t handle, const SensorBundle_t **ppBundle)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (!SensorBundleIsOpen(&pIMX334Ctx->ModeBundle)) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    *ppBundle = &pIMX334Ctx->ModeBundle;
+    return (RET_SUCCESS);
+}
+
+RESULT IMX334_IsiSetTuningProfileIss(IsiSensorHandle_t handle, const char *pName)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+    int32_t index;
+
+    TRACE(IMX334_INFO, "%s: (enter)\n", __func__);
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pName == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    index = SensorProfileFind(&pIMX334Ctx->TuningProfiles, pName);
+    if (index < 0) {
+        TRACE(IMX334_ERROR, "%s: no tuning profile %s\n", __func__, pName);
+        return (RET_NOTAVAILABLE);
+    }
+
+    TRACE(IMX334_INFO, "%s: (exit)\n", __func__);
+    return SensorProfileRequest(&pIMX334Ctx->TuningProfiles, index);
+}
+
+RESULT IMX334_IsiLatchTuningProfileIss(IsiSensorHandle_t handle, const SensorTuningProfile_t **ppProfile, bool_t *pChanged)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+    bool_t changed;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppProfile == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (pIMX334Ctx->TuningProfiles.count == 0) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    changed = SensorProfileFrameBoundary(&pIMX334Ctx->TuningProfiles, ppProfile);
+    if (changed) {
+        pIMX334Ctx->AecMaxGain = SensorGainArbiterUpdate(&pIMX334Ctx->GainArbiter, &pIMX334Ctx->TuningProfiles);
+    }
+    if (pChanged != NULL) {
+        *pChanged = changed;
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT IMX334_IsiGetExposureStateIss(IsiSensorHandle_t handle, SensorExposureState_t *pState)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pState == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    pState->minGain                  = pIMX334Ctx->AecMinGain;
+    pState->maxGain                  = pIMX334Ctx->AecMaxGain;
+    pState->gainIncrement            = pIMX334Ctx->AecGainIncrement;
+    pState->minIntegrationTime       = pIMX334Ctx->AecMinIntegrationTime;
+    pState->maxIntegrationTime       = SensorAntiFlickerSnapTime(&pIMX334Ctx->AntiFlicker, pIMX334Ctx->AecMaxIntegrationTime);
+    pState->integrationTimeIncrement = pIMX334Ctx->AecIntegrationTimeIncrement;
+    pState->curGain                  = pIMX334Ctx->AecCurGain;
+    pState->curIntegrationTime       = pIMX334Ctx->AecCurIntegrationTime;
+    pState->curHdrRatio              = pIMX334Ctx->CurHdrRatio;
+    pState->curFps                   = pIMX334Ctx->CurrFps;
+    pState->minFps                   = pIMX334Ctx->MinFps;
+    pState->maxFps                   = pIMX334Ctx->MaxFps;
+    pState->frameLengthLines         = pIMX334Ctx->FrameLengthLines;
+    pState->curFrameLengthLines      = pIMX334Ctx->CurFrameLengthLines;
+    pState->minIntegrationLine       = pIMX334Ctx->MinIntegrationLine;
+    pState->maxIntegrationLine       = pIMX334Ctx->MaxIntegrationLine;
+
+    SensorExposureStatePublish(&pIMX334Ctx->ExposureState, pState);
+    return (RET_SUCCESS);
+}
+
+RESULT IMX334_IsiSetAntiFlickerIss(IsiSensorHandle_t handle, SensorAntiFlickerMode_t mode, uint32_t detectedHz)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    TRACE(IMX334_INFO, "%s: mode=%d detected=%uHz\n", __func__, mode, detectedHz);
+    return SensorAntiFlickerSet(&pIMX334Ctx->AntiFlicker, mode, detectedHz);
+}
+
+RESULT IMX334_IsiFrameStartIss(IsiSensorHandle_t handle, uint32_t frame)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+
+    if (pIMX334Ctx == NULL || pIMX334Ctx->IsiCtx.HalHandle == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    HalContext_t *pHalCtx = (HalContext_t *) pIMX334Ctx->IsiCtx.HalHandle;
+    return SensorLatencyFrameStart(&pIMX334Ctx->LatencySched, pHalCtx->sensor_fd, frame);
+}
+
+RESULT IMX334_IsiGetExposureValidFrameIss(IsiSensorHandle_t handle, uint32_t *pFrame)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pFrame == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    *pFrame = SensorLatencyValidFrame(&pIMX334Ctx->LatencySched);
+    return (RET_SUCCESS);
+}
+
+RESULT IMX334_IsiGetFrameExposureIss(IsiSensorHandle_t handle, uint32_t frame, SensorFrameMeta_t *pMeta)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorFrameMetaLookup(&pIMX334Ctx->FrameMeta, frame, pMeta);
+}
+
+RESULT IMX334_IsiGetGainSplitIss(IsiSensorHandle_t handle, float gain, SensorGainSplit_t *pSplit)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pSplit == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorGainArbitrate(&pIMX334Ctx->GainArbiter, NULL, pIMX334Ctx->AecCurGain, gain, pSplit);
+
+    return (RET_SUCCESS);
+}
+
+RESULT IMX334_IsiSetHdrDynamicRangeIss(IsiSensorHandle_t handle, float rangeDb)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+    float ratio = SensorDolRatioForRange(rangeDb, IMX334_DOL_FRAMES);
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    pIMX334Ctx->DolRatio[0] = ratio;
+    pIMX334Ctx->DolRatio[1] = ratio;
+    TRACE(IMX334_INFO, "%s: %.1f dB, ratio %.2f per exposure\n", __func__, rangeDb, ratio);
+
+    return (RET_SUCCESS);
+}
+
+/*
+ * Change between the linear and the 3DOL mode while configured: stop
+ * streaming, write the register delta (or have the kernel driver change the
+ * mode), carry the exposure in force over to the new line time and restart. pNumberOfFramesToSkip
+ * receives the frames until the new mode is exposed as requested.
+ */
+RESULT IMX334_IsiSwitchHdrIss(IsiSensorHandle_t handle, bool_t enable, uint8_t *pNumberOfFramesToSkip)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+    RESULT result = RET_SUCCESS;
+    uint32_t target = enable ? 1 : 0;
+    const struct vvcam_mode_info *pMode = NULL;
+    HalContext_t *pHalCtx;
+    bool_t streaming;
+    float gain, time, setGain, setTime, hdrRatio[SENSOR_DOL_MAX_FRAMES - 1];
+
+    TRACE(IMX334_INFO, "%s: (enter)\n", __func__);
+
+    if (pIMX334Ctx == NULL || pIMX334Ctx->IsiCtx.HalHandle == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+    if (pNumberOfFramesToSkip == NULL) {
+        return (RET_NULL_POINTER);
+    }
+    pHalCtx = (HalContext_t *) pIMX334Ctx->IsiCtx.HalHandle;
+
+    *pNumberOfFramesToSkip = 0;
+    if ((bool_t)pIMX334Ctx->enableHdr == enable) {
+        return (RET_SUCCESS);
+    }
+
+    streaming = pIMX334Ctx->Streaming;
+    gain      = pIMX334Ctx->AecCurGain;
+    time      = pIMX334Ctx->AecCurIntegrationTime;
+    /* the kernel driver takes the ratio as given, the 3DOL solve falls back to DolRatio anyway */
+    MEMCPY(hdrRatio, pIMX334Ctx->DolRatio, sizeof(hdrRatio));
+
+    if (!pIMX334Ctx->KernelDriverFlag) {
+        pMode = IMX334_FindMode(enable ? IMX334_DOL_MODE : IMX334_LINEAR_MODE);
+        if ((pIMX334Ctx->SensorMode.index != IMX334_LINEAR_MODE &&
+             pIMX334Ctx->SensorMode.index != IMX334_DOL_MODE) || pMode == NULL) {
+            TRACE(IMX334_ERROR, "%s: mode %u has no %s counterpart\n", __func__,
+                  pIMX334Ctx->SensorMode.index, enable ? "3DOL" : "linear");
+            return (RET_NOTSUPP);
+        }
+    }
+
+    if (streaming) {
+        result = IMX334_IsiSensorSetStreamingIss(handle, BOOL_FALSE);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+
+    if (pIMX334Ctx->KernelDriverFlag) {
+        uint32_t hdr_mode = enable ? SENSOR_MODE_HDR_STITCH : SENSOR_MODE_LINEAR;
+
+        if (ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_HDR_MODE, &hdr_mode) != 0) {
+            TRACE(IMX334_ERROR, "%s: set hdr mode error!\n", __func__);
+            return (RET_FAILURE);
+        }
+        /* the kernel driver changed the mode, take over what it reports for the new one */
+        result = IMX334_KernelModeLimits(pIMX334Ctx);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+        pIMX334Ctx->enableHdr = (pIMX334Ctx->SensorMode.hdr_mode != SENSOR_MODE_LINEAR);
+    } else {
+        /* soon no longer the register set the warm restart record was taken of */
+        SensorWarmInvalidate(&pIMX334Ctx->Warm);
+
+        result = IMX334_WriteHdrSwitch(pIMX334Ctx, target);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+
+        memcpy(&pIMX334Ctx->SensorMode, pMode, sizeof(struct vvcam_mode_info));
+        result = IMX334_SetModeLimits(pIMX334Ctx, pIMX334Ctx->HdrSwitchLineTimePs[target]);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+    pIMX334Ctx->AecMaxGain = SensorGainArbiterInit(&pIMX334Ctx->GainArbiter, &pIMX334Ctx->TuningProfiles, pIMX334Ctx->AecMaxGain);
+
+    /* the same exposure time in lines of the new mode */
+    result = IMX334_IsiExposureControlIss(handle, gain, time, pNumberOfFramesToSkip, &setGain, &setTime, hdrRatio);
+    RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+
+    if (streaming) {
+        result = IMX334_IsiSensorSetStreamingIss(handle, BOOL_TRUE);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+
+    TRACE(IMX334_INFO, "%s: mode %u, exposure %f s x %f, %u frames to skip\n", __func__,
+          pIMX334Ctx->SensorMode.index, setTime, setGain, *pNumberOfFramesToSkip);
+    return (RET_SUCCESS);
+}
+
+/*
+ * How the exposures of the mode in force arrive at the receiver, as the 3DOL
+ * register set programs it and IMX334_ReadDolLayout() read it back: WD_SET2
+ * selects one virtual channel per exposure, longest on VC 0, or line
+ * information on one channel; OPB_SIZE_V optical black lines precede each
+ * exposure; the readout offsets are RHS1/RHS2.
+ */
+RESULT IMX334_IsiGetHdrLayoutIss(IsiSensorHandle_t handle, SensorDolStreamLayout_t *pLayout)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+    uint8_t dt;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+    if (pLayout == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    MEMSET(pLayout, 0, sizeof(SensorDolStreamLayout_t));
+    pLayout->width  = pIMX334Ctx->SensorMode.width;
+    pLayout->height = pIMX334Ctx->SensorMode.height;
+    if (!pIMX334Ctx->enableHdr) {
+        return (RET_SUCCESS);
+    }
+    if (pIMX334Ctx->KernelDriverFlag || pIMX334Ctx->DolLayout.count == 0) {
+        /* the kernel driver owns the registers, the layout is not known here */
+        return (RET_NOTAVAILABLE);
+    }
+
+    dt = SensorDolRawDataType(pIMX334Ctx->SensorMode.bit_width);
+    pLayout->count = pIMX334Ctx->DolLayout.count;
+    pLayout->demux = pIMX334Ctx->DolDemux;
+    for (uint32_t i = 0; i < pLayout->count; i++) {
+        pLayout->exposure[i].vc            = (pLayout->demux == SENSOR_DOL_DEMUX_VC) ? i : 0;
+        pLayout->exposure[i].dt            = dt;
+        pLayout->exposure[i].embeddedLines = pIMX334Ctx->DolEmbeddedLines;
+    }
+    pLayout->exposure[1].lineOffset = pIMX334Ctx->DolRhs1;
+    pLayout->exposure[2].lineOffset = pIMX334Ctx->DolRhs2;
+
+    return (RET_SUCCESS);
+}
+
+RESULT IMX334_IsiInitSensorAsyncIss(IsiSensorHandle_t handle, SensorInitDone_t done, void *pUser)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorInitAsyncStart(&pIMX334Ctx->InitAsync, IMX334_IsiInitSensorIss, handle, done, pUser);
+}
+
+RESULT IMX334_IsiGetInitStatusIss(IsiSensorHandle_t handle, SensorInitStatus_t *pStatus)
+{
+    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
+
+    if (pIMX334Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pStatus == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorInitAsyncQuery(&pIMX334Ctx->InitAsync, pStatus);
+
+    return (RET_SUCCESS);
+}
+
 RESULT IMX334_IsiGetSensorFpsIss(IsiSensorHandle_t handle, uint32_t * pfps)
 {
     IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
@@ -1781,6 +2752,7 @@ RESULT IMX334_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
+        pIMX334Ctx->CurrFps = fps;
 #ifdef SUBDEV_CHAR
         struct vvcam_ae_info_s ae_info;
         ret =
@@ -1790,12 +2762,8 @@ RESULT IMX334_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
-        pIMX334Ctx->one_line_exp_time =
-            (float)ae_info.one_line_exp_time_ns / 1000000000;
         pIMX334Ctx->MaxIntegrationLine = ae_info.max_integration_time;
-        pIMX334Ctx->AecMaxIntegrationTime =
-            pIMX334Ctx->MaxIntegrationLine *
-            pIMX334Ctx->one_line_exp_time;
+        IMX334_SetExposureTiming(pIMX334Ctx, ae_info.one_line_exp_time_ns * SENSOR_EXPOSURE_PS_PER_NS);
 #endif
     } else {
         uint16_t FrameLengthLines;
@@ -1817,9 +2785,7 @@ RESULT IMX334_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
         pIMX334Ctx->CurFrameLengthLines = FrameLengthLines;
         pIMX334Ctx->MaxIntegrationLine =
             pIMX334Ctx->CurFrameLengthLines - 3;
-        pIMX334Ctx->AecMaxIntegrationTime =
-            pIMX334Ctx->MaxIntegrationLine *
-            pIMX334Ctx->one_line_exp_time;
+        IMX334_SetExposureTiming(pIMX334Ctx, pIMX334Ctx->ExpTiming.lineTimePs);
     }
 
     TRACE(IMX334_INFO, "%s: set sensor fps = %d\n", __func__,
@@ -1892,52 +2858,6 @@ static RESULT IMX334_IsiActivateTestPattern(IsiSensorHandle_t handle,
     return (result);
 }
 
-/*
-static RESULT IMX334_IsiEnableHdr(IsiSensorHandle_t handle, const bool_t enable)
-{
-    RESULT result = RET_SUCCESS;
-    int32_t ret = 0;
-    TRACE(IMX334_INFO, "%s: (enter)\n", __func__);
-
-    IMX334_Context_t *pIMX334Ctx = (IMX334_Context_t *) handle;
-    if (pIMX334Ctx == NULL || pIMX334Ctx->IsiCtx.HalHandle == NULL) {
-        return RET_NULL_POINTER;
-    }
-
-#ifdef SUBDEV_CHAR
-    HalContext_t *pHalCtx = (HalContext_t *) pIMX334Ctx->IsiCtx.HalHandle;
-    result = IMX334_IsiSensorSetStreamingIss(handle, 0);
-
-    if (pIMX334Ctx->KernelDriverFlag) {
-        uint32_t hdr_mode;
-        if (enable == 0) {
-            hdr_mode = SENSOR_MODE_LINEAR;
-        } else {
-            hdr_mode = SENSOR_MODE_HDR_STITCH;
-        }
-        ret =
-            ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_HDR_MODE,
-              &hdr_mode);
-    } else {
-        result |=
-            IMX334_IsiRegisterWriteIss(handle, 0x3190,
-                           enable ? 0x05 : 0x08);
-    }
-    result |=
-        IMX334_IsiSensorSetStreamingIss(handle, pIMX334Ctx->Streaming);
-#endif
-
-    if (result != 0 || ret != 0) {
-        TRACE(IMX334_ERROR, "%s: change hdr status error\n", __func__);
-        return RET_FAILURE;
-    }
-
-    pIMX334Ctx->enableHdr = enable;
-    TRACE(IMX334_INFO, "%s: (exit)\n", __func__);
-    return RET_SUCCESS;
-}
-*/
-
 RESULT IMX334_IsiGetSensorIss(IsiSensor_t *pIsiSensor)
 {
     RESULT result = RET_SUCCESS;
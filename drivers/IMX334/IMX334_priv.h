@@ -34,6 +34,17 @@
 #include <hal/hal_api.h>
 #include <isi/isi_common.h>
 #include "vvsensor.h"
+#include "sensor_bundle.h"
+#include "sensor_profile.h"
+#include "sensor_exposure.h"
+#include "sensor_latency.h"
+#include "sensor_frame_meta.h"
+#include "sensor_gain_split.h"
+#include "sensor_init_async.h"
+#include "sensor_prefetch.h"
+#include "sensor_warm.h"
+#include "sensor_trace.h"
+#include "sensor_dol.h"
 
 
 
@@ -49,6 +60,8 @@ typedef struct IMX334_Context_s
     struct vvcam_mode_info SensorMode;
     uint32_t            KernelDriverFlag;
     char                SensorRegCfgFile[128];
+    SensorBundle_t      ModeBundle;             /**< mapped per-mode bundle, preferred over SensorRegCfgFile */
+    SensorProfileSet_t  TuningProfiles;         /**< 3A tuning profiles preloaded from ModeBundle */
 
     uint32_t              HdrMode;
     IsiResolution_t       Resolution;
@@ -65,6 +78,7 @@ typedef struct IMX334_Context_s
     bool_t              isAfpsRun;              /**< if true, just do anything required for Afps parameter calculation, but DON'T access SensorHW! */
 
     float               one_line_exp_time;
+    SensorExposureTiming_t ExpTiming;         /**< integer line timing, see sensor_exposure.h */
     uint16_t            MaxIntegrationLine;
     uint16_t            MinIntegrationLine;
     uint32_t            gain_accuracy;
@@ -84,17 +98,40 @@ typedef struct IMX334_Context_s
     float               AecCurIntegrationTime;
     float               AecCurGainSEF1;
     float               AecCurIntegrationTimeSEF1;
+    float               AecCurGainSEF2;
+    float               AecCurIntegrationTimeSEF2;
 
     bool                GroupHold;
     uint32_t            OldGain;
     uint32_t            OldIntegrationTime;
     uint32_t            OldGainSEF1;
     uint32_t            OldIntegrationTimeSEF1;
+    uint32_t            OldIntegrationTimeSEF2;
+
+    uint32_t            DolFsc;                 /**< 3DOL frame set length in lines, read from the sensor */
+    uint32_t            DolRhs1;                /**< SEF1 readout line */
+    uint32_t            DolRhs2;                /**< SEF2 readout line */
+    SensorDolLayout_t   DolLayout;              /**< exposure windows of the frame set */
+    float               DolRatio[SENSOR_DOL_MAX_FRAMES - 1];    /**< used when the caller passes no ratio */
+    SensorDolDemux_t    DolDemux;               /**< output of the exposures, read from the sensor */
+    uint16_t            DolEmbeddedLines;       /**< optical black lines ahead of each exposure */
+
+    struct vvcam_sccb_data *HdrSwitchRegs[2];   /**< register delta into the linear [0] and the 3DOL [1] mode */
+    uint32_t            HdrSwitchCount[2];      /**< 0 if the mode has no counterpart */
+    uint32_t            HdrSwitchLineTimePs[2];
 
     int                 subdev;
     bool                enableHdr;
     uint8_t             pattern;
     float               CurHdrRatio;
+    SensorExposureState_t ExposureState;      /**< last published exposure snapshot */
+    SensorAntiFlicker_t AntiFlicker;            /**< off unless set */
+    SensorLatencySched_t LatencySched;        /**< frame tagging of exposure writes */
+    SensorFrameMetaRing_t FrameMeta;          /**< exposures in force, by frame */
+    SensorGainArbiter_t GainArbiter;            /**< sensor/ISP gain limits from the tuning */
+    SensorInitAsync_t   InitAsync;              /**< background InitSensorIss */
+    SensorPrefetch_t    Prefetch;               /**< mode data loading from create to init */
+    SensorWarm_t        Warm;                   /**< record for a warm restart */
 } IMX334_Context_t;
 
 static RESULT IMX334_IsiCreateSensorIss(IsiSensorInstanceConfig_t *
@@ -194,6 +231,29 @@ static RESULT IMX334_IsiSetSEF1IntegrationTimeIss(IsiSensorHandle_t
 static RESULT IMX334_IsiGetResolutionIss
     (IsiSensorHandle_t handle, uint16_t *pwidth, uint16_t *pheight);
 
+RESULT IMX334_IsiGetModeBundleIss(IsiSensorHandle_t handle, const SensorBundle_t **ppBundle);
+
+RESULT IMX334_IsiSetTuningProfileIss(IsiSensorHandle_t handle, const char *pName);
+
+RESULT IMX334_IsiLatchTuningProfileIss(IsiSensorHandle_t handle, const SensorTuningProfile_t **ppProfile, bool_t *pChanged);
+
+RESULT IMX334_IsiGetExposureStateIss(IsiSensorHandle_t handle, SensorExposureState_t *pState);
+
+RESULT IMX334_IsiSetAntiFlickerIss(IsiSensorHandle_t handle, SensorAntiFlickerMode_t mode, uint32_t detectedHz);
+
+RESULT IMX334_IsiFrameStartIss(IsiSensorHandle_t handle, uint32_t frame);
+
+RESULT IMX334_IsiGetExposureValidFrameIss(IsiSensorHandle_t handle, uint32_t *pFrame);
+
+RESULT IMX334_IsiGetFrameExposureIss(IsiSensorHandle_t handle, uint32_t frame, SensorFrameMeta_t *pMeta);
+
+RESULT IMX334_IsiGetGainSplitIss(IsiSensorHandle_t handle, float gain, SensorGainSplit_t *pSplit);
+RESULT IMX334_IsiInitSensorAsyncIss(IsiSensorHandle_t handle, SensorInitDone_t done, void *pUser);
+RESULT IMX334_IsiGetInitStatusIss(IsiSensorHandle_t handle, SensorInitStatus_t *pStatus);
+RESULT IMX334_IsiSetHdrDynamicRangeIss(IsiSensorHandle_t handle, float rangeDb);
+RESULT IMX334_IsiSwitchHdrIss(IsiSensorHandle_t handle, bool_t enable, uint8_t *pNumberOfFramesToSkip);
+RESULT IMX334_IsiGetHdrLayoutIss(IsiSensorHandle_t handle, SensorDolStreamLayout_t *pLayout);
+
 static RESULT IMX334_IsiResetSensorIss(IsiSensorHandle_t handle);
 
 
@@ -40,7 +40,12 @@ CREATE_TRACER( OV12870_REG_DEBUG, "OV12870: ", INFO, 1);
 *****************************************************************************/
 static const char SensorName[16] = "OV12870";
 
-static struct vvcam_mode_info pov12870_mode_info[] = {
+/* frames until a shutter, gain and VTS write is in force; unverified: not
+   from the OV12870 datasheet nor measured, 2 for every group writes all of them
+   on the same frame as before */
+static const SensorLatency_t OV12870_Latency = { .exposure = 2, .gain = 2, .vts = 2 };
+
+static const struct vvcam_mode_info pov12870_mode_info[] = {
     {
         .index     = 0,
         .width     = 640,
@@ -342,11 +347,29 @@ static RESULT OV12870_IsiGetSensorModeIss(IsiSensorHandle_t handle,void *mode)
     return ( RET_SUCCESS );
 }
 
+static RESULT OV12870_IsiGetRegCfgIss(const char *registerFileName, struct vvcam_sccb_array *arry);
+static RESULT OV12870_IsiCheckSensorConnectionIss(IsiSensorHandle_t handle);
+
+/* written at runtime, never a warm restart signature */
+static const uint32_t OV12870_WarmVolatileRegs[] = {
+    0x0100, 0x0103, 0x301e, 0x3501, 0x3502,
+    0x30a0, 0x30a1, 0x30a2, 0x30a3, 0x30a4, 0x30a5, 0x30a6, 0x30a7,
+};
+
+static const SensorWarmOps_t OV12870_WarmOps = {
+    .read          = OV12870_IsiRegisterReadIss,
+    .write         = OV12870_IsiRegisterWriteIss,
+    .pageReg       = SENSOR_WARM_NO_PAGE,
+    .pVolatile     = OV12870_WarmVolatileRegs,
+    .volatileCount = sizeof(OV12870_WarmVolatileRegs) / sizeof(OV12870_WarmVolatileRegs[0]),
+};
+
 static RESULT OV12870_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     RESULT result = RET_SUCCESS;
     OV12870_Context_t *pOV12870Ctx;
 
     TRACE(OV12870_INFO, "%s (enter)\n", __func__);
+    uint64_t createSpan = SensorTraceBegin();
 
     if (!pConfig || !pConfig->pSensor)
         return (RET_NULL_POINTER);
@@ -366,6 +389,7 @@ static RESULT OV12870_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         return (result);
     }
 
+    SensorLatencySchedInit(&pOV12870Ctx->LatencySched, &OV12870_Latency);
     pOV12870Ctx->IsiCtx.HalHandle = pConfig->HalHandle;
     pOV12870Ctx->IsiCtx.pSensor = pConfig->pSensor;
     pOV12870Ctx->GroupHold = BOOL_FALSE;
@@ -378,7 +402,7 @@ static RESULT OV12870_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     pOV12870Ctx->SensorMode.index = pConfig->SensorModeIndex;
     pConfig->hSensor = (IsiSensorHandle_t) pOV12870Ctx;
 #ifdef SUBDEV_CHAR
-    struct vvcam_mode_info *SensorDefaultMode = NULL;
+    const struct vvcam_mode_info *SensorDefaultMode = NULL;
     for (int i=0; i < sizeof(pov12870_mode_info)/ sizeof(struct vvcam_mode_info); i++)
     {
         if (pov12870_mode_info[i].index == pOV12870Ctx->SensorMode.index)
@@ -409,9 +433,15 @@ static RESULT OV12870_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
                 return -1;
         }
 
-        if (access(pOV12870Ctx->SensorRegCfgFile, F_OK) == 0) {
+        if (SensorBundleOpen(SensorName, SensorDefaultMode->index, &pOV12870Ctx->ModeBundle) == RET_SUCCESS ||
+            access(pOV12870Ctx->SensorRegCfgFile, F_OK) == 0) {
             pOV12870Ctx->KernelDriverFlag = 0;
             memcpy(&(pOV12870Ctx->SensorMode),SensorDefaultMode,sizeof(struct vvcam_mode_info));
+            /* read the mode data while the sensor powers up */
+            (void)SensorPrefetchStart(&pOV12870Ctx->Prefetch, &pOV12870Ctx->ModeBundle, pOV12870Ctx->SensorRegCfgFile, OV12870_IsiGetRegCfgIss);
+            if (SensorBundleIsOpen(&pOV12870Ctx->ModeBundle)) {
+                (void)SensorProfileSetInit(&pOV12870Ctx->TuningProfiles, &pOV12870Ctx->ModeBundle);
+            }
         } else {
             pOV12870Ctx->KernelDriverFlag = 1;
         }
@@ -420,7 +450,9 @@ static RESULT OV12870_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         pOV12870Ctx->KernelDriverFlag = 1;
     }
 
+    uint64_t span = SensorTraceBegin();
     result = OV12870_IsiSensorSetPowerIss(pOV12870Ctx, BOOL_TRUE);
+    SensorTraceEnd(SensorName, "power", span);
     system("echo 456 > /sys/class/gpio/export");
     system("echo out > /sys/class/gpio/gpio456/direction");
     system("echo 0 > /sys/class/gpio/gpio456/value");
@@ -431,6 +463,7 @@ static RESULT OV12870_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
 
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
+    span = SensorTraceBegin();
     uint32_t SensorClkIn = 0;
     if (pOV12870Ctx->KernelDriverFlag) {
         result = OV12870_IsiSensorGetClkIss(pOV12870Ctx, &SensorClkIn);
@@ -438,19 +471,33 @@ static RESULT OV12870_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     }
 
     result = OV12870_IsiSensorSetClkIss(pOV12870Ctx, SensorClkIn);
+    SensorTraceEnd(SensorName, "clk", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
-    result = OV12870_IsiResetSensorIss(pOV12870Ctx);
-    RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
-
-    pOV12870Ctx->pattern = ISI_BPAT_BGBGGRGR;
-
     if (!pOV12870Ctx->KernelDriverFlag) {
+        span = SensorTraceBegin();
         result = OV12870_IsiConfigSensorSCCBIss(pOV12870Ctx);
+        SensorTraceEnd(SensorName, "sccb", span);
         RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
     }
+
+    span = SensorTraceBegin();
+    /* a sensor a previous process left in this mode still holds its registers */
+    if (pOV12870Ctx->KernelDriverFlag ||
+        SensorWarmOpen(&pOV12870Ctx->Warm, SensorName, ((HalContext_t *)pOV12870Ctx->IsiCtx.HalHandle)->sensor_fd,
+                       &OV12870_WarmOps, pOV12870Ctx) != RET_SUCCESS ||
+        OV12870_IsiCheckSensorConnectionIss(pOV12870Ctx) != RET_SUCCESS ||
+        SensorWarmProbe(&pOV12870Ctx->Warm, pOV12870Ctx->SensorMode.index) != RET_SUCCESS) {
+        SensorWarmInvalidate(&pOV12870Ctx->Warm);
+        result = OV12870_IsiResetSensorIss(pOV12870Ctx);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+    SensorTraceEnd(SensorName, "reset", span);
+
+    pOV12870Ctx->pattern = ISI_BPAT_BGBGGRGR;
 #endif
 
+    SensorTraceEnd(SensorName, "create", createSpan);
     TRACE(OV12870_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -506,41 +553,86 @@ static RESULT OV12870_IsiGetRegCfgIss(const char *registerFileName,
     return 0;
 }
 
+static void OV12870_SetExposureTiming(OV12870_Context_t *pOV12870Ctx, uint32_t lineTimePs)
+{
+    SensorExposureTiming_t *pTiming = &pOV12870Ctx->ExpTiming;
+
+    SensorExposureTimingSet(pTiming, lineTimePs, pOV12870Ctx->MinIntegrationLine, pOV12870Ctx->MaxIntegrationLine);
+    pOV12870Ctx->one_line_exp_time           = (float)lineTimePs / 1e12f;
+    pOV12870Ctx->AecIntegrationTimeIncrement = SensorExposureLinesToTime(pTiming, 1);
+    pOV12870Ctx->AecMinIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->minLines);
+    pOV12870Ctx->AecMaxIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->maxLines);
+}
+
 static RESULT OV12870_IsiInitSensorIss(IsiSensorHandle_t handle) {
     RESULT result = RET_SUCCESS;
 
     int ret = 0;
+    uint32_t lineTimePs = 0;
     OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
 
     HalContext_t *pHalCtx = (HalContext_t *) pOV12870Ctx->IsiCtx.HalHandle;
     TRACE(OV12870_INFO, "%s (enter)\n", __func__);
+    uint64_t initSpan = SensorTraceBegin();
 
     if (pOV12870Ctx == NULL) {
         return (RET_WRONG_HANDLE);
     }
 
     if (pOV12870Ctx->KernelDriverFlag) {
-        ;
+        /* the kernel driver set the mode up, its frame rate is the one in force */
+        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pOV12870Ctx->SensorMode));
+        if (ret != 0) {
+            TRACE(OV12870_ERROR, "%s:sensor get mode info error!\n",
+                  __func__);
+            return (RET_FAILURE);
+        }
+        pOV12870Ctx->MaxFps  = pOV12870Ctx->SensorMode.fps;
+        pOV12870Ctx->MinFps  = 1;
+        pOV12870Ctx->CurrFps = pOV12870Ctx->MaxFps;
     } else {
         struct vvcam_sccb_array arry;
-        result = OV12870_IsiGetRegCfgIss(pOV12870Ctx->SensorRegCfgFile, &arry);
+        uint64_t span = SensorTraceBegin();
+        SensorPrefetchWait(&pOV12870Ctx->Prefetch);
+        if (SensorBundleIsOpen(&pOV12870Ctx->ModeBundle)) {
+            result = SensorBundleGetRegArray(&pOV12870Ctx->ModeBundle, &arry);
+        } else if (SensorPrefetchTakeRegs(&pOV12870Ctx->Prefetch, &arry) != RET_SUCCESS) {
+            result = OV12870_IsiGetRegCfgIss(pOV12870Ctx->SensorRegCfgFile, &arry);
+        }
+        SensorTraceEnd(SensorName, "load", span);
         if (result != 0) {
             TRACE(OV12870_ERROR,
                   "%s:OV12870_IsiGetRegCfgIss error!\n", __func__);
             return (RET_FAILURE);
         }
 
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &arry);
-        if (ret != 0) {
-            TRACE(OV12870_ERROR, "%s:Sensor Write Reg arry error!\n",
-                  __func__);
-            return (RET_FAILURE);
+        bool_t warm = pOV12870Ctx->Warm.resumed;
+        uint64_t regHash = SensorBundleHash(arry.sccb_data, arry.count * sizeof(struct vvcam_sccb_data),
+                                            SENSOR_BUNDLE_FNV_SEED);
+        if (SensorWarmResume(&pOV12870Ctx->Warm, regHash)) {
+            TRACE(OV12870_INFO, "%s: warm restart, register set skipped\n", __func__);
+        } else {
+            if (warm) {
+                /* create skipped the reset, but the register set changed since */
+                result = OV12870_IsiResetSensorIss(pOV12870Ctx);
+                RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+            }
+
+            span = SensorTraceBegin();
+            ret = SensorInitWriteRegs(&pOV12870Ctx->InitAsync, pHalCtx->sensor_fd, &arry);
+            SensorTraceEnd(SensorName, "write", span);
+            if (ret != 0) {
+                TRACE(OV12870_ERROR, "%s:Sensor Write Reg arry error!\n",
+                      __func__);
+                return (RET_FAILURE);
+            }
+            (void)SensorWarmCommit(&pOV12870Ctx->Warm, pOV12870Ctx->SensorMode.index, regHash, &arry);
         }
 
         switch(pOV12870Ctx->SensorMode.index)
         {
             case 0:
-                pOV12870Ctx->one_line_exp_time = 0.000001;
+                lineTimePs = 1000000;
                 pOV12870Ctx->FrameLengthLines = 480-36;
                 pOV12870Ctx->CurFrameLengthLines = pOV12870Ctx->FrameLengthLines;
                 pOV12870Ctx->MaxIntegrationLine = pOV12870Ctx->CurFrameLengthLines;
@@ -549,7 +641,7 @@ static RESULT OV12870_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pOV12870Ctx->AecMinGain = 1;
                 break;
             case 1:
-                pOV12870Ctx->one_line_exp_time = 0.000001;
+                lineTimePs = 1000000;
                 pOV12870Ctx->FrameLengthLines = 2142;
                 pOV12870Ctx->CurFrameLengthLines = pOV12870Ctx->FrameLengthLines;
                 pOV12870Ctx->MaxIntegrationLine = pOV12870Ctx->CurFrameLengthLines;
@@ -563,11 +655,7 @@ static RESULT OV12870_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 return ( RET_NOTAVAILABLE );
                 break;
         }
-		pOV12870Ctx->AecIntegrationTimeIncrement = pOV12870Ctx->one_line_exp_time;
-		pOV12870Ctx->AecMinIntegrationTime =
-			pOV12870Ctx->one_line_exp_time * pOV12870Ctx->MinIntegrationLine;
-		pOV12870Ctx->AecMaxIntegrationTime =
-			pOV12870Ctx->one_line_exp_time * pOV12870Ctx->MaxIntegrationLine;
+        OV12870_SetExposureTiming(pOV12870Ctx, lineTimePs);
 
 
         pOV12870Ctx->MaxFps  = pOV12870Ctx->SensorMode.fps;
@@ -575,6 +663,21 @@ static RESULT OV12870_IsiInitSensorIss(IsiSensorHandle_t handle) {
         pOV12870Ctx->CurrFps = pOV12870Ctx->MaxFps;
     }
 
+    /* the tuning may allow the sensor less gain than the mode can do */
+    pOV12870Ctx->AecMaxGain = SensorGainArbiterInit(&pOV12870Ctx->GainArbiter, &pOV12870Ctx->TuningProfiles, pOV12870Ctx->AecMaxGain);
+
+    if (pOV12870Ctx->Warm.resumed) {
+        float gain, integrationTime, hdrRatio, setGain, setIntegrationTime;
+        uint8_t skip;
+
+        /* carry on with the exposure the sensor streamed with */
+        if (SensorWarmLastExposure(&pOV12870Ctx->Warm, &gain, &integrationTime, &hdrRatio)) {
+            (void)OV12870_IsiExposureControlIss(handle, gain, integrationTime, &skip,
+                                                &setGain, &setIntegrationTime, &hdrRatio);
+        }
+    }
+
+    SensorTraceEnd(SensorName, "init", initSpan);
     TRACE(OV12870_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -587,10 +690,19 @@ static RESULT OV12870_IsiReleaseSensorIss(IsiSensorHandle_t handle) {
     if (pOV12870Ctx == NULL)
         return (RET_WRONG_HANDLE);
 
+    /* an initialization still running in the background uses the context */
+    (void)SensorInitAsyncWait(&pOV12870Ctx->InitAsync);
+
     (void)OV12870_IsiSensorSetStreamingIss(pOV12870Ctx, BOOL_FALSE);
     (void)OV12870_IsiSensorSetPowerIss(pOV12870Ctx, BOOL_FALSE);
     (void)HalDelRef(pOV12870Ctx->IsiCtx.HalHandle);
 
+    SensorWarmClose(&pOV12870Ctx->Warm, BOOL_TRUE);
+
+    SensorPrefetchRelease(&pOV12870Ctx->Prefetch);
+    SensorLatencySchedRelease(&pOV12870Ctx->LatencySched);
+    (void)SensorBundleClose(&pOV12870Ctx->ModeBundle);
+
     MEMSET(pOV12870Ctx, 0, sizeof(OV12870_Context_t));
     free(pOV12870Ctx);
     TRACE(OV12870_INFO, "%s (exit)\n", __func__);
@@ -612,6 +724,7 @@ static RESULT OV12870_IsiSetupSensorIss
     RESULT result = RET_SUCCESS;
 
     TRACE(OV12870_INFO, "%s: (enter)\n", __func__);
+    uint64_t setupSpan = SensorTraceBegin();
 
     if (!pOV12870Ctx) {
         TRACE(OV12870_ERROR,
@@ -635,7 +748,9 @@ static RESULT OV12870_IsiSetupSensorIss
 
     /* 1.) SW reset of image sensor (via I2C register interface)  be careful, bits 6..0 are reserved, reset bit is not sticky */
     TRACE(OV12870_DEBUG, "%s: OV12870 System-Reset executed\n", __func__);
+    uint64_t span = SensorTraceBegin();
     osSleep(100);
+    SensorTraceEnd(SensorName, "settle", span);
 
     //OV12870_AecSetModeParameters not defined yet as of 2021/8/9.
     //result = OV12870_AecSetModeParameters(pOV12870Ctx, pConfig);
@@ -652,6 +767,7 @@ static RESULT OV12870_IsiSetupSensorIss
     ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);//result = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);
 #endif
     pOV12870Ctx->Configured = BOOL_TRUE;
+    SensorTraceEnd(SensorName, "setup", setupSpan);
     TRACE(OV12870_INFO, "%s: (exit) ret=0x%x \n", __func__, result);
     return result;
 }
@@ -674,6 +790,7 @@ static RESULT OV12870_IsiSensorSetStreamingIss
     RESULT result = RET_SUCCESS;
     int ret = 0;
     TRACE(OV12870_INFO, "%s (enter)\n", __func__);
+    uint64_t streamSpan = SensorTraceBegin();
 
     OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
     if (pOV12870Ctx == NULL || pOV12870Ctx->IsiCtx.HalHandle == NULL) {
@@ -694,6 +811,7 @@ static RESULT OV12870_IsiSensorSetStreamingIss
 
     pOV12870Ctx->Streaming = on;
 
+    SensorTraceEnd(SensorName, on ? "stream on" : "stream off", streamSpan);
     TRACE(OV12870_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -830,7 +948,7 @@ static RESULT OV12870_IsiGetIntegrationTimeLimitsIss
     }
 
     *pMinIntegrationTime = pOV12870Ctx->AecMinIntegrationTime;
-    *pMaxIntegrationTime = pOV12870Ctx->AecMaxIntegrationTime;
+    *pMaxIntegrationTime = SensorAntiFlickerSnapTime(&pOV12870Ctx->AntiFlicker, pOV12870Ctx->AecMaxIntegrationTime);
 
     TRACE(OV12870_INFO, "%s: (enter)\n", __func__);
     return (result);
@@ -1218,7 +1336,6 @@ RESULT OV12870_IsiSetIntegrationTimeIss
     HalContext_t *pHalCtx = (HalContext_t *) pOV12870Ctx->IsiCtx.HalHandle;
 
     uint32_t exp_line = 0;
-    uint32_t exp_line_old = 0;
 
     TRACE(OV12870_INFO, "%s: (enter)\n", __func__);
 
@@ -1236,11 +1353,7 @@ RESULT OV12870_IsiSetIntegrationTimeIss
         return (RET_NULL_POINTER);
     }
 
-    exp_line = NewIntegrationTime / pOV12870Ctx->one_line_exp_time;
-    exp_line_old = exp_line;
-    exp_line =
-        MIN(pOV12870Ctx->MaxIntegrationLine,
-        MAX(pOV12870Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pOV12870Ctx->ExpTiming, NewIntegrationTime);
 
     TRACE(OV12870_DEBUG, "%s: set AEC_PK_EXPO=0x%05x\n", __func__, exp_line);
 
@@ -1250,7 +1363,7 @@ RESULT OV12870_IsiSetIntegrationTimeIss
         //ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_EXP, &exp_line);
         pOV12870Ctx->OldIntegrationTime = exp_line;    // remember current integration time
         pOV12870Ctx->AecCurIntegrationTime =
-            exp_line * pOV12870Ctx->one_line_exp_time;
+            SensorExposureLinesToTime(&pOV12870Ctx->ExpTiming, exp_line);
 
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
@@ -1273,11 +1386,7 @@ RESULT OV12870_IsiSetIntegrationTimeIss
     }
 
 
-    if (exp_line_old != exp_line) {
-        *pSetIntegrationTime = pOV12870Ctx->AecCurIntegrationTime;
-    } else {
-        *pSetIntegrationTime = NewIntegrationTime;
-    }
+    *pSetIntegrationTime = pOV12870Ctx->AecCurIntegrationTime;
 
     TRACE(OV12870_DEBUG, "%s: Ti=%f\n", __func__, *pSetIntegrationTime);
     TRACE(OV12870_INFO, "%s: (exit)\n", __func__);
@@ -1298,8 +1407,7 @@ RESULT OV12870_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integ
     HalContext_t *pHalCtx = (HalContext_t *) pOV12870Ctx->IsiCtx.HalHandle;
 
     uint32_t exp_line = 0;
-    exp_line = IntegrationTime / pOV12870Ctx->one_line_exp_time;
-    exp_line = MIN(pOV12870Ctx->MaxIntegrationLine, MAX(pOV12870Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pOV12870Ctx->ExpTiming, IntegrationTime);
 
     if (exp_line != pOV12870Ctx->LastLongExpLine)
     {
@@ -1314,7 +1422,7 @@ RESULT OV12870_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integ
         }
 
         pOV12870Ctx->LastLongExpLine = exp_line;
-        pOV12870Ctx->AecCurLongIntegrationTime =  pOV12870Ctx->LastLongExpLine*pOV12870Ctx->one_line_exp_time;
+        pOV12870Ctx->AecCurLongIntegrationTime =  SensorExposureLinesToTime(&pOV12870Ctx->ExpTiming, pOV12870Ctx->LastLongExpLine);
     }
 
 
@@ -1354,10 +1462,7 @@ RESULT OV12870_IsiSetVSIntegrationTimeIss
           pOV12870Ctx->AecMinIntegrationTime);
 
 
-    exp_line = NewIntegrationTime / pOV12870Ctx->one_line_exp_time;
-    exp_line =
-        MIN(pOV12870Ctx->MaxIntegrationLine,
-        MAX(pOV12870Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pOV12870Ctx->ExpTiming, NewIntegrationTime);
 
     if (exp_line != pOV12870Ctx->OldVsIntegrationTime) {
     /*TODO*/
@@ -1365,7 +1470,7 @@ RESULT OV12870_IsiSetVSIntegrationTimeIss
     } else if (1){
 
         pOV12870Ctx->OldVsIntegrationTime = exp_line;
-        pOV12870Ctx->AecCurVSIntegrationTime = exp_line * pOV12870Ctx->one_line_exp_time;    //remember current integration time
+        pOV12870Ctx->AecCurVSIntegrationTime = SensorExposureLinesToTime(&pOV12870Ctx->ExpTiming, exp_line);    //remember current integration time
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
         *pNumberOfFramesToSkip = 0U;    //no frame skip
@@ -1388,6 +1493,8 @@ RESULT OV12870_IsiExposureControlIss
 {
     OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
     RESULT result = RET_SUCCESS;
+    SensorFrameMeta_t meta;
+    uint32_t frame, validFrame;
     int TmpGain;
     /*TODO*/
 
@@ -1408,6 +1515,8 @@ RESULT OV12870_IsiExposureControlIss
         return (RET_NULL_POINTER);
     }
 
+    SensorAntiFlickerApply(&pOV12870Ctx->AntiFlicker, &NewGain, &NewIntegrationTime);
+
     if (NewGain >= 25) { // More than 25 will not take effect
         NewGain = 25;
     }
@@ -1415,18 +1524,15 @@ RESULT OV12870_IsiExposureControlIss
     TRACE(OV12870_DEBUG, "%s: g=%f, Ti=%f\n", __func__, NewGain,
           NewIntegrationTime);
 
-    if (NewIntegrationTime > pOV12870Ctx->FrameLengthLines * pOV12870Ctx->one_line_exp_time)
-        NewIntegrationTime = pOV12870Ctx->FrameLengthLines * pOV12870Ctx->one_line_exp_time;
-
-    float exp_t = NewIntegrationTime * 16.0f / pOV12870Ctx->one_line_exp_time;
+    uint32_t exp_line = SensorExposureTimeToLines(&pOV12870Ctx->ExpTiming, NewIntegrationTime);
 
     TmpGain = (int)NewGain;
 
-    __ov12870_set_exposure(handle, (int)exp_t,
+    __ov12870_set_exposure(handle, exp_line << 4,
 				((int)NewGain << 4) + round((NewGain - TmpGain) / 0.0625f), 1024, OV12870_ANALOG_GAIN | OV12870_INTEGRATION_TIME | OV12870_DIGITAL_GAIN);
 
     *pSetGain = NewGain;
-    *pSetIntegrationTime = (int)exp_t / 16.0f * pOV12870Ctx->one_line_exp_time;
+    *pSetIntegrationTime = SensorExposureLinesToTime(&pOV12870Ctx->ExpTiming, exp_line);
     pOV12870Ctx->AecCurGain = NewGain;
     pOV12870Ctx->AecCurIntegrationTime = *pSetIntegrationTime;
 
@@ -1485,6 +1591,20 @@ RESULT OV12870_IsiExposureControlIss
     result = OV12870_IsiSetIntegrationTimeIss(handle, NewIntegrationTime, pSetIntegrationTime, pNumberOfFramesToSkip, hdr_ratio);
     TRACE(OV12870_DEBUG, "%s: set: vsg=%f, vsTi=%f, vsskip=%d\n", __func__,
           NewGain, NewIntegrationTime, *pNumberOfFramesToSkip);
+    validFrame = SensorLatencyWritten(&pOV12870Ctx->LatencySched, &frame);
+    *pNumberOfFramesToSkip = validFrame - frame;
+
+    meta.frame           = validFrame;
+    meta.lines           = SensorExposureTimeToLines(&pOV12870Ctx->ExpTiming, *pSetIntegrationTime);
+    meta.again           = 0;
+    meta.dgain           = 0;
+    meta.vts             = pOV12870Ctx->CurFrameLengthLines;
+    meta.gain            = *pSetGain;
+    meta.integrationTime = *pSetIntegrationTime;
+    meta.hdrRatio        = pOV12870Ctx->CurHdrRatio;
+    SensorFrameMetaRecord(&pOV12870Ctx->FrameMeta, &meta);
+    SensorWarmNoteExposure(&pOV12870Ctx->Warm, meta.gain, meta.integrationTime, meta.hdrRatio);
+
     TRACE(OV12870_INFO, "%s: (exit)\n", __func__);
 
     return result;
@@ -1535,6 +1655,208 @@ RESULT OV12870_IsiGetResolutionIss(IsiSensorHandle_t handle, uint16_t *pwidth, u
     return (result);
 }
 
+RESULT OV12870_IsiGetModeBundleIss(IsiSensorHandle_t handle, const SensorBundle_t **ppBundle)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (!SensorBundleIsOpen(&pOV12870Ctx->ModeBundle)) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    *ppBundle = &pOV12870Ctx->ModeBundle;
+    return (RET_SUCCESS);
+}
+
+RESULT OV12870_IsiSetTuningProfileIss(IsiSensorHandle_t handle, const char *pName)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+    int32_t index;
+
+    TRACE(OV12870_INFO, "%s: (enter)\n", __func__);
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pName == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    index = SensorProfileFind(&pOV12870Ctx->TuningProfiles, pName);
+    if (index < 0) {
+        TRACE(OV12870_ERROR, "%s: no tuning profile %s\n", __func__, pName);
+        return (RET_NOTAVAILABLE);
+    }
+
+    TRACE(OV12870_INFO, "%s: (exit)\n", __func__);
+    return SensorProfileRequest(&pOV12870Ctx->TuningProfiles, index);
+}
+
+RESULT OV12870_IsiLatchTuningProfileIss(IsiSensorHandle_t handle, const SensorTuningProfile_t **ppProfile, bool_t *pChanged)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+    bool_t changed;
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppProfile == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (pOV12870Ctx->TuningProfiles.count == 0) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    changed = SensorProfileFrameBoundary(&pOV12870Ctx->TuningProfiles, ppProfile);
+    if (changed) {
+        pOV12870Ctx->AecMaxGain = SensorGainArbiterUpdate(&pOV12870Ctx->GainArbiter, &pOV12870Ctx->TuningProfiles);
+    }
+    if (pChanged != NULL) {
+        *pChanged = changed;
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT OV12870_IsiGetExposureStateIss(IsiSensorHandle_t handle, SensorExposureState_t *pState)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pState == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    pState->minGain                  = pOV12870Ctx->AecMinGain;
+    pState->maxGain                  = pOV12870Ctx->AecMaxGain;
+    pState->gainIncrement            = pOV12870Ctx->AecGainIncrement;
+    pState->minIntegrationTime       = pOV12870Ctx->AecMinIntegrationTime;
+    pState->maxIntegrationTime       = SensorAntiFlickerSnapTime(&pOV12870Ctx->AntiFlicker, pOV12870Ctx->AecMaxIntegrationTime);
+    pState->integrationTimeIncrement = pOV12870Ctx->AecIntegrationTimeIncrement;
+    pState->curGain                  = pOV12870Ctx->AecCurGain;
+    pState->curIntegrationTime       = pOV12870Ctx->AecCurIntegrationTime;
+    pState->curHdrRatio              = pOV12870Ctx->CurHdrRatio;
+    pState->curFps                   = pOV12870Ctx->CurrFps;
+    pState->minFps                   = pOV12870Ctx->MinFps;
+    pState->maxFps                   = pOV12870Ctx->MaxFps;
+    pState->frameLengthLines         = pOV12870Ctx->FrameLengthLines;
+    pState->curFrameLengthLines      = pOV12870Ctx->CurFrameLengthLines;
+    pState->minIntegrationLine       = pOV12870Ctx->MinIntegrationLine;
+    pState->maxIntegrationLine       = pOV12870Ctx->MaxIntegrationLine;
+
+    SensorExposureStatePublish(&pOV12870Ctx->ExposureState, pState);
+    return (RET_SUCCESS);
+}
+
+RESULT OV12870_IsiSetAntiFlickerIss(IsiSensorHandle_t handle, SensorAntiFlickerMode_t mode, uint32_t detectedHz)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    TRACE(OV12870_INFO, "%s: mode=%d detected=%uHz\n", __func__, mode, detectedHz);
+    return SensorAntiFlickerSet(&pOV12870Ctx->AntiFlicker, mode, detectedHz);
+}
+
+RESULT OV12870_IsiFrameStartIss(IsiSensorHandle_t handle, uint32_t frame)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+
+    if (pOV12870Ctx == NULL || pOV12870Ctx->IsiCtx.HalHandle == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    HalContext_t *pHalCtx = (HalContext_t *) pOV12870Ctx->IsiCtx.HalHandle;
+    return SensorLatencyFrameStart(&pOV12870Ctx->LatencySched, pHalCtx->sensor_fd, frame);
+}
+
+RESULT OV12870_IsiGetExposureValidFrameIss(IsiSensorHandle_t handle, uint32_t *pFrame)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pFrame == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    *pFrame = SensorLatencyValidFrame(&pOV12870Ctx->LatencySched);
+    return (RET_SUCCESS);
+}
+
+RESULT OV12870_IsiGetFrameExposureIss(IsiSensorHandle_t handle, uint32_t frame, SensorFrameMeta_t *pMeta)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorFrameMetaLookup(&pOV12870Ctx->FrameMeta, frame, pMeta);
+}
+
+RESULT OV12870_IsiGetGainSplitIss(IsiSensorHandle_t handle, float gain, SensorGainSplit_t *pSplit)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pSplit == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorGainArbitrate(&pOV12870Ctx->GainArbiter, NULL, pOV12870Ctx->AecCurGain, gain, pSplit);
+
+    return (RET_SUCCESS);
+}
+
+RESULT OV12870_IsiInitSensorAsyncIss(IsiSensorHandle_t handle, SensorInitDone_t done, void *pUser)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorInitAsyncStart(&pOV12870Ctx->InitAsync, OV12870_IsiInitSensorIss, handle, done, pUser);
+}
+
+RESULT OV12870_IsiGetInitStatusIss(IsiSensorHandle_t handle, SensorInitStatus_t *pStatus)
+{
+    OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
+
+    if (pOV12870Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pStatus == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorInitAsyncQuery(&pOV12870Ctx->InitAsync, pStatus);
+
+    return (RET_SUCCESS);
+}
+
 RESULT OV12870_IsiGetSensorFpsIss(IsiSensorHandle_t handle, uint32_t * pfps)
 {
     OV12870_Context_t *pOV12870Ctx = (OV12870_Context_t *) handle;
@@ -1599,11 +1921,15 @@ RESULT OV12870_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
+        pOV12870Ctx->CurrFps = fps;
 
         ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pOV12870Ctx->SensorMode));
-        {
+        if (ret == 0) {
             pOV12870Ctx->MaxIntegrationLine = pOV12870Ctx->SensorMode.ae_info.max_integration_time;
-            pOV12870Ctx->AecMaxIntegrationTime = pOV12870Ctx->MaxIntegrationLine * pOV12870Ctx->one_line_exp_time;
+            /* the line time comes with the AE info only, unknown it stays 0 */
+            if (pOV12870Ctx->ExpTiming.lineTimePs != 0) {
+                OV12870_SetExposureTiming(pOV12870Ctx, pOV12870Ctx->ExpTiming.lineTimePs);
+            }
         }
 #ifdef SUBDEV_CHAR
         struct vvcam_ae_info_s ae_info;
@@ -1614,12 +1940,8 @@ RESULT OV12870_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
-        pOV12870Ctx->one_line_exp_time =
-            (float)ae_info.one_line_exp_time_ns / 1000000000;
         pOV12870Ctx->MaxIntegrationLine = ae_info.max_integration_time;
-        pOV12870Ctx->AecMaxIntegrationTime =
-            pOV12870Ctx->MaxIntegrationLine *
-            pOV12870Ctx->one_line_exp_time;
+        OV12870_SetExposureTiming(pOV12870Ctx, ae_info.one_line_exp_time_ns * SENSOR_EXPOSURE_PS_PER_NS);
 #endif
     }
 
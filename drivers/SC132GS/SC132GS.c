@@ -37,7 +37,12 @@ CREATE_TRACER( SC132GS_REG_DEBUG, "SC132GS: ", INFO, 1);
 *****************************************************************************/
 static const char SensorName[16] = "SC132GS";
 
-static struct vvcam_mode_info psc132gs_mode_info[] = {
+/* frames until a shutter, gain and VTS write is in force; unverified: not
+   from the SC132GS datasheet nor measured, 2 for every group writes all of them
+   on the same frame as before */
+static const SensorLatency_t SC132GS_Latency = { .exposure = 2, .gain = 2, .vts = 2 };
+
+static const struct vvcam_mode_info psc132gs_mode_info[] = {
     {
         .index     = 0,
         .width     = 1080,
@@ -121,7 +126,7 @@ typedef struct {
     float max_val;
 } sc132gs_gain_map_t;
 
-static sc132gs_gain_map_t sc132gs_gain_map[] = {
+static const sc132gs_gain_map_t sc132gs_gain_map[] = {
     {0x03, 0.031, 1},
     {0x03, 0.031, 1.781},
     {0x023, 0.056, 3.568},
@@ -434,11 +439,29 @@ static RESULT SC132GS_IsiGetSensorModeIss(IsiSensorHandle_t handle,void *mode)
     return ( RET_SUCCESS );
 }
 
+static RESULT SC132GS_IsiGetRegCfgIss(const char *registerFileName, struct vvcam_sccb_array *arry);
+static RESULT SC132GS_IsiCheckSensorConnectionIss(IsiSensorHandle_t handle);
+
+/* written at runtime, never a warm restart signature */
+static const uint32_t SC132GS_WarmVolatileRegs[] = {
+    0x0100, 0x0103, 0x3800, 0x3817, 0x3e00, 0x3e01, 0x3e02, 0x3e08, 0x3e09, 0x3e12, 0x3e13,
+    0x30a0, 0x30a1, 0x30a2, 0x30a3, 0x30a4, 0x30a5, 0x30a6, 0x30a7,
+};
+
+static const SensorWarmOps_t SC132GS_WarmOps = {
+    .read          = SC132GS_IsiRegisterReadIss,
+    .write         = SC132GS_IsiRegisterWriteIss,
+    .pageReg       = SENSOR_WARM_NO_PAGE,
+    .pVolatile     = SC132GS_WarmVolatileRegs,
+    .volatileCount = sizeof(SC132GS_WarmVolatileRegs) / sizeof(SC132GS_WarmVolatileRegs[0]),
+};
+
 static RESULT SC132GS_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     RESULT result = RET_SUCCESS;
     SC132GS_Context_t *pSC132GSCtx;
 
     TRACE(SC132GS_INFO, "%s (enter)\n", __func__);
+    uint64_t createSpan = SensorTraceBegin();
 
     if (!pConfig || !pConfig->pSensor)
         return (RET_NULL_POINTER);
@@ -458,6 +481,7 @@ static RESULT SC132GS_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         return (result);
     }
 
+    SensorLatencySchedInit(&pSC132GSCtx->LatencySched, &SC132GS_Latency);
     pSC132GSCtx->IsiCtx.HalHandle = pConfig->HalHandle;
     pSC132GSCtx->IsiCtx.pSensor = pConfig->pSensor;
     pSC132GSCtx->GroupHold = BOOL_FALSE;
@@ -470,7 +494,7 @@ static RESULT SC132GS_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     pSC132GSCtx->SensorMode.index = pConfig->SensorModeIndex;
     pConfig->hSensor = (IsiSensorHandle_t) pSC132GSCtx;
 #ifdef SUBDEV_CHAR
-    struct vvcam_mode_info *SensorDefaultMode = NULL;
+    const struct vvcam_mode_info *SensorDefaultMode = NULL;
     for (int i=0; i < sizeof(psc132gs_mode_info)/ sizeof(struct vvcam_mode_info); i++)
     {
         if (psc132gs_mode_info[i].index == pSC132GSCtx->SensorMode.index)
@@ -514,9 +538,15 @@ static RESULT SC132GS_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
                 return -1;
         }
 
-        if (access(pSC132GSCtx->SensorRegCfgFile, F_OK) == 0) {
+        if (SensorBundleOpen(SensorName, SensorDefaultMode->index, &pSC132GSCtx->ModeBundle) == RET_SUCCESS ||
+            access(pSC132GSCtx->SensorRegCfgFile, F_OK) == 0) {
             pSC132GSCtx->KernelDriverFlag = 0;
             memcpy(&(pSC132GSCtx->SensorMode),SensorDefaultMode,sizeof(struct vvcam_mode_info));
+            /* read the mode data while the sensor powers up */
+            (void)SensorPrefetchStart(&pSC132GSCtx->Prefetch, &pSC132GSCtx->ModeBundle, pSC132GSCtx->SensorRegCfgFile, SC132GS_IsiGetRegCfgIss);
+            if (SensorBundleIsOpen(&pSC132GSCtx->ModeBundle)) {
+                (void)SensorProfileSetInit(&pSC132GSCtx->TuningProfiles, &pSC132GSCtx->ModeBundle);
+            }
         } else {
             return -1;
         }
@@ -525,9 +555,12 @@ static RESULT SC132GS_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         pSC132GSCtx->KernelDriverFlag = 1;
     }
 
+    uint64_t span = SensorTraceBegin();
     result = SC132GS_IsiSensorSetPowerIss(pSC132GSCtx, BOOL_TRUE);
+    SensorTraceEnd(SensorName, "power", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
+    span = SensorTraceBegin();
     uint32_t SensorClkIn = 0;
     if (pSC132GSCtx->KernelDriverFlag) {
         result = SC132GS_IsiSensorGetClkIss(pSC132GSCtx, &SensorClkIn);
@@ -535,19 +568,33 @@ static RESULT SC132GS_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     }
 
     result = SC132GS_IsiSensorSetClkIss(pSC132GSCtx, SensorClkIn);
+    SensorTraceEnd(SensorName, "clk", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
-    result = SC132GS_IsiResetSensorIss(pSC132GSCtx);
-    RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
-
-    pSC132GSCtx->pattern = ISI_BPAT_BGBGGRGR;
-
     if (!pSC132GSCtx->KernelDriverFlag) {
+        span = SensorTraceBegin();
         result = SC132GS_IsiConfigSensorSCCBIss(pSC132GSCtx);
+        SensorTraceEnd(SensorName, "sccb", span);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+
+    span = SensorTraceBegin();
+    /* a sensor a previous process left in this mode still holds its registers */
+    if (pSC132GSCtx->KernelDriverFlag ||
+        SensorWarmOpen(&pSC132GSCtx->Warm, SensorName, ((HalContext_t *)pSC132GSCtx->IsiCtx.HalHandle)->sensor_fd,
+                       &SC132GS_WarmOps, pSC132GSCtx) != RET_SUCCESS ||
+        SC132GS_IsiCheckSensorConnectionIss(pSC132GSCtx) != RET_SUCCESS ||
+        SensorWarmProbe(&pSC132GSCtx->Warm, pSC132GSCtx->SensorMode.index) != RET_SUCCESS) {
+        SensorWarmInvalidate(&pSC132GSCtx->Warm);
+        result = SC132GS_IsiResetSensorIss(pSC132GSCtx);
         RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
     }
+    SensorTraceEnd(SensorName, "reset", span);
+
+    pSC132GSCtx->pattern = ISI_BPAT_BGBGGRGR;
 #endif
 
+    SensorTraceEnd(SensorName, "create", createSpan);
     TRACE(SC132GS_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -603,41 +650,86 @@ static RESULT SC132GS_IsiGetRegCfgIss(const char *registerFileName,
     return 0;
 }
 
+static void SC132GS_SetExposureTiming(SC132GS_Context_t *pSC132GSCtx, uint32_t lineTimePs)
+{
+    SensorExposureTiming_t *pTiming = &pSC132GSCtx->ExpTiming;
+
+    SensorExposureTimingSet(pTiming, lineTimePs, pSC132GSCtx->MinIntegrationLine, pSC132GSCtx->MaxIntegrationLine);
+    pSC132GSCtx->one_line_exp_time           = (float)lineTimePs / 1e12f;
+    pSC132GSCtx->AecIntegrationTimeIncrement = SensorExposureLinesToTime(pTiming, 1);
+    pSC132GSCtx->AecMinIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->minLines);
+    pSC132GSCtx->AecMaxIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->maxLines);
+}
+
 static RESULT SC132GS_IsiInitSensorIss(IsiSensorHandle_t handle) {
     RESULT result = RET_SUCCESS;
 
     int ret = 0;
+    uint32_t lineTimePs = 0;
     SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
 
     HalContext_t *pHalCtx = (HalContext_t *) pSC132GSCtx->IsiCtx.HalHandle;
     TRACE(SC132GS_INFO, "%s (enter)\n", __func__);
+    uint64_t initSpan = SensorTraceBegin();
 
     if (pSC132GSCtx == NULL) {
         return (RET_WRONG_HANDLE);
     }
 
     if (pSC132GSCtx->KernelDriverFlag) {
-        ;
+        /* the kernel driver set the mode up, its frame rate is the one in force */
+        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pSC132GSCtx->SensorMode));
+        if (ret != 0) {
+            TRACE(SC132GS_ERROR, "%s:sensor get mode info error!\n",
+                  __func__);
+            return (RET_FAILURE);
+        }
+        pSC132GSCtx->MaxFps  = pSC132GSCtx->SensorMode.fps;
+        pSC132GSCtx->MinFps  = 1;
+        pSC132GSCtx->CurrFps = pSC132GSCtx->MaxFps;
     } else {
         struct vvcam_sccb_array arry;
-        result = SC132GS_IsiGetRegCfgIss(pSC132GSCtx->SensorRegCfgFile, &arry);
+        uint64_t span = SensorTraceBegin();
+        SensorPrefetchWait(&pSC132GSCtx->Prefetch);
+        if (SensorBundleIsOpen(&pSC132GSCtx->ModeBundle)) {
+            result = SensorBundleGetRegArray(&pSC132GSCtx->ModeBundle, &arry);
+        } else if (SensorPrefetchTakeRegs(&pSC132GSCtx->Prefetch, &arry) != RET_SUCCESS) {
+            result = SC132GS_IsiGetRegCfgIss(pSC132GSCtx->SensorRegCfgFile, &arry);
+        }
+        SensorTraceEnd(SensorName, "load", span);
         if (result != 0) {
             TRACE(SC132GS_ERROR,
                   "%s:SC132GS_IsiGetRegCfgIss error!\n", __func__);
             return (RET_FAILURE);
         }
 
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &arry);
-        if (ret != 0) {
-            TRACE(SC132GS_ERROR, "%s:Sensor Write Reg arry error!\n",
-                  __func__);
-            return (RET_FAILURE);
+        bool_t warm = pSC132GSCtx->Warm.resumed;
+        uint64_t regHash = SensorBundleHash(arry.sccb_data, arry.count * sizeof(struct vvcam_sccb_data),
+                                            SENSOR_BUNDLE_FNV_SEED);
+        if (SensorWarmResume(&pSC132GSCtx->Warm, regHash)) {
+            TRACE(SC132GS_INFO, "%s: warm restart, register set skipped\n", __func__);
+        } else {
+            if (warm) {
+                /* create skipped the reset, but the register set changed since */
+                result = SC132GS_IsiResetSensorIss(pSC132GSCtx);
+                RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+            }
+
+            span = SensorTraceBegin();
+            ret = SensorInitWriteRegs(&pSC132GSCtx->InitAsync, pHalCtx->sensor_fd, &arry);
+            SensorTraceEnd(SensorName, "write", span);
+            if (ret != 0) {
+                TRACE(SC132GS_ERROR, "%s:Sensor Write Reg arry error!\n",
+                      __func__);
+                return (RET_FAILURE);
+            }
+            (void)SensorWarmCommit(&pSC132GSCtx->Warm, pSC132GSCtx->SensorMode.index, regHash, &arry);
         }
 
         switch(pSC132GSCtx->SensorMode.index)
         {
             case 0:
-                pSC132GSCtx->one_line_exp_time = 0.81257f; //us 1/16  * line_time
+                lineTimePs = 812570;    /* 1/16 * line_time */
                 pSC132GSCtx->FrameLengthLines = (0x546 - 8) * 16;
                 pSC132GSCtx->CurFrameLengthLines = pSC132GSCtx->FrameLengthLines;
                 pSC132GSCtx->MaxIntegrationLine = pSC132GSCtx->CurFrameLengthLines - 3;
@@ -646,7 +738,7 @@ static RESULT SC132GS_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pSC132GSCtx->AecMinGain = 1;
                 break;
             case 1:
-                pSC132GSCtx->one_line_exp_time = 0.81257f; //us 1/16  * line_time
+                lineTimePs = 812570;    /* 1/16 * line_time */
                 pSC132GSCtx->FrameLengthLines = (0x546 - 8) * 16;
                 pSC132GSCtx->CurFrameLengthLines = pSC132GSCtx->FrameLengthLines;
                 pSC132GSCtx->MaxIntegrationLine = pSC132GSCtx->CurFrameLengthLines - 3;
@@ -655,7 +747,7 @@ static RESULT SC132GS_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pSC132GSCtx->AecMinGain = 1;
                 break;
             case 2:
-                pSC132GSCtx->one_line_exp_time = 0.81257f; //us 1/16  * line_time
+                lineTimePs = 812570;    /* 1/16 * line_time */
                 pSC132GSCtx->FrameLengthLines = (0x546 - 8) * 16;
                 pSC132GSCtx->CurFrameLengthLines = pSC132GSCtx->FrameLengthLines;
                 pSC132GSCtx->MaxIntegrationLine = pSC132GSCtx->CurFrameLengthLines - 3;
@@ -664,7 +756,7 @@ static RESULT SC132GS_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pSC132GSCtx->AecMinGain = 1;
                 break;
             case 3:
-                pSC132GSCtx->one_line_exp_time = 0.81257f; //us 1/16  * line_time
+                lineTimePs = 812570;    /* 1/16 * line_time */
                 pSC132GSCtx->FrameLengthLines = (0x546 - 8) * 16;
                 pSC132GSCtx->CurFrameLengthLines = pSC132GSCtx->FrameLengthLines;
                 pSC132GSCtx->MaxIntegrationLine = pSC132GSCtx->CurFrameLengthLines - 3;
@@ -673,7 +765,7 @@ static RESULT SC132GS_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pSC132GSCtx->AecMinGain = 1;
                 break;
             case 4:
-                pSC132GSCtx->one_line_exp_time = 0.81257f; //us 1/16  * line_time
+                lineTimePs = 812570;    /* 1/16 * line_time */
                 pSC132GSCtx->FrameLengthLines = (0x546 - 8) * 16;
                 pSC132GSCtx->CurFrameLengthLines = pSC132GSCtx->FrameLengthLines;
                 pSC132GSCtx->MaxIntegrationLine = pSC132GSCtx->CurFrameLengthLines - 3;
@@ -682,7 +774,7 @@ static RESULT SC132GS_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pSC132GSCtx->AecMinGain = 1;
                 break;
             case 5:
-                pSC132GSCtx->one_line_exp_time = 0.81257f; //us 1/16  * line_time
+                lineTimePs = 812570;    /* 1/16 * line_time */
                 pSC132GSCtx->FrameLengthLines = (0x546 - 8) * 16;
                 pSC132GSCtx->CurFrameLengthLines = pSC132GSCtx->FrameLengthLines;
                 pSC132GSCtx->MaxIntegrationLine = pSC132GSCtx->CurFrameLengthLines - 3;
@@ -694,17 +786,28 @@ static RESULT SC132GS_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 return ( RET_NOTAVAILABLE );
         }
 
-        pSC132GSCtx->AecIntegrationTimeIncrement = pSC132GSCtx->one_line_exp_time;
-        pSC132GSCtx->AecMinIntegrationTime =
-            pSC132GSCtx->one_line_exp_time * pSC132GSCtx->MinIntegrationLine;
-        pSC132GSCtx->AecMaxIntegrationTime =
-            pSC132GSCtx->one_line_exp_time * pSC132GSCtx->FrameLengthLines;
+        SC132GS_SetExposureTiming(pSC132GSCtx, lineTimePs);
 
         pSC132GSCtx->MaxFps  = pSC132GSCtx->SensorMode.fps;
         pSC132GSCtx->MinFps  = 1;
         pSC132GSCtx->CurrFps = pSC132GSCtx->MaxFps;
     }
 
+    /* the tuning may allow the sensor less gain than the mode can do */
+    pSC132GSCtx->AecMaxGain = SensorGainArbiterInit(&pSC132GSCtx->GainArbiter, &pSC132GSCtx->TuningProfiles, pSC132GSCtx->AecMaxGain);
+
+    if (pSC132GSCtx->Warm.resumed) {
+        float gain, integrationTime, hdrRatio, setGain, setIntegrationTime;
+        uint8_t skip;
+
+        /* carry on with the exposure the sensor streamed with */
+        if (SensorWarmLastExposure(&pSC132GSCtx->Warm, &gain, &integrationTime, &hdrRatio)) {
+            (void)SC132GS_IsiExposureControlIss(handle, gain, integrationTime, &skip,
+                                                &setGain, &setIntegrationTime, &hdrRatio);
+        }
+    }
+
+    SensorTraceEnd(SensorName, "init", initSpan);
     TRACE(SC132GS_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -717,10 +820,19 @@ static RESULT SC132GS_IsiReleaseSensorIss(IsiSensorHandle_t handle) {
     if (pSC132GSCtx == NULL)
         return (RET_WRONG_HANDLE);
 
+    /* an initialization still running in the background uses the context */
+    (void)SensorInitAsyncWait(&pSC132GSCtx->InitAsync);
+
     (void)SC132GS_IsiSensorSetStreamingIss(pSC132GSCtx, BOOL_FALSE);
     (void)SC132GS_IsiSensorSetPowerIss(pSC132GSCtx, BOOL_FALSE);
     (void)HalDelRef(pSC132GSCtx->IsiCtx.HalHandle);
 
+    SensorWarmClose(&pSC132GSCtx->Warm, BOOL_TRUE);
+
+    SensorPrefetchRelease(&pSC132GSCtx->Prefetch);
+    SensorLatencySchedRelease(&pSC132GSCtx->LatencySched);
+    (void)SensorBundleClose(&pSC132GSCtx->ModeBundle);
+
     MEMSET(pSC132GSCtx, 0, sizeof(SC132GS_Context_t));
     free(pSC132GSCtx);
     TRACE(SC132GS_INFO, "%s (exit)\n", __func__);
@@ -742,6 +854,7 @@ static RESULT SC132GS_IsiSetupSensorIss
     RESULT result = RET_SUCCESS;
 
     TRACE(SC132GS_INFO, "%s: (enter)\n", __func__);
+    uint64_t setupSpan = SensorTraceBegin();
 
     if (!pSC132GSCtx) {
         TRACE(SC132GS_ERROR,
@@ -765,7 +878,9 @@ static RESULT SC132GS_IsiSetupSensorIss
 
     /* 1.) SW reset of image sensor (via I2C register interface)  be careful, bits 6..0 are reserved, reset bit is not sticky */
     TRACE(SC132GS_DEBUG, "%s: SC132GS System-Reset executed\n", __func__);
+    uint64_t span = SensorTraceBegin();
     osSleep(100);
+    SensorTraceEnd(SensorName, "settle", span);
 
     //SC132GS_AecSetModeParameters not defined yet as of 2021/8/9.
     //result = SC132GS_AecSetModeParameters(pSC132GSCtx, pConfig);
@@ -782,6 +897,7 @@ static RESULT SC132GS_IsiSetupSensorIss
     ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);//result = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_S_FPS, &fmt);
 #endif
     pSC132GSCtx->Configured = BOOL_TRUE;
+    SensorTraceEnd(SensorName, "setup", setupSpan);
     TRACE(SC132GS_INFO, "%s: (exit) ret=0x%x \n", __func__, result);
     return result;
 }
@@ -804,6 +920,7 @@ static RESULT SC132GS_IsiSensorSetStreamingIss
     RESULT result = RET_SUCCESS;
     int ret = 0;
     TRACE(SC132GS_INFO, "%s (enter)\n", __func__);
+    uint64_t streamSpan = SensorTraceBegin();
 
     SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
     if (pSC132GSCtx == NULL || pSC132GSCtx->IsiCtx.HalHandle == NULL) {
@@ -851,6 +968,7 @@ static RESULT SC132GS_IsiSensorSetStreamingIss
 
     pSC132GSCtx->Streaming = on;
 
+    SensorTraceEnd(SensorName, on ? "stream on" : "stream off", streamSpan);
     TRACE(SC132GS_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -976,7 +1094,7 @@ static RESULT SC132GS_IsiGetIntegrationTimeLimitsIss
     }
 
     *pMinIntegrationTime = pSC132GSCtx->AecMinIntegrationTime;
-    *pMaxIntegrationTime = pSC132GSCtx->AecMaxIntegrationTime;
+    *pMaxIntegrationTime = SensorAntiFlickerSnapTime(&pSC132GSCtx->AntiFlicker, pSC132GSCtx->AecMaxIntegrationTime);
 
     TRACE(SC132GS_INFO, "%s: (enter)\n", __func__);
     return (result);
@@ -1348,18 +1466,12 @@ RESULT SC132GS_IsiSetIntegrationTimeIss
     SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
     HalContext_t *pHalCtx = (HalContext_t *) pSC132GSCtx->IsiCtx.HalHandle;
 
-    NewIntegrationTime *= 1000000;  //us
-
     // 曝光时间小于3ms, 对应到寄存器值3692
     //if (NewIntegrationTime > 3000) {
     //    NewIntegrationTime = 3000;
     //}
     // time to lines
-    exp_lines = NewIntegrationTime / pSC132GSCtx->one_line_exp_time;
-
-    if (exp_lines > pSC132GSCtx->FrameLengthLines) {
-        exp_lines = pSC132GSCtx->FrameLengthLines;
-    }
+    exp_lines = SensorExposureTimeToLines(&pSC132GSCtx->ExpTiming, NewIntegrationTime);
 
     //行长 = 寄存器{16‘h320c, 16′h320d}值*2
     //2*{16’h320e,16’h320f}-6:h320e,h320f为帧长
@@ -1371,7 +1483,7 @@ RESULT SC132GS_IsiSetIntegrationTimeIss
     result = SC132GS_IsiRegisterWriteIss(handle, 0x3e01, mval_time);
     result = SC132GS_IsiRegisterWriteIss(handle, 0x3e02, lval_time);
 
-    pSC132GSCtx->AecCurIntegrationTime = exp_lines * pSC132GSCtx->one_line_exp_time;
+    pSC132GSCtx->AecCurIntegrationTime = SensorExposureLinesToTime(&pSC132GSCtx->ExpTiming, exp_lines);
     *pNumberOfFramesToSkip = 1U;
     *pSetIntegrationTime = pSC132GSCtx->AecCurIntegrationTime;
 
@@ -1448,8 +1560,7 @@ RESULT SC132GS_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integ
     HalContext_t *pHalCtx = (HalContext_t *) pSC132GSCtx->IsiCtx.HalHandle;
 
     uint32_t exp_line = 0;
-    exp_line = IntegrationTime / pSC132GSCtx->one_line_exp_time;
-    exp_line = MIN(pSC132GSCtx->MaxIntegrationLine, MAX(pSC132GSCtx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pSC132GSCtx->ExpTiming, IntegrationTime);
 
     if (exp_line != pSC132GSCtx->LastLongExpLine)
     {
@@ -1464,7 +1575,7 @@ RESULT SC132GS_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integ
         }
 
         pSC132GSCtx->LastLongExpLine = exp_line;
-        pSC132GSCtx->AecCurLongIntegrationTime =  pSC132GSCtx->LastLongExpLine*pSC132GSCtx->one_line_exp_time;
+        pSC132GSCtx->AecCurLongIntegrationTime = SensorExposureLinesToTime(&pSC132GSCtx->ExpTiming, exp_line);
     }
 
 
@@ -1504,10 +1615,7 @@ RESULT SC132GS_IsiSetVSIntegrationTimeIss
           pSC132GSCtx->AecMinIntegrationTime);
 
 
-    exp_line = NewIntegrationTime / pSC132GSCtx->one_line_exp_time;
-    exp_line =
-        MIN(pSC132GSCtx->MaxIntegrationLine,
-        MAX(pSC132GSCtx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pSC132GSCtx->ExpTiming, NewIntegrationTime);
 
     if (exp_line != pSC132GSCtx->OldVsIntegrationTime) {
     /*TODO*/
@@ -1515,7 +1623,7 @@ RESULT SC132GS_IsiSetVSIntegrationTimeIss
     } else if (1){
 
         pSC132GSCtx->OldVsIntegrationTime = exp_line;
-        pSC132GSCtx->AecCurVSIntegrationTime = exp_line * pSC132GSCtx->one_line_exp_time;    //remember current integration time
+        pSC132GSCtx->AecCurVSIntegrationTime = SensorExposureLinesToTime(&pSC132GSCtx->ExpTiming, exp_line);    //remember current integration time
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
         *pNumberOfFramesToSkip = 0U;    //no frame skip
@@ -1538,6 +1646,8 @@ RESULT SC132GS_IsiExposureControlIss
 {
     SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
     RESULT result = RET_SUCCESS;
+    SensorFrameMeta_t meta;
+    uint32_t frame, validFrame;
 
     TRACE(SC132GS_INFO, "%s: (enter)\n", __func__);
 
@@ -1556,6 +1666,8 @@ RESULT SC132GS_IsiExposureControlIss
         return (RET_NULL_POINTER);
     }
 
+    SensorAntiFlickerApply(&pSC132GSCtx->AntiFlicker, &NewGain, &NewIntegrationTime);
+
     if (NewGain >= 28) {
         NewGain = 28;
     }
@@ -1563,9 +1675,6 @@ RESULT SC132GS_IsiExposureControlIss
     TRACE(SC132GS_DEBUG, "%s: g=%f, Ti=%f\n", __func__, NewGain,
           NewIntegrationTime);
 
-    if (NewIntegrationTime > pSC132GSCtx->FrameLengthLines * pSC132GSCtx->one_line_exp_time)
-        NewIntegrationTime = pSC132GSCtx->FrameLengthLines * pSC132GSCtx->one_line_exp_time;
-
     sc132gs_set_gain(handle, NewGain, pSetGain);
     SC132GS_IsiSetIntegrationTimeIss(handle, NewIntegrationTime, pSetIntegrationTime, pNumberOfFramesToSkip, hdr_ratio);
     pSC132GSCtx->AecCurGain = NewGain;
@@ -1573,6 +1682,20 @@ RESULT SC132GS_IsiExposureControlIss
 
     TRACE(SC132GS_DEBUG, "%s: set: vsg=%f, vsTi=%f, vsskip=%d\n", __func__,
           NewGain, NewIntegrationTime, *pNumberOfFramesToSkip);
+    validFrame = SensorLatencyWritten(&pSC132GSCtx->LatencySched, &frame);
+    *pNumberOfFramesToSkip = validFrame - frame;
+
+    meta.frame           = validFrame;
+    meta.lines           = SensorExposureTimeToLines(&pSC132GSCtx->ExpTiming, *pSetIntegrationTime);
+    meta.again           = 0;
+    meta.dgain           = 0;
+    meta.vts             = pSC132GSCtx->CurFrameLengthLines;
+    meta.gain            = *pSetGain;
+    meta.integrationTime = *pSetIntegrationTime;
+    meta.hdrRatio        = pSC132GSCtx->CurHdrRatio;
+    SensorFrameMetaRecord(&pSC132GSCtx->FrameMeta, &meta);
+    SensorWarmNoteExposure(&pSC132GSCtx->Warm, meta.gain, meta.integrationTime, meta.hdrRatio);
+
     TRACE(SC132GS_INFO, "%s: (exit)\n", __func__);
 
     return result;
@@ -1623,6 +1746,235 @@ RESULT SC132GS_IsiGetResolutionIss(IsiSensorHandle_t handle, uint16_t *pwidth, u
     return (result);
 }
 
+RESULT SC132GS_IsiGetModeBundleIss(IsiSensorHandle_t handle, const SensorBundle_t **ppBundle)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (!SensorBundleIsOpen(&pSC132GSCtx->ModeBundle)) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    *ppBundle = &pSC132GSCtx->ModeBundle;
+    return (RET_SUCCESS);
+}
+
+RESULT SC132GS_IsiSetTuningProfileIss(IsiSensorHandle_t handle, const char *pName)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+    int32_t index;
+
+    TRACE(SC132GS_INFO, "%s: (enter)\n", __func__);
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pName == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    index = SensorProfileFind(&pSC132GSCtx->TuningProfiles, pName);
+    if (index < 0) {
+        TRACE(SC132GS_ERROR, "%s: no tuning profile %s\n", __func__, pName);
+        return (RET_NOTAVAILABLE);
+    }
+
+    TRACE(SC132GS_INFO, "%s: (exit)\n", __func__);
+    return SensorProfileRequest(&pSC132GSCtx->TuningProfiles, index);
+}
+
+RESULT SC132GS_IsiLatchTuningProfileIss(IsiSensorHandle_t handle, const SensorTuningProfile_t **ppProfile, bool_t *pChanged)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+    bool_t changed;
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppProfile == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (pSC132GSCtx->TuningProfiles.count == 0) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    changed = SensorProfileFrameBoundary(&pSC132GSCtx->TuningProfiles, ppProfile);
+    if (changed) {
+        pSC132GSCtx->AecMaxGain = SensorGainArbiterUpdate(&pSC132GSCtx->GainArbiter, &pSC132GSCtx->TuningProfiles);
+    }
+    if (pChanged != NULL) {
+        *pChanged = changed;
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT SC132GS_IsiGetExposureStateIss(IsiSensorHandle_t handle, SensorExposureState_t *pState)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pState == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    pState->minGain                  = pSC132GSCtx->AecMinGain;
+    pState->maxGain                  = pSC132GSCtx->AecMaxGain;
+    pState->gainIncrement            = pSC132GSCtx->AecGainIncrement;
+    pState->minIntegrationTime       = pSC132GSCtx->AecMinIntegrationTime;
+    pState->maxIntegrationTime       = SensorAntiFlickerSnapTime(&pSC132GSCtx->AntiFlicker, pSC132GSCtx->AecMaxIntegrationTime);
+    pState->integrationTimeIncrement = pSC132GSCtx->AecIntegrationTimeIncrement;
+    pState->curGain                  = pSC132GSCtx->AecCurGain;
+    pState->curIntegrationTime       = pSC132GSCtx->AecCurIntegrationTime;
+    pState->curHdrRatio              = pSC132GSCtx->CurHdrRatio;
+    pState->curFps                   = pSC132GSCtx->CurrFps;
+    pState->minFps                   = pSC132GSCtx->MinFps;
+    pState->maxFps                   = pSC132GSCtx->MaxFps;
+    pState->frameLengthLines         = pSC132GSCtx->FrameLengthLines;
+    pState->curFrameLengthLines      = pSC132GSCtx->CurFrameLengthLines;
+    pState->minIntegrationLine       = pSC132GSCtx->MinIntegrationLine;
+    pState->maxIntegrationLine       = pSC132GSCtx->MaxIntegrationLine;
+
+    SensorExposureStatePublish(&pSC132GSCtx->ExposureState, pState);
+    return (RET_SUCCESS);
+}
+
+RESULT SC132GS_IsiSetAntiFlickerIss(IsiSensorHandle_t handle, SensorAntiFlickerMode_t mode, uint32_t detectedHz)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    TRACE(SC132GS_INFO, "%s: mode=%d detected=%uHz\n", __func__, mode, detectedHz);
+    return SensorAntiFlickerSet(&pSC132GSCtx->AntiFlicker, mode, detectedHz);
+}
+
+RESULT SC132GS_IsiFrameStartIss(IsiSensorHandle_t handle, uint32_t frame)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+
+    if (pSC132GSCtx == NULL || pSC132GSCtx->IsiCtx.HalHandle == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    HalContext_t *pHalCtx = (HalContext_t *) pSC132GSCtx->IsiCtx.HalHandle;
+    return SensorLatencyFrameStart(&pSC132GSCtx->LatencySched, pHalCtx->sensor_fd, frame);
+}
+
+RESULT SC132GS_IsiGetExposureValidFrameIss(IsiSensorHandle_t handle, uint32_t *pFrame)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pFrame == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    *pFrame = SensorLatencyValidFrame(&pSC132GSCtx->LatencySched);
+    return (RET_SUCCESS);
+}
+
+RESULT SC132GS_IsiGetFrameExposureIss(IsiSensorHandle_t handle, uint32_t frame, SensorFrameMeta_t *pMeta)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorFrameMetaLookup(&pSC132GSCtx->FrameMeta, frame, pMeta);
+}
+
+RESULT SC132GS_IsiGetGainSplitIss(IsiSensorHandle_t handle, float gain, SensorGainSplit_t *pSplit)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pSplit == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorGainArbitrate(&pSC132GSCtx->GainArbiter, NULL, pSC132GSCtx->AecCurGain, gain, pSplit);
+
+    return (RET_SUCCESS);
+}
+
+/* frame sync role of a mode, known before the sensor is created so bring-up can order the pair */
+RESULT SC132GS_IsiGetSyncRoleIss(uint32_t modeIndex, SensorSyncRole_t *pRole)
+{
+    if (pRole == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    switch (modeIndex) {
+        case 0:
+        case 3:
+            *pRole = SENSOR_SYNC_NONE;
+            break;
+        case 1:
+        case 4:
+            *pRole = SENSOR_SYNC_MASTER;
+            break;
+        case 2:
+        case 5:
+            *pRole = SENSOR_SYNC_SLAVE;
+            break;
+        default:
+            return (RET_NOTAVAILABLE);
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT SC132GS_IsiInitSensorAsyncIss(IsiSensorHandle_t handle, SensorInitDone_t done, void *pUser)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorInitAsyncStart(&pSC132GSCtx->InitAsync, SC132GS_IsiInitSensorIss, handle, done, pUser);
+}
+
+RESULT SC132GS_IsiGetInitStatusIss(IsiSensorHandle_t handle, SensorInitStatus_t *pStatus)
+{
+    SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
+
+    if (pSC132GSCtx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pStatus == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorInitAsyncQuery(&pSC132GSCtx->InitAsync, pStatus);
+
+    return (RET_SUCCESS);
+}
+
 RESULT SC132GS_IsiGetSensorFpsIss(IsiSensorHandle_t handle, uint32_t * pfps)
 {
     SC132GS_Context_t *pSC132GSCtx = (SC132GS_Context_t *) handle;
@@ -1687,11 +2039,15 @@ RESULT SC132GS_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
+        pSC132GSCtx->CurrFps = fps;
 
         ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pSC132GSCtx->SensorMode));
-        {
+        if (ret == 0) {
             pSC132GSCtx->MaxIntegrationLine = pSC132GSCtx->SensorMode.ae_info.max_integration_time;
-            pSC132GSCtx->AecMaxIntegrationTime = pSC132GSCtx->MaxIntegrationLine * pSC132GSCtx->one_line_exp_time;
+            /* the line time comes with the AE info only, unknown it stays 0 */
+            if (pSC132GSCtx->ExpTiming.lineTimePs != 0) {
+                SC132GS_SetExposureTiming(pSC132GSCtx, pSC132GSCtx->ExpTiming.lineTimePs);
+            }
         }
 #ifdef SUBDEV_CHAR
         struct vvcam_ae_info_s ae_info;
@@ -1702,12 +2058,8 @@ RESULT SC132GS_IsiSetSensorFpsIss(IsiSensorHandle_t handle, uint32_t fps)
                   __func__);
             return (RET_FAILURE);
         }
-        pSC132GSCtx->one_line_exp_time =
-            (float)ae_info.one_line_exp_time_ns / 1000000000;
         pSC132GSCtx->MaxIntegrationLine = ae_info.max_integration_time;
-        pSC132GSCtx->AecMaxIntegrationTime =
-            pSC132GSCtx->MaxIntegrationLine *
-            pSC132GSCtx->one_line_exp_time;
+        SC132GS_SetExposureTiming(pSC132GSCtx, ae_info.one_line_exp_time_ns * SENSOR_EXPOSURE_PS_PER_NS);
 #endif
     }
 
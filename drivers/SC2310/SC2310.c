@@ -38,7 +38,12 @@ CREATE_TRACER( SC2310_REG_DEBUG, "SC2310: ", INFO, 1);
 *****************************************************************************/
 static const char SensorName[16] = "SC2310";
 
-static struct vvcam_mode_info psc2310_mode_info[] = {
+/* frames until a shutter, gain and VTS write is in force; unverified: not
+   from the SC2310 datasheet nor measured, 2 for every group writes all of them
+   on the same frame as before */
+static const SensorLatency_t SC2310_Latency = { .exposure = 2, .gain = 2, .vts = 2 };
+
+static const struct vvcam_mode_info psc2310_mode_info[] = {
     {
         .index     = 0,
         .width     = 640,
@@ -103,7 +108,7 @@ typedef struct {
     float max_val;
 } sc2310_gain_map_t;
 
-static sc2310_gain_map_t sc2310_gain_map[] = {
+static const sc2310_gain_map_t sc2310_gain_map[] = {
     {0x03, 0.015, 1},
     {0x03, 0.015, 1.984},
     {0x07, 0.031, 2.688},
@@ -380,11 +385,29 @@ static RESULT SC2310_IsiGetSensorModeIss(IsiSensorHandle_t handle,void *mode)
     return ( RET_SUCCESS );
 }
 
+static RESULT SC2310_IsiGetRegCfgIss(const char *registerFileName, struct vvcam_sccb_array *arry);
+static RESULT SC2310_IsiCheckSensorConnectionIss(IsiSensorHandle_t handle);
+
+/* written at runtime, never a warm restart signature */
+static const uint32_t SC2310_WarmVolatileRegs[] = {
+    0x0100, 0x0103, 0x3812, 0x3e01, 0x3e02, 0x3e04, 0x3e05, 0x3e08, 0x3e09, 0x4501,
+    0x30a0, 0x30a1, 0x30a2, 0x30a3, 0x30a4, 0x30a5, 0x30a6, 0x30a7,
+};
+
+static const SensorWarmOps_t SC2310_WarmOps = {
+    .read          = SC2310_IsiRegisterReadIss,
+    .write         = SC2310_IsiRegisterWriteIss,
+    .pageReg       = SENSOR_WARM_NO_PAGE,
+    .pVolatile     = SC2310_WarmVolatileRegs,
+    .volatileCount = sizeof(SC2310_WarmVolatileRegs) / sizeof(SC2310_WarmVolatileRegs[0]),
+};
+
 static RESULT SC2310_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     RESULT result = RET_SUCCESS;
     SC2310_Context_t *pSC2310Ctx;
 
     TRACE(SC2310_INFO, "%s (enter)\n", __func__);
+    uint64_t createSpan = SensorTraceBegin();
 
     if (!pConfig || !pConfig->pSensor)
         return (RET_NULL_POINTER);
@@ -404,6 +427,7 @@ static RESULT SC2310_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         return (result);
     }
 
+    SensorLatencySchedInit(&pSC2310Ctx->LatencySched, &SC2310_Latency);
     pSC2310Ctx->IsiCtx.HalHandle = pConfig->HalHandle;
     pSC2310Ctx->IsiCtx.pSensor = pConfig->pSensor;
     pSC2310Ctx->GroupHold = BOOL_FALSE;
@@ -416,7 +440,7 @@ static RESULT SC2310_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     pSC2310Ctx->SensorMode.index = pConfig->SensorModeIndex;
     pConfig->hSensor = (IsiSensorHandle_t)pSC2310Ctx;
 #ifdef SUBDEV_CHAR
-    struct vvcam_mode_info *SensorDefaultMode = NULL;
+    const struct vvcam_mode_info *SensorDefaultMode = NULL;
     for (int i=0; i < sizeof(psc2310_mode_info)/ sizeof(struct vvcam_mode_info); i++)
     {
         if (psc2310_mode_info[i].index == pSC2310Ctx->SensorMode.index)
@@ -451,9 +475,15 @@ static RESULT SC2310_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
                 break;
         }
 
-        if (access(pSC2310Ctx->SensorRegCfgFile, F_OK) == 0) {
+        if (SensorBundleOpen(SensorName, SensorDefaultMode->index, &pSC2310Ctx->ModeBundle) == RET_SUCCESS ||
+            access(pSC2310Ctx->SensorRegCfgFile, F_OK) == 0) {
             pSC2310Ctx->KernelDriverFlag = 0;
             memcpy(&(pSC2310Ctx->SensorMode),SensorDefaultMode,sizeof(struct vvcam_mode_info));
+            /* read the mode data while the sensor powers up */
+            (void)SensorPrefetchStart(&pSC2310Ctx->Prefetch, &pSC2310Ctx->ModeBundle, pSC2310Ctx->SensorRegCfgFile, SC2310_IsiGetRegCfgIss);
+            if (SensorBundleIsOpen(&pSC2310Ctx->ModeBundle)) {
+                (void)SensorProfileSetInit(&pSC2310Ctx->TuningProfiles, &pSC2310Ctx->ModeBundle);
+            }
         } else {
             pSC2310Ctx->KernelDriverFlag = 1;
         }
@@ -462,10 +492,13 @@ static RESULT SC2310_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
         pSC2310Ctx->KernelDriverFlag = 1;
     }
 
+    uint64_t span = SensorTraceBegin();
     result = SC2310_IsiSensorSetPowerIss(pSC2310Ctx, BOOL_TRUE);
+    SensorTraceEnd(SensorName, "power", span);
 
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
+    span = SensorTraceBegin();
     uint32_t SensorClkIn = 0;
     if (pSC2310Ctx->KernelDriverFlag) {
         result = SC2310_IsiSensorGetClkIss(pSC2310Ctx, &SensorClkIn);
@@ -473,20 +506,33 @@ static RESULT SC2310_IsiCreateSensorIss(IsiSensorInstanceConfig_t * pConfig) {
     }
 
     result = SC2310_IsiSensorSetClkIss(pSC2310Ctx, SensorClkIn);
+    SensorTraceEnd(SensorName, "clk", span);
     RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
     if (!pSC2310Ctx->KernelDriverFlag) {
+        span = SensorTraceBegin();
         result = SC2310_IsiConfigSensorSCCBIss(pSC2310Ctx);
+        SensorTraceEnd(SensorName, "sccb", span);
         RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
 
-    result = SC2310_IsiResetSensorIss(pSC2310Ctx);
-    RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    span = SensorTraceBegin();
+    /* a sensor a previous process left in this mode still holds its registers */
+    if (SensorWarmOpen(&pSC2310Ctx->Warm, SensorName, ((HalContext_t *)pSC2310Ctx->IsiCtx.HalHandle)->sensor_fd,
+                       &SC2310_WarmOps, pSC2310Ctx) != RET_SUCCESS ||
+        SC2310_IsiCheckSensorConnectionIss(pSC2310Ctx) != RET_SUCCESS ||
+        SensorWarmProbe(&pSC2310Ctx->Warm, pSC2310Ctx->SensorMode.index) != RET_SUCCESS) {
+        SensorWarmInvalidate(&pSC2310Ctx->Warm);
+        result = SC2310_IsiResetSensorIss(pSC2310Ctx);
+        RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+    }
+    SensorTraceEnd(SensorName, "reset", span);
 
     pSC2310Ctx->pattern = ISI_BPAT_BGBGGRGR;
 
     }
 #endif
 
+    SensorTraceEnd(SensorName, "create", createSpan);
     TRACE(SC2310_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -542,41 +588,86 @@ static RESULT SC2310_IsiGetRegCfgIss(const char *registerFileName,
     return 0;
 }
 
+static void SC2310_SetExposureTiming(SC2310_Context_t *pSC2310Ctx, uint32_t lineTimePs)
+{
+    SensorExposureTiming_t *pTiming = &pSC2310Ctx->ExpTiming;
+
+    SensorExposureTimingSet(pTiming, lineTimePs, pSC2310Ctx->MinIntegrationLine, pSC2310Ctx->MaxIntegrationLine);
+    pSC2310Ctx->one_line_exp_time           = (float)lineTimePs / 1e12f;
+    pSC2310Ctx->AecIntegrationTimeIncrement = SensorExposureLinesToTime(pTiming, 1);
+    pSC2310Ctx->AecMinIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->minLines);
+    pSC2310Ctx->AecMaxIntegrationTime       = SensorExposureLinesToTime(pTiming, pTiming->maxLines);
+}
+
 static RESULT SC2310_IsiInitSensorIss(IsiSensorHandle_t handle) {
     RESULT result = RET_SUCCESS;
 
     int ret = 0;
+    uint32_t lineTimePs = 0;
     SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
 
     HalContext_t *pHalCtx = (HalContext_t *) pSC2310Ctx->IsiCtx.HalHandle;
     TRACE(SC2310_INFO, "%s (enter)\n", __func__);
+    uint64_t initSpan = SensorTraceBegin();
 
     if (pSC2310Ctx == NULL) {
         return (RET_WRONG_HANDLE);
     }
 
     if (pSC2310Ctx->KernelDriverFlag) {
-        ;
+        /* the kernel driver set the mode up, its frame rate is the one in force */
+        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_G_SENSOR_MODE, &(pSC2310Ctx->SensorMode));
+        if (ret != 0) {
+            TRACE(SC2310_ERROR, "%s:sensor get mode info error!\n",
+                  __func__);
+            return (RET_FAILURE);
+        }
+        pSC2310Ctx->MaxFps  = pSC2310Ctx->SensorMode.fps;
+        pSC2310Ctx->MinFps  = 1;
+        pSC2310Ctx->CurrFps = pSC2310Ctx->MaxFps;
     } else {
         struct vvcam_sccb_array arry;
-        result = SC2310_IsiGetRegCfgIss(pSC2310Ctx->SensorRegCfgFile, &arry);
+        uint64_t span = SensorTraceBegin();
+        SensorPrefetchWait(&pSC2310Ctx->Prefetch);
+        if (SensorBundleIsOpen(&pSC2310Ctx->ModeBundle)) {
+            result = SensorBundleGetRegArray(&pSC2310Ctx->ModeBundle, &arry);
+        } else if (SensorPrefetchTakeRegs(&pSC2310Ctx->Prefetch, &arry) != RET_SUCCESS) {
+            result = SC2310_IsiGetRegCfgIss(pSC2310Ctx->SensorRegCfgFile, &arry);
+        }
+        SensorTraceEnd(SensorName, "load", span);
         if (result != 0) {
             TRACE(SC2310_ERROR,
                   "%s:SC2310_IsiGetRegCfgIss error!\n", __func__);
             return (RET_FAILURE);
         }
 
-        ret = ioctl(pHalCtx->sensor_fd, VVSENSORIOC_WRITE_ARRAY, &arry);
-        if (ret != 0) {
-            TRACE(SC2310_ERROR, "%s:Sensor Write Reg arry error!\n",
-                  __func__);
-            return (RET_FAILURE);
+        bool_t warm = pSC2310Ctx->Warm.resumed;
+        uint64_t regHash = SensorBundleHash(arry.sccb_data, arry.count * sizeof(struct vvcam_sccb_data),
+                                            SENSOR_BUNDLE_FNV_SEED);
+        if (SensorWarmResume(&pSC2310Ctx->Warm, regHash)) {
+            TRACE(SC2310_INFO, "%s: warm restart, register set skipped\n", __func__);
+        } else {
+            if (warm) {
+                /* create skipped the reset, but the register set changed since */
+                result = SC2310_IsiResetSensorIss(pSC2310Ctx);
+                RETURN_RESULT_IF_DIFFERENT(RET_SUCCESS, result);
+            }
+
+            span = SensorTraceBegin();
+            ret = SensorInitWriteRegs(&pSC2310Ctx->InitAsync, pHalCtx->sensor_fd, &arry);
+            SensorTraceEnd(SensorName, "write", span);
+            if (ret != 0) {
+                TRACE(SC2310_ERROR, "%s:Sensor Write Reg arry error!\n",
+                      __func__);
+                return (RET_FAILURE);
+            }
+            (void)SensorWarmCommit(&pSC2310Ctx->Warm, pSC2310Ctx->SensorMode.index, regHash, &arry);
         }
 
         switch(pSC2310Ctx->SensorMode.index)
         {
             case 0:
-                pSC2310Ctx->one_line_exp_time = 1.0 / (2.0 * 0x465 - 6.0) / 26.0;
+                lineTimePs = 17139723;    /* 1 / (2 * 0x465 - 6) / 26 s */
                 pSC2310Ctx->FrameLengthLines = 2 * 0x465;
                 pSC2310Ctx->CurFrameLengthLines = pSC2310Ctx->FrameLengthLines;
                 pSC2310Ctx->MaxIntegrationLine = pSC2310Ctx->CurFrameLengthLines - 6;
@@ -585,7 +676,7 @@ static RESULT SC2310_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pSC2310Ctx->AecMinGain = 1;
                 break;
             case 1:
-                pSC2310Ctx->one_line_exp_time = 1.0 / (2 * 0x465 - 6.0) / 26.0;
+                lineTimePs = 17139723;
                 pSC2310Ctx->FrameLengthLines = 2 * 0x465;
                 pSC2310Ctx->CurFrameLengthLines = pSC2310Ctx->FrameLengthLines;
                 pSC2310Ctx->MaxIntegrationLine = pSC2310Ctx->CurFrameLengthLines - 6;
@@ -594,7 +685,7 @@ static RESULT SC2310_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pSC2310Ctx->AecMinGain = 1;
                 break;
             case 2:
-                pSC2310Ctx->one_line_exp_time = 1.0 / (2 * 0x465 - 6.0) / 30.0;
+                lineTimePs = 14854427;    /* 1 / (2 * 0x465 - 6) / 30 s */
                 pSC2310Ctx->FrameLengthLines = 2 * 0x465;
                 pSC2310Ctx->CurFrameLengthLines = pSC2310Ctx->FrameLengthLines;
                 pSC2310Ctx->MaxIntegrationLine = pSC2310Ctx->CurFrameLengthLines - 6;
@@ -603,7 +694,7 @@ static RESULT SC2310_IsiInitSensorIss(IsiSensorHandle_t handle) {
                 pSC2310Ctx->AecMinGain = 1;
                 break;
             case 3:
-                pSC2310Ctx->one_line_exp_time = 1.0 / (2 * 0x465 - 6.0) / 30.0;
+                lineTimePs = 14854427;
                 pSC2310Ctx->FrameLengthLines = 2 * 0x465;
                 pSC2310Ctx->CurFrameLengthLines = pSC2310Ctx->FrameLengthLines;
                 pSC2310Ctx->MaxIntegrationLine = pSC2310Ctx->CurFrameLengthLines - 6;
@@ -615,12 +706,7 @@ static RESULT SC2310_IsiInitSensorIss(IsiSensorHandle_t handle) {
             default:
                 return ( RET_NOTAVAILABLE );
         }
-        printf("pSC2310Ctx->one_line_exp_time %f\n", pSC2310Ctx->one_line_exp_time);
-		pSC2310Ctx->AecIntegrationTimeIncrement = pSC2310Ctx->one_line_exp_time;
-		pSC2310Ctx->AecMinIntegrationTime =
-			pSC2310Ctx->one_line_exp_time * pSC2310Ctx->MinIntegrationLine;
-		pSC2310Ctx->AecMaxIntegrationTime =
-			pSC2310Ctx->one_line_exp_time * pSC2310Ctx->FrameLengthLines;
+        SC2310_SetExposureTiming(pSC2310Ctx, lineTimePs);
 
 
         pSC2310Ctx->MaxFps  = pSC2310Ctx->SensorMode.fps;
@@ -628,6 +714,21 @@ static RESULT SC2310_IsiInitSensorIss(IsiSensorHandle_t handle) {
         pSC2310Ctx->CurrFps = pSC2310Ctx->MaxFps;
     }
 
+    /* the tuning may allow the sensor less gain than the mode can do */
+    pSC2310Ctx->AecMaxGain = SensorGainArbiterInit(&pSC2310Ctx->GainArbiter, &pSC2310Ctx->TuningProfiles, pSC2310Ctx->AecMaxGain);
+
+    if (pSC2310Ctx->Warm.resumed) {
+        float gain, integrationTime, hdrRatio, setGain, setIntegrationTime;
+        uint8_t skip;
+
+        /* carry on with the exposure the sensor streamed with */
+        if (SensorWarmLastExposure(&pSC2310Ctx->Warm, &gain, &integrationTime, &hdrRatio)) {
+            (void)SC2310_IsiExposureControlIss(handle, gain, integrationTime, &skip,
+                                               &setGain, &setIntegrationTime, &hdrRatio);
+        }
+    }
+
+    SensorTraceEnd(SensorName, "init", initSpan);
     TRACE(SC2310_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -640,10 +741,19 @@ static RESULT SC2310_IsiReleaseSensorIss(IsiSensorHandle_t handle) {
     if (pSC2310Ctx == NULL)
         return (RET_WRONG_HANDLE);
 
+    /* an initialization still running in the background uses the context */
+    (void)SensorInitAsyncWait(&pSC2310Ctx->InitAsync);
+
     (void)SC2310_IsiSensorSetStreamingIss(pSC2310Ctx, BOOL_FALSE);
     (void)SC2310_IsiSensorSetPowerIss(pSC2310Ctx, BOOL_FALSE);
     (void)HalDelRef(pSC2310Ctx->IsiCtx.HalHandle);
 
+    SensorWarmClose(&pSC2310Ctx->Warm, BOOL_TRUE);
+
+    SensorPrefetchRelease(&pSC2310Ctx->Prefetch);
+    SensorLatencySchedRelease(&pSC2310Ctx->LatencySched);
+    (void)SensorBundleClose(&pSC2310Ctx->ModeBundle);
+
     MEMSET(pSC2310Ctx, 0, sizeof(SC2310_Context_t));
     free(pSC2310Ctx);
     TRACE(SC2310_INFO, "%s (exit)\n", __func__);
@@ -665,6 +775,7 @@ static RESULT SC2310_IsiSetupSensorIss
     RESULT result = RET_SUCCESS;
 
     TRACE(SC2310_INFO, "%s: (enter)\n", __func__);
+    uint64_t setupSpan = SensorTraceBegin();
 
     if (!pSC2310Ctx) {
         TRACE(SC2310_ERROR,
@@ -687,6 +798,7 @@ static RESULT SC2310_IsiSetupSensorIss
     memcpy(&pSC2310Ctx->Config, pConfig, sizeof(IsiSensorConfig_t));
 
     pSC2310Ctx->Configured = BOOL_TRUE;
+    SensorTraceEnd(SensorName, "setup", setupSpan);
     TRACE(SC2310_INFO, "%s: (exit) ret=0x%x \n", __func__, result);
     return result;
 }
@@ -709,6 +821,7 @@ static RESULT SC2310_IsiSensorSetStreamingIss
     RESULT result = RET_SUCCESS;
     int ret = 0;
     TRACE(SC2310_INFO, "%s (enter)\n", __func__);
+    uint64_t streamSpan = SensorTraceBegin();
 
     SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
     if (pSC2310Ctx == NULL || pSC2310Ctx->IsiCtx.HalHandle == NULL) {
@@ -744,6 +857,7 @@ static RESULT SC2310_IsiSensorSetStreamingIss
 
     pSC2310Ctx->Streaming = on;
 
+    SensorTraceEnd(SensorName, on ? "stream on" : "stream off", streamSpan);
     TRACE(SC2310_INFO, "%s (exit)\n", __func__);
     return (result);
 }
@@ -870,7 +984,7 @@ static RESULT SC2310_IsiGetIntegrationTimeLimitsIss
     }
 
     *pMinIntegrationTime = pSC2310Ctx->AecMinIntegrationTime;
-    *pMaxIntegrationTime = pSC2310Ctx->AecMaxIntegrationTime;
+    *pMaxIntegrationTime = SensorAntiFlickerSnapTime(&pSC2310Ctx->AntiFlicker, pSC2310Ctx->AecMaxIntegrationTime);
 
     TRACE(SC2310_INFO, "%s: (enter)\n", __func__);
     return (result);
@@ -1237,12 +1351,7 @@ RESULT SC2310_IsiSetIntegrationTimeIss
     SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
     HalContext_t *pHalCtx = (HalContext_t *) pSC2310Ctx->IsiCtx.HalHandle;
 
-    exp_lines = NewIntegrationTime / pSC2310Ctx->one_line_exp_time;
-    if (exp_lines > pSC2310Ctx->MaxIntegrationLine) {
-        exp_lines = pSC2310Ctx->MaxIntegrationLine;
-    } else if (exp_lines < 3) {
-        exp_lines = 3;
-    }
+    exp_lines = SensorExposureTimeToLines(&pSC2310Ctx->ExpTiming, NewIntegrationTime);
 
     //行长 = 寄存器{16‘h320c, 16′h320d}值*2
     //2*{16’h320e,16’h320f}-6:h320e,h320f为帧长
@@ -1252,7 +1361,7 @@ RESULT SC2310_IsiSetIntegrationTimeIss
     result = SC2310_IsiRegisterWriteIss(handle, 0x3e01, hval_time);
     result = SC2310_IsiRegisterWriteIss(handle, 0x3e02, lval_time);
 
-    pSC2310Ctx->AecCurIntegrationTime = exp_lines * pSC2310Ctx->one_line_exp_time;
+    pSC2310Ctx->AecCurIntegrationTime = SensorExposureLinesToTime(&pSC2310Ctx->ExpTiming, exp_lines);
     *pNumberOfFramesToSkip = 1U;
     *pSetIntegrationTime = pSC2310Ctx->AecCurIntegrationTime;
 
@@ -1330,12 +1439,7 @@ RESULT SC2310_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integr
 
     HalContext_t *pHalCtx = (HalContext_t *) pSC2310Ctx->IsiCtx.HalHandle;
 
-    exp_lines = IntegrationTime / pSC2310Ctx->one_line_exp_time;
-    if (exp_lines > pSC2310Ctx->MaxIntegrationLine) {
-        exp_lines = pSC2310Ctx->MaxIntegrationLine;
-    } else if (exp_lines < 1) {
-        exp_lines = 1;
-    }
+    exp_lines = SensorExposureTimeToLines(&pSC2310Ctx->ExpTiming, IntegrationTime);
 
     uint32_t hval_time =  (exp_lines & 0xf00) >> 4;
     uint32_t lval_time =  exp_lines & 0xff;
@@ -1343,8 +1447,8 @@ RESULT SC2310_IsiSetLongIntegrationTimeIss(IsiSensorHandle_t handle,float Integr
     SC2310_IsiRegisterWriteIss(handle, 0x3e01, lval_time);
     SC2310_IsiRegisterWriteIss(handle, 0x3e02, hval_time);
 
-    pSC2310Ctx->AecCurIntegrationTime = exp_lines * pSC2310Ctx->one_line_exp_time;
-    pSC2310Ctx->AecCurLongIntegrationTime = exp_lines * pSC2310Ctx->one_line_exp_time;
+    pSC2310Ctx->AecCurIntegrationTime = SensorExposureLinesToTime(&pSC2310Ctx->ExpTiming, exp_lines);
+    pSC2310Ctx->AecCurLongIntegrationTime = pSC2310Ctx->AecCurIntegrationTime;
 
     TRACE(SC2310_INFO, "%s: (exit)\n", __func__);
     return (RET_SUCCESS);
@@ -1390,10 +1494,7 @@ RESULT SC2310_IsiSetVSIntegrationTimeIss
 
 
 
-    exp_line = NewIntegrationTime / pSC2310Ctx->one_line_exp_time;
-    exp_line =
-        MIN(pSC2310Ctx->MaxIntegrationLine,
-        MAX(pSC2310Ctx->MinIntegrationLine, exp_line));
+    exp_line = SensorExposureTimeToLines(&pSC2310Ctx->ExpTiming, NewIntegrationTime);
 
     if (exp_line != pSC2310Ctx->OldVsIntegrationTime) {
     /*TODO*/
@@ -1401,7 +1502,7 @@ RESULT SC2310_IsiSetVSIntegrationTimeIss
     } else if (1){
 
         pSC2310Ctx->OldVsIntegrationTime = exp_line;
-        pSC2310Ctx->AecCurVSIntegrationTime = exp_line * pSC2310Ctx->one_line_exp_time;    //remember current integration time
+        pSC2310Ctx->AecCurVSIntegrationTime = SensorExposureLinesToTime(&pSC2310Ctx->ExpTiming, exp_line);    //remember current integration time
         *pNumberOfFramesToSkip = 1U;    //skip 1 frame
     } else {
         *pNumberOfFramesToSkip = 0U;    //no frame skip
@@ -1424,6 +1525,8 @@ RESULT SC2310_IsiExposureControlIss
 {
     SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
     RESULT result = RET_SUCCESS;
+    SensorFrameMeta_t meta;
+    uint32_t frame, validFrame;
 
     TRACE(SC2310_INFO, "%s: (enter)\n", __func__);
 
@@ -1442,6 +1545,8 @@ RESULT SC2310_IsiExposureControlIss
         return (RET_NULL_POINTER);
     }
 
+    SensorAntiFlickerApply(&pSC2310Ctx->AntiFlicker, &NewGain, &NewIntegrationTime);
+
     if (NewGain >= 35) { // More than 35 will not take effect
         NewGain = 35;
     }
@@ -1449,9 +1554,6 @@ RESULT SC2310_IsiExposureControlIss
     TRACE(SC2310_DEBUG, "%s: g=%f, Ti=%f\n", __func__, NewGain,
           NewIntegrationTime);
 
-    if (NewIntegrationTime > pSC2310Ctx->MaxIntegrationLine * pSC2310Ctx->one_line_exp_time)
-        NewIntegrationTime = pSC2310Ctx->MaxIntegrationLine * pSC2310Ctx->one_line_exp_time;
-
 
     sc2310_set_gain(handle, NewGain, pSetGain);
     SC2310_IsiSetIntegrationTimeIss(handle, NewIntegrationTime, pSetIntegrationTime, pNumberOfFramesToSkip, hdr_ratio);
@@ -1461,6 +1563,20 @@ RESULT SC2310_IsiExposureControlIss
 
     TRACE(SC2310_DEBUG, "%s: set: vsg=%f, vsTi=%f, vsskip=%d\n", __func__,
           NewGain, NewIntegrationTime, *pNumberOfFramesToSkip);
+    validFrame = SensorLatencyWritten(&pSC2310Ctx->LatencySched, &frame);
+    *pNumberOfFramesToSkip = validFrame - frame;
+
+    meta.frame           = validFrame;
+    meta.lines           = SensorExposureTimeToLines(&pSC2310Ctx->ExpTiming, *pSetIntegrationTime);
+    meta.again           = 0;
+    meta.dgain           = 0;
+    meta.vts             = pSC2310Ctx->CurFrameLengthLines;
+    meta.gain            = *pSetGain;
+    meta.integrationTime = *pSetIntegrationTime;
+    meta.hdrRatio        = pSC2310Ctx->CurHdrRatio;
+    SensorFrameMetaRecord(&pSC2310Ctx->FrameMeta, &meta);
+    SensorWarmNoteExposure(&pSC2310Ctx->Warm, meta.gain, meta.integrationTime, meta.hdrRatio);
+
     TRACE(SC2310_INFO, "%s: (exit)\n", __func__);
 
     return result;
@@ -1511,6 +1627,208 @@ RESULT SC2310_IsiGetResolutionIss(IsiSensorHandle_t handle, uint16_t *pwidth, ui
     return (result);
 }
 
+RESULT SC2310_IsiGetModeBundleIss(IsiSensorHandle_t handle, const SensorBundle_t **ppBundle)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (!SensorBundleIsOpen(&pSC2310Ctx->ModeBundle)) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    *ppBundle = &pSC2310Ctx->ModeBundle;
+    return (RET_SUCCESS);
+}
+
+RESULT SC2310_IsiSetTuningProfileIss(IsiSensorHandle_t handle, const char *pName)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+    int32_t index;
+
+    TRACE(SC2310_INFO, "%s: (enter)\n", __func__);
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pName == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    index = SensorProfileFind(&pSC2310Ctx->TuningProfiles, pName);
+    if (index < 0) {
+        TRACE(SC2310_ERROR, "%s: no tuning profile %s\n", __func__, pName);
+        return (RET_NOTAVAILABLE);
+    }
+
+    TRACE(SC2310_INFO, "%s: (exit)\n", __func__);
+    return SensorProfileRequest(&pSC2310Ctx->TuningProfiles, index);
+}
+
+RESULT SC2310_IsiLatchTuningProfileIss(IsiSensorHandle_t handle, const SensorTuningProfile_t **ppProfile, bool_t *pChanged)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+    bool_t changed;
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (ppProfile == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (pSC2310Ctx->TuningProfiles.count == 0) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    changed = SensorProfileFrameBoundary(&pSC2310Ctx->TuningProfiles, ppProfile);
+    if (changed) {
+        pSC2310Ctx->AecMaxGain = SensorGainArbiterUpdate(&pSC2310Ctx->GainArbiter, &pSC2310Ctx->TuningProfiles);
+    }
+    if (pChanged != NULL) {
+        *pChanged = changed;
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT SC2310_IsiGetExposureStateIss(IsiSensorHandle_t handle, SensorExposureState_t *pState)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pState == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    pState->minGain                  = pSC2310Ctx->AecMinGain;
+    pState->maxGain                  = pSC2310Ctx->AecMaxGain;
+    pState->gainIncrement            = pSC2310Ctx->AecGainIncrement;
+    pState->minIntegrationTime       = pSC2310Ctx->AecMinIntegrationTime;
+    pState->maxIntegrationTime       = SensorAntiFlickerSnapTime(&pSC2310Ctx->AntiFlicker, pSC2310Ctx->AecMaxIntegrationTime);
+    pState->integrationTimeIncrement = pSC2310Ctx->AecIntegrationTimeIncrement;
+    pState->curGain                  = pSC2310Ctx->AecCurGain;
+    pState->curIntegrationTime       = pSC2310Ctx->AecCurIntegrationTime;
+    pState->curHdrRatio              = pSC2310Ctx->CurHdrRatio;
+    pState->curFps                   = pSC2310Ctx->CurrFps;
+    pState->minFps                   = pSC2310Ctx->MinFps;
+    pState->maxFps                   = pSC2310Ctx->MaxFps;
+    pState->frameLengthLines         = pSC2310Ctx->FrameLengthLines;
+    pState->curFrameLengthLines      = pSC2310Ctx->CurFrameLengthLines;
+    pState->minIntegrationLine       = pSC2310Ctx->MinIntegrationLine;
+    pState->maxIntegrationLine       = pSC2310Ctx->MaxIntegrationLine;
+
+    SensorExposureStatePublish(&pSC2310Ctx->ExposureState, pState);
+    return (RET_SUCCESS);
+}
+
+RESULT SC2310_IsiSetAntiFlickerIss(IsiSensorHandle_t handle, SensorAntiFlickerMode_t mode, uint32_t detectedHz)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    TRACE(SC2310_INFO, "%s: mode=%d detected=%uHz\n", __func__, mode, detectedHz);
+    return SensorAntiFlickerSet(&pSC2310Ctx->AntiFlicker, mode, detectedHz);
+}
+
+RESULT SC2310_IsiFrameStartIss(IsiSensorHandle_t handle, uint32_t frame)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+
+    if (pSC2310Ctx == NULL || pSC2310Ctx->IsiCtx.HalHandle == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    HalContext_t *pHalCtx = (HalContext_t *) pSC2310Ctx->IsiCtx.HalHandle;
+    return SensorLatencyFrameStart(&pSC2310Ctx->LatencySched, pHalCtx->sensor_fd, frame);
+}
+
+RESULT SC2310_IsiGetExposureValidFrameIss(IsiSensorHandle_t handle, uint32_t *pFrame)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pFrame == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    *pFrame = SensorLatencyValidFrame(&pSC2310Ctx->LatencySched);
+    return (RET_SUCCESS);
+}
+
+RESULT SC2310_IsiGetFrameExposureIss(IsiSensorHandle_t handle, uint32_t frame, SensorFrameMeta_t *pMeta)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorFrameMetaLookup(&pSC2310Ctx->FrameMeta, frame, pMeta);
+}
+
+RESULT SC2310_IsiGetGainSplitIss(IsiSensorHandle_t handle, float gain, SensorGainSplit_t *pSplit)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pSplit == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorGainArbitrate(&pSC2310Ctx->GainArbiter, NULL, pSC2310Ctx->AecCurGain, gain, pSplit);
+
+    return (RET_SUCCESS);
+}
+
+RESULT SC2310_IsiInitSensorAsyncIss(IsiSensorHandle_t handle, SensorInitDone_t done, void *pUser)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    return SensorInitAsyncStart(&pSC2310Ctx->InitAsync, SC2310_IsiInitSensorIss, handle, done, pUser);
+}
+
+RESULT SC2310_IsiGetInitStatusIss(IsiSensorHandle_t handle, SensorInitStatus_t *pStatus)
+{
+    SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
+
+    if (pSC2310Ctx == NULL) {
+        return (RET_WRONG_HANDLE);
+    }
+
+    if (pStatus == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorInitAsyncQuery(&pSC2310Ctx->InitAsync, pStatus);
+
+    return (RET_SUCCESS);
+}
+
 RESULT SC2310_IsiGetSensorFpsIss(IsiSensorHandle_t handle, uint32_t * pfps)
 {
     SC2310_Context_t *pSC2310Ctx = (SC2310_Context_t *) handle;
@@ -0,0 +1,72 @@
+# sensor_add_bundle(<module> <mode index> <register txt> <3aconfig json|NONE> <calibration xml|NONE>
+#                   [PROFILE <name> <3aconfig json>]...)
+#
+# Packs one mode of a driver into ${SENSOR_NAME}_mode<index>.vsb with
+# tools/sensor_bundle.py (which also runs tools/calib_compiler.py on the
+# calibration xml, and packs <xml name>.gain.csv from next to the xml if there
+# is one) and installs it next to the .drv. All bundles of a
+# driver are collected into the ${module}.bundle target. The 3aconfig json is
+# the "default" tuning profile, the one the gain split limits are read from;
+# each PROFILE adds a named tuning that can be switched to at runtime (see
+# sensor_profile.h). Without Python 3 no bundle is built: the drivers then
+# run from the register files, without profiles and gain split limits.
+function(sensor_add_bundle module mode regs config_3a calib)
+    if (NOT PYTHONINTERP_FOUND)
+        get_property(warned GLOBAL PROPERTY SENSOR_BUNDLE_WARNED)
+        if (NOT warned)
+            message(WARNING "Python 3 not found: no sensor bundles, the drivers run without "
+                            "tuning profiles and gain split limits")
+            set_property(GLOBAL PROPERTY SENSOR_BUNDLE_WARNED TRUE)
+        endif()
+        return()
+    endif()
+
+    string(TOUPPER ${module} SENSOR_NAME)
+    get_filename_component(tools ${SENSOR_BUNDLE_TOOL} DIRECTORY)
+    set(src ${CMAKE_CURRENT_SOURCE_DIR})
+    set(out ${CMAKE_CURRENT_BINARY_DIR}/${SENSOR_NAME}_mode${mode}.vsb)
+    set(args --sensor ${SENSOR_NAME} --mode ${mode} --regs ${src}/${regs})
+    set(deps ${src}/${regs})
+    if (NOT config_3a STREQUAL "NONE")
+        list(APPEND args --config-3a ${src}/${config_3a})
+        list(APPEND deps ${src}/${config_3a})
+    endif()
+    if (NOT calib STREQUAL "NONE")
+        list(APPEND args --calib ${src}/${calib})
+        list(APPEND deps ${src}/${calib})
+        get_filename_component(calib_name ${calib} NAME_WE)
+        if (EXISTS ${src}/${calib_name}.gain.csv)
+            list(APPEND args --gain-curve ${src}/${calib_name}.gain.csv)
+            list(APPEND deps ${src}/${calib_name}.gain.csv)
+        endif()
+    endif()
+    set(extra ${ARGN})
+    while (extra)
+        list(GET extra 0 keyword)
+        list(LENGTH extra n)
+        if (NOT keyword STREQUAL "PROFILE" OR n LESS 3)
+            message(FATAL_ERROR "sensor_add_bundle: expected PROFILE <name> <json>, got ${extra}")
+        endif()
+        list(GET extra 1 name)
+        list(GET extra 2 json)
+        list(APPEND args --profile ${name}=${src}/${json})
+        list(APPEND deps ${src}/${json})
+        list(REMOVE_AT extra 0 1 2)
+    endwhile()
+
+    add_custom_command(OUTPUT ${out}
+                       COMMAND ${PYTHON_EXECUTABLE} ${SENSOR_BUNDLE_TOOL} pack ${args} -o ${out}
+                       COMMAND ${CMAKE_COMMAND} -E make_directory ${LIB_ROOT}/rootfs/usr/share/vi/isp/test/
+                       COMMAND ${CMAKE_COMMAND} -E copy ${out} ${LIB_ROOT}/rootfs/usr/share/vi/isp/test/
+                       COMMAND ${CMAKE_COMMAND} -E copy ${out} ${LIB_ROOT}/rootfs/usr/share/vi/tuningtool/bin/
+                       DEPENDS ${deps} ${SENSOR_BUNDLE_TOOL} ${tools}/calib_compiler.py
+                       COMMENT "Packing ${SENSOR_NAME} mode ${mode} bundle"
+                       )
+
+    if (NOT TARGET ${module}.bundle)
+        add_custom_target(${module}.bundle ALL)
+        add_dependencies(${module}.bundle ${module}.drv)
+    endif()
+    add_custom_target(${module}.bundle.${mode} DEPENDS ${out})
+    add_dependencies(${module}.bundle ${module}.bundle.${mode})
+endfunction()
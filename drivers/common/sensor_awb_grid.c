@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_awb_grid.h"
+
+CREATE_TRACER( SENSOR_AWB_GRID_ERROR, "SENSOR_AWB_GRID: ", ERROR, 1);
+
+RESULT SensorAwbGridInit(const SensorBundle_t *pBundle, SensorAwbGrid_t *pGrid)
+{
+    const SensorAwbGridHeader_t *pHeader;
+    const void *pData = NULL;
+    uint32_t size = 0;
+    uint32_t tableSize;
+    RESULT result;
+
+    if (pGrid == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    MEMSET(pGrid, 0, sizeof(SensorAwbGrid_t));
+
+    result = SensorBundleGetSection(pBundle, SENSOR_BUNDLE_SECTION_AWB_GRID, &pData, &size);
+    if (result != RET_SUCCESS) {
+        return (result);
+    }
+
+    if (size < sizeof(SensorAwbGridHeader_t)) {
+        return (RET_FAILURE);
+    }
+
+    pHeader = (const SensorAwbGridHeader_t *)pData;
+    tableSize = (uint32_t)pHeader->rgSteps * pHeader->bgSteps * pHeader->illuCount;
+    if (pHeader->magic != SENSOR_AWB_GRID_MAGIC ||
+        pHeader->illuCount == 0 || pHeader->illuCount > SENSOR_AWB_GRID_MAX_ILLU ||
+        pHeader->rgSteps == 0 || pHeader->bgSteps == 0 ||
+        pHeader->rgStep <= 0.0f || pHeader->bgStep <= 0.0f ||
+        size - sizeof(SensorAwbGridHeader_t) < tableSize) {
+        TRACE(SENSOR_AWB_GRID_ERROR, "%s: malformed AWB grid\n", __func__);
+        return (RET_FAILURE);
+    }
+
+    pGrid->pHeader   = pHeader;
+    pGrid->pWeights  = (const uint8_t *)pData + sizeof(SensorAwbGridHeader_t);
+    pGrid->rgInvStep = 1.0f / pHeader->rgStep;
+    pGrid->bgInvStep = 1.0f / pHeader->bgStep;
+
+    return (RET_SUCCESS);
+}
+
+int32_t SensorAwbGridClassify(const SensorAwbGrid_t *pGrid, float rg, float bg)
+{
+    const uint8_t *pWeights = SensorAwbGridLookup(pGrid, rg, bg);
+    int32_t best = -1;
+    uint8_t bestWeight = 0;
+
+    for (int32_t i = 0; i < pGrid->pHeader->illuCount; i++) {
+        if (pWeights[i] > bestWeight) {
+            bestWeight = pWeights[i];
+            best = i;
+        }
+    }
+
+    return best;
+}
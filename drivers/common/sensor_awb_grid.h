@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_awb_grid.h
+ *
+ * @brief Precomputed AWB illuminant classifier.
+ *
+ * tools/calib_compiler.py evaluates the per-illuminant Gaussians of the AWB
+ * calibration (GMM invCovMatrix, GaussianMeanValue, GaussianScalingFactor,
+ * after the SVDMeanValue/PCAMatrix projection) on a quantized (r/g, b/g)
+ * grid and stores normalized weights, 255 meaning "only this illuminant".
+ * The grid is shipped in the mode bundle, so classifying a white point is a
+ * single table read. tau is carried through unchanged for the AWB side.
+ *
+ * @defgroup sensor_awb_grid
+ * @{
+ *
+ */
+#ifndef __SENSOR_AWB_GRID_H__
+#define __SENSOR_AWB_GRID_H__
+
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include "sensor_bundle.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_AWB_GRID_MAGIC       0x44475741U     /**< "AWGD" little endian */
+#define SENSOR_AWB_GRID_MAX_ILLU    8
+#define SENSOR_AWB_GRID_NAME_LEN    16
+
+/**
+ * @brief On-disk grid header, followed by
+ *        uint8_t weights[bgSteps][rgSteps][illuCount].
+ */
+typedef struct SensorAwbGridHeader_s
+{
+    uint32_t    magic;
+    uint16_t    illuCount;
+    uint16_t    rgSteps;
+    uint16_t    bgSteps;
+    uint16_t    reserved;
+    float       rgMin;
+    float       rgStep;
+    float       bgMin;
+    float       bgStep;
+    char        illuName[SENSOR_AWB_GRID_MAX_ILLU][SENSOR_AWB_GRID_NAME_LEN];
+    float       tau[SENSOR_AWB_GRID_MAX_ILLU][2];
+} SensorAwbGridHeader_t;
+
+typedef struct SensorAwbGrid_s
+{
+    const SensorAwbGridHeader_t *pHeader;
+    const uint8_t               *pWeights;
+    float                       rgInvStep;
+    float                       bgInvStep;
+} SensorAwbGrid_t;
+
+/**
+ * @brief Attach to the AWB grid of an opened bundle, nothing is copied.
+ *
+ * @return  RET_SUCCESS, RET_NOTAVAILABLE if the bundle carries no grid,
+ *          RET_FAILURE if the section is malformed
+ */
+RESULT SensorAwbGridInit(const SensorBundle_t *pBundle, SensorAwbGrid_t *pGrid);
+
+/**
+ * @brief Return the illuminant weights (pGrid->pHeader->illuCount entries)
+ *        for a white point. Points outside the grid are clamped to its edge.
+ *        All weights are zero where no illuminant model fits.
+ */
+static inline const uint8_t *SensorAwbGridLookup(const SensorAwbGrid_t *pGrid, float rg, float bg)
+{
+    const SensorAwbGridHeader_t *pHeader = pGrid->pHeader;
+    int32_t i = (int32_t)((rg - pHeader->rgMin) * pGrid->rgInvStep);
+    int32_t j = (int32_t)((bg - pHeader->bgMin) * pGrid->bgInvStep);
+
+    i = MIN(MAX(i, 0), (int32_t)pHeader->rgSteps - 1);
+    j = MIN(MAX(j, 0), (int32_t)pHeader->bgSteps - 1);
+
+    return pGrid->pWeights + ((uint32_t)j * pHeader->rgSteps + (uint32_t)i) * pHeader->illuCount;
+}
+
+/**
+ * @brief Index of the illuminant with the largest weight, -1 if none fits.
+ */
+int32_t SensorAwbGridClassify(const SensorAwbGrid_t *pGrid, float rg, float bg);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_awb_grid */
+
+#endif    /* __SENSOR_AWB_GRID_H__ */
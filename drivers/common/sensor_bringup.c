@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <pthread.h>
+#include <time.h>
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_bringup.h"
+
+CREATE_TRACER( SENSOR_BRINGUP_INFO , "SENSOR_BRINGUP: ", INFO,    0);
+CREATE_TRACER( SENSOR_BRINGUP_ERROR, "SENSOR_BRINGUP: ", ERROR,   1);
+
+typedef struct BringupPool_s
+{
+    pthread_mutex_t     lock;
+    pthread_cond_t      progress;           /**< a job completed a stage or finished */
+    SensorBringupJob_t  *pJobs;
+    uint32_t            order[SENSOR_BRINGUP_MAX_JOBS];     /**< masters before their slaves */
+    uint32_t            count;
+    uint32_t            next;               /**< next entry of order to start */
+} BringupPool_t;
+
+static uint64_t BringupNowUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* start order with every master ahead of its slaves, FALSE on a bad or circular reference */
+static bool_t BringupOrder(BringupPool_t *pPool)
+{
+    bool_t queued[SENSOR_BRINGUP_MAX_JOBS] = { BOOL_FALSE };
+    uint32_t n = 0;
+
+    while (n < pPool->count) {
+        uint32_t before = n;
+
+        for (uint32_t i = 0; i < pPool->count; i++) {
+            int32_t master = pPool->pJobs[i].master;
+
+            if (queued[i]) {
+                continue;
+            }
+            if (master != SENSOR_BRINGUP_NO_MASTER &&
+                (master < 0 || (uint32_t)master >= pPool->count || (uint32_t)master == i)) {
+                return BOOL_FALSE;
+            }
+            if (master == SENSOR_BRINGUP_NO_MASTER || queued[master]) {
+                queued[i] = BOOL_TRUE;
+                pPool->order[n++] = i;
+            }
+        }
+        if (n == before) {
+            return BOOL_FALSE;
+        }
+    }
+
+    return BOOL_TRUE;
+}
+
+static void BringupAdvance(BringupPool_t *pPool, SensorBringupJob_t *pJob, SensorBringupStage_t stage)
+{
+    pthread_mutex_lock(&pPool->lock);
+    pJob->stage = stage;
+    pthread_cond_broadcast(&pPool->progress);
+    pthread_mutex_unlock(&pPool->lock);
+}
+
+static RESULT BringupWaitMaster(BringupPool_t *pPool, const SensorBringupJob_t *pJob)
+{
+    const SensorBringupJob_t *pMaster;
+    RESULT result = RET_SUCCESS;
+
+    if (pJob->master == SENSOR_BRINGUP_NO_MASTER) {
+        return (RET_SUCCESS);
+    }
+    pMaster = &pPool->pJobs[pJob->master];
+
+    pthread_mutex_lock(&pPool->lock);
+    while (pMaster->stage < pJob->masterStage && pMaster->result == RET_PENDING) {
+        pthread_cond_wait(&pPool->progress, &pPool->lock);
+    }
+    if (pMaster->stage < pJob->masterStage) {
+        result = RET_CANCELED;      /* the master failed or stopped short */
+    }
+    pthread_mutex_unlock(&pPool->lock);
+
+    return (result);
+}
+
+static void BringupJob(BringupPool_t *pPool, SensorBringupJob_t *pJob)
+{
+    const IsiSensor_t *pSensor = pJob->pSensor;
+    uint64_t start = BringupNowUs();
+    RESULT result;
+
+    result = BringupWaitMaster(pPool, pJob);
+
+    if (result == RET_SUCCESS) {
+        result = (pSensor->pIsiCreateSensorIss != NULL) ?
+                 pSensor->pIsiCreateSensorIss(pJob->pConfig) : RET_NOTSUPP;
+        if (result == RET_SUCCESS) {
+            BringupAdvance(pPool, pJob, SENSOR_BRINGUP_CREATE);
+        }
+    }
+
+    if (result == RET_SUCCESS) {
+        result = (pSensor->pIsiInitSensorIss != NULL) ?
+                 pSensor->pIsiInitSensorIss(pJob->pConfig->hSensor) : RET_NOTSUPP;
+        if (result == RET_SUCCESS) {
+            BringupAdvance(pPool, pJob, SENSOR_BRINGUP_INIT);
+        }
+    }
+
+    if (result == RET_SUCCESS && pJob->pSetup != NULL) {
+        result = (pSensor->pIsiSetupSensorIss != NULL) ?
+                 pSensor->pIsiSetupSensorIss(pJob->pConfig->hSensor, pJob->pSetup) : RET_NOTSUPP;
+        if (result == RET_SUCCESS) {
+            BringupAdvance(pPool, pJob, SENSOR_BRINGUP_SETUP);
+        }
+    }
+
+    pthread_mutex_lock(&pPool->lock);
+    pJob->durationUs = (uint32_t)(BringupNowUs() - start);
+    pJob->result     = result;
+    pthread_cond_broadcast(&pPool->progress);
+    pthread_mutex_unlock(&pPool->lock);
+
+    if (result != RET_SUCCESS) {
+        TRACE(SENSOR_BRINGUP_ERROR, "%s: %s failed after stage %d: %d\n", __func__,
+              pSensor->pszName, pJob->stage, result);
+    } else {
+        TRACE(SENSOR_BRINGUP_INFO, "%s: %s up in %u us\n", __func__, pSensor->pszName, pJob->durationUs);
+    }
+}
+
+static void *BringupWorker(void *pArg)
+{
+    BringupPool_t *pPool = (BringupPool_t *)pArg;
+
+    for (;;) {
+        uint32_t index;
+
+        pthread_mutex_lock(&pPool->lock);
+        if (pPool->next >= pPool->count) {
+            pthread_mutex_unlock(&pPool->lock);
+            break;
+        }
+        index = pPool->order[pPool->next++];
+        pthread_mutex_unlock(&pPool->lock);
+
+        BringupJob(pPool, &pPool->pJobs[index]);
+    }
+
+    return NULL;
+}
+
+void SensorBringupLinkSync(SensorBringupJob_t *pJobs, uint32_t count, const SensorSyncRole_t *pRoles,
+                           const uint32_t *pGroups)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t master = SENSOR_BRINGUP_NO_MASTER;
+
+        if (pRoles[i] != SENSOR_SYNC_SLAVE) {
+            continue;
+        }
+
+        for (uint32_t j = 0; j < count && master == SENSOR_BRINGUP_NO_MASTER; j++) {
+            if (pRoles[j] == SENSOR_SYNC_MASTER && (pGroups == NULL || pGroups[j] == pGroups[i])) {
+                master = (int32_t)j;
+            }
+        }
+        pJobs[i].master      = master;
+        pJobs[i].masterStage = SENSOR_BRINGUP_INIT;
+    }
+}
+
+RESULT SensorBringupRun(SensorBringupJob_t *pJobs, uint32_t count, uint32_t threads)
+{
+    pthread_t thread[SENSOR_BRINGUP_MAX_JOBS];
+    uint32_t started = 0;
+    uint64_t start = BringupNowUs();
+    BringupPool_t pool;
+    RESULT result = RET_SUCCESS;
+
+    if (pJobs == NULL) {
+        return (RET_NULL_POINTER);
+    }
+    if (count == 0 || count > SENSOR_BRINGUP_MAX_JOBS) {
+        return (RET_OUTOFRANGE);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (pJobs[i].pSensor == NULL || pJobs[i].pConfig == NULL) {
+            return (RET_NULL_POINTER);
+        }
+        pJobs[i].result     = RET_PENDING;
+        pJobs[i].stage      = SENSOR_BRINGUP_NONE;
+        pJobs[i].durationUs = 0;
+    }
+
+    MEMSET(&pool, 0, sizeof(pool));
+    pool.pJobs = pJobs;
+    pool.count = count;
+    if (!BringupOrder(&pool)) {
+        TRACE(SENSOR_BRINGUP_ERROR, "%s: bad or circular master reference\n", __func__);
+        return (RET_INVALID_PARM);
+    }
+
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.progress, NULL);
+
+    threads = (threads == 0) ? count : MIN(threads, count);
+    for (uint32_t i = 0; i < threads; i++) {
+        if (pthread_create(&thread[started], NULL, BringupWorker, &pool) == 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        (void)BringupWorker(&pool);     /* no threads to be had, one after the other */
+    }
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(thread[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool.progress);
+    pthread_mutex_destroy(&pool.lock);
+
+    for (uint32_t i = 0; i < count && result == RET_SUCCESS; i++) {
+        result = pJobs[i].result;
+    }
+
+    TRACE(SENSOR_BRINGUP_INFO, "%s: %u sensors on %u threads in %u us\n", __func__,
+          count, MAX(started, 1U), (uint32_t)(BringupNowUs() - start));
+    return (result);
+}
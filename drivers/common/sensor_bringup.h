@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_bringup.h
+ *
+ * @brief Concurrent bring-up of several sensors.
+ *
+ * Creating a sensor powers it, sets its clock, resets it and configures
+ * SCCB; initializing it writes the mode's register set. Most of that time
+ * the CPU waits on power-on and reset delays or on I2C. Run one sensor
+ * after the other and a board pays these delays once per camera.
+ *
+ * SensorBringupRun() runs create, init and setup of every job on a small
+ * pool of threads, so the waits overlap. Each sensor still goes through
+ * its stages in order on one thread; different sensors share nothing but
+ * the I2C bus, which the kernel serializes.
+ *
+ * A job may depend on another one, e.g. a frame sync slave whose master
+ * must be initialized first (SC132GS dual camera modes): it then waits
+ * for the master to finish the given stage before it starts, and fails
+ * with RET_CANCELED if the master fails. Masters are started before their
+ * slaves, so a waiting slave never holds the thread its master needs.
+ *
+ * @defgroup sensor_bringup
+ * @{
+ *
+ */
+#ifndef __SENSOR_BRINGUP_H__
+#define __SENSOR_BRINGUP_H__
+
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include <isi/isi.h>
+#include <isi/isi_iss.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_BRINGUP_MAX_JOBS     8
+#define SENSOR_BRINGUP_NO_MASTER    (-1)
+
+typedef enum SensorBringupStage_e
+{
+    SENSOR_BRINGUP_NONE     = 0,        /**< nothing done yet */
+    SENSOR_BRINGUP_CREATE   = 1,
+    SENSOR_BRINGUP_INIT     = 2,
+    SENSOR_BRINGUP_SETUP    = 3,
+} SensorBringupStage_t;
+
+typedef enum SensorSyncRole_e
+{
+    SENSOR_SYNC_NONE        = 0,
+    SENSOR_SYNC_MASTER      = 1,
+    SENSOR_SYNC_SLAVE       = 2,
+} SensorSyncRole_t;
+
+typedef struct SensorBringupJob_s
+{
+    const IsiSensor_t           *pSensor;       /**< driver entry points */
+    IsiSensorInstanceConfig_t   *pConfig;       /**< hSensor receives the handle */
+    const IsiSensorConfig_t     *pSetup;        /**< NULL to stop after init */
+    int32_t                     master;         /**< index of the job to wait for, SENSOR_BRINGUP_NO_MASTER if none */
+    SensorBringupStage_t        masterStage;    /**< stage the master has to complete first */
+
+    RESULT                      result;         /**< out: first failure, or RET_SUCCESS */
+    SensorBringupStage_t        stage;          /**< out: last stage completed */
+    uint32_t                    durationUs;     /**< out: from start to the last stage */
+} SensorBringupJob_t;
+
+/**
+ * @brief Make every slave job wait for the init of the master of its group.
+ *
+ * @param   pRoles      sync role of each job, e.g. from the mode it is
+ *                      created with
+ * @param   pGroups     sync group of each job, e.g. the frame sync line it
+ *                      is wired to; NULL if all jobs share one. The slaves
+ *                      of a group without a master run unordered, of one
+ *                      with several the first master counts
+ */
+void SensorBringupLinkSync(SensorBringupJob_t *pJobs, uint32_t count, const SensorSyncRole_t *pRoles,
+                           const uint32_t *pGroups);
+
+/**
+ * @brief Bring up count sensors on up to threads threads (0: one per job)
+ *        and wait for all of them.
+ *
+ * @return  RET_SUCCESS if every job succeeded, else the first failure; the
+ *          per job outcome is in each job, sensors that were created stay
+ *          created
+ */
+RESULT SensorBringupRun(SensorBringupJob_t *pJobs, uint32_t count, uint32_t threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_bringup */
+
+#endif    /* __SENSOR_BRINGUP_H__ */
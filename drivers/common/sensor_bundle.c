@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include <common/misc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "sensor_bundle.h"
+
+CREATE_TRACER( SENSOR_BUNDLE_INFO , "SENSOR_BUNDLE: ", INFO,    0);
+CREATE_TRACER( SENSOR_BUNDLE_ERROR, "SENSOR_BUNDLE: ", ERROR,   1);
+
+uint64_t SensorBundleHash(const void *pData, size_t size, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)pData;
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+bool_t SensorBundleIsOpen(const SensorBundle_t *pBundle)
+{
+    return (pBundle != NULL && pBundle->pBase != NULL) ? BOOL_TRUE : BOOL_FALSE;
+}
+
+static RESULT SensorBundleCheck(const SensorBundle_t *pBundle)
+{
+    const SensorBundleHeader_t *pHeader = pBundle->pHeader;
+    size_t indexEnd;
+
+    if (pBundle->size < sizeof(SensorBundleHeader_t)) {
+        return (RET_FAILURE);
+    }
+
+    if (pHeader->magic != SENSOR_BUNDLE_MAGIC ||
+        pHeader->version != SENSOR_BUNDLE_VERSION ||
+        pHeader->totalSize != pBundle->size) {
+        return (RET_FAILURE);
+    }
+
+    indexEnd = sizeof(SensorBundleHeader_t) +
+               pHeader->sectionCount * sizeof(SensorBundleSection_t);
+    if (indexEnd > pBundle->size) {
+        return (RET_FAILURE);
+    }
+
+    for (uint32_t i = 0; i < pHeader->sectionCount; i++) {
+        const SensorBundleSection_t *pSection = &pBundle->pSections[i];
+        if ((pSection->offset % SENSOR_BUNDLE_ALIGN) != 0 ||
+            pSection->offset < indexEnd ||
+            pSection->size > pBundle->size - pSection->offset) {
+            return (RET_FAILURE);
+        }
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT SensorBundleOpenFile(const char *pFileName, SensorBundle_t *pBundle)
+{
+    struct stat st;
+    void *pMap;
+    int fd;
+
+    if (pFileName == NULL || pBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    MEMSET(pBundle, 0, sizeof(SensorBundle_t));
+    pBundle->fd = -1;
+
+    fd = open(pFileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return (RET_FAILURE);
+    }
+
+    /* not populated here, the pages are read ahead while the caller goes on (see sensor_prefetch.h) */
+    pMap = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pMap == MAP_FAILED) {
+        TRACE(SENSOR_BUNDLE_ERROR, "%s: mmap %s failed\n", __func__, pFileName);
+        close(fd);
+        return (RET_FAILURE);
+    }
+    (void)madvise(pMap, st.st_size, MADV_WILLNEED);
+
+    pBundle->fd        = fd;
+    pBundle->pBase     = (const uint8_t *)pMap;
+    pBundle->size      = st.st_size;
+    pBundle->pHeader   = (const SensorBundleHeader_t *)pMap;
+    pBundle->pSections = (const SensorBundleSection_t *)(pBundle->pBase + sizeof(SensorBundleHeader_t));
+
+    if (SensorBundleCheck(pBundle) != RET_SUCCESS) {
+        TRACE(SENSOR_BUNDLE_ERROR, "%s: %s is not a valid bundle\n", __func__, pFileName);
+        SensorBundleClose(pBundle);
+        return (RET_FAILURE);
+    }
+
+    TRACE(SENSOR_BUNDLE_INFO, "%s: %s mode %u, %u sections, hash 0x%016llx\n",
+          __func__, pFileName, pBundle->pHeader->modeIndex,
+          pBundle->pHeader->sectionCount,
+          (unsigned long long)pBundle->pHeader->contentHash);
+
+    return (RET_SUCCESS);
+}
+
+RESULT SensorBundleOpen(const char *pSensorName, uint32_t modeIndex, SensorBundle_t *pBundle)
+{
+    char fileName[256];
+    int n;
+
+    if (pSensorName == NULL || pBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    n = snprintf(fileName, sizeof(fileName), "%s%s_mode%u" SENSOR_BUNDLE_SUFFIX,
+                 get_vi_config_path(), pSensorName, modeIndex);
+    if (n < 0 || n >= (int)sizeof(fileName)) {
+        return (RET_OUTOFRANGE);
+    }
+
+    RESULT result = SensorBundleOpenFile(fileName, pBundle);
+    if (result != RET_SUCCESS) {
+        return (result);
+    }
+
+    if (pBundle->pHeader->modeIndex != modeIndex ||
+        strncmp(pBundle->pHeader->sensorName, pSensorName, sizeof(pBundle->pHeader->sensorName)) != 0) {
+        TRACE(SENSOR_BUNDLE_ERROR, "%s: %s does not belong to %s mode %u\n",
+              __func__, fileName, pSensorName, modeIndex);
+        SensorBundleClose(pBundle);
+        return (RET_FAILURE);
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT SensorBundleClose(SensorBundle_t *pBundle)
+{
+    if (pBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    /* a zeroed (never opened) bundle owns neither a mapping nor fd 0 */
+    if (pBundle->pBase == NULL) {
+        return (RET_SUCCESS);
+    }
+
+    munmap((void *)pBundle->pBase, pBundle->size);
+    close(pBundle->fd);
+
+    MEMSET(pBundle, 0, sizeof(SensorBundle_t));
+    pBundle->fd = -1;
+
+    return (RET_SUCCESS);
+}
+
+RESULT SensorBundleVerify(const SensorBundle_t *pBundle)
+{
+    uint64_t contentHash = SENSOR_BUNDLE_FNV_SEED;
+
+    if (!SensorBundleIsOpen(pBundle)) {
+        return (RET_WRONG_STATE);
+    }
+
+    for (uint32_t i = 0; i < pBundle->pHeader->sectionCount; i++) {
+        const SensorBundleSection_t *pSection = &pBundle->pSections[i];
+        const uint8_t *pData = pBundle->pBase + pSection->offset;
+
+        if (SensorBundleHash(pData, pSection->size, SENSOR_BUNDLE_FNV_SEED) != pSection->hash) {
+            return (RET_FAILURE);
+        }
+        contentHash = SensorBundleHash(pData, pSection->size, contentHash);
+    }
+
+    return (contentHash == pBundle->pHeader->contentHash) ? RET_SUCCESS : RET_FAILURE;
+}
+
+RESULT SensorBundleGetSectionAt(const SensorBundle_t *pBundle, uint32_t type, uint32_t nth,
+                                const void **ppData, uint32_t *pSize)
+{
+    if (ppData == NULL || pSize == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (!SensorBundleIsOpen(pBundle)) {
+        return (RET_WRONG_STATE);
+    }
+
+    for (uint32_t i = 0; i < pBundle->pHeader->sectionCount; i++) {
+        if (pBundle->pSections[i].type == type && nth-- == 0) {
+            *ppData = pBundle->pBase + pBundle->pSections[i].offset;
+            *pSize  = pBundle->pSections[i].size;
+            return (RET_SUCCESS);
+        }
+    }
+
+    return (RET_NOTAVAILABLE);
+}
+
+RESULT SensorBundleGetSection(const SensorBundle_t *pBundle, uint32_t type,
+                              const void **ppData, uint32_t *pSize)
+{
+    return SensorBundleGetSectionAt(pBundle, type, 0, ppData, pSize);
+}
+
+RESULT SensorBundleGetRegArray(const SensorBundle_t *pBundle, struct vvcam_sccb_array *arry)
+{
+    const void *pData = NULL;
+    uint32_t size = 0;
+    RESULT result;
+
+    if (arry == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    result = SensorBundleGetSection(pBundle, SENSOR_BUNDLE_SECTION_REGS, &pData, &size);
+    if (result != RET_SUCCESS) {
+        return (result);
+    }
+
+    /* the packer writes {uint32_t addr, uint32_t data}, which must match the kernel struct */
+    if (sizeof(struct vvcam_sccb_data) != 2 * sizeof(uint32_t) ||
+        (size % sizeof(struct vvcam_sccb_data)) != 0) {
+        return (RET_NOTSUPP);
+    }
+
+    arry->count     = size / sizeof(struct vvcam_sccb_data);
+    arry->sccb_data = (struct vvcam_sccb_data *)pData;
+
+    return (RET_SUCCESS);
+}
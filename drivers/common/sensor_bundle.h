@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_bundle.h
+ *
+ * @brief Per-mode tuning bundle shared by all sensor drivers.
+ *
+ * A bundle packs everything a sensor mode needs into one file: the register
+ * init sequence (the former *.txt), the 3A parameters (3aconfig_*.json) and
+ * the calibration data (*_WxH.xml). The file starts with a fixed header and
+ * a section index, so it can be opened with one open() and one mmap() and
+ * then used in place.
+ *
+ * Bundles are produced at build time by tools/sensor_bundle.py and are named
+ * "<SENSOR>_mode<index>.vsb", keyed by vvcam_mode_info.index.
+ *
+ * @defgroup sensor_bundle
+ * @{
+ *
+ */
+#ifndef __SENSOR_BUNDLE_H__
+#define __SENSOR_BUNDLE_H__
+
+#include <stddef.h>
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include <vvsensor.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_BUNDLE_MAGIC         0x4e425356U     /**< "VSBN" little endian */
+#define SENSOR_BUNDLE_VERSION       1U
+#define SENSOR_BUNDLE_SUFFIX        ".vsb"
+#define SENSOR_BUNDLE_ALIGN         8U
+
+/**
+ * @brief Section types stored in a bundle.
+ */
+typedef enum SensorBundleSectionType_e
+{
+    SENSOR_BUNDLE_SECTION_INVALID   = 0,
+    SENSOR_BUNDLE_SECTION_REGS      = 1,    /**< uint32_t {addr, data} pairs, same layout as struct vvcam_sccb_data */
+    SENSOR_BUNDLE_SECTION_3A_CONFIG = 2,    /**< 3aconfig json text, NUL terminated */
+    SENSOR_BUNDLE_SECTION_CALIB     = 3,    /**< calibration xml text, NUL terminated */
+    SENSOR_BUNDLE_SECTION_AWB_GRID  = 4,    /**< AWB illuminant grid compiled from the xml, see sensor_awb_grid.h */
+    SENSOR_BUNDLE_SECTION_3A_PROFILE = 5,   /**< named alternative 3aconfig, may repeat, see sensor_profile.h */
+    SENSOR_BUNDLE_SECTION_GAIN_CURVE = 6,   /**< measured gain curve from next to the xml, see sensor_gain_lut.h */
+    SENSOR_BUNDLE_SECTION_MAX
+} SensorBundleSectionType_t;
+
+/**
+ * @brief On-disk bundle header, followed by sectionCount SensorBundleSection_t.
+ */
+typedef struct SensorBundleHeader_s
+{
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    sectionCount;
+    uint32_t    modeIndex;
+    uint32_t    totalSize;          /**< size of the whole file in bytes */
+    uint64_t    contentHash;        /**< FNV-1a 64 over all section payloads, in index order */
+    char        sensorName[16];
+} SensorBundleHeader_t;
+
+/**
+ * @brief On-disk section index entry.
+ */
+typedef struct SensorBundleSection_s
+{
+    uint32_t    type;               /**< SensorBundleSectionType_t */
+    uint32_t    offset;             /**< from start of file, SENSOR_BUNDLE_ALIGN aligned */
+    uint32_t    size;               /**< payload size in bytes */
+    uint32_t    reserved;
+    uint64_t    hash;               /**< FNV-1a 64 of the payload */
+} SensorBundleSection_t;
+
+/**
+ * @brief An opened (mapped) bundle.
+ */
+typedef struct SensorBundle_s
+{
+    int                             fd;
+    const uint8_t                   *pBase;
+    size_t                          size;
+    const SensorBundleHeader_t      *pHeader;
+    const SensorBundleSection_t     *pSections;
+} SensorBundle_t;
+
+#define SENSOR_BUNDLE_FNV_SEED      0xcbf29ce484222325ULL
+
+/**
+ * @brief FNV-1a 64 bit hash, chainable through seed.
+ */
+uint64_t SensorBundleHash(const void *pData, size_t size, uint64_t seed);
+
+/**
+ * @brief Build the bundle path for a mode and open it.
+ *
+ * @param   pSensorName     sensor name, e.g. "GC5035"
+ * @param   modeIndex       vvcam_mode_info.index
+ * @param   pBundle         bundle to fill in, zeroed on failure
+ *
+ * @return  RET_SUCCESS, RET_NOTAVAILABLE if no bundle is installed for the
+ *          mode, RET_FAILURE if the file is malformed
+ */
+RESULT SensorBundleOpen(const char *pSensorName, uint32_t modeIndex, SensorBundle_t *pBundle);
+
+RESULT SensorBundleOpenFile(const char *pFileName, SensorBundle_t *pBundle);
+
+RESULT SensorBundleClose(SensorBundle_t *pBundle);
+
+bool_t SensorBundleIsOpen(const SensorBundle_t *pBundle);
+
+/**
+ * @brief Recompute all section hashes and the content hash.
+ */
+RESULT SensorBundleVerify(const SensorBundle_t *pBundle);
+
+/**
+ * @brief Look up a section, the returned pointer is valid until close.
+ *
+ * @return  RET_SUCCESS or RET_NOTAVAILABLE if the bundle has no such section
+ */
+RESULT SensorBundleGetSection(const SensorBundle_t *pBundle, uint32_t type,
+                              const void **ppData, uint32_t *pSize);
+
+/**
+ * @brief Look up the nth section of a type that may repeat.
+ */
+RESULT SensorBundleGetSectionAt(const SensorBundle_t *pBundle, uint32_t type, uint32_t nth,
+                                const void **ppData, uint32_t *pSize);
+
+/**
+ * @brief Describe the register section as a vvcam_sccb_array, ready for
+ *        VVSENSORIOC_WRITE_ARRAY. The array points into the mapping, nothing
+ *        is copied and nothing needs to be freed.
+ */
+RESULT SensorBundleGetRegArray(const SensorBundle_t *pBundle, struct vvcam_sccb_array *arry);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_bundle */
+
+#endif    /* __SENSOR_BUNDLE_H__ */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <math.h>
+#include <ebase/types.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_dol.h"
+
+/* within half a line of the requested short exposure */
+#define DOL_RATIO_TOLERANCE     0.5f
+
+static uint32_t DolClamp(const SensorDolWindow_t *pWindow, uint32_t lines)
+{
+    return MIN(MAX(lines, pWindow->minLines), pWindow->maxLines);
+}
+
+RESULT SensorDolSolve(const SensorDolLayout_t *pLayout, uint32_t longLines, const float *pRatio,
+                      SensorDolSolution_t *pSolution)
+{
+    float ratio[SENSOR_DOL_MAX_FRAMES];
+    float lo, hi, product = 1.0f;
+    uint32_t count, i;
+
+    if (pLayout == NULL || pSolution == NULL || (pRatio == NULL && pLayout->count > 1)) {
+        return (RET_NULL_POINTER);
+    }
+
+    count = pLayout->count;
+    if (count == 0 || count > SENSOR_DOL_MAX_FRAMES) {
+        return (RET_OUTOFRANGE);
+    }
+
+    /* range of long exposures for which every short one fits at the requested ratios */
+    lo = (float)pLayout->window[0].minLines;
+    hi = (float)pLayout->window[0].maxLines;
+    for (i = 1; i < count; i++) {
+        ratio[i] = MAX(pRatio[i - 1], 1.0f);
+        product *= ratio[i];
+        lo = MAX(lo, (float)pLayout->window[i].minLines * product);
+        hi = MIN(hi, (float)pLayout->window[i].maxLines * product);
+    }
+
+    pSolution->lines[0] = DolClamp(&pLayout->window[0], longLines);
+    if (lo <= hi) {
+        pSolution->lines[0] = (uint32_t)MIN(MAX((float)pSolution->lines[0], ceilf(lo)), floorf(hi));
+    }
+
+    pSolution->exact = BOOL_TRUE;
+    for (i = 1; i < count; i++) {
+        float want = (float)pSolution->lines[i - 1] / ratio[i];
+
+        pSolution->lines[i] = DolClamp(&pLayout->window[i], (uint32_t)(want + 0.5f));
+        if (fabsf((float)pSolution->lines[i] - want) > DOL_RATIO_TOLERANCE) {
+            pSolution->exact = BOOL_FALSE;
+        }
+        pSolution->ratio[i - 1] = (float)pSolution->lines[i - 1] / (float)MAX(pSolution->lines[i], 1U);
+    }
+    for (; i < SENSOR_DOL_MAX_FRAMES; i++) {
+        pSolution->lines[i]     = 0;
+        pSolution->ratio[i - 1] = 1.0f;
+    }
+
+    return (RET_SUCCESS);
+}
+
+float SensorDolRatioForRange(float rangeDb, uint32_t count)
+{
+    if (count < 2 || !(rangeDb > 0.0f)) {
+        return 1.0f;
+    }
+
+    return powf(10.0f, rangeDb / 20.0f / (float)(count - 1));
+}
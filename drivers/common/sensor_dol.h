@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_dol.h
+ *
+ * @brief Exposure ratio solver for DOL (digital overlap) HDR.
+ *
+ * A DOL sensor reads the long and the short exposures out of one frame set
+ * at fixed offsets (RHS), so each exposure has to fit the window between
+ * the previous readout, plus the sensor's minimum gap, and its own readout.
+ * A driver describes these windows once per mode in a SensorDolLayout_t.
+ *
+ * SensorDolSolve() turns a long exposure and the ratios between successive
+ * exposures into line counts that fit the windows. When the ratio can be
+ * kept by moving the long exposure inside its window, it is; the driver
+ * makes up the lost or added integration with gain, and narrows the long
+ * window to what its gain range can make up for. Otherwise the long
+ * exposure stays and the short ones are clamped. Either way the ratios
+ * actually achieved are returned, so the ISP stitches with the real ones
+ * instead of the requested ones.
+ *
+ * The solver is a few multiplications per exposure and runs every frame.
+ *
+ * SensorDolStreamLayout_t tells the receiver how the exposures arrive on
+ * the MIPI link: the virtual channel and data type of each, how far its
+ * readout trails the long one and how many embedded data lines precede
+ * it. With one virtual channel per exposure the receiver can write each
+ * into its own buffer by DMA, without a CPU pass separating the lines.
+ *
+ * @defgroup sensor_dol
+ * @{
+ *
+ */
+#ifndef __SENSOR_DOL_H__
+#define __SENSOR_DOL_H__
+
+#include <ebase/types.h>
+#include <common/return_codes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_DOL_MAX_FRAMES   3       /**< long and up to two short exposures */
+
+typedef struct SensorDolWindow_s
+{
+    uint32_t    minLines;
+    uint32_t    maxLines;               /**< from the earliest shutter to the readout */
+} SensorDolWindow_t;
+
+typedef struct SensorDolLayout_s
+{
+    uint32_t            count;          /**< exposures per frame set, 0 in linear modes */
+    SensorDolWindow_t   window[SENSOR_DOL_MAX_FRAMES];  /**< longest first */
+} SensorDolLayout_t;
+
+typedef struct SensorDolSolution_s
+{
+    uint32_t    lines[SENSOR_DOL_MAX_FRAMES];
+    float       ratio[SENSOR_DOL_MAX_FRAMES - 1];   /**< lines[i] / lines[i + 1] achieved */
+    bool_t      exact;                  /**< the requested ratios are met up to line rounding */
+} SensorDolSolution_t;
+
+typedef enum SensorDolDemux_e
+{
+    SENSOR_DOL_DEMUX_VC         = 0,    /**< one virtual channel per exposure */
+    SENSOR_DOL_DEMUX_LINE_INFO  = 1,    /**< one channel, each line tagged with its exposure */
+} SensorDolDemux_t;
+
+typedef struct SensorDolStream_s
+{
+    uint8_t     vc;                     /**< MIPI virtual channel */
+    uint8_t     dt;                     /**< MIPI data type, e.g. 0x2c RAW12 */
+    uint16_t    embeddedLines;          /**< embedded data lines ahead of the image lines */
+    uint32_t    lineOffset;             /**< readout start after the long exposure's, in sensor lines */
+} SensorDolStream_t;
+
+typedef struct SensorDolStreamLayout_s
+{
+    uint32_t            count;          /**< exposures per frame set, 0 in linear modes */
+    SensorDolDemux_t    demux;
+    uint32_t            width;          /**< image size of each exposure */
+    uint32_t            height;
+    SensorDolStream_t   exposure[SENSOR_DOL_MAX_FRAMES];    /**< longest first */
+} SensorDolStreamLayout_t;
+
+/**
+ * @brief MIPI CSI-2 data type of raw Bayer data, 0 for an unsupported width.
+ */
+static inline uint8_t SensorDolRawDataType(uint32_t bitWidth)
+{
+    switch (bitWidth) {
+        case 8:
+            return 0x2a;
+        case 10:
+            return 0x2b;
+        case 12:
+            return 0x2c;
+        case 14:
+            return 0x2d;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Fit the exposures of one frame set into the layout.
+ *
+ * @param   longLines       requested long exposure
+ * @param   pRatio          count - 1 requested ratios, long / short first,
+ *                          values below 1 count as 1
+ */
+RESULT SensorDolSolve(const SensorDolLayout_t *pLayout, uint32_t longLines, const float *pRatio,
+                      SensorDolSolution_t *pSolution);
+
+/**
+ * @brief Ratio between successive exposures that extends the dynamic range
+ *        of a single exposure by rangeDb, split evenly over count exposures.
+ */
+float SensorDolRatioForRange(float rangeDb, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_dol */
+
+#endif    /* __SENSOR_DOL_H__ */
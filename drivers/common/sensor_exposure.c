@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <ebase/types.h>
+#include <ebase/builtins.h>
+#include <string.h>
+#include "sensor_exposure.h"
+
+void SensorExposureTimingSet(SensorExposureTiming_t *pTiming, uint32_t lineTimePs,
+                             uint32_t minLines, uint32_t maxLines)
+{
+    pTiming->lineTimePs = lineTimePs;
+    pTiming->minLines   = minLines;
+    pTiming->maxLines   = MAX(maxLines, minLines);
+    pTiming->fineSteps  = 1;
+}
+
+void SensorExposureTimingSetFine(SensorExposureTiming_t *pTiming, uint32_t lineTimePs, uint32_t fineSteps,
+                                 uint32_t minLines, uint32_t maxLines)
+{
+    fineSteps = MAX(fineSteps, 1U);
+
+    SensorExposureTimingSet(pTiming, (lineTimePs + fineSteps / 2) / fineSteps,
+                            minLines * fineSteps, maxLines * fineSteps);
+    pTiming->fineSteps = fineSteps;
+}
+
+RESULT SensorAntiFlickerSet(SensorAntiFlicker_t *pFlicker, SensorAntiFlickerMode_t mode, uint32_t detectedHz)
+{
+    uint32_t hz;
+
+    if (pFlicker == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    switch (mode) {
+        case SENSOR_ANTI_FLICKER_OFF:
+            hz = 0;
+            break;
+        case SENSOR_ANTI_FLICKER_50HZ:
+            hz = 50;
+            break;
+        case SENSOR_ANTI_FLICKER_60HZ:
+            hz = 60;
+            break;
+        case SENSOR_ANTI_FLICKER_AUTO:
+            if (detectedHz != 0 && detectedHz != 50 && detectedHz != 60) {
+                return (RET_OUTOFRANGE);
+            }
+            hz = detectedHz;
+            break;
+        default:
+            return (RET_INVALID_PARM);
+    }
+
+    pFlicker->mode       = mode;
+    pFlicker->detectedHz = (mode == SENSOR_ANTI_FLICKER_AUTO) ? detectedHz : 0;
+    pFlicker->bandNs     = (hz != 0) ? (uint32_t)(SENSOR_EXPOSURE_NS_PER_S / (2 * hz)) : 0;
+
+    return (RET_SUCCESS);
+}
+
+void SensorExposureStatePublish(SensorExposureState_t *pCache, SensorExposureState_t *pState)
+{
+    const size_t offset = sizeof(pState->version);
+
+    if (pCache->version == 0 ||
+        memcmp((const uint8_t *)pCache + offset, (const uint8_t *)pState + offset,
+               sizeof(SensorExposureState_t) - offset) != 0) {
+        pState->version = pCache->version + 1;
+        MEMCPY(pCache, pState, sizeof(SensorExposureState_t));
+    } else {
+        pState->version = pCache->version;
+    }
+}
+
+RESULT SensorExposureSolve(const SensorExposureTiming_t *pTiming, const SensorGainLut_t *pLut,
+                           uint32_t lineStep, uint32_t bandNs, float exposure, SensorExposureSplit_t *pSplit)
+{
+    const SensorGainCode_t *pCode, *pNext, *pLast;
+    uint32_t fineSteps, step, lo, hi;
+    uint64_t ns, lines;
+    float target;
+
+    if (pTiming == NULL || pLut == NULL || pSplit == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    MEMSET(pSplit, 0, sizeof(SensorExposureSplit_t));
+    /* no timing before Init, none at all while a kernel driver owns the sensor */
+    if (pTiming->lineTimePs == 0 || pLut->pTable == NULL) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    pLast     = &pLut->pTable[pLut->maxGain - pLut->minGain];
+    fineSteps = MAX(pTiming->fineSteps, 1U);
+    /* a coarse shutter step leaves nothing for the fine register to refine */
+    step      = (lineStep > 1) ? lineStep * fineSteps : 1;
+    lo        = (pTiming->minLines + step - 1) / step * step;
+    hi        = MAX(pTiming->maxLines / step * step, lo);
+
+    /* longest integration that still needs at least the minimum gain */
+    ns = SensorExposureSecondsToNs(exposure * SENSOR_GAIN_LUT_ONE / pLut->minGain);
+    if (bandNs != 0 && MIN(ns, SensorExposureLinesToNs(pTiming, hi)) >= bandNs) {
+        /* whole flicker bands, on the line count closest to them */
+        ns = MIN(ns, SensorExposureLinesToNs(pTiming, hi)) / bandNs * bandNs;
+        lines = (ns * SENSOR_EXPOSURE_PS_PER_NS + pTiming->lineTimePs / 2) / pTiming->lineTimePs;
+        lines = (lines + step / 2) / step * step;
+    } else {
+        lines = ns * SENSOR_EXPOSURE_PS_PER_NS / pTiming->lineTimePs;
+        lines = lines / step * step;
+    }
+    lines = MAX(MIN(lines, hi), lo);
+
+    pSplit->lines           = (uint32_t)lines / fineSteps;
+    pSplit->fine            = (uint32_t)lines % fineSteps;
+    pSplit->integrationTime = SensorExposureLinesToTime(pTiming, (uint32_t)lines);
+
+    /* the table truncates, the next distinct code may be closer */
+    target = exposure / pSplit->integrationTime * SENSOR_GAIN_LUT_ONE;
+    pCode = SensorGainLutLookup(pLut, target / SENSOR_GAIN_LUT_ONE);
+    for (pNext = pCode; pNext < pLast && pNext->gain == pCode->gain; pNext++) {
+        ;
+    }
+    if ((float)pNext->gain - target < target - (float)pCode->gain) {
+        pCode = pNext;
+    }
+
+    pSplit->code     = *pCode;
+    pSplit->gain     = (float)pCode->gain / SENSOR_GAIN_LUT_ONE;
+    pSplit->residual = (exposure > 0.0f) ?
+                       (pSplit->integrationTime * pSplit->gain - exposure) / exposure : 0.0f;
+
+    return (RET_SUCCESS);
+}
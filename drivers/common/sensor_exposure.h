@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_exposure.h
+ *
+ * @brief Exposure state snapshot shared by all sensor drivers.
+ *
+ * The AE loop needs the gain and integration time limits, their increments,
+ * the values in force and the frame timing every frame. Instead of a dozen
+ * Isi getters (each with its own trace and, for fps, an ioctl), a driver
+ * fills one SensorExposureState_t from its context. The snapshot carries a
+ * version that only moves when some value changed, so a caller can compare
+ * it against the last one it saw and skip re-evaluating its limits.
+ *
+ * The exposure engine below converts between integration time and lines
+ * in integers: times in nanoseconds, the line period in picoseconds (some
+ * sensors count in fractions of a line). Both directions round to nearest,
+ * so a time reported for n lines converts back to exactly n lines and a
+ * driver that always reports the applied time never toggles between two
+ * neighbouring line counts.
+ *
+ * A sensor with a fine integration register sets its timing with
+ * SensorExposureTimingSetFine(): the engine then counts in fine steps, so
+ * the integration time increment a driver derives from one step is the
+ * real one, and short exposures in bright light move in sub-line steps
+ * instead of 1/n jumps. The solver hands back whole lines and the fine
+ * steps on top of them.
+ *
+ * SensorExposureSolve() splits a total exposure (time x gain) into lines
+ * and gain codes in one go: it takes the longest integration the sensor's
+ * line step allows without going below the minimum gain, then picks the
+ * gain table entry closest to what is left, so the shutter quantization is
+ * absorbed by the gain instead of being patched afterwards.
+ *
+ * With anti-flicker on, integration time is snapped down to whole mains
+ * half periods (10 ms at 50 Hz, 8.33 ms at 60 Hz) as soon as at least one
+ * fits, the gain making up the difference. Every frame then integrates the
+ * same number of light pulses and AE no longer hunts across flicker bands.
+ *
+ * @defgroup sensor_exposure
+ * @{
+ *
+ */
+#ifndef __SENSOR_EXPOSURE_H__
+#define __SENSOR_EXPOSURE_H__
+
+#include <ebase/types.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_gain_lut.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct SensorExposureState_s
+{
+    uint32_t    version;                    /**< starts at 1, bumped whenever any other member changes */
+
+    float       minGain;
+    float       maxGain;
+    float       gainIncrement;
+    float       minIntegrationTime;
+    float       maxIntegrationTime;
+    float       integrationTimeIncrement;
+
+    float       curGain;
+    float       curIntegrationTime;
+    float       curHdrRatio;
+
+    uint32_t    curFps;                     /**< cached in the driver, no sensor access */
+    uint32_t    minFps;
+    uint32_t    maxFps;
+    uint16_t    frameLengthLines;           /**< frame length of the mode */
+    uint16_t    curFrameLengthLines;        /**< frame length in force */
+    uint16_t    minIntegrationLine;
+    uint16_t    maxIntegrationLine;
+} SensorExposureState_t;
+
+#define SENSOR_EXPOSURE_PS_PER_NS   1000ULL
+#define SENSOR_EXPOSURE_NS_PER_S    1000000000ULL
+
+/**
+ * @brief Integration line timing of the mode in force.
+ */
+typedef struct SensorExposureTiming_s
+{
+    uint32_t    lineTimePs;                 /**< one integration step in picoseconds, 0 while unknown */
+    uint32_t    minLines;                   /**< in integration steps */
+    uint32_t    maxLines;                   /**< in integration steps */
+    uint32_t    fineSteps;                  /**< integration steps per line, 1 if the shutter counts whole lines */
+} SensorExposureTiming_t;
+
+void SensorExposureTimingSet(SensorExposureTiming_t *pTiming, uint32_t lineTimePs,
+                             uint32_t minLines, uint32_t maxLines);
+
+/**
+ * @brief Timing for a shutter with a fine integration register.
+ *
+ * @param   lineTimePs      line period
+ * @param   fineSteps       fine integration steps per line
+ * @param   minLines        limits in whole lines
+ */
+void SensorExposureTimingSetFine(SensorExposureTiming_t *pTiming, uint32_t lineTimePs, uint32_t fineSteps,
+                                 uint32_t minLines, uint32_t maxLines);
+
+/**
+ * @brief Seconds (as used by the Isi interface) to nanoseconds, rounded to
+ *        nearest, negative times give 0.
+ */
+static inline uint32_t SensorExposureSecondsToNs(float seconds)
+{
+    double ns = (double)seconds * SENSOR_EXPOSURE_NS_PER_S + 0.5;
+
+    if (!(ns > 0.0)) {
+        return 0;
+    }
+    if (ns >= 4294967295.0) {
+        return 0xffffffffU;
+    }
+
+    return (uint32_t)ns;
+}
+
+static inline float SensorExposureNsToSeconds(uint32_t ns)
+{
+    return (float)((double)ns / SENSOR_EXPOSURE_NS_PER_S);
+}
+
+/**
+ * @brief Nanoseconds to lines, rounded to nearest and clamped to the limits.
+ */
+static inline uint32_t SensorExposureNsToLines(const SensorExposureTiming_t *pTiming, uint32_t ns)
+{
+    uint64_t lines;
+
+    if (pTiming->lineTimePs == 0) {
+        return pTiming->minLines;   /* timing not known yet */
+    }
+
+    lines = ((uint64_t)ns * SENSOR_EXPOSURE_PS_PER_NS + pTiming->lineTimePs / 2) / pTiming->lineTimePs;
+
+    return (uint32_t)MIN(MAX(lines, (uint64_t)pTiming->minLines), (uint64_t)pTiming->maxLines);
+}
+
+/**
+ * @brief Lines to nanoseconds, rounded to nearest.
+ */
+static inline uint32_t SensorExposureLinesToNs(const SensorExposureTiming_t *pTiming, uint32_t lines)
+{
+    return (uint32_t)(((uint64_t)lines * pTiming->lineTimePs + SENSOR_EXPOSURE_PS_PER_NS / 2) / SENSOR_EXPOSURE_PS_PER_NS);
+}
+
+static inline uint32_t SensorExposureTimeToLines(const SensorExposureTiming_t *pTiming, float seconds)
+{
+    return SensorExposureNsToLines(pTiming, SensorExposureSecondsToNs(seconds));
+}
+
+static inline float SensorExposureLinesToTime(const SensorExposureTiming_t *pTiming, uint32_t lines)
+{
+    return SensorExposureNsToSeconds(SensorExposureLinesToNs(pTiming, lines));
+}
+
+/**
+ * @brief Publish a freshly filled state.
+ *
+ * Compares pState (version ignored) against the cached copy, bumps the
+ * cached version if anything differs, then copies the cache, version
+ * included, back into pState.
+ */
+void SensorExposureStatePublish(SensorExposureState_t *pCache, SensorExposureState_t *pState);
+
+typedef enum SensorAntiFlickerMode_e
+{
+    SENSOR_ANTI_FLICKER_OFF     = 0,
+    SENSOR_ANTI_FLICKER_50HZ    = 1,
+    SENSOR_ANTI_FLICKER_60HZ    = 2,
+    SENSOR_ANTI_FLICKER_AUTO    = 3,    /**< follows the mains frequency found by flicker detection */
+} SensorAntiFlickerMode_t;
+
+typedef struct SensorAntiFlicker_s
+{
+    SensorAntiFlickerMode_t mode;
+    uint32_t                detectedHz;     /**< AUTO only, 0 until detection reports 50 or 60 */
+    uint32_t                bandNs;         /**< mains half period in force, 0 if none */
+} SensorAntiFlicker_t;
+
+/**
+ * @brief Select the anti-flicker mode.
+ *
+ * @param   detectedHz      mains frequency for SENSOR_ANTI_FLICKER_AUTO,
+ *                          50, 60 or 0 if not known (no snapping)
+ */
+RESULT SensorAntiFlickerSet(SensorAntiFlicker_t *pFlicker, SensorAntiFlickerMode_t mode, uint32_t detectedHz);
+
+/**
+ * @brief Snap an integration time down to whole bands, times shorter than
+ *        one band are returned unchanged.
+ */
+static inline float SensorAntiFlickerSnapTime(const SensorAntiFlicker_t *pFlicker, float seconds)
+{
+    uint32_t ns = SensorExposureSecondsToNs(seconds);
+
+    if (pFlicker->bandNs == 0 || ns < pFlicker->bandNs) {
+        return seconds;
+    }
+
+    return SensorExposureNsToSeconds(ns / pFlicker->bandNs * pFlicker->bandNs);
+}
+
+/**
+ * @brief Snap *pTime and scale *pGain to keep the exposure, for drivers
+ *        that set integration and gain separately.
+ */
+static inline void SensorAntiFlickerApply(const SensorAntiFlicker_t *pFlicker, float *pGain, float *pTime)
+{
+    float time = SensorAntiFlickerSnapTime(pFlicker, *pTime);
+
+    if (time < *pTime) {
+        *pGain = *pGain * *pTime / time;
+        *pTime = time;
+    }
+}
+
+/**
+ * @brief Integration and gain realizing a total exposure.
+ */
+typedef struct SensorExposureSplit_s
+{
+    uint32_t            lines;              /**< whole lines */
+    uint32_t            fine;               /**< fine steps on top of lines, always 0 if fineSteps is 1 */
+    SensorGainCode_t    code;
+    float               integrationTime;    /**< seconds, of lines and fine */
+    float               gain;               /**< of code */
+    float               residual;           /**< (applied - requested) / requested exposure */
+} SensorExposureSplit_t;
+
+/**
+ * @brief Split exposure (integration time in seconds x gain) into lines
+ *        and gain codes.
+ *
+ * @param   lineStep        lines the shutter register moves in, 1 for most
+ *                          sensors; lines is always a multiple of it and
+ *                          fine steps are not used then
+ * @param   bandNs          SensorAntiFlicker_t.bandNs, 0 for no snapping
+ *
+ * The residual stays within half a gain code unless the request is outside
+ * [minLines x minGain, maxLines x maxGain].
+ *
+ * @return  RET_SUCCESS, RET_NOTAVAILABLE with an empty split while the
+ *          timing is not set (lineTimePs 0)
+ */
+RESULT SensorExposureSolve(const SensorExposureTiming_t *pTiming, const SensorGainLut_t *pLut,
+                           uint32_t lineStep, uint32_t bandNs, float exposure, SensorExposureSplit_t *pSplit);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_exposure */
+
+#endif    /* __SENSOR_EXPOSURE_H__ */
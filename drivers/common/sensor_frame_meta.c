@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <ebase/types.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_frame_meta.h"
+
+#define FRAME_META_SLOT(n)      ((n) & (SENSOR_FRAME_META_DEPTH - 1))
+
+void SensorFrameMetaRecord(SensorFrameMetaRing_t *pRing, const SensorFrameMeta_t *pMeta)
+{
+    uint32_t count = __atomic_load_n(&pRing->count, __ATOMIC_RELAXED);
+
+    MEMCPY(&pRing->entry[FRAME_META_SLOT(count)], pMeta, sizeof(SensorFrameMeta_t));
+    __atomic_store_n(&pRing->count, count + 1, __ATOMIC_RELEASE);
+}
+
+RESULT SensorFrameMetaLookup(const SensorFrameMetaRing_t *pRing, uint32_t frame, SensorFrameMeta_t *pMeta)
+{
+    uint32_t count, oldest;
+
+    if (pRing == NULL || pMeta == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    count = __atomic_load_n(&pRing->count, __ATOMIC_ACQUIRE);
+    /* the slot after the newest is the next one to be overwritten, skip it */
+    oldest = (count >= SENSOR_FRAME_META_DEPTH) ? count - SENSOR_FRAME_META_DEPTH + 1 : 0;
+
+    for (uint32_t n = count; n-- > oldest; ) {
+        MEMCPY(pMeta, &pRing->entry[FRAME_META_SLOT(n)], sizeof(SensorFrameMeta_t));
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&pRing->count, __ATOMIC_RELAXED) - n >= SENSOR_FRAME_META_DEPTH) {
+            return (RET_BUSY);
+        }
+
+        if ((int32_t)(frame - pMeta->frame) >= 0) {
+            return (RET_SUCCESS);
+        }
+    }
+
+    return (RET_NOTAVAILABLE);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_frame_meta.h
+ *
+ * @brief Exposure parameters actually in force, per frame.
+ *
+ * Every committed exposure is recorded with the frame it takes effect on
+ * (see sensor_latency.h) in a small per-handle ring. The ISP or 3A can then
+ * ask which parameters exposed frame N, rather than taking the last
+ * requested ones, which under fast AE belong to a later frame.
+ *
+ * One thread records, any thread may look up. A lookup that raced with the
+ * writer lapping the ring fails rather than return a torn record.
+ *
+ * @defgroup sensor_frame_meta
+ * @{
+ *
+ */
+#ifndef __SENSOR_FRAME_META_H__
+#define __SENSOR_FRAME_META_H__
+
+#include <ebase/types.h>
+#include <common/return_codes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_FRAME_META_DEPTH     16      /**< power of 2 */
+
+typedef struct SensorFrameMeta_s
+{
+    uint32_t    frame;              /**< first frame the values are in force on */
+    uint32_t    lines;              /**< integration in lines */
+    uint16_t    again;              /**< analog gain code, 0 if the driver has none */
+    uint16_t    dgain;              /**< digital gain code, 0 if the driver has none */
+    uint32_t    vts;                /**< frame length in lines */
+    float       gain;               /**< effective total gain */
+    float       integrationTime;    /**< seconds */
+    float       hdrRatio;
+} SensorFrameMeta_t;
+
+typedef struct SensorFrameMetaRing_s
+{
+    SensorFrameMeta_t   entry[SENSOR_FRAME_META_DEPTH];
+    uint32_t            count;      /**< records written so far, read and written atomically */
+} SensorFrameMetaRing_t;
+
+/**
+ * @brief Append a record, the oldest one is dropped when the ring is full.
+ */
+void SensorFrameMetaRecord(SensorFrameMetaRing_t *pRing, const SensorFrameMeta_t *pMeta);
+
+/**
+ * @brief Copy the record in force on a frame, i.e. the newest one whose
+ *        frame is not after it.
+ *
+ * @return  RET_SUCCESS, RET_NOTAVAILABLE if the frame is older than the
+ *          ring or nothing was recorded yet, RET_BUSY if the writer
+ *          overtook the lookup
+ */
+RESULT SensorFrameMetaLookup(const SensorFrameMetaRing_t *pRing, uint32_t frame, SensorFrameMeta_t *pMeta);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_frame_meta */
+
+#endif    /* __SENSOR_FRAME_META_H__ */
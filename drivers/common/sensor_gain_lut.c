@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <stdlib.h>
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_gain_lut.h"
+
+CREATE_TRACER( SENSOR_GAIN_LUT_INFO , "SENSOR_GAIN_LUT: ", INFO,    0);
+CREATE_TRACER( SENSOR_GAIN_LUT_ERROR, "SENSOR_GAIN_LUT: ", ERROR,   1);
+
+RESULT SensorGainLutInit(SensorGainLut_t *pLut, uint32_t minGain, uint32_t maxGain,
+                         SensorGainQuantizeFunc_t pQuantize)
+{
+    uint32_t count;
+
+    if (pLut == NULL || pQuantize == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (minGain == 0 || maxGain < minGain) {
+        return (RET_INVALID_PARM);
+    }
+
+    count = maxGain - minGain + 1;
+    pLut->pTable = (SensorGainCode_t *)malloc(count * sizeof(SensorGainCode_t));
+    if (pLut->pTable == NULL) {
+        TRACE(SENSOR_GAIN_LUT_ERROR, "%s: can't allocate %u entries\n", __func__, count);
+        return (RET_OUTOFMEM);
+    }
+
+    pLut->minGain = minGain;
+    pLut->maxGain = maxGain;
+    for (uint32_t i = 0; i < count; i++) {
+        pQuantize(minGain + i, &pLut->pTable[i]);
+    }
+
+    TRACE(SENSOR_GAIN_LUT_INFO, "%s: %u entries, gain %u..%u/256\n", __func__, count, minGain, maxGain);
+    return (RET_SUCCESS);
+}
+
+void SensorGainLutRelease(SensorGainLut_t *pLut)
+{
+    if (pLut == NULL) {
+        return;
+    }
+
+    free(pLut->pTable);
+    MEMSET(pLut, 0, sizeof(SensorGainLut_t));
+}
+
+/* measured gain of a nominal one, between points linear, outside the ratio at the end holds */
+static uint32_t SensorGainCurveMap(const SensorGainCurvePoint_t *pPoint, uint32_t count, uint32_t gain)
+{
+    uint32_t i;
+
+    if (gain <= pPoint[0].requested) {
+        return (uint32_t)((uint64_t)gain * pPoint[0].actual / pPoint[0].requested);
+    }
+
+    for (i = 1; i < count && pPoint[i].requested < gain; i++) {
+        ;
+    }
+
+    if (i == count) {
+        return (uint32_t)((uint64_t)gain * pPoint[count - 1].actual / pPoint[count - 1].requested);
+    }
+
+    return pPoint[i - 1].actual +
+           (uint32_t)((uint64_t)(pPoint[i].actual - pPoint[i - 1].actual) * (gain - pPoint[i - 1].requested) /
+                      (pPoint[i].requested - pPoint[i - 1].requested));
+}
+
+RESULT SensorGainLutCalibrate(SensorGainLut_t *pLut, const SensorBundle_t *pBundle)
+{
+    const SensorGainCurveHeader_t *pHeader;
+    const SensorGainCurvePoint_t *pPoint;
+    SensorGainCode_t *pNominal;
+    const void *pData = NULL;
+    uint32_t size = 0, count, next;
+    RESULT result;
+
+    if (pLut == NULL || pLut->pTable == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    result = SensorBundleGetSection(pBundle, SENSOR_BUNDLE_SECTION_GAIN_CURVE, &pData, &size);
+    if (result != RET_SUCCESS) {
+        return (result);
+    }
+
+    pHeader = (const SensorGainCurveHeader_t *)pData;
+    pPoint  = (const SensorGainCurvePoint_t *)(pHeader + 1);
+    if (size < sizeof(SensorGainCurveHeader_t) || pHeader->magic != SENSOR_GAIN_CURVE_MAGIC ||
+        pHeader->count < 2 || pHeader->count > SENSOR_GAIN_CURVE_MAX_POINTS ||
+        size - sizeof(SensorGainCurveHeader_t) < pHeader->count * sizeof(SensorGainCurvePoint_t) ||
+        pPoint[0].requested == 0 || pPoint[0].actual == 0) {
+        TRACE(SENSOR_GAIN_LUT_ERROR, "%s: malformed gain curve\n", __func__);
+        return (RET_FAILURE);
+    }
+
+    for (uint32_t i = 1; i < pHeader->count; i++) {
+        if (pPoint[i].requested <= pPoint[i - 1].requested || pPoint[i].actual < pPoint[i - 1].actual) {
+            TRACE(SENSOR_GAIN_LUT_ERROR, "%s: gain curve not rising at point %u\n", __func__, i);
+            return (RET_FAILURE);
+        }
+    }
+
+    count = pLut->maxGain - pLut->minGain + 1;
+    pNominal = (SensorGainCode_t *)malloc(count * sizeof(SensorGainCode_t));
+    if (pNominal == NULL) {
+        return (RET_OUTOFMEM);
+    }
+    MEMCPY(pNominal, pLut->pTable, count * sizeof(SensorGainCode_t));
+
+    /* nominal gains rise with the index, so do the measured ones */
+    next = (count > 1) ? SensorGainCurveMap(pPoint, pHeader->count, pNominal[1].gain) : 0;
+    for (uint32_t i = 0, j = 0; i < count; i++) {
+        while (j + 1 < count && next <= pLut->minGain + i) {
+            j++;
+            next = (j + 1 < count) ? SensorGainCurveMap(pPoint, pHeader->count, pNominal[j + 1].gain) : 0;
+        }
+
+        pLut->pTable[i]      = pNominal[j];
+        pLut->pTable[i].gain = SensorGainCurveMap(pPoint, pHeader->count, pNominal[j].gain);
+    }
+
+    free(pNominal);
+    TRACE(SENSOR_GAIN_LUT_INFO, "%s: %u point gain curve applied\n", __func__, pHeader->count);
+    return (RET_SUCCESS);
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_gain_lut.h
+ *
+ * @brief Gain to register code lookup table.
+ *
+ * Turning an AE gain into sensor register codes means a table scan or a
+ * float division per frame. Instead each driver runs its own conversion
+ * (its quantize function) once per gain step of 1/256 when the sensor is
+ * created, and SetGain does a single indexed load. Every entry also holds
+ * the gain the codes really produce, so the driver can report it back.
+ *
+ * The quantize functions assume the nominal, linear gain of the register
+ * codes. When the mode bundle carries a gain curve measured on the module
+ * (tools/gain_sweep.py), SensorGainLutCalibrate() remaps the table through
+ * it: every gain step then gets the codes that measured closest at or below
+ * it, which mostly means a different digital code, and the gain recorded is
+ * the measured one. AE no longer overshoots where an analog step is off.
+ *
+ * @defgroup sensor_gain_lut
+ * @{
+ *
+ */
+#ifndef __SENSOR_GAIN_LUT_H__
+#define __SENSOR_GAIN_LUT_H__
+
+#include <ebase/types.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_bundle.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_GAIN_LUT_SHIFT       8
+#define SENSOR_GAIN_LUT_ONE         (1U << SENSOR_GAIN_LUT_SHIFT)   /**< 1x gain in lut units */
+
+/**
+ * @brief One table entry, 8 bytes.
+ */
+typedef struct SensorGainCode_s
+{
+    uint16_t    again;              /**< analog gain register code */
+    uint16_t    dgain;              /**< digital gain register code, sensor specific fixed point */
+    uint32_t    gain;               /**< total gain applied by the codes, in 1/256 */
+} SensorGainCode_t;
+
+/**
+ * @brief Driver specific conversion, gain in 1/256.
+ */
+typedef void (*SensorGainQuantizeFunc_t)(uint32_t gain, SensorGainCode_t *pCode);
+
+typedef struct SensorGainLut_s
+{
+    uint32_t            minGain;    /**< in 1/256 */
+    uint32_t            maxGain;    /**< in 1/256 */
+    SensorGainCode_t    *pTable;    /**< maxGain - minGain + 1 entries */
+} SensorGainLut_t;
+
+/**
+ * @brief Allocate the table and fill it by calling pQuantize for every
+ *        gain step in [minGain, maxGain].
+ */
+RESULT SensorGainLutInit(SensorGainLut_t *pLut, uint32_t minGain, uint32_t maxGain,
+                         SensorGainQuantizeFunc_t pQuantize);
+
+void SensorGainLutRelease(SensorGainLut_t *pLut);
+
+#define SENSOR_GAIN_CURVE_MAGIC         0x56524347U     /**< "GCRV" little endian */
+#define SENSOR_GAIN_CURVE_MAX_POINTS    256
+
+/**
+ * @brief On-disk gain curve header, followed by count SensorGainCurvePoint_t
+ *        with requested rising and actual not falling.
+ */
+typedef struct SensorGainCurveHeader_s
+{
+    uint32_t    magic;
+    uint16_t    count;
+    uint16_t    reserved;
+} SensorGainCurveHeader_t;
+
+typedef struct SensorGainCurvePoint_s
+{
+    uint32_t    requested;          /**< nominal gain, in 1/256 */
+    uint32_t    actual;             /**< measured gain, in 1/256 */
+} SensorGainCurvePoint_t;
+
+/**
+ * @brief Remap the table through the measured gain curve of a bundle.
+ *
+ * @return  RET_SUCCESS, RET_NOTAVAILABLE if the bundle has no curve (the
+ *          table is left as is), RET_FAILURE if the curve is malformed
+ */
+RESULT SensorGainLutCalibrate(SensorGainLut_t *pLut, const SensorBundle_t *pBundle);
+
+/**
+ * @brief Codes for a gain, truncated to 1/256 and clamped to the table range.
+ */
+static inline const SensorGainCode_t *SensorGainLutLookup(const SensorGainLut_t *pLut, float gain)
+{
+    int32_t step = (int32_t)(gain * (float)SENSOR_GAIN_LUT_ONE);
+
+    step = MIN(MAX(step, (int32_t)pLut->minGain), (int32_t)pLut->maxGain);
+
+    return &pLut->pTable[step - pLut->minGain];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_gain_lut */
+
+#endif    /* __SENSOR_GAIN_LUT_H__ */
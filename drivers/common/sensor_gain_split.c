@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sensor_gain_split.h"
+
+CREATE_TRACER( SENSOR_GAIN_SPLIT_INFO , "SENSOR_GAIN_SPLIT: ", INFO,    0);
+
+#define GAIN_SPLIT_CLASS_KEY    "\"classname\""
+
+/* value of "key" between pBegin and pEnd, just past the colon */
+static const char *GainSplitFindValue(const char *pBegin, const char *pEnd, const char *pKey)
+{
+    size_t len = strlen(pKey);
+
+    for (const char *p = pBegin; p + len + 2 <= pEnd; p++) {
+        if (p[0] != '"' || strncmp(p + 1, pKey, len) != 0 || p[len + 1] != '"') {
+            continue;
+        }
+
+        for (p += len + 2; p < pEnd && (isspace((unsigned char)*p) || *p == ':'); p++) {
+            ;
+        }
+        return (p < pEnd) ? p : NULL;
+    }
+
+    return NULL;
+}
+
+static bool_t GainSplitFindNumber(const char *pBegin, const char *pEnd, const char *pKey, float *pValue)
+{
+    const char *pText = GainSplitFindValue(pBegin, pEnd, pKey);
+    char *pStop;
+    float value;
+
+    if (pText == NULL) {
+        return BOOL_FALSE;
+    }
+
+    value = strtof(pText, &pStop);
+    if (pStop == pText || !(value > 0.0f)) {
+        return BOOL_FALSE;
+    }
+
+    *pValue = value;
+    return BOOL_TRUE;
+}
+
+RESULT SensorGainLimitsParse(const char *pJson, SensorGainLimits_t *pLimits)
+{
+    const char *pClass, *pNext;
+
+    if (pJson == NULL || pLimits == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    /* the root is a flat list of classes, each runs up to the next classname */
+    for (pClass = strstr(pJson, GAIN_SPLIT_CLASS_KEY); pClass != NULL; pClass = pNext) {
+        const char *pEnd, *pEnable;
+        SensorGainLimits_t limits = { 0.0f, 1.0f, 1.0f };
+
+        pNext = strstr(pClass + 1, GAIN_SPLIT_CLASS_KEY);
+        pEnd  = (pNext != NULL) ? pNext : pClass + strlen(pClass);
+
+        pEnable = GainSplitFindValue(pClass, pEnd, "enable");
+        if (pEnable == NULL || strncmp(pEnable, "true", 4) != 0 ||
+            !GainSplitFindNumber(pClass, pEnd, "maxSensorAgain", &limits.maxSensorAgain)) {
+            continue;
+        }
+
+        (void)GainSplitFindNumber(pClass, pEnd, "maxSensorDgain", &limits.maxSensorDgain);
+        (void)GainSplitFindNumber(pClass, pEnd, "maxIspDgain", &limits.maxIspDgain);
+        *pLimits = limits;
+        return (RET_SUCCESS);
+    }
+
+    return (RET_NOTAVAILABLE);
+}
+
+static float SensorGainArbiterRead(SensorGainArbiter_t *pArbiter, const SensorProfileSet_t *pSet)
+{
+    const SensorTuningProfile_t *pProfile;
+
+    MEMSET(&pArbiter->limits, 0, sizeof(SensorGainLimits_t));
+    pArbiter->maxGain = pArbiter->hwMaxGain;
+
+    if (SensorProfileGetActive(pSet, &pProfile, &pArbiter->generation) != RET_SUCCESS ||
+        SensorGainLimitsParse(pProfile->pJson, &pArbiter->limits) != RET_SUCCESS) {
+        TRACE(SENSOR_GAIN_SPLIT_INFO, "%s: no gain split limits, max sensor gain %f\n", __func__,
+              pArbiter->maxGain);
+        return pArbiter->maxGain;
+    }
+
+    pArbiter->maxGain = MIN(pArbiter->hwMaxGain, pArbiter->limits.maxSensorAgain * pArbiter->limits.maxSensorDgain);
+    pArbiter->maxGain = MAX(pArbiter->maxGain, 1.0f);
+
+    TRACE(SENSOR_GAIN_SPLIT_INFO, "%s: %s, sensor %f x %f, isp %f, max sensor gain %f\n", __func__,
+          pProfile->pName, pArbiter->limits.maxSensorAgain, pArbiter->limits.maxSensorDgain,
+          pArbiter->limits.maxIspDgain, pArbiter->maxGain);
+    return pArbiter->maxGain;
+}
+
+float SensorGainArbiterInit(SensorGainArbiter_t *pArbiter, const SensorProfileSet_t *pSet, float hwMaxGain)
+{
+    pArbiter->hwMaxGain = hwMaxGain;
+
+    return SensorGainArbiterRead(pArbiter, pSet);
+}
+
+float SensorGainArbiterUpdate(SensorGainArbiter_t *pArbiter, const SensorProfileSet_t *pSet)
+{
+    const SensorTuningProfile_t *pProfile;
+    uint32_t generation;
+
+    if (SensorProfileGetActive(pSet, &pProfile, &generation) == RET_SUCCESS &&
+        generation != pArbiter->generation) {
+        return SensorGainArbiterRead(pArbiter, pSet);
+    }
+
+    return pArbiter->maxGain;
+}
+
+void SensorGainArbitrate(const SensorGainArbiter_t *pArbiter, const SensorGainLut_t *pLut,
+                         float curSensorGain, float gain, SensorGainSplit_t *pSplit)
+{
+    float ispMax = MAX(pArbiter->limits.maxIspDgain, 1.0f);
+    float target;
+
+    gain   = MIN(MAX(gain, 1.0f), pArbiter->maxGain * ispMax);
+    target = MIN(gain, pArbiter->maxGain);
+
+    if (ispMax > 1.0f && curSensorGain >= 1.0f && curSensorGain <= target &&
+        gain <= curSensorGain * ispMax && target < curSensorGain * (1.0f + SENSOR_GAIN_SPLIT_HOLD)) {
+        /* a small step up, the ISP covers it */
+        pSplit->sensorGain = curSensorGain;
+    } else if (ispMax > 1.0f && pLut != NULL) {
+        /* the code at or below the target, the ISP adds the remainder */
+        pSplit->sensorGain = (float)SensorGainLutLookup(pLut, target)->gain / SENSOR_GAIN_LUT_ONE;
+        pSplit->sensorGain = MIN(MAX(pSplit->sensorGain, 1.0f), target);
+    } else {
+        pSplit->sensorGain = target;
+    }
+
+    pSplit->ispDgain    = MIN(MAX(gain / pSplit->sensorGain, 1.0f), ispMax);
+    pSplit->sensorWrite = (pSplit->sensorGain != curSensorGain) ? BOOL_TRUE : BOOL_FALSE;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_gain_split.h
+ *
+ * @brief Sensor versus ISP gain arbitration.
+ *
+ * The 3aconfig of a mode declares, per AE class, how much analog and
+ * digital gain the sensor may apply (maxSensorAgain, maxSensorDgain) and
+ * how much digital gain the ISP may add on top (maxIspDgain). The driver
+ * reads these from the tuning profile in force, caps the sensor gain it
+ * reports to AE with them, and on request splits a total gain into a
+ * sensor share and an ISP share:
+ *
+ * - the sensor takes as much as it is allowed, analog gain before digital
+ *   is up to the driver's gain table;
+ * - with ISP headroom the sensor share is rounded down to a gain code the
+ *   driver can realize exactly and the ISP makes up the rest, so the
+ *   quantization of the sensor gain never shows;
+ * - a small change that the ISP can absorb keeps the sensor gain in force,
+ *   saving the register writes (and their frame latency) of AE fine steps.
+ *
+ * Only the product maxSensorAgain x maxSensorDgain limits the sensor gain,
+ * how a gain table divides it between analog and digital codes is left to
+ * the driver.
+ *
+ * The limits come with the mode bundle (see sensor_profile.h for how the
+ * build puts the 3aconfig in it); without a bundle there are none, the
+ * sensor keeps its hardware maximum and the ISP adds nothing.
+ *
+ * @defgroup sensor_gain_split
+ * @{
+ *
+ */
+#ifndef __SENSOR_GAIN_SPLIT_H__
+#define __SENSOR_GAIN_SPLIT_H__
+
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include "sensor_gain_lut.h"
+#include "sensor_profile.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_GAIN_SPLIT_HOLD      (1.0f / 32.0f)  /**< relative change the ISP absorbs without a sensor write */
+
+typedef struct SensorGainLimits_s
+{
+    float       maxSensorAgain;
+    float       maxSensorDgain;
+    float       maxIspDgain;
+} SensorGainLimits_t;
+
+typedef struct SensorGainArbiter_s
+{
+    SensorGainLimits_t  limits;         /**< all 0 if the tuning declares none */
+    uint32_t            generation;     /**< of the profile the limits were read from */
+    float               hwMaxGain;      /**< what the sensor mode can do */
+    float               maxGain;        /**< sensor gain allowed, hwMaxGain capped by the limits */
+} SensorGainArbiter_t;
+
+typedef struct SensorGainSplit_s
+{
+    float       sensorGain;             /**< to pass to ExposureControl */
+    float       ispDgain;               /**< for the ISP to apply, >= 1 */
+    bool_t      sensorWrite;            /**< sensorGain differs from the gain in force */
+} SensorGainSplit_t;
+
+/**
+ * @brief Read the limits of the first enabled AE class that declares them.
+ *
+ * This is a key scanner for the flat 3aconfig layout, not a json parser.
+ * maxSensorDgain and maxIspDgain default to 1.
+ *
+ * @return  RET_SUCCESS, RET_NOTAVAILABLE if no enabled class has
+ *          maxSensorAgain
+ */
+RESULT SensorGainLimitsParse(const char *pJson, SensorGainLimits_t *pLimits);
+
+/**
+ * @brief Set the hardware limit of the mode and read the limits of the
+ *        profile in force.
+ *
+ * @return  the sensor gain allowed
+ */
+float SensorGainArbiterInit(SensorGainArbiter_t *pArbiter, const SensorProfileSet_t *pSet, float hwMaxGain);
+
+/**
+ * @brief Re-read the limits if another profile came into force.
+ *
+ * @return  the sensor gain allowed
+ */
+float SensorGainArbiterUpdate(SensorGainArbiter_t *pArbiter, const SensorProfileSet_t *pSet);
+
+/**
+ * @brief Split a total gain.
+ *
+ * @param   pLut            the driver's gain table, NULL if it has none
+ *                          (the sensor share is then not quantized)
+ * @param   curSensorGain   sensor gain in force
+ *
+ * The total is clamped to [1, maxGain x maxIspDgain].
+ */
+void SensorGainArbitrate(const SensorGainArbiter_t *pArbiter, const SensorGainLut_t *pLut,
+                         float curSensorGain, float gain, SensorGainSplit_t *pSplit);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_gain_split */
+
+#endif    /* __SENSOR_GAIN_SPLIT_H__ */
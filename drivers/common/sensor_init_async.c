@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <sys/ioctl.h>
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_init_async.h"
+
+CREATE_TRACER( SENSOR_INIT_ASYNC_INFO , "SENSOR_INIT_ASYNC: ", INFO,    0);
+CREATE_TRACER( SENSOR_INIT_ASYNC_ERROR, "SENSOR_INIT_ASYNC: ", ERROR,   1);
+
+RESULT SensorInitWriteRegs(SensorInitAsync_t *pAsync, int fd, const struct vvcam_sccb_array *pArry)
+{
+    struct vvcam_sccb_array chunk;
+
+    __atomic_store_n(&pAsync->regsWritten, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pAsync->regsTotal, pArry->count, __ATOMIC_RELAXED);
+
+    for (uint32_t i = 0; i < pArry->count; i += chunk.count) {
+        chunk.count     = MIN(pArry->count - i, (uint32_t)SENSOR_INIT_CHUNK_REGS);
+        chunk.sccb_data = &pArry->sccb_data[i];
+        if (ioctl(fd, VVSENSORIOC_WRITE_ARRAY, &chunk) != 0) {
+            TRACE(SENSOR_INIT_ASYNC_ERROR, "%s: write registers %u..%u error!\n", __func__,
+                  i, i + chunk.count - 1);
+            return (RET_FAILURE);
+        }
+        __atomic_store_n(&pAsync->regsWritten, i + chunk.count, __ATOMIC_RELAXED);
+    }
+
+    return (RET_SUCCESS);
+}
+
+static void *SensorInitThread(void *pArg)
+{
+    SensorInitAsync_t *pAsync = (SensorInitAsync_t *)pArg;
+    RESULT result = pAsync->init(pAsync->handle);
+
+    __atomic_store_n(&pAsync->result, (uint32_t)result, __ATOMIC_RELAXED);
+    __atomic_store_n(&pAsync->state, (result == RET_SUCCESS) ? SENSOR_INIT_DONE : SENSOR_INIT_FAILED,
+                     __ATOMIC_RELEASE);
+
+    TRACE(SENSOR_INIT_ASYNC_INFO, "%s: %p done: %d\n", __func__, pAsync->handle, result);
+    if (pAsync->done != NULL) {
+        pAsync->done(pAsync->handle, result, pAsync->pUser);
+    }
+
+    return NULL;
+}
+
+RESULT SensorInitAsyncStart(SensorInitAsync_t *pAsync, SensorInitFunc_t init, IsiSensorHandle_t handle,
+                            SensorInitDone_t done, void *pUser)
+{
+    if (pAsync == NULL || init == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (__atomic_load_n(&pAsync->state, __ATOMIC_ACQUIRE) == SENSOR_INIT_RUNNING) {
+        return (RET_BUSY);
+    }
+    (void)SensorInitAsyncWait(pAsync);
+
+    pAsync->init   = init;
+    pAsync->handle = handle;
+    pAsync->done   = done;
+    pAsync->pUser  = pUser;
+    __atomic_store_n(&pAsync->result, (uint32_t)RET_PENDING, __ATOMIC_RELAXED);
+    __atomic_store_n(&pAsync->regsWritten, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pAsync->regsTotal, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pAsync->state, SENSOR_INIT_RUNNING, __ATOMIC_RELEASE);
+
+    if (pthread_create(&pAsync->thread, NULL, SensorInitThread, pAsync) != 0) {
+        __atomic_store_n(&pAsync->result, (uint32_t)RET_FAILURE, __ATOMIC_RELAXED);
+        __atomic_store_n(&pAsync->state, SENSOR_INIT_FAILED, __ATOMIC_RELEASE);
+        TRACE(SENSOR_INIT_ASYNC_ERROR, "%s: no thread for %p\n", __func__, handle);
+        return (RET_FAILURE);
+    }
+    pAsync->joinable = BOOL_TRUE;
+
+    return (RET_SUCCESS);
+}
+
+void SensorInitAsyncQuery(const SensorInitAsync_t *pAsync, SensorInitStatus_t *pStatus)
+{
+    pStatus->state       = (SensorInitState_t)__atomic_load_n(&pAsync->state, __ATOMIC_ACQUIRE);
+    pStatus->result      = (pStatus->state == SENSOR_INIT_IDLE) ? RET_SUCCESS :
+                           (RESULT)__atomic_load_n(&pAsync->result, __ATOMIC_RELAXED);
+    pStatus->regsWritten = __atomic_load_n(&pAsync->regsWritten, __ATOMIC_RELAXED);
+    pStatus->regsTotal   = __atomic_load_n(&pAsync->regsTotal, __ATOMIC_RELAXED);
+}
+
+RESULT SensorInitAsyncWait(SensorInitAsync_t *pAsync)
+{
+    if (!pAsync->joinable) {
+        return (__atomic_load_n(&pAsync->state, __ATOMIC_ACQUIRE) == SENSOR_INIT_IDLE) ?
+               RET_SUCCESS : (RESULT)__atomic_load_n(&pAsync->result, __ATOMIC_RELAXED);
+    }
+
+    pthread_join(pAsync->thread, NULL);
+    pAsync->joinable = BOOL_FALSE;
+
+    return (RESULT)__atomic_load_n(&pAsync->result, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_init_async.h
+ *
+ * @brief Sensor initialization in the background.
+ *
+ * InitSensorIss loads the mode's register set and writes up to a thousand
+ * registers over I2C, which takes long enough to matter at startup. A
+ * driver can run it on a thread of its own instead: the call returns at
+ * once and the application brings up the ISP, its buffers and the encoder
+ * meanwhile. A callback reports completion, and the status can be polled
+ * for the register progress and the result.
+ *
+ * The register set goes out in chunks so progress is visible; a driver
+ * uses SensorInitWriteRegs() for this in its InitSensorIss, called
+ * synchronously or not.
+ *
+ * Until the callback ran or the status left SENSOR_INIT_RUNNING, no other
+ * call may be made on the sensor handle, except the status query and
+ * release, which waits for the initialization to finish.
+ *
+ * @defgroup sensor_init_async
+ * @{
+ *
+ */
+#ifndef __SENSOR_INIT_ASYNC_H__
+#define __SENSOR_INIT_ASYNC_H__
+
+#include <pthread.h>
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include <isi/isi_common.h>
+#include <vvsensor.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_INIT_CHUNK_REGS      64      /**< registers per write ioctl */
+
+typedef enum SensorInitState_e
+{
+    SENSOR_INIT_IDLE        = 0,            /**< never started in the background */
+    SENSOR_INIT_RUNNING     = 1,
+    SENSOR_INIT_DONE        = 2,
+    SENSOR_INIT_FAILED      = 3,
+} SensorInitState_t;
+
+typedef struct SensorInitStatus_s
+{
+    SensorInitState_t   state;
+    RESULT              result;             /**< RET_PENDING while running */
+    uint32_t            regsWritten;
+    uint32_t            regsTotal;          /**< 0 until the register set is loaded */
+} SensorInitStatus_t;
+
+typedef RESULT (*SensorInitFunc_t)(IsiSensorHandle_t handle);
+
+/**
+ * @brief Completion callback, runs on the initialization thread, so it
+ *        must not release the sensor itself.
+ */
+typedef void (*SensorInitDone_t)(IsiSensorHandle_t handle, RESULT result, void *pUser);
+
+typedef struct SensorInitAsync_s
+{
+    pthread_t           thread;
+    bool_t              joinable;           /**< a thread was started and not joined yet */
+    SensorInitFunc_t    init;
+    IsiSensorHandle_t   handle;
+    SensorInitDone_t    done;
+    void                *pUser;
+
+    uint32_t            state;              /**< SensorInitState_t, read and written atomically */
+    uint32_t            result;
+    uint32_t            regsWritten;
+    uint32_t            regsTotal;
+} SensorInitAsync_t;
+
+/**
+ * @brief Write a register set in chunks, counting progress in pAsync.
+ */
+RESULT SensorInitWriteRegs(SensorInitAsync_t *pAsync, int fd, const struct vvcam_sccb_array *pArry);
+
+/**
+ * @brief Run init(handle) on a new thread.
+ *
+ * @param   done        called with the result when init returns, may be NULL
+ *
+ * @return  RET_SUCCESS if started, RET_BUSY if an initialization is still
+ *          running, RET_FAILURE if no thread could be created
+ */
+RESULT SensorInitAsyncStart(SensorInitAsync_t *pAsync, SensorInitFunc_t init, IsiSensorHandle_t handle,
+                            SensorInitDone_t done, void *pUser);
+
+void SensorInitAsyncQuery(const SensorInitAsync_t *pAsync, SensorInitStatus_t *pStatus);
+
+/**
+ * @brief Wait for a background initialization to finish.
+ *
+ * @return  its result, RET_SUCCESS if none was started
+ */
+RESULT SensorInitAsyncWait(SensorInitAsync_t *pAsync);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_init_async */
+
+#endif    /* __SENSOR_INIT_ASYNC_H__ */
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <sys/ioctl.h>
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_latency.h"
+
+CREATE_TRACER( SENSOR_LATENCY_INFO , "SENSOR_LATENCY: ", INFO,    0);
+CREATE_TRACER( SENSOR_LATENCY_ERROR, "SENSOR_LATENCY: ", ERROR,   1);
+
+static RESULT SensorLatencyWrite(int fd, const struct vvcam_sccb_data *pRegs, uint32_t count)
+{
+    struct vvcam_sccb_array arry;
+
+    if (count == 0) {
+        return (RET_SUCCESS);
+    }
+
+    arry.count     = count;
+    arry.sccb_data = (struct vvcam_sccb_data *)pRegs;
+    if (ioctl(fd, VVSENSORIOC_WRITE_ARRAY, &arry) != 0) {
+        TRACE(SENSOR_LATENCY_ERROR, "%s: write %u registers error!\n", __func__, count);
+        return (RET_FAILURE);
+    }
+
+    return (RET_SUCCESS);
+}
+
+void SensorLatencySchedInit(SensorLatencySched_t *pSched, const SensorLatency_t *pLatency)
+{
+    MEMSET(pSched, 0, sizeof(SensorLatencySched_t));
+    pthread_mutex_init(&pSched->lock, NULL);
+    pSched->pLatency = pLatency;
+}
+
+void SensorLatencySchedRelease(SensorLatencySched_t *pSched)
+{
+    pthread_mutex_destroy(&pSched->lock);
+}
+
+RESULT SensorLatencyFrameStart(SensorLatencySched_t *pSched, int fd, uint32_t frame)
+{
+    RESULT result = RET_SUCCESS;
+
+    pthread_mutex_lock(&pSched->lock);
+    pSched->frameSync = BOOL_TRUE;
+    pSched->frame     = frame;
+
+    if (pSched->pendingCount != 0 && (int32_t)(frame - pSched->pendingFrame) >= 0) {
+        result = SensorLatencyWrite(fd, pSched->pendingRegs, pSched->pendingCount);
+        pSched->pendingCount = 0;
+    }
+    pthread_mutex_unlock(&pSched->lock);
+
+    return (result);
+}
+
+RESULT SensorLatencySubmit(SensorLatencySched_t *pSched, int fd,
+                           const struct vvcam_sccb_data *pShutter, uint32_t shutterCount,
+                           const struct vvcam_sccb_data *pGain, uint32_t gainCount,
+                           uint32_t *pFrame, uint32_t *pValidFrame)
+{
+    struct vvcam_sccb_data regs[2 * SENSOR_LATENCY_MAX_REGS];
+    const struct vvcam_sccb_data *pNow = pShutter, *pLater = pGain;
+    uint32_t nowCount = shutterCount, laterCount = gainCount;
+    uint32_t shutterDelay = MAX(pSched->pLatency->exposure, pSched->pLatency->vts);
+    uint32_t gainDelay = pSched->pLatency->gain;
+    RESULT result;
+
+    if (shutterCount > SENSOR_LATENCY_MAX_REGS || gainCount > SENSOR_LATENCY_MAX_REGS) {
+        return (RET_OUTOFRANGE);
+    }
+
+    pthread_mutex_lock(&pSched->lock);
+
+    /* a group the previous frame start did not get to belongs to a superseded
+       request; writing it now would put that request on the sensor early */
+    pSched->pendingCount = 0;
+
+    pSched->validFrame = pSched->frame + MAX(shutterDelay, gainDelay);
+    if (pFrame != NULL) {
+        *pFrame = pSched->frame;
+    }
+    if (pValidFrame != NULL) {
+        *pValidFrame = pSched->validFrame;
+    }
+
+    if (!pSched->frameSync || shutterDelay == gainDelay) {
+        MEMCPY(regs, pShutter, shutterCount * sizeof(struct vvcam_sccb_data));
+        MEMCPY(&regs[shutterCount], pGain, gainCount * sizeof(struct vvcam_sccb_data));
+        result = SensorLatencyWrite(fd, regs, shutterCount + gainCount);
+        pthread_mutex_unlock(&pSched->lock);
+        return (result);
+    }
+
+    if (gainDelay > shutterDelay) {
+        pNow       = pGain;
+        nowCount   = gainCount;
+        pLater     = pShutter;
+        laterCount = shutterCount;
+    }
+
+    /* the faster group waits for the slower one */
+    MEMCPY(pSched->pendingRegs, pLater, laterCount * sizeof(struct vvcam_sccb_data));
+    pSched->pendingCount = laterCount;
+    pSched->pendingFrame = pSched->frame + MAX(shutterDelay, gainDelay) - MIN(shutterDelay, gainDelay);
+
+    TRACE(SENSOR_LATENCY_INFO, "%s: frame %u, %u registers held until %u, valid at %u\n", __func__,
+          pSched->frame, laterCount, pSched->pendingFrame, pSched->validFrame);
+    result = SensorLatencyWrite(fd, pNow, nowCount);
+    pthread_mutex_unlock(&pSched->lock);
+
+    return (result);
+}
+
+uint32_t SensorLatencyWritten(SensorLatencySched_t *pSched, uint32_t *pFrame)
+{
+    uint32_t validFrame;
+
+    pthread_mutex_lock(&pSched->lock);
+    pSched->validFrame = pSched->frame +
+                         MAX(MAX(pSched->pLatency->exposure, pSched->pLatency->vts), pSched->pLatency->gain);
+    validFrame = pSched->validFrame;
+    if (pFrame != NULL) {
+        *pFrame = pSched->frame;
+    }
+    pthread_mutex_unlock(&pSched->lock);
+
+    return validFrame;
+}
+
+uint32_t SensorLatencyValidFrame(SensorLatencySched_t *pSched)
+{
+    uint32_t validFrame;
+
+    pthread_mutex_lock(&pSched->lock);
+    validFrame = pSched->validFrame;
+    pthread_mutex_unlock(&pSched->lock);
+
+    return validFrame;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_latency.h
+ *
+ * @brief Frame latency model for exposure writes.
+ *
+ * A sensor latches shutter, VTS and gain registers at different frame
+ * boundaries, e.g. a shutter write is in force two frames later, a gain
+ * write one frame later. Each driver declares these delays in a
+ * SensorLatency_t. When the ISP reports frame starts, the register group
+ * with the shorter delay is held back by the difference, so a requested
+ * exposure lands completely on one frame, and the driver can tell AE the
+ * number of that frame instead of a fixed frame skip.
+ *
+ * Without frame starts both groups are written at once, as before, and
+ * the valid frame counts from the last frame start seen (0 if none).
+ *
+ * A new request supersedes a group still held back for the previous one;
+ * that group is dropped, not written. Frame starts come from the ISP
+ * thread, requests from AE, so the scheduler takes a lock of its own.
+ *
+ * @defgroup sensor_latency
+ * @{
+ *
+ */
+#ifndef __SENSOR_LATENCY_H__
+#define __SENSOR_LATENCY_H__
+
+#include <pthread.h>
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include <vvsensor.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_LATENCY_MAX_REGS     8
+
+/**
+ * @brief Frames from a register write until it is in force.
+ */
+typedef struct SensorLatency_s
+{
+    uint8_t     exposure;
+    uint8_t     gain;
+    uint8_t     vts;
+} SensorLatency_t;
+
+typedef struct SensorLatencySched_s
+{
+    pthread_mutex_t         lock;               /**< held for every member below */
+    const SensorLatency_t   *pLatency;
+    bool_t                  frameSync;          /**< frame starts are being reported */
+    uint32_t                frame;              /**< last frame start */
+    uint32_t                validFrame;         /**< first frame fully exposed with the last request */
+
+    uint32_t                pendingFrame;       /**< frame start at which pendingRegs go out */
+    uint32_t                pendingCount;       /**< 0 if nothing is held back */
+    struct vvcam_sccb_data  pendingRegs[SENSOR_LATENCY_MAX_REGS];
+} SensorLatencySched_t;
+
+void SensorLatencySchedInit(SensorLatencySched_t *pSched, const SensorLatency_t *pLatency);
+void SensorLatencySchedRelease(SensorLatencySched_t *pSched);
+
+/**
+ * @brief Report a frame start, writes anything due by then.
+ */
+RESULT SensorLatencyFrameStart(SensorLatencySched_t *pSched, int fd, uint32_t frame);
+
+/**
+ * @brief Write a shutter (with VTS) and a gain register group to the sensor
+ *        device fd so both are in force on the same frame.
+ *
+ * A group still held back for the previous request is dropped.
+ *
+ * @param   pFrame          receives the frame start the request counts from, may be NULL
+ * @param   pValidFrame     receives that frame, may be NULL
+ */
+RESULT SensorLatencySubmit(SensorLatencySched_t *pSched, int fd,
+                           const struct vvcam_sccb_data *pShutter, uint32_t shutterCount,
+                           const struct vvcam_sccb_data *pGain, uint32_t gainCount,
+                           uint32_t *pFrame, uint32_t *pValidFrame);
+
+/**
+ * @brief Account for shutter and gain written directly by the driver.
+ *
+ * @param   pFrame          receives the frame start the writes count from, may be NULL
+ *
+ * @return  the frame from which both are in force
+ */
+uint32_t SensorLatencyWritten(SensorLatencySched_t *pSched, uint32_t *pFrame);
+
+/**
+ * @brief First frame fully exposed with the last request.
+ */
+uint32_t SensorLatencyValidFrame(SensorLatencySched_t *pSched);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_latency */
+
+#endif    /* __SENSOR_LATENCY_H__ */
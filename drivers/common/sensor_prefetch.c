@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include "sensor_prefetch.h"
+#include "sensor_trace.h"
+
+CREATE_TRACER( SENSOR_PREFETCH_INFO , "SENSOR_PREFETCH: ", INFO,    0);
+CREATE_TRACER( SENSOR_PREFETCH_ERROR, "SENSOR_PREFETCH: ", ERROR,   1);
+
+static void *SensorPrefetchThread(void *pArg)
+{
+    SensorPrefetch_t *pPrefetch = (SensorPrefetch_t *)pArg;
+    uint64_t span = SensorTraceBegin();
+
+    if (SensorBundleIsOpen(pPrefetch->pBundle)) {
+        const volatile uint8_t *pByte = pPrefetch->pBundle->pBase;
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+        /* one read per page faults the whole mapping in */
+        for (size_t offset = 0; offset < pPrefetch->pBundle->size; offset += page) {
+            (void)pByte[offset];
+        }
+        pPrefetch->result = RET_SUCCESS;
+    } else {
+        pPrefetch->result = pPrefetch->parse(pPrefetch->pRegFile, &pPrefetch->regs);
+        if (pPrefetch->result != RET_SUCCESS) {
+            TRACE(SENSOR_PREFETCH_ERROR, "%s: %s: %d\n", __func__, pPrefetch->pRegFile, pPrefetch->result);
+        }
+    }
+
+    SensorTraceEnd(SensorBundleIsOpen(pPrefetch->pBundle) ? pPrefetch->pBundle->pHeader->sensorName : NULL,
+                   "prefetch", span);
+    return NULL;
+}
+
+RESULT SensorPrefetchStart(SensorPrefetch_t *pPrefetch, const SensorBundle_t *pBundle,
+                           const char *pRegFile, SensorRegFileParse_t parse)
+{
+    if (pPrefetch == NULL || pBundle == NULL) {
+        return (RET_NULL_POINTER);
+    }
+    if (!SensorBundleIsOpen(pBundle) && (pRegFile == NULL || parse == NULL)) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorPrefetchRelease(pPrefetch);
+
+    pPrefetch->pBundle  = pBundle;
+    pPrefetch->pRegFile = pRegFile;
+    pPrefetch->parse    = parse;
+    pPrefetch->result   = RET_PENDING;
+
+    if (pthread_create(&pPrefetch->thread, NULL, SensorPrefetchThread, pPrefetch) != 0) {
+        pPrefetch->result = RET_FAILURE;
+        return (RET_FAILURE);
+    }
+    pPrefetch->joinable = BOOL_TRUE;
+
+    return (RET_SUCCESS);
+}
+
+void SensorPrefetchWait(SensorPrefetch_t *pPrefetch)
+{
+    if (pPrefetch->joinable) {
+        pthread_join(pPrefetch->thread, NULL);
+        pPrefetch->joinable = BOOL_FALSE;
+    }
+}
+
+RESULT SensorPrefetchTakeRegs(SensorPrefetch_t *pPrefetch, struct vvcam_sccb_array *pArry)
+{
+    SensorPrefetchWait(pPrefetch);
+
+    if (pPrefetch->result != RET_SUCCESS || pPrefetch->regs.sccb_data == NULL) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    *pArry = pPrefetch->regs;
+    MEMSET(&pPrefetch->regs, 0, sizeof(pPrefetch->regs));
+
+    return (RET_SUCCESS);
+}
+
+void SensorPrefetchRelease(SensorPrefetch_t *pPrefetch)
+{
+    SensorPrefetchWait(pPrefetch);
+
+    free(pPrefetch->regs.sccb_data);
+    MEMSET(pPrefetch, 0, sizeof(SensorPrefetch_t));
+}
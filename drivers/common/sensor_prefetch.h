@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_prefetch.h
+ *
+ * @brief Mode data loading overlapped with the sensor power-up.
+ *
+ * The mode index is known when the sensor is created, but its register
+ * set is only needed at init, after power, clock and reset delays. A
+ * driver starts a prefetch as soon as it knows the mode: on a helper
+ * thread the mapped bundle is faulted in page by page (register set, 3A
+ * configuration and calibration alike), or, without a bundle, the register
+ * text file is parsed. By init the data sits in memory and the storage
+ * latency was spent while the sensor was powering up.
+ *
+ * Init waits for the prefetch and takes the parsed register set over;
+ * release waits as well before the bundle is unmapped.
+ *
+ * @defgroup sensor_prefetch
+ * @{
+ *
+ */
+#ifndef __SENSOR_PREFETCH_H__
+#define __SENSOR_PREFETCH_H__
+
+#include <pthread.h>
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include <vvsensor.h>
+#include "sensor_bundle.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief A driver's register text file parser, fills a malloc'ed array.
+ */
+typedef RESULT (*SensorRegFileParse_t)(const char *pFileName, struct vvcam_sccb_array *pArry);
+
+typedef struct SensorPrefetch_s
+{
+    pthread_t               thread;
+    bool_t                  joinable;       /**< a thread was started and not joined yet */
+    const SensorBundle_t    *pBundle;       /**< faulted in if open */
+    const char              *pRegFile;      /**< parsed otherwise */
+    SensorRegFileParse_t    parse;
+
+    RESULT                  result;
+    struct vvcam_sccb_array regs;           /**< parsed register set, until taken */
+} SensorPrefetch_t;
+
+/**
+ * @brief Start prefetching a mode's data.
+ *
+ * pBundle and pRegFile have to stay valid until SensorPrefetchWait(). If no
+ * thread can be had, nothing is prefetched and init loads as before.
+ */
+RESULT SensorPrefetchStart(SensorPrefetch_t *pPrefetch, const SensorBundle_t *pBundle,
+                           const char *pRegFile, SensorRegFileParse_t parse);
+
+/**
+ * @brief Wait for the prefetch to complete.
+ */
+void SensorPrefetchWait(SensorPrefetch_t *pPrefetch);
+
+/**
+ * @brief Hand the parsed register set over, the caller owns it afterwards.
+ *
+ * @return  RET_SUCCESS, RET_NOTAVAILABLE if nothing was parsed (bundle,
+ *          no prefetch or a parse error)
+ */
+RESULT SensorPrefetchTakeRegs(SensorPrefetch_t *pPrefetch, struct vvcam_sccb_array *pArry);
+
+/**
+ * @brief Wait, then free whatever was not taken.
+ */
+void SensorPrefetchRelease(SensorPrefetch_t *pPrefetch);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_prefetch */
+
+#endif    /* __SENSOR_PREFETCH_H__ */
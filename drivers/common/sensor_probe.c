@@ -0,0 +1,369 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vvsensor.h>
+#include "sensor_probe.h"
+
+CREATE_TRACER( SENSOR_PROBE_INFO , "SENSOR_PROBE: ", INFO,    0);
+CREATE_TRACER( SENSOR_PROBE_ERROR, "SENSOR_PROBE: ", ERROR,   1);
+
+#define PROBE_MAX_SIGNATURES    16
+#define PROBE_MAX_MEMO          8       /**< ID registers read under one SCCB setting */
+#define PROBE_CACHE_LINES       64
+#define PROBE_CACHE_LINE_LEN    160
+
+/*
+ * The ID registers are those of each driver's chip ID check. The addresses
+ * are not the drivers': their ConfigSensorSCCBIss returns before setting
+ * one, the kernel driver keeps the address the device tree gives it. IMX334
+ * carries its address in that dead code; the others are the defaults of
+ * the datasheets. SC132GS's dead code has 0x31 against its comment's 0x30
+ * or 0x32, the table keeps the default. A board strapping a sensor
+ * otherwise probes with a copy of the table holding its address.
+ *
+ * OV12870 is left out: its check reads 0x6000-0x6002 and takes 0 as its
+ * ID, which any sensor or an empty register answers as well.
+ */
+const SensorProbeSignature_t SensorProbeKnown[] = {
+    { "GC02M1B", "gc02m1b.drv", 0x37, 1, 1, 2, { 0xf0, 0xf1 },           0x02e0 },     /* datasheet */
+    { "GC5035",  "gc5035.drv",  0x37, 1, 1, 2, { 0xf0, 0xf1 },           0x5035 },     /* datasheet */
+    { "IMX219",  "imx219.drv",  0x10, 2, 1, 2, { 0x0000, 0x0001 },       0x0219 },     /* datasheet */
+    { "IMX334",  "imx334.drv",  0x1a, 2, 1, 2, { 0x3a04, 0x3a05 },       0x9012 },     /* driver */
+    { "SC132GS", "sc132gs.drv", 0x30, 2, 1, 2, { 0x3107, 0x3108 },       0x0132 },     /* datasheet */
+    { "SC2310",  "sc2310.drv",  0x30, 2, 1, 2, { 0x3107, 0x3108 },       0x2311 },     /* datasheet */
+};
+const uint32_t SensorProbeKnownCount = sizeof(SensorProbeKnown) / sizeof(SensorProbeKnown[0]);
+
+typedef struct ProbeBus_s
+{
+    int                     fd;
+    struct vvcam_sccb_cfg_s cfg;
+    bool_t                  silent;                 /**< nobody answered on the address */
+    uint32_t                memoCount;
+    uint32_t                memoReg[PROBE_MAX_MEMO];
+    uint32_t                memoValue[PROBE_MAX_MEMO];
+    uint32_t                reads;
+} ProbeBus_t;
+
+static bool_t ProbeSameBus(const SensorProbeSignature_t *pA, const SensorProbeSignature_t *pB)
+{
+    return (pA->slaveAddr == pB->slaveAddr && pA->addrByte == pB->addrByte &&
+            pA->dataByte == pB->dataByte) ? BOOL_TRUE : BOOL_FALSE;
+}
+
+static RESULT ProbeSelect(ProbeBus_t *pBus, const SensorProbeSignature_t *pSig)
+{
+    pBus->cfg.slave_addr = pSig->slaveAddr;
+    pBus->cfg.addr_byte  = pSig->addrByte;
+    pBus->cfg.data_byte  = pSig->dataByte;
+    pBus->silent         = BOOL_FALSE;
+    pBus->memoCount      = 0;
+
+    if (ioctl(pBus->fd, VVSENSORIOC_SENSOR_SCCB_CFG, &pBus->cfg) != 0) {
+        TRACE(SENSOR_PROBE_ERROR, "%s: SCCB 0x%02x not configurable\n", __func__, pSig->slaveAddr);
+        pBus->silent = BOOL_TRUE;
+        return (RET_FAILURE);
+    }
+
+    return (RET_SUCCESS);
+}
+
+static RESULT ProbeRead(ProbeBus_t *pBus, uint32_t reg, uint32_t *pValue)
+{
+    struct vvcam_sccb_data sccb_data;
+
+    for (uint32_t i = 0; i < pBus->memoCount; i++) {
+        if (pBus->memoReg[i] == reg) {
+            *pValue = pBus->memoValue[i];
+            return (RET_SUCCESS);
+        }
+    }
+    if (pBus->silent) {
+        return (RET_FAILURE);
+    }
+
+    sccb_data.addr = reg;
+    sccb_data.data = 0;
+    pBus->reads++;
+    if (ioctl(pBus->fd, VVSENSORIOC_READ_REG, &sccb_data) != 0) {
+        pBus->silent = BOOL_TRUE;       /* no ack, the other registers won't do better */
+        return (RET_FAILURE);
+    }
+
+    if (pBus->memoCount < PROBE_MAX_MEMO) {
+        pBus->memoReg[pBus->memoCount]   = reg;
+        pBus->memoValue[pBus->memoCount] = sccb_data.data;
+        pBus->memoCount++;
+    }
+    *pValue = sccb_data.data;
+    return (RET_SUCCESS);
+}
+
+static bool_t ProbeMatch(ProbeBus_t *pBus, const SensorProbeSignature_t *pSig)
+{
+    uint32_t chipId = 0;
+    uint32_t value;
+
+    for (uint32_t i = 0; i < pSig->idRegCount; i++) {
+        if (ProbeRead(pBus, pSig->idReg[i], &value) != RET_SUCCESS) {
+            return BOOL_FALSE;
+        }
+        chipId = (chipId << 8) | (value & 0xff);
+    }
+
+    return (pSig->idRegCount > 0 && chipId == pSig->chipId) ? BOOL_TRUE : BOOL_FALSE;
+}
+
+static const char *ProbeCachePath(void)
+{
+    const char *pPath = getenv(SENSOR_PROBE_CACHE_ENV);
+
+    return (pPath != NULL && pPath[0] != '\0') ? pPath : SENSOR_PROBE_DEFAULT_CACHE;
+}
+
+/* read the cache, every line but the one of boardId/port */
+static uint32_t ProbeCacheLoad(const char *pBoardId, uint32_t port, char lines[][PROBE_CACHE_LINE_LEN],
+                               char *pSensorName, size_t nameSize)
+{
+    FILE *fp = fopen(ProbeCachePath(), "r");
+    char line[PROBE_CACHE_LINE_LEN];
+    uint32_t count = 0;
+
+    if (pSensorName != NULL) {
+        pSensorName[0] = '\0';
+    }
+    if (fp == NULL) {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char board[SENSOR_PROBE_BOARD_ID_LEN];
+        char name[32];
+        unsigned int linePort;
+
+        if (sscanf(line, "%63s %u %31s", board, &linePort, name) != 3) {
+            continue;
+        }
+        if (strcmp(board, pBoardId) == 0 && linePort == port) {
+            if (pSensorName != NULL) {
+                strncpy(pSensorName, name, nameSize - 1);
+                pSensorName[nameSize - 1] = '\0';
+            }
+        } else if (lines != NULL && count < PROBE_CACHE_LINES) {
+            strcpy(lines[count++], line);
+        }
+    }
+    fclose(fp);
+
+    return count;
+}
+
+/* call with the cache lock held, or the last of two writers drops the entry of the other */
+static RESULT ProbeCacheRewrite(const char *pBoardId, uint32_t port, const char *pSensorName)
+{
+    char lines[PROBE_CACHE_LINES][PROBE_CACHE_LINE_LEN];
+    const char *pPath = ProbeCachePath();
+    char tmpPath[256];
+    uint32_t count;
+    FILE *fp;
+    int fd;
+
+    count = ProbeCacheLoad(pBoardId, port, lines, NULL, 0);
+
+    /* readers see the old file or the new one, never a half written one */
+    snprintf(tmpPath, sizeof(tmpPath), "%s.XXXXXX", pPath);
+    fd = mkstemp(tmpPath);
+    if (fd < 0) {
+        TRACE(SENSOR_PROBE_ERROR, "%s: can't write next to %s\n", __func__, pPath);
+        return (RET_FAILURE);
+    }
+    fp = fdopen(fd, "w");
+    if (fp == NULL || fchmod(fd, 0644) != 0) {
+        if (fp != NULL) {
+            fclose(fp);
+        } else {
+            close(fd);
+        }
+        remove(tmpPath);
+        return (RET_FAILURE);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        fputs(lines[i], fp);
+    }
+    if (pSensorName != NULL) {
+        fprintf(fp, "%s %u %s\n", pBoardId, port, pSensorName);
+    }
+    if (fclose(fp) != 0 || rename(tmpPath, pPath) != 0) {
+        remove(tmpPath);
+        return (RET_FAILURE);
+    }
+
+    return (RET_SUCCESS);
+}
+
+static RESULT ProbeCacheStore(const char *pBoardId, uint32_t port, const char *pSensorName)
+{
+    const char *pPath = ProbeCachePath();
+    char lockPath[256];
+    RESULT result;
+    int fd;
+
+    /* probes of several ports may store at once: each reads the file, adds
+       its entry and renames its copy over it, one after the other */
+    snprintf(lockPath, sizeof(lockPath), "%s.lock", pPath);
+    fd = open(lockPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        TRACE(SENSOR_PROBE_ERROR, "%s: can't lock %s\n", __func__, pPath);
+        return (RET_FAILURE);
+    }
+    if (flock(fd, LOCK_EX) != 0) {
+        TRACE(SENSOR_PROBE_ERROR, "%s: can't lock %s\n", __func__, pPath);
+        close(fd);
+        return (RET_FAILURE);
+    }
+
+    result = ProbeCacheRewrite(pBoardId, port, pSensorName);
+
+    close(fd);
+    return (result);
+}
+
+static bool_t ProbeReadId(const char *pFile, char *pBoardId, size_t size)
+{
+    FILE *fp = fopen(pFile, "r");
+    size_t n;
+
+    if (fp == NULL) {
+        return BOOL_FALSE;
+    }
+    n = fread(pBoardId, 1, size - 1, fp);
+    fclose(fp);
+    pBoardId[n] = '\0';
+
+    return (n > 0) ? BOOL_TRUE : BOOL_FALSE;
+}
+
+void SensorProbeBoardId(char *pBoardId, size_t size)
+{
+    const char *pEnv = getenv(SENSOR_PROBE_BOARD_ENV);
+    size_t n = 0;
+
+    if (pEnv != NULL && pEnv[0] != '\0') {
+        strncpy(pBoardId, pEnv, size - 1);
+        pBoardId[size - 1] = '\0';
+    } else if (!ProbeReadId("/proc/device-tree/serial-number", pBoardId, size) &&
+               !ProbeReadId("/proc/device-tree/model", pBoardId, size)) {
+        strncpy(pBoardId, "unknown", size - 1);
+        pBoardId[size - 1] = '\0';
+    }
+
+    /* one word in the cache file; device tree strings end in a NUL */
+    for (char *p = pBoardId; *p != '\0'; p++) {
+        pBoardId[n++] = isgraph((unsigned char)*p) ? *p : '_';
+    }
+    while (n > 0 && pBoardId[n - 1] == '_') {
+        n--;
+    }
+    pBoardId[n] = '\0';
+    if (n == 0) {
+        strncpy(pBoardId, "unknown", size - 1);
+        pBoardId[size - 1] = '\0';
+    }
+}
+
+RESULT SensorProbePort(int fd, uint32_t port, const SensorProbeSignature_t *pSignatures, uint32_t count,
+                       SensorProbeResult_t *pResult)
+{
+    char boardId[SENSOR_PROBE_BOARD_ID_LEN];
+    char cachedName[32];
+    uint32_t order[PROBE_MAX_SIGNATURES];
+    bool_t queued[PROBE_MAX_SIGNATURES] = { BOOL_FALSE };
+    uint32_t n = 0;
+    ProbeBus_t bus;
+    int32_t enable;
+    uint32_t clk = 0;
+
+    if (pSignatures == NULL || pResult == NULL) {
+        return (RET_NULL_POINTER);
+    }
+    if (count == 0 || count > PROBE_MAX_SIGNATURES) {
+        return (RET_OUTOFRANGE);
+    }
+    MEMSET(pResult, 0, sizeof(SensorProbeResult_t));
+
+    SensorProbeBoardId(boardId, sizeof(boardId));
+    (void)ProbeCacheLoad(boardId, port, NULL, cachedName, sizeof(cachedName));
+    for (uint32_t i = 0; i < count && cachedName[0] != '\0'; i++) {
+        if (strcmp(pSignatures[i].pSensorName, cachedName) == 0) {
+            TRACE(SENSOR_PROBE_INFO, "%s: port %u of %s: %s, cached\n", __func__, port, boardId, cachedName);
+            pResult->pSignature = &pSignatures[i];
+            pResult->cached     = BOOL_TRUE;
+            return (RET_SUCCESS);
+        }
+    }
+
+    /* signatures on the same address one after the other, first come first */
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t j = i; j < count && n < count; j++) {
+            if (!queued[j] && ProbeSameBus(&pSignatures[i], &pSignatures[j])) {
+                queued[j]  = BOOL_TRUE;
+                order[n++] = j;
+            }
+        }
+    }
+
+    enable = 1;
+    (void)ioctl(fd, VVSENSORIOC_S_POWER, &enable);
+    if (ioctl(fd, VVSENSORIOC_G_CLK, &clk) == 0) {
+        (void)ioctl(fd, VVSENSORIOC_S_CLK, &clk);
+    }
+
+    MEMSET(&bus, 0, sizeof(bus));
+    bus.fd = fd;
+    for (uint32_t i = 0; i < n && pResult->pSignature == NULL; i++) {
+        const SensorProbeSignature_t *pSig = &pSignatures[order[i]];
+
+        if (i == 0 || !ProbeSameBus(pSig, &pSignatures[order[i - 1]])) {
+            (void)ProbeSelect(&bus, pSig);
+        }
+        if (ProbeMatch(&bus, pSig)) {
+            pResult->pSignature = pSig;
+        }
+    }
+    pResult->reads = bus.reads;     /* the pass stopped on the match, its SCCB setting stays */
+
+    if (pResult->pSignature == NULL) {
+        TRACE(SENSOR_PROBE_ERROR, "%s: port %u: no known sensor after %u reads\n", __func__, port, bus.reads);
+        enable = 0;
+        (void)ioctl(fd, VVSENSORIOC_S_POWER, &enable);
+        return (RET_NOTAVAILABLE);
+    }
+
+    TRACE(SENSOR_PROBE_INFO, "%s: port %u of %s: %s after %u reads\n", __func__, port, boardId,
+          pResult->pSignature->pSensorName, bus.reads);
+    (void)ProbeCacheStore(boardId, port, pResult->pSignature->pSensorName);
+
+    return (RET_SUCCESS);
+}
+
+RESULT SensorProbeForget(uint32_t port)
+{
+    char boardId[SENSOR_PROBE_BOARD_ID_LEN];
+
+    SensorProbeBoardId(boardId, sizeof(boardId));
+    return ProbeCacheStore(boardId, port, NULL);
+}
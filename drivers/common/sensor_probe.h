@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_probe.h
+ *
+ * @brief Finding out which sensor sits on a port before loading a driver.
+ *
+ * Every driver's CheckSensorConnectionIss reads the chip ID of its own
+ * sensor, so an application loading the wrong .drv only learns so after
+ * power-up, and tries the next. The probe instead powers the port once and
+ * tries the chip ID signatures of all drivers in one pass over the bus:
+ * signatures sharing an SCCB address are read under one SCCB setting, a
+ * register is read once even if several signatures use it, and an address
+ * nobody answers on is given up after its first read.
+ *
+ * The answer is cached per port, keyed by the board ID, in the file named
+ * by SENSOR_PROBE_CACHE_ENV (SENSOR_PROBE_DEFAULT_CACHE if unset); later
+ * boots take the driver from the cache without touching the bus. Should
+ * the cached driver then fail its connection check (the camera module was
+ * swapped), SensorProbeForget() drops the entry and the next probe goes to
+ * the bus again. Updates of the cache are serialized by flock() on a
+ * "<cache>.lock" file next to it.
+ *
+ * The board ID is SENSOR_PROBE_BOARD_ENV if set, else the device tree
+ * serial number, else the device tree model.
+ *
+ * @defgroup sensor_probe
+ * @{
+ *
+ */
+#ifndef __SENSOR_PROBE_H__
+#define __SENSOR_PROBE_H__
+
+#include <stddef.h>
+#include <ebase/types.h>
+#include <common/return_codes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_PROBE_CACHE_ENV          "VI_SENSOR_PROBE_CACHE"
+#define SENSOR_PROBE_DEFAULT_CACHE      "/var/cache/vi-sensor-probe"
+#define SENSOR_PROBE_BOARD_ENV          "VI_BOARD_ID"
+#define SENSOR_PROBE_MAX_ID_REGS        3
+#define SENSOR_PROBE_BOARD_ID_LEN       64
+
+/**
+ * @brief How a driver recognizes its sensor.
+ */
+typedef struct SensorProbeSignature_s
+{
+    const char  *pSensorName;                       /**< as the driver calls itself */
+    const char  *pDriver;                           /**< file to load, e.g. "sc2310.drv" */
+    uint8_t     slaveAddr;                          /**< 7 bit SCCB address */
+    uint8_t     addrByte;
+    uint8_t     dataByte;
+    uint8_t     idRegCount;
+    uint16_t    idReg[SENSOR_PROBE_MAX_ID_REGS];    /**< most significant ID byte first */
+    uint32_t    chipId;
+} SensorProbeSignature_t;
+
+/**
+ * @brief The signatures of the drivers in this tree.
+ */
+extern const SensorProbeSignature_t SensorProbeKnown[];
+extern const uint32_t SensorProbeKnownCount;
+
+typedef struct SensorProbeResult_s
+{
+    const SensorProbeSignature_t    *pSignature;    /**< the sensor found, NULL if none */
+    bool_t                          cached;         /**< taken from the cache, the bus was not touched */
+    uint32_t                        reads;          /**< register reads spent */
+} SensorProbeResult_t;
+
+/**
+ * @brief The ID the cache is keyed by, "unknown" if the board has none.
+ */
+void SensorProbeBoardId(char *pBoardId, size_t size);
+
+/**
+ * @brief Find the sensor on a port.
+ *
+ * The port is powered and clocked for the probe and left so if a sensor
+ * answered, under the SCCB setting of its signature; if none did, it is
+ * powered off again.
+ *
+ * @param   fd          the port's sensor device
+ * @param   port        port number, the cache key besides the board ID
+ * @param   pSignatures signatures to try, in order, SensorProbeKnown for all
+ *                      at their default addresses
+ * @param   count       number of signatures, at most 16
+ * @param   pResult     what was found and how
+ *
+ * @return  RET_SUCCESS, RET_NOTAVAILABLE if no signature matched
+ */
+RESULT SensorProbePort(int fd, uint32_t port, const SensorProbeSignature_t *pSignatures, uint32_t count,
+                       SensorProbeResult_t *pResult);
+
+/**
+ * @brief Drop the cache entry of a port.
+ */
+RESULT SensorProbeForget(uint32_t port);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_probe */
+
+#endif    /* __SENSOR_PROBE_H__ */
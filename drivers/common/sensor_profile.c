@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include <string.h>
+#include "sensor_profile.h"
+
+CREATE_TRACER( SENSOR_PROFILE_INFO , "SENSOR_PROFILE: ", INFO,    0);
+CREATE_TRACER( SENSOR_PROFILE_ERROR, "SENSOR_PROFILE: ", ERROR,   1);
+
+#define PROFILE_STATE(generation, index)    (((generation) << 8) | (index))
+#define PROFILE_STATE_INDEX(state)          ((state) & 0xff)
+#define PROFILE_STATE_GENERATION(state)     ((state) >> 8)
+
+RESULT SensorProfileSetInit(SensorProfileSet_t *pSet, const SensorBundle_t *pBundle)
+{
+    const void *pData = NULL;
+    uint32_t size = 0;
+    RESULT result;
+
+    if (pSet == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    MEMSET(pSet, 0, sizeof(SensorProfileSet_t));
+
+    result = SensorBundleGetSection(pBundle, SENSOR_BUNDLE_SECTION_3A_CONFIG, &pData, &size);
+    if (result != RET_SUCCESS) {
+        return (result);
+    }
+
+    /* the json is scanned with str functions, it must end inside the section */
+    if (size == 0 || ((const char *)pData)[size - 1] != '\0') {
+        TRACE(SENSOR_PROFILE_ERROR, "%s: 3A config not NUL terminated\n", __func__);
+        return (RET_INVALID_PARM);
+    }
+
+    pSet->profile[0].pName = SENSOR_PROFILE_DEFAULT;
+    pSet->profile[0].pJson = (const char *)pData;
+    pSet->profile[0].size  = size;
+    pSet->count = 1;
+
+    for (uint32_t n = 0; pSet->count < SENSOR_PROFILE_MAX; n++) {
+        const SensorProfileSectionHeader_t *pHeader;
+
+        if (SensorBundleGetSectionAt(pBundle, SENSOR_BUNDLE_SECTION_3A_PROFILE, n, &pData, &size) != RET_SUCCESS) {
+            break;
+        }
+
+        pHeader = (const SensorProfileSectionHeader_t *)pData;
+        if (size <= sizeof(SensorProfileSectionHeader_t) ||
+            memchr(pHeader->name, '\0', sizeof(pHeader->name)) == NULL ||
+            ((const char *)pData)[size - 1] != '\0') {
+            TRACE(SENSOR_PROFILE_ERROR, "%s: skipping malformed profile %u\n", __func__, n);
+            continue;
+        }
+
+        pSet->profile[pSet->count].pName = pHeader->name;
+        pSet->profile[pSet->count].pJson = (const char *)(pHeader + 1);
+        pSet->profile[pSet->count].size  = size - sizeof(SensorProfileSectionHeader_t);
+        pSet->count++;
+    }
+
+    TRACE(SENSOR_PROFILE_INFO, "%s: %u profiles\n", __func__, pSet->count);
+    return (RET_SUCCESS);
+}
+
+int32_t SensorProfileFind(const SensorProfileSet_t *pSet, const char *pName)
+{
+    if (pSet == NULL || pName == NULL) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < pSet->count; i++) {
+        if (strcmp(pSet->profile[i].pName, pName) == 0) {
+            return (int32_t)i;
+        }
+    }
+
+    return -1;
+}
+
+RESULT SensorProfileRequest(SensorProfileSet_t *pSet, uint32_t index)
+{
+    if (pSet == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (index >= pSet->count) {
+        return (RET_OUTOFRANGE);
+    }
+
+    __atomic_store_n(&pSet->pending, index, __ATOMIC_RELEASE);
+    return (RET_SUCCESS);
+}
+
+bool_t SensorProfileFrameBoundary(SensorProfileSet_t *pSet, const SensorTuningProfile_t **ppProfile)
+{
+    uint32_t state = __atomic_load_n(&pSet->state, __ATOMIC_ACQUIRE);
+    uint32_t pending = __atomic_load_n(&pSet->pending, __ATOMIC_ACQUIRE);
+    bool_t changed = BOOL_FALSE;
+
+    if (pending != PROFILE_STATE_INDEX(state)) {
+        state = PROFILE_STATE(PROFILE_STATE_GENERATION(state) + 1, pending);
+        __atomic_store_n(&pSet->state, state, __ATOMIC_RELEASE);
+        changed = BOOL_TRUE;
+        TRACE(SENSOR_PROFILE_INFO, "%s: switched to %s\n", __func__, pSet->profile[pending].pName);
+    }
+
+    if (ppProfile != NULL) {
+        *ppProfile = &pSet->profile[PROFILE_STATE_INDEX(state)];
+    }
+
+    return changed;
+}
+
+RESULT SensorProfileGetActive(const SensorProfileSet_t *pSet,
+                              const SensorTuningProfile_t **ppProfile, uint32_t *pGeneration)
+{
+    uint32_t state;
+
+    if (pSet == NULL || ppProfile == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    if (pSet->count == 0) {
+        return (RET_WRONG_STATE);
+    }
+
+    state = __atomic_load_n(&pSet->state, __ATOMIC_ACQUIRE);
+    *ppProfile = &pSet->profile[PROFILE_STATE_INDEX(state)];
+    if (pGeneration != NULL) {
+        *pGeneration = PROFILE_STATE_GENERATION(state);
+    }
+
+    return (RET_SUCCESS);
+}
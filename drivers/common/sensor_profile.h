@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_profile.h
+ *
+ * @brief Runtime switchable 3A tuning profiles (day/night, indoor/outdoor).
+ *
+ * All profiles of a mode are preloaded from its bundle: profile 0 is the
+ * mode's 3aconfig ("default"), further ones come from 3A_PROFILE sections.
+ * The build supplies both: the 3aconfig json given to sensor_add_bundle()
+ * in the driver's CMakeLists.txt becomes "default", each PROFILE <name>
+ * <json> after it one more profile (see common/SensorBundle.cmake). A
+ * driver that finds no bundle in the config path and runs from the
+ * register file alone has no profiles, and so no gain split limits
+ * (sensor_gain_split.h) either.
+ * Any thread may request a profile at any time; the request is only latched
+ * by SensorProfileFrameBoundary(), which the 3A loop calls once per frame,
+ * so a frame never sees a half switched configuration. The profile data
+ * stays mapped, switching copies nothing.
+ *
+ * @defgroup sensor_profile
+ * @{
+ *
+ */
+#ifndef __SENSOR_PROFILE_H__
+#define __SENSOR_PROFILE_H__
+
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include "sensor_bundle.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_PROFILE_MAX          8
+#define SENSOR_PROFILE_NAME_LEN     32
+#define SENSOR_PROFILE_DEFAULT      "default"
+
+/**
+ * @brief On-disk 3A_PROFILE section header, followed by the json text.
+ */
+typedef struct SensorProfileSectionHeader_s
+{
+    char        name[SENSOR_PROFILE_NAME_LEN];
+} SensorProfileSectionHeader_t;
+
+typedef struct SensorTuningProfile_s
+{
+    const char  *pName;
+    const char  *pJson;                 /**< NUL terminated 3aconfig json */
+    uint32_t    size;
+} SensorTuningProfile_t;
+
+typedef struct SensorProfileSet_s
+{
+    SensorTuningProfile_t   profile[SENSOR_PROFILE_MAX];
+    uint32_t                count;
+
+    uint32_t                state;      /**< generation << 8 | profile in force, read and written atomically */
+    uint32_t                pending;    /**< requested profile, latched at the next frame boundary */
+} SensorProfileSet_t;
+
+/**
+ * @brief Preload all profiles of a bundle, "default" is made active.
+ *
+ * @return  RET_INVALID_PARM if the 3aconfig is not NUL terminated; profiles
+ *          that are not are skipped
+ */
+RESULT SensorProfileSetInit(SensorProfileSet_t *pSet, const SensorBundle_t *pBundle);
+
+/**
+ * @brief Look up a profile index by name.
+ *
+ * @return  index, or -1 if there is no such profile
+ */
+int32_t SensorProfileFind(const SensorProfileSet_t *pSet, const char *pName);
+
+/**
+ * @brief Request a switch, safe to call from any thread. The last request
+ *        before a frame boundary wins.
+ */
+RESULT SensorProfileRequest(SensorProfileSet_t *pSet, uint32_t index);
+
+/**
+ * @brief Latch a pending request. Call once per frame from the 3A thread,
+ *        before the frame's parameters are evaluated.
+ *
+ * @param   ppProfile       receives the profile in force for this frame
+ *
+ * @return  BOOL_TRUE if the profile changed at this boundary
+ */
+bool_t SensorProfileFrameBoundary(SensorProfileSet_t *pSet, const SensorTuningProfile_t **ppProfile);
+
+/**
+ * @brief Read the profile in force and its generation without latching.
+ */
+RESULT SensorProfileGetActive(const SensorProfileSet_t *pSet,
+                              const SensorTuningProfile_t **ppProfile, uint32_t *pGeneration);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_profile */
+
+#endif    /* __SENSOR_PROFILE_H__ */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/syscall.h>
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include "sensor_trace.h"
+
+CREATE_TRACER( SENSOR_TRACE_INFO , "SENSOR_TRACE: ", INFO,    0);
+CREATE_TRACER( SENSOR_TRACE_ERROR, "SENSOR_TRACE: ", ERROR,   1);
+
+static pthread_once_t TraceOnce = PTHREAD_ONCE_INIT;
+static int TraceFd = -1;
+
+static uint64_t TraceNowUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* the process_name event the file starts with, followed by nothing but events */
+static int TraceHeader(char *pBuf, size_t size, int pid)
+{
+    return snprintf(pBuf, size, "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                    "\"args\":{\"name\":\"sensor startup\"}}", pid);
+}
+
+static void TraceOpen(void)
+{
+    const char *pPath = getenv(SENSOR_TRACE_ENV);
+    char header[128], found[128];
+    int fd, length;
+    ssize_t got;
+
+    if (pPath == NULL || pPath[0] == '\0') {
+        return;
+    }
+
+    /* every driver links a copy of this file and opens the trace of its
+       own; the first one in the process starts the file over, the others
+       find its header and append */
+    fd = open(pPath, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        TRACE(SENSOR_TRACE_ERROR, "%s: can't write %s\n", __func__, pPath);
+        return;
+    }
+
+    length = TraceHeader(header, sizeof(header), (int)getpid());
+    (void)flock(fd, LOCK_EX);
+    got = pread(fd, found, (size_t)length, 0);
+    if (got != length || memcmp(found, header, (size_t)length) != 0) {
+        if (ftruncate(fd, 0) != 0 || write(fd, header, (size_t)length) != length) {
+            TRACE(SENSOR_TRACE_ERROR, "%s: can't write %s\n", __func__, pPath);
+            (void)flock(fd, LOCK_UN);
+            close(fd);
+            return;
+        }
+    }
+    (void)flock(fd, LOCK_UN);
+
+    TraceFd = fd;
+    TRACE(SENSOR_TRACE_INFO, "%s: tracing to %s\n", __func__, pPath);
+}
+
+uint64_t SensorTraceBegin(void)
+{
+    pthread_once(&TraceOnce, TraceOpen);
+
+    return (TraceFd >= 0) ? TraceNowUs() : 0;
+}
+
+void SensorTraceEnd(const char *pSensor, const char *pPhase, uint64_t startUs)
+{
+    char event[256];
+    uint64_t endUs;
+    int length;
+
+    if (startUs == 0) {
+        return;
+    }
+    endUs = TraceNowUs();
+
+    /* one write per event, so events of several drivers never interleave */
+    length = snprintf(event, sizeof(event),
+                      ",\n{\"name\":\"%s%s%s\",\"cat\":\"sensor\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,"
+                      "\"pid\":%d,\"tid\":%ld}",
+                      (pSensor != NULL) ? pSensor : "", (pSensor != NULL) ? " " : "", pPhase,
+                      (unsigned long long)startUs, (unsigned long long)(endUs - startUs),
+                      (int)getpid(), (long)syscall(SYS_gettid));
+    if (length <= 0 || (size_t)length >= sizeof(event)) {
+        TRACE(SENSOR_TRACE_ERROR, "%s: %s event too long\n", __func__, pPhase);
+        return;
+    }
+    (void)write(TraceFd, event, (size_t)length);
+}
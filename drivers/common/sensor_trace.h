@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_trace.h
+ *
+ * @brief Startup timeline of the sensor drivers as a Chrome trace.
+ *
+ * The drivers put timestamped spans around the phases of create (power,
+ * clock, reset, SCCB), init (register set load and write), setup and
+ * streaming. With SENSOR_TRACE_ENV naming a file, the spans are written
+ * there in the Chrome trace event format, to be opened in chrome://tracing
+ * or ui.perfetto.dev; every thread shows as a lane of its own, so sensors
+ * brought up in parallel line up next to each other.
+ *
+ * Unset, a span costs a check of a flag. Set, every span is one line,
+ * appended with a single write, so the drivers of one process share the
+ * file and a crashed process leaves a readable trace too. The event array
+ * is never closed, as no driver knows it is the last one; the viewers
+ * accept it without its closing bracket.
+ *
+ * @defgroup sensor_trace
+ * @{
+ *
+ */
+#ifndef __SENSOR_TRACE_H__
+#define __SENSOR_TRACE_H__
+
+#include <ebase/types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_TRACE_ENV            "VI_SENSOR_TRACE"      /**< path of the trace file */
+
+/**
+ * @brief Start a span.
+ *
+ * @return  CLOCK_MONOTONIC timestamp in us, 0 if tracing is off
+ */
+uint64_t SensorTraceBegin(void);
+
+/**
+ * @brief Close a span and write it out, nothing if it was begun with
+ *        tracing off.
+ *
+ * @param   pSensor     sensor name, may be NULL
+ * @param   pPhase      what the span covers, e.g. "power"
+ * @param   startUs     from SensorTraceBegin()
+ */
+void SensorTraceEnd(const char *pSensor, const char *pPhase, uint64_t startUs);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_trace */
+
+#endif    /* __SENSOR_TRACE_H__ */
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <ebase/types.h>
+#include <ebase/trace.h>
+#include <ebase/builtins.h>
+#include <common/return_codes.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sensor_warm.h"
+
+CREATE_TRACER( SENSOR_WARM_INFO , "SENSOR_WARM: ", INFO,    0);
+CREATE_TRACER( SENSOR_WARM_ERROR, "SENSOR_WARM: ", ERROR,   1);
+
+static bool_t WarmIsVolatile(const SensorWarmOps_t *pOps, uint32_t addr)
+{
+    for (uint32_t i = 0; i < pOps->volatileCount; i++) {
+        if (pOps->pVolatile[i] == addr) {
+            return BOOL_TRUE;
+        }
+    }
+
+    return BOOL_FALSE;
+}
+
+/* the last SENSOR_WARM_SIGNATURES distinct registers the set leaves alone afterwards */
+static uint32_t WarmPickSignature(const SensorWarmOps_t *pOps, const struct vvcam_sccb_array *pArry,
+                                  SensorWarmReg_t *pSig, uint32_t *pLastPage)
+{
+    uint32_t page = 0;
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < pArry->count; i++) {
+        uint32_t addr = pArry->sccb_data[i].addr;
+
+        if (pOps->pageReg != SENSOR_WARM_NO_PAGE && addr == pOps->pageReg) {
+            page = pArry->sccb_data[i].data;
+            continue;
+        }
+        if (WarmIsVolatile(pOps, addr)) {
+            continue;
+        }
+
+        /* a register written again counts with its last write */
+        for (uint32_t j = 0; j < count; j++) {
+            if (pSig[j].page == page && pSig[j].addr == addr) {
+                memmove(&pSig[j], &pSig[j + 1], (count - j - 1) * sizeof(SensorWarmReg_t));
+                count--;
+                break;
+            }
+        }
+        if (count == SENSOR_WARM_SIGNATURES) {
+            memmove(&pSig[0], &pSig[1], (count - 1) * sizeof(SensorWarmReg_t));
+            count--;
+        }
+        pSig[count].page  = page;
+        pSig[count].addr  = addr;
+        pSig[count].value = pArry->sccb_data[i].data;
+        count++;
+    }
+
+    *pLastPage = page;
+    return count;
+}
+
+/* the record directory, created private if missing; -1 unless it is ours alone */
+static int WarmOpenDir(const char *pDir)
+{
+    struct stat st;
+    int fd;
+
+    if (mkdir(pDir, 0700) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    fd = open(pDir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != geteuid() ||
+        (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+        TRACE(SENSOR_WARM_ERROR, "%s: %s is not a private directory\n", __func__, pDir);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static RESULT WarmReadSignature(const SensorWarm_t *pWarm, const SensorWarmReg_t *pSig, uint32_t *pValue)
+{
+    const SensorWarmOps_t *pOps = pWarm->pOps;
+    RESULT result;
+
+    if (pOps->pageReg != SENSOR_WARM_NO_PAGE) {
+        result = pOps->write(pWarm->handle, pOps->pageReg, pSig->page);
+        if (result != RET_SUCCESS) {
+            return (result);
+        }
+    }
+
+    return pOps->read(pWarm->handle, pSig->addr, pValue);
+}
+
+static void WarmRestorePage(const SensorWarm_t *pWarm, uint32_t page)
+{
+    if (pWarm->pOps->pageReg != SENSOR_WARM_NO_PAGE) {
+        (void)pWarm->pOps->write(pWarm->handle, pWarm->pOps->pageReg, page);
+    }
+}
+
+RESULT SensorWarmOpen(SensorWarm_t *pWarm, const char *pSensorName, int sensorFd,
+                      const SensorWarmOps_t *pOps, IsiSensorHandle_t handle)
+{
+    const char *pDir = getenv(SENSOR_WARM_DIR_ENV);
+    char name[128];
+    struct stat st;
+    void *pMap;
+    int dirFd, fd;
+
+    if (pWarm == NULL || pSensorName == NULL || pOps == NULL || pOps->read == NULL) {
+        return (RET_NULL_POINTER);
+    }
+    if (pOps->pageReg != SENSOR_WARM_NO_PAGE && pOps->write == NULL) {
+        return (RET_NULL_POINTER);
+    }
+
+    SensorWarmClose(pWarm, BOOL_FALSE);
+
+    if (fstat(sensorFd, &st) != 0) {
+        return (RET_FAILURE);
+    }
+    if (pDir == NULL || pDir[0] == '\0') {
+        pDir = SENSOR_WARM_DEFAULT_DIR;
+    }
+    /* one record per sensor device node, two of a kind on different ports don't share */
+    snprintf(name, sizeof(name), "vi-sensor-%s-%u-%u.warm", pSensorName,
+             major(st.st_rdev), minor(st.st_rdev));
+
+    /* a record lets create skip the reset: only one this user wrote in a directory nobody else can */
+    dirFd = WarmOpenDir(pDir);
+    if (dirFd < 0) {
+        TRACE(SENSOR_WARM_INFO, "%s: no record directory %s\n", __func__, pDir);
+        return (RET_FAILURE);
+    }
+    fd = openat(dirFd, name, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    close(dirFd);
+    if (fd < 0) {
+        TRACE(SENSOR_WARM_INFO, "%s: no record at %s/%s\n", __func__, pDir, name);
+        return (RET_FAILURE);
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_uid != geteuid() || st.st_nlink != 1 ||
+        (st.st_mode & (S_IRWXG | S_IRWXO)) != 0) {
+        TRACE(SENSOR_WARM_ERROR, "%s: %s/%s is not a private file, ignored\n", __func__, pDir, name);
+        close(fd);
+        return (RET_FAILURE);
+    }
+    if ((size_t)st.st_size < sizeof(SensorWarmRecord_t) && ftruncate(fd, sizeof(SensorWarmRecord_t)) != 0) {
+        close(fd);
+        return (RET_FAILURE);
+    }
+
+    pMap = mmap(NULL, sizeof(SensorWarmRecord_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pMap == MAP_FAILED) {
+        TRACE(SENSOR_WARM_ERROR, "%s: mmap %s/%s failed\n", __func__, pDir, name);
+        close(fd);
+        return (RET_FAILURE);
+    }
+
+    pWarm->fd      = fd;
+    pWarm->pRecord = (SensorWarmRecord_t *)pMap;
+    pWarm->pOps    = pOps;
+    pWarm->handle  = handle;
+    pWarm->resumed = BOOL_FALSE;
+
+    if (pWarm->pRecord->magic != SENSOR_WARM_MAGIC || pWarm->pRecord->version != SENSOR_WARM_VERSION) {
+        MEMSET(pWarm->pRecord, 0, sizeof(SensorWarmRecord_t));
+        pWarm->pRecord->magic   = SENSOR_WARM_MAGIC;
+        pWarm->pRecord->version = SENSOR_WARM_VERSION;
+    }
+
+    return (RET_SUCCESS);
+}
+
+RESULT SensorWarmProbe(SensorWarm_t *pWarm, uint32_t modeIndex)
+{
+    const SensorWarmRecord_t *pRecord = pWarm->pRecord;
+    uint32_t value;
+    uint32_t i;
+
+    pWarm->resumed = BOOL_FALSE;
+    if (pRecord == NULL) {
+        return (RET_NOTAVAILABLE);
+    }
+    if (!__atomic_load_n(&pRecord->valid, __ATOMIC_ACQUIRE) ||
+        pRecord->modeIndex != modeIndex || pRecord->sigCount == 0 ||
+        pRecord->sigCount > SENSOR_WARM_SIGNATURES) {
+        SensorWarmInvalidate(pWarm);
+        return (RET_NOTAVAILABLE);
+    }
+
+    for (i = 0; i < pRecord->sigCount; i++) {
+        if (WarmReadSignature(pWarm, &pRecord->sig[i], &value) != RET_SUCCESS ||
+            value != pRecord->sig[i].value) {
+            break;
+        }
+    }
+    WarmRestorePage(pWarm, pRecord->lastPage);
+
+    if (i < pRecord->sigCount) {
+        TRACE(SENSOR_WARM_INFO, "%s: register 0x%x differs, cold start\n", __func__, pRecord->sig[i].addr);
+        SensorWarmInvalidate(pWarm);
+        return (RET_NOTAVAILABLE);
+    }
+
+    TRACE(SENSOR_WARM_INFO, "%s: sensor holds mode %u\n", __func__, modeIndex);
+    pWarm->resumed = BOOL_TRUE;
+    return (RET_SUCCESS);
+}
+
+bool_t SensorWarmResume(SensorWarm_t *pWarm, uint64_t regHash)
+{
+    if (!pWarm->resumed) {
+        return BOOL_FALSE;
+    }
+    if (pWarm->pRecord->regHash != regHash) {
+        TRACE(SENSOR_WARM_INFO, "%s: register set changed, cold start\n", __func__);
+        SensorWarmInvalidate(pWarm);
+        return BOOL_FALSE;
+    }
+
+    return BOOL_TRUE;
+}
+
+RESULT SensorWarmCommit(SensorWarm_t *pWarm, uint32_t modeIndex, uint64_t regHash,
+                        const struct vvcam_sccb_array *pArry)
+{
+    SensorWarmRecord_t *pRecord = pWarm->pRecord;
+    SensorWarmReg_t sig[SENSOR_WARM_SIGNATURES];
+    uint32_t lastPage = 0;
+    uint32_t count;
+    RESULT result = RET_SUCCESS;
+
+    if (pRecord == NULL) {
+        return (RET_NOTAVAILABLE);
+    }
+    SensorWarmInvalidate(pWarm);
+
+    count = WarmPickSignature(pWarm->pOps, pArry, sig, &lastPage);
+    if (count == 0) {
+        return (RET_NOTAVAILABLE);
+    }
+
+    /* what the sensor reads back, not what was written: some bits read differently */
+    for (uint32_t i = 0; i < count && result == RET_SUCCESS; i++) {
+        result = WarmReadSignature(pWarm, &sig[i], &sig[i].value);
+    }
+    WarmRestorePage(pWarm, lastPage);
+    if (result != RET_SUCCESS) {
+        return (result);
+    }
+
+    pRecord->modeIndex     = modeIndex;
+    pRecord->regHash       = regHash;
+    pRecord->lastPage      = lastPage;
+    pRecord->sigCount      = count;
+    memcpy(pRecord->sig, sig, sizeof(sig));
+    pRecord->exposureValid = 0;
+    __atomic_store_n(&pRecord->valid, 1, __ATOMIC_RELEASE);
+
+    return (RET_SUCCESS);
+}
+
+bool_t SensorWarmLastExposure(const SensorWarm_t *pWarm, float *pGain, float *pIntegrationTime, float *pHdrRatio)
+{
+    const SensorWarmRecord_t *pRecord = pWarm->pRecord;
+
+    if (pRecord == NULL || !pRecord->valid || !pRecord->exposureValid) {
+        return BOOL_FALSE;
+    }
+
+    *pGain            = pRecord->gain;
+    *pIntegrationTime = pRecord->integrationTime;
+    *pHdrRatio        = pRecord->hdrRatio;
+    return BOOL_TRUE;
+}
+
+void SensorWarmNoteExposure(SensorWarm_t *pWarm, float gain, float integrationTime, float hdrRatio)
+{
+    SensorWarmRecord_t *pRecord = pWarm->pRecord;
+
+    if (pRecord == NULL) {
+        return;
+    }
+
+    pRecord->gain            = gain;
+    pRecord->integrationTime = integrationTime;
+    pRecord->hdrRatio        = hdrRatio;
+    pRecord->exposureValid   = 1;
+}
+
+void SensorWarmInvalidate(SensorWarm_t *pWarm)
+{
+    pWarm->resumed = BOOL_FALSE;
+    if (pWarm->pRecord != NULL) {
+        __atomic_store_n(&pWarm->pRecord->valid, 0, __ATOMIC_RELEASE);
+    }
+}
+
+void SensorWarmClose(SensorWarm_t *pWarm, bool_t poweredOff)
+{
+    if (pWarm->pRecord == NULL) {
+        return;
+    }
+
+    if (poweredOff) {
+        SensorWarmInvalidate(pWarm);
+    }
+    munmap(pWarm->pRecord, sizeof(SensorWarmRecord_t));
+    close(pWarm->fd);
+    MEMSET(pWarm, 0, sizeof(SensorWarm_t));
+}
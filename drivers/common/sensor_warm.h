@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_warm.h
+ *
+ * @brief Warm restart of a sensor that still holds its mode.
+ *
+ * When the camera process restarts while the sensor stays powered, the
+ * sensor keeps every register of the mode it was set up for, and the
+ * reset plus the full register set at the next create and init are
+ * wasted time. A small record per sensor outlives the process: the mode
+ * index, a hash of the mode's register set, a few signature registers
+ * read back after init and the last exposure. It is mapped shared from a
+ * file, so the exposure is noted with plain stores and survives a crash.
+ *
+ * At create, after the chip ID checked out, a driver compares the
+ * signature registers with the record. If they match, it skips the reset,
+ * and init skips the register set as long as its hash is unchanged, then
+ * restores the last exposure. Anything else falls back to the cold path.
+ * A clean release powers the sensor off and invalidates the record.
+ *
+ * Registers the driver writes at runtime (exposure, gain, VTS, streaming)
+ * are listed as volatile and never taken as signatures. For sensors with
+ * paged register maps the page register is given, signatures remember
+ * their page.
+ *
+ * The record lives in SENSOR_WARM_DIR_ENV, SENSOR_WARM_DEFAULT_DIR if
+ * unset, one file per sensor name and device node. A tmpfs is the right
+ * place: a reboot power-cycles the sensor and should forget the record.
+ * Since a record lets create skip the reset and init, it is only trusted
+ * in a directory owned by the process's user and writable by nobody else,
+ * as a regular file of that user with one link. A missing directory is
+ * created so.
+ *
+ * @defgroup sensor_warm
+ * @{
+ *
+ */
+#ifndef __SENSOR_WARM_H__
+#define __SENSOR_WARM_H__
+
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include <isi/isi_common.h>
+#include <vvsensor.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_WARM_DIR_ENV         "VI_SENSOR_STATE_DIR"
+#define SENSOR_WARM_DEFAULT_DIR     "/run/vi-sensor"
+#define SENSOR_WARM_MAGIC           0x4d524157U     /* "WARM" */
+#define SENSOR_WARM_VERSION         1U
+#define SENSOR_WARM_SIGNATURES      4               /**< signature registers per record */
+#define SENSOR_WARM_NO_PAGE         0xffffffffU     /**< flat register map */
+
+typedef RESULT (*SensorWarmRegRead_t)(IsiSensorHandle_t handle, const uint32_t address, uint32_t *pValue);
+typedef RESULT (*SensorWarmRegWrite_t)(IsiSensorHandle_t handle, const uint32_t address, const uint32_t value);
+
+/**
+ * @brief A driver's register access and register map, static per driver.
+ */
+typedef struct SensorWarmOps_s
+{
+    SensorWarmRegRead_t     read;
+    SensorWarmRegWrite_t    write;
+    uint32_t                pageReg;        /**< page select register or SENSOR_WARM_NO_PAGE */
+    const uint32_t          *pVolatile;     /**< registers written at runtime */
+    uint32_t                volatileCount;
+} SensorWarmOps_t;
+
+typedef struct SensorWarmReg_s
+{
+    uint32_t    page;
+    uint32_t    addr;
+    uint32_t    value;                      /**< as read back after init */
+} SensorWarmReg_t;
+
+/**
+ * @brief The persisted record, shared mapped.
+ */
+typedef struct SensorWarmRecord_s
+{
+    uint32_t        magic;
+    uint32_t        version;
+    uint32_t        valid;                  /**< set after init wrote the mode, cleared before a reset */
+    uint32_t        modeIndex;
+    uint64_t        regHash;                /**< FNV-1a 64 of the mode's register set */
+    uint32_t        lastPage;               /**< page the register set ends on */
+    uint32_t        sigCount;
+    SensorWarmReg_t sig[SENSOR_WARM_SIGNATURES];
+
+    float           gain;                   /**< last exposure */
+    float           integrationTime;
+    float           hdrRatio;
+    uint32_t        exposureValid;
+} SensorWarmRecord_t;
+
+typedef struct SensorWarm_s
+{
+    int                     fd;
+    SensorWarmRecord_t      *pRecord;       /**< NULL if not opened */
+    const SensorWarmOps_t   *pOps;
+    IsiSensorHandle_t       handle;
+    bool_t                  resumed;        /**< create found the sensor holding the mode */
+} SensorWarm_t;
+
+/**
+ * @brief Map the record of the sensor behind sensorFd, create it if missing.
+ *
+ * @return  RET_SUCCESS, RET_FAILURE if the file can't be had; the driver
+ *          then runs cold as before
+ */
+RESULT SensorWarmOpen(SensorWarm_t *pWarm, const char *pSensorName, int sensorFd,
+                      const SensorWarmOps_t *pOps, IsiSensorHandle_t handle);
+
+/**
+ * @brief Compare the record with the sensor, after its chip ID checked out.
+ *
+ * @return  RET_SUCCESS and resumed set if the sensor holds modeIndex,
+ *          RET_NOTAVAILABLE otherwise, the record is invalidated then
+ */
+RESULT SensorWarmProbe(SensorWarm_t *pWarm, uint32_t modeIndex);
+
+/**
+ * @brief At init: may the register set be skipped?
+ *
+ * FALSE if the create was cold or the register set changed since the
+ * record was taken; in the latter case the driver resets the sensor first.
+ */
+bool_t SensorWarmResume(SensorWarm_t *pWarm, uint64_t regHash);
+
+/**
+ * @brief After the register set was written, pick and read back the
+ *        signature registers and validate the record.
+ */
+RESULT SensorWarmCommit(SensorWarm_t *pWarm, uint32_t modeIndex, uint64_t regHash,
+                        const struct vvcam_sccb_array *pArry);
+
+/**
+ * @brief The last exposure to restore, FALSE if none was noted.
+ */
+bool_t SensorWarmLastExposure(const SensorWarm_t *pWarm, float *pGain, float *pIntegrationTime, float *pHdrRatio);
+
+/**
+ * @brief Note the exposure set, a few plain stores.
+ */
+void SensorWarmNoteExposure(SensorWarm_t *pWarm, float gain, float integrationTime, float hdrRatio);
+
+/**
+ * @brief The registers no longer hold what the record says.
+ */
+void SensorWarmInvalidate(SensorWarm_t *pWarm);
+
+/**
+ * @brief Unmap the record; invalidate it first if the sensor is powered off.
+ */
+void SensorWarmClose(SensorWarm_t *pWarm, bool_t poweredOff);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_warm */
+
+#endif    /* __SENSOR_WARM_H__ */
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include "sensor_mock.h"
+#include "../GC02M1B/GC02M1B.c"
+
+/* the codes GC02M1B_IsiSetGainIss wrote before the lookup table */
+static void Gc02m1bOldGainCodes(float NewGain, uint32_t *pAgain, uint32_t *pDgain)
+{
+    int Analog_Index;
+    uint32_t SensorGain = NewGain * 64;
+
+    if (SensorGain < 64) {
+        SensorGain = 64;
+    }
+
+    /* the old scan read one past the table for 16x, taken as no limit here */
+    for (Analog_Index = 0; Analog_Index < 16; Analog_Index++) {
+        if ((gainLevelTable[Analog_Index] <= SensorGain) && (SensorGain < gainLevelTable[Analog_Index + 1]))
+            break;
+    }
+
+    *pAgain = Analog_Index;
+    *pDgain = SensorGain * 1024 / gainLevelTable[Analog_Index];
+}
+
+static GC02M1B_Context_t *Gc02m1bCreate(SensorMock_t *pMock, uint32_t modeIndex)
+{
+    static IsiSensor_t sensor;
+    IsiSensorInstanceConfig_t config;
+
+    (void)GC02M1B_IsiGetSensorIss(&sensor);
+    MEMSET(&config, 0, sizeof(config));
+    config.HalHandle       = &pMock->hal;
+    config.pSensor         = &sensor;
+    config.SensorModeIndex = modeIndex;
+
+    if (GC02M1B_IsiCreateSensorIss(&config) != RET_SUCCESS) {
+        return NULL;
+    }
+
+    return (GC02M1B_Context_t *)config.hSensor;
+}
+
+/* every 1/256 gain step from 1x to 16x */
+static void TestGainLut(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(0xfe);
+    GC02M1B_Context_t *pCtx = Gc02m1bCreate(pMock, 0);
+    uint32_t again, dgain;
+    float setGain, hdrRatio = 1.0f;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    for (uint32_t gain = SENSOR_GAIN_LUT_ONE; gain <= 16 * SENSOR_GAIN_LUT_ONE; gain++) {
+        float newGain = (float)gain / SENSOR_GAIN_LUT_ONE;
+
+        SENSOR_MOCK_CHECK(GC02M1B_IsiSetGainIss(pCtx, newGain, &setGain, &hdrRatio) == RET_SUCCESS);
+        Gc02m1bOldGainCodes(newGain, &again, &dgain);
+
+        SENSOR_MOCK_CHECK(SensorMockReg(pMock, 0xb6) == again);
+        SENSOR_MOCK_CHECK(SensorMockReg(pMock, 0xb1) == (dgain >> 8));
+        SENSOR_MOCK_CHECK(SensorMockReg(pMock, 0xb2) == (dgain & 0xff));
+        SENSOR_MOCK_CHECK(setGain == (float)(gainLevelTable[again] * dgain / 256) / SENSOR_GAIN_LUT_ONE);
+    }
+
+    (void)GC02M1B_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+int main(void)
+{
+    TestGainLut();
+
+    if (SensorMockFailures != 0) {
+        fprintf(stderr, "gc02m1b_test: %u checks failed\n", SensorMockFailures);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,454 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <pthread.h>
+#include "sensor_mock.h"
+#include "../GC5035/GC5035.c"
+
+/* the codes GC5035_IsiSetGainIss wrote before the lookup table */
+static void Gc5035OldGainCodes(uint32_t sensorGain, uint32_t dgainRatio, uint32_t *pAgain, uint32_t *pAgc,
+                               uint32_t *pDgain)
+{
+    int gain_index;
+
+    for (gain_index = 16; gain_index > 0; gain_index--) {
+        if (sensorGain >= GC5035_AGC_Param[gain_index][0])
+            break;
+    }
+
+    *pAgain = GC5035_AGC_Param[gain_index][1];
+    *pAgc   = GC5035_AGC_Param[gain_index][0];
+    *pDgain = sensorGain * dgainRatio / GC5035_AGC_Param[gain_index][0];
+}
+
+static uint32_t Gc5035AgcOf(uint32_t again)
+{
+    for (uint32_t i = 0; i < 17; i++) {
+        if (GC5035_AGC_Param[i][1] == again) {
+            return GC5035_AGC_Param[i][0];
+        }
+    }
+
+    return 0;
+}
+
+static GC5035_Context_t *Gc5035Create(SensorMock_t *pMock, uint32_t modeIndex)
+{
+    static IsiSensor_t sensor;
+    IsiSensorInstanceConfig_t config;
+
+    (void)GC5035_IsiGetSensorIss(&sensor);
+    MEMSET(&config, 0, sizeof(config));
+    config.HalHandle       = &pMock->hal;
+    config.pSensor         = &sensor;
+    config.SensorModeIndex = modeIndex;
+
+    if (GC5035_IsiCreateSensorIss(&config) != RET_SUCCESS) {
+        return NULL;
+    }
+
+    return (GC5035_Context_t *)config.hSensor;
+}
+
+/* Create leaves the kernel driver in charge when it finds no register file
+   in the config path; the tests run from the drivers directory instead */
+static GC5035_Context_t *Gc5035Open(SensorMock_t *pMock, uint32_t modeIndex, const char *pRegFile)
+{
+    GC5035_Context_t *pCtx = Gc5035Create(pMock, modeIndex);
+
+    if (pCtx == NULL) {
+        return NULL;
+    }
+
+    pCtx->KernelDriverFlag = 0;
+    MEMCPY(&pCtx->SensorMode, &pgc5035_mode_info[modeIndex], sizeof(struct vvcam_mode_info));
+    snprintf(pCtx->SensorRegCfgFile, sizeof(pCtx->SensorRegCfgFile), "GC5035/%s", pRegFile);
+    if (GC5035_IsiInitSensorIss(pCtx) != RET_SUCCESS) {
+        (void)GC5035_IsiReleaseSensorIss(pCtx);
+        return NULL;
+    }
+
+    return pCtx;
+}
+
+/* every 1/256 gain step from 1x to 16x, without and with shutter rounding compensation */
+static void TestGainLut(void)
+{
+    static const uint32_t ratios[] = { 256, 288, 320, 341, 384, 448 };
+    SensorMock_t *pMock = SensorMockCreate(0xfe);
+    GC5035_Context_t *pCtx = Gc5035Create(pMock, 1);
+    uint32_t again, agc, dgain;
+    float setGain, hdrRatio = 1.0f;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    for (uint32_t r = 0; r < sizeof(ratios) / sizeof(ratios[0]); r++) {
+        pCtx->DgainRatio = ratios[r];
+
+        for (uint32_t gain = SENSOR_GAIN_LUT_ONE; gain <= 16 * SENSOR_GAIN_LUT_ONE; gain++) {
+            uint32_t newAgain, newDgain;
+
+            if (gain * ratios[r] / 256 > 16 * SENSOR_GAIN_LUT_ONE) {
+                break;                  /* the table ends at 16x, the old code went beyond */
+            }
+
+            SENSOR_MOCK_CHECK(GC5035_IsiSetGainIss(pCtx, (float)gain / SENSOR_GAIN_LUT_ONE,
+                                                   &setGain, &hdrRatio) == RET_SUCCESS);
+            newAgain = SensorMockReg(pMock, 0xb6);
+            newDgain = (SensorMockReg(pMock, 0xb1) << 8) | SensorMockReg(pMock, 0xb2);
+            Gc5035OldGainCodes(gain, ratios[r], &again, &agc, &dgain);
+
+            if (ratios[r] == 256) {
+                SENSOR_MOCK_CHECK(newAgain == again);
+                SENSOR_MOCK_CHECK(newDgain == (dgain & 0xffc));
+                SENSOR_MOCK_CHECK(setGain == (float)(agc * (dgain & 0xffc) / 256) / SENSOR_GAIN_LUT_ONE);
+            } else {
+                /* the compensated gain picks its own analog step; like the old codes it ends up
+                   at most one 0xb2 step (4 digital codes) below, plus truncation */
+                uint32_t target = gain * ratios[r];
+                uint32_t total = Gc5035AgcOf(newAgain) * newDgain;
+
+                SENSOR_MOCK_CHECK(total <= target && target - total < Gc5035AgcOf(newAgain) * 5);
+                SENSOR_MOCK_CHECK(target - agc * (dgain & 0xffc) < agc * 5);
+            }
+        }
+    }
+
+    (void)GC5035_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* exposure before Init has no line time to solve with, it must fail without a write */
+static void TestNoTiming(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(0xfe);
+    GC5035_Context_t *pCtx = Gc5035Create(pMock, 1);
+    float setGain = 0.0f, setIntegrationTime = 0.0f, hdrRatio = 1.0f;
+    uint8_t skip;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    pCtx->KernelDriverFlag = 0;
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 2.0f, 0.01f, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) != RET_SUCCESS);
+    SENSOR_MOCK_CHECK(pMock->logCount == 0);
+    SENSOR_MOCK_CHECK(setGain == 0.0f && setIntegrationTime == 0.0f);
+
+    (void)GC5035_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+static uint32_t Gc5035Writes(const SensorMock_t *pMock, uint32_t addr)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < pMock->logCount; i++) {
+        count += (pMock->pLog[i].addr == addr) ? 1 : 0;
+    }
+
+    return count;
+}
+
+/* the gain is in force a frame before the shutter and waits for it; a second
+   request before that frame supersedes the held gain instead of flushing it */
+static void TestHeldGainSuperseded(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(0xfe);
+    GC5035_Context_t *pCtx = Gc5035Open(pMock, 1, "GC5035_mipi2lane_1920x1080@30_gc.txt");
+    float setGain, setIntegrationTime, hdrRatio = 1.0f;
+    const SensorMockWrite_t *pWrite;
+    uint8_t skip;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    SENSOR_MOCK_CHECK(GC5035_IsiFrameStartIss(pCtx, SensorMockNextFrame(pMock)) == RET_SUCCESS);
+    SensorMockClearLog(pMock);
+
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 2.0f, 0.03f, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 8.0f, 0.03f, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(SensorMockLastWrite(pMock, 0xb6) == NULL);
+
+    SENSOR_MOCK_CHECK(GC5035_IsiFrameStartIss(pCtx, SensorMockNextFrame(pMock)) == RET_SUCCESS);
+    pWrite = SensorMockLastWrite(pMock, 0xb6);
+    SENSOR_MOCK_CHECK(pWrite != NULL && pWrite->frame == pMock->frame);
+
+    SENSOR_MOCK_CHECK(Gc5035Writes(pMock, 0xb6) == 1);
+    SENSOR_MOCK_CHECK(setGain > 6.0f);   /* of the second request, past the longest shutter */
+
+    (void)GC5035_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* a shutter rounded down to a multiple of 4 lines is made up by the digital
+   gain; the reported pair is what the sensor runs and keeps the exposure */
+static void TestShutterCompensation(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(0xfe);
+    GC5035_Context_t *pCtx = Gc5035Open(pMock, 1, "GC5035_mipi2lane_1920x1080@30_gc.txt");
+    float setGain, setIntegrationTime, hdrRatio = 1.0f, time, exposure;
+    uint32_t again, dgain;
+    uint8_t skip;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    time = SensorExposureLinesToTime(&pCtx->ExpTiming, 7);
+    SENSOR_MOCK_CHECK(GC5035_IsiFrameStartIss(pCtx, SensorMockNextFrame(pMock)) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 1.0f, time, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(GC5035_IsiFrameStartIss(pCtx, SensorMockNextFrame(pMock)) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(GC5035_IsiFrameStartIss(pCtx, SensorMockNextFrame(pMock)) == RET_SUCCESS);
+
+    SENSOR_MOCK_CHECK(setIntegrationTime == SensorExposureLinesToTime(&pCtx->ExpTiming, 4));
+    SENSOR_MOCK_CHECK(setGain > 1.7f);     /* 7 / 4 lines */
+    SENSOR_MOCK_CHECK(SensorMockReg(pMock, 0x03) == 0 && SensorMockReg(pMock, 0x04) == 4);
+
+    again = SensorMockReg(pMock, 0xb6);
+    dgain = (SensorMockReg(pMock, 0xb1) << 8) | SensorMockReg(pMock, 0xb2);
+    SENSOR_MOCK_CHECK(setGain == (float)(Gc5035AgcOf(again) * dgain / SENSOR_GAIN_LUT_ONE) / SENSOR_GAIN_LUT_ONE);
+
+    exposure = setGain * setIntegrationTime;
+    SENSOR_MOCK_CHECK(fabsf(exposure - time) <= time / 128.0f);
+
+    (void)GC5035_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* a failed write leaves the outputs, the frame meta and the state alone */
+static void TestWriteFailure(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(0xfe);
+    GC5035_Context_t *pCtx = Gc5035Open(pMock, 1, "GC5035_mipi2lane_1920x1080@30_gc.txt");
+    float setGain = 0.0f, setIntegrationTime = 0.0f, hdrRatio = 1.0f;
+    float curGain, curIntegrationTime;
+    uint32_t metaCount;
+    uint8_t skip;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    curGain            = pCtx->AecCurGain;
+    curIntegrationTime = pCtx->AecCurIntegrationTime;
+    metaCount          = pCtx->FrameMeta.count;
+    pMock->failWrites  = BOOL_TRUE;
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 4.0f, 0.02f, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) != RET_SUCCESS);
+    SENSOR_MOCK_CHECK(setGain == 0.0f && setIntegrationTime == 0.0f);
+    SENSOR_MOCK_CHECK(pCtx->FrameMeta.count == metaCount);
+    SENSOR_MOCK_CHECK(pCtx->AecCurGain == curGain && pCtx->AecCurIntegrationTime == curIntegrationTime);
+
+    (void)GC5035_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* VTS is written only when a shutter needs a longer frame and when it no
+   longer does, the frame length of the mode is left alone otherwise */
+static void TestVtsOnDemand(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(0xfe);
+    GC5035_Context_t *pCtx = Gc5035Open(pMock, 1, "GC5035_mipi2lane_1920x1080@30_gc.txt");
+    float setGain, setIntegrationTime, hdrRatio = 1.0f;
+    uint8_t skip;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    SensorMockClearLog(pMock);
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 1.0f, 0.01f, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(Gc5035Writes(pMock, 0x41) == 0 && Gc5035Writes(pMock, 0x42) == 0);
+    SENSOR_MOCK_CHECK(((SensorMockReg(pMock, 0x03) << 8) | SensorMockReg(pMock, 0x04)) == pCtx->OldIntegrationTime);
+    SENSOR_MOCK_CHECK(pCtx->CurFrameLengthLines == pCtx->FrameLengthLines);
+
+    SENSOR_MOCK_CHECK(GC5035_IsiSetAutoFrameLengthIss(pCtx, BOOL_TRUE) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 1.0f, 0.1f, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(Gc5035Writes(pMock, 0x41) == 1 && Gc5035Writes(pMock, 0x42) == 1);
+    SENSOR_MOCK_CHECK(pCtx->CurFrameLengthLines > pCtx->FrameLengthLines);
+    SENSOR_MOCK_CHECK(((SensorMockReg(pMock, 0x41) << 8) | SensorMockReg(pMock, 0x42)) == pCtx->CurFrameLengthLines);
+
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 1.0f, 0.1f, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(Gc5035Writes(pMock, 0x41) == 1);
+
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 1.0f, 0.01f, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(Gc5035Writes(pMock, 0x41) == 2);
+    SENSOR_MOCK_CHECK(((SensorMockReg(pMock, 0x41) << 8) | SensorMockReg(pMock, 0x42)) == pCtx->FrameLengthLines);
+
+    (void)GC5035_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* with the kernel driver in charge nothing is solved and no VTS written */
+static void TestKernelExposure(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(0xfe);
+    GC5035_Context_t *pCtx = Gc5035Create(pMock, 1);
+    float setGain, setIntegrationTime, hdrRatio = 1.0f;
+    uint8_t skip;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL && pCtx->KernelDriverFlag);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pCtx, 2.0f, 0.01f, &skip, &setGain,
+                                                   &setIntegrationTime, &hdrRatio) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(Gc5035Writes(pMock, 0x41) == 0 && Gc5035Writes(pMock, 0x42) == 0);
+    SENSOR_MOCK_CHECK(pCtx->CurFrameLengthLines == 0);
+
+    (void)GC5035_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+#define STRESS_INSTANCES    4
+#define STRESS_ROUNDS       2000
+#define STRESS_REGS         5
+
+static const uint32_t StressRegs[STRESS_REGS] = { 0x03, 0x04, 0xb6, 0xb1, 0xb2 };
+
+typedef struct StressRun_s
+{
+    SensorMock_t        *pMock;
+    GC5035_Context_t    *pCtx;
+    uint32_t            instance;
+    uint32_t            regs[STRESS_ROUNDS][STRESS_REGS];
+    float               gain[STRESS_ROUNDS];
+    float               integrationTime[STRESS_ROUNDS];
+} StressRun_t;
+
+/* a sequence of its own per instance, half through SetIntegrationTime/SetGain
+   (shutter rounding compensated by DgainRatio), half through ExposureControl */
+static void *StressThread(void *pArg)
+{
+    StressRun_t *pRun = (StressRun_t *)pArg;
+    float hdrRatio = 1.0f, setGain, setIntegrationTime;
+    uint8_t skip;
+
+    for (uint32_t round = 0; round < STRESS_ROUNDS; round++) {
+        float integrationTime = 0.0005f + 0.00037f * ((pRun->instance * 7 + round) % 80);
+        float gain = 1.0f + 0.19f * ((pRun->instance * 13 + round * 3) % 75);
+
+        if (round % 2 != 0) {
+            SENSOR_MOCK_CHECK(GC5035_IsiSetIntegrationTimeIss(pRun->pCtx, integrationTime, &setIntegrationTime,
+                                                              &skip, &hdrRatio) == RET_SUCCESS);
+            SENSOR_MOCK_CHECK(GC5035_IsiSetGainIss(pRun->pCtx, gain, &setGain, &hdrRatio) == RET_SUCCESS);
+        } else {
+            SENSOR_MOCK_CHECK(GC5035_IsiExposureControlIss(pRun->pCtx, gain, integrationTime, &skip, &setGain,
+                                                           &setIntegrationTime, &hdrRatio) == RET_SUCCESS);
+        }
+
+        for (uint32_t i = 0; i < STRESS_REGS; i++) {
+            pRun->regs[round][i] = SensorMockReg(pRun->pMock, StressRegs[i]);
+        }
+        pRun->gain[round]            = setGain;
+        pRun->integrationTime[round] = setIntegrationTime;
+    }
+
+    return NULL;
+}
+
+static bool_t StressOpen(StressRun_t *pRun, uint32_t instance)
+{
+    MEMSET(pRun, 0, sizeof(StressRun_t));
+    pRun->instance = instance;
+    pRun->pMock    = SensorMockCreate(0xfe);
+    pRun->pCtx     = (pRun->pMock != NULL) ?
+                     Gc5035Open(pRun->pMock, 1, "GC5035_mipi2lane_1920x1080@30_gc.txt") : NULL;
+
+    return (pRun->pCtx != NULL) ? BOOL_TRUE : BOOL_FALSE;
+}
+
+static void StressClose(StressRun_t *pRun)
+{
+    if (pRun->pCtx != NULL) {
+        (void)GC5035_IsiReleaseSensorIss(pRun->pCtx);
+    }
+    SensorMockDestroy(pRun->pMock);
+}
+
+/* identical sensors on one process: each must end up with exactly what it
+   gets when it runs alone */
+static void TestMultiInstance(void)
+{
+    static StressRun_t alone, together[STRESS_INSTANCES];
+    pthread_t thread[STRESS_INSTANCES];
+
+    for (uint32_t n = 0; n < STRESS_INSTANCES; n++) {
+        SENSOR_MOCK_CHECK(StressOpen(&together[n], n));
+    }
+
+    for (uint32_t n = 0; n < STRESS_INSTANCES; n++) {
+        if (together[n].pCtx != NULL) {
+            SENSOR_MOCK_CHECK(pthread_create(&thread[n], NULL, StressThread, &together[n]) == 0);
+        }
+    }
+    for (uint32_t n = 0; n < STRESS_INSTANCES; n++) {
+        if (together[n].pCtx != NULL) {
+            (void)pthread_join(thread[n], NULL);
+        }
+    }
+
+    for (uint32_t n = 0; n < STRESS_INSTANCES; n++) {
+        if (together[n].pCtx == NULL || !StressOpen(&alone, n)) {
+            StressClose(&alone);
+            continue;
+        }
+        (void)StressThread(&alone);
+
+        SENSOR_MOCK_CHECK(memcmp(alone.regs, together[n].regs, sizeof(alone.regs)) == 0);
+        SENSOR_MOCK_CHECK(memcmp(alone.gain, together[n].gain, sizeof(alone.gain)) == 0);
+        SENSOR_MOCK_CHECK(memcmp(alone.integrationTime, together[n].integrationTime,
+                                 sizeof(alone.integrationTime)) == 0);
+        StressClose(&alone);
+    }
+
+    for (uint32_t n = 0; n < STRESS_INSTANCES; n++) {
+        StressClose(&together[n]);
+    }
+}
+
+int main(void)
+{
+    TestGainLut();
+    TestNoTiming();
+    TestHeldGainSuperseded();
+    TestShutterCompensation();
+    TestWriteFailure();
+    TestVtsOnDemand();
+    TestKernelExposure();
+    TestMultiInstance();
+
+    if (SensorMockFailures != 0) {
+        fprintf(stderr, "gc5035_test: %u checks failed\n", SensorMockFailures);
+        return 1;
+    }
+
+    return 0;
+}
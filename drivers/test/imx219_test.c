@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include "sensor_mock.h"
+#include "../IMX219/IMX219.c"
+
+/* the codes IMX219_IsiSetGainIss wrote before the lookup table */
+static void Imx219OldGainCodes(float NewGain, uint32_t *pAgain, uint32_t *pDgainInt, uint32_t *pDgainFrac)
+{
+    int32_t again;
+    float gain_left;
+
+    again = 256-256/NewGain;
+    if (again >=232) {
+        again = 232;
+    }
+    gain_left = NewGain / (256.0 / (256.0 - (float)again)); // what's left after again
+
+    *pAgain     = again;
+    *pDgainInt  = ((unsigned int)gain_left > 15 ) ? 15 : (unsigned int)gain_left;
+    *pDgainFrac = (unsigned int)((float)(gain_left - (unsigned int)gain_left) * 256.0);
+}
+
+static IMX219_Context_t *Imx219Create(SensorMock_t *pMock, uint32_t modeIndex)
+{
+    static IsiSensor_t sensor;
+    IsiSensorInstanceConfig_t config;
+
+    (void)IMX219_IsiGetSensorIss(&sensor);
+    MEMSET(&config, 0, sizeof(config));
+    config.HalHandle       = &pMock->hal;
+    config.pSensor         = &sensor;
+    config.SensorModeIndex = modeIndex;
+
+    if (IMX219_IsiCreateSensorIss(&config) != RET_SUCCESS) {
+        return NULL;
+    }
+
+    return (IMX219_Context_t *)config.hSensor;
+}
+
+/* every 1/256 gain step from 1x to 16x */
+static void TestGainLut(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(SENSOR_MOCK_NO_PAGE);
+    IMX219_Context_t *pCtx = Imx219Create(pMock, 0);
+    uint32_t again, dgainInt, dgainFrac;
+    float setGain, hdrRatio = 1.0f;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    for (uint32_t gain = SENSOR_GAIN_LUT_ONE; gain <= 16 * SENSOR_GAIN_LUT_ONE; gain++) {
+        float newGain = (float)gain / SENSOR_GAIN_LUT_ONE;
+
+        SENSOR_MOCK_CHECK(IMX219_IsiSetGainIss(pCtx, newGain, &setGain, &hdrRatio) == RET_SUCCESS);
+        Imx219OldGainCodes(newGain, &again, &dgainInt, &dgainFrac);
+
+        SENSOR_MOCK_CHECK(SensorMockReg(pMock, 0x157) == again);
+        SENSOR_MOCK_CHECK(SensorMockReg(pMock, 0x158) == dgainInt);
+        SENSOR_MOCK_CHECK(SensorMockReg(pMock, 0x159) == dgainFrac);
+    }
+
+    (void)IMX219_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+int main(void)
+{
+    TestGainLut();
+
+    if (SensorMockFailures != 0) {
+        fprintf(stderr, "imx219_test: %u checks failed\n", SensorMockFailures);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include "sensor_mock.h"
+#include "../IMX334/IMX334.c"
+
+#define IMX334_TEST_RHS2        0xaa    /* the 3DOL set leaves RHS2 at reset, the mock needs a value */
+
+static const uint32_t ShrAddr[IMX334_DOL_FRAMES]  = { 0x3058, 0x305c, 0x3060 };
+static const uint32_t GainAddr[IMX334_DOL_FRAMES] = { 0x30e8, 0x30ea, 0x30ec };
+
+/* Create finds the register files in the source tree, the tests run from the drivers directory */
+static IMX334_Context_t *Imx334Open(SensorMock_t *pMock, uint32_t modeIndex)
+{
+    static IsiSensor_t sensor;
+    IsiSensorInstanceConfig_t config;
+    IMX334_Context_t *pCtx;
+
+    (void)IMX334_IsiGetSensorIss(&sensor);
+    MEMSET(&config, 0, sizeof(config));
+    config.HalHandle       = &pMock->hal;
+    config.pSensor         = &sensor;
+    config.SensorModeIndex = modeIndex;
+
+    SensorMockSetConfigPath("IMX334/");
+    if (IMX334_IsiCreateSensorIss(&config) != RET_SUCCESS) {
+        return NULL;
+    }
+    pCtx = (IMX334_Context_t *)config.hSensor;
+
+    if (IMX334_IsiInitSensorIss(pCtx) != RET_SUCCESS) {
+        (void)IMX334_IsiReleaseSensorIss(pCtx);
+        return NULL;
+    }
+
+    return pCtx;
+}
+
+static uint32_t Imx334Reg24(SensorMock_t *pMock, uint32_t addr)
+{
+    return SensorMockReg(pMock, addr) | (SensorMockReg(pMock, addr + 1) << 8) |
+           ((SensorMockReg(pMock, addr + 2) & 0x0f) << 16);
+}
+
+/* every register of the last exposure write went out in one batch, inside REGHOLD */
+static void Imx334CheckBatch(SensorMock_t *pMock, uint32_t count)
+{
+    const SensorMockWrite_t *pFirst = NULL;
+    uint32_t batch = pMock->pLog[pMock->logCount - 1].batch;
+    uint32_t writes = 0;
+
+    for (uint32_t i = 0; i < pMock->logCount; i++) {
+        const SensorMockWrite_t *pWrite = &pMock->pLog[i];
+
+        if (pWrite->batch != batch) {
+            continue;
+        }
+        pFirst = (pFirst == NULL) ? pWrite : pFirst;
+        writes++;
+    }
+
+    SENSOR_MOCK_CHECK(pFirst != NULL && pFirst->addr == IMX334_REGHOLD && pFirst->data == 0x01);
+    SENSOR_MOCK_CHECK(pMock->pLog[pMock->logCount - 1].addr == IMX334_REGHOLD &&
+                      pMock->pLog[pMock->logCount - 1].data == 0x00);
+    SENSOR_MOCK_CHECK(writes == 2 + 5 * count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const SensorMockWrite_t *pShr = SensorMockLastWrite(pMock, ShrAddr[i]);
+        const SensorMockWrite_t *pGain = SensorMockLastWrite(pMock, GainAddr[i]);
+
+        SENSOR_MOCK_CHECK(pShr != NULL && pShr->batch == batch);
+        SENSOR_MOCK_CHECK(pGain != NULL && pGain->batch == batch);
+    }
+}
+
+/* SHR and RHS of every exposure in 3DOL: each shutter inside its readout
+   window, the long one as requested and the reported values as written */
+static void TestDolExposure(void)
+{
+    static const float times[] = { 0.0005f, 0.002f, 0.008f, 0.016f, 0.03f };
+    static const float ratios[] = { 1.0f, 4.0f, 16.0f };
+    SensorMock_t *pMock = SensorMockCreate(SENSOR_MOCK_NO_PAGE);
+    IMX334_Context_t *pCtx;
+    uint32_t fsc, rhs1, rhs2;
+
+    SensorMockSetReg(pMock, 0x306c, IMX334_TEST_RHS2);
+    pCtx = Imx334Open(pMock, IMX334_DOL_MODE);
+    SENSOR_MOCK_CHECK(pCtx != NULL && pCtx->enableHdr);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    fsc  = Imx334Reg24(pMock, 0x3030) * IMX334_DOL_FRAMES;
+    rhs1 = Imx334Reg24(pMock, 0x3068);
+    rhs2 = Imx334Reg24(pMock, 0x306c);
+    SENSOR_MOCK_CHECK(fsc == pCtx->DolFsc && rhs1 == pCtx->DolRhs1 && rhs2 == pCtx->DolRhs2);
+
+    for (uint32_t t = 0; t < sizeof(times) / sizeof(times[0]); t++) {
+        for (uint32_t r = 0; r < sizeof(ratios) / sizeof(ratios[0]); r++) {
+            float hdrRatio[2] = { ratios[r], ratios[r] };
+            float setGain, setIntegrationTime;
+            uint32_t shr[IMX334_DOL_FRAMES], lines[IMX334_DOL_FRAMES];
+            uint8_t skip;
+
+            SensorMockClearLog(pMock);
+            SENSOR_MOCK_CHECK(IMX334_IsiExposureControlIss(pCtx, 4.0f, times[t], &skip, &setGain,
+                                                           &setIntegrationTime, hdrRatio) == RET_SUCCESS);
+            Imx334CheckBatch(pMock, IMX334_DOL_FRAMES);
+
+            for (uint32_t i = 0; i < IMX334_DOL_FRAMES; i++) {
+                shr[i] = Imx334Reg24(pMock, ShrAddr[i]);
+            }
+            lines[0] = fsc - shr[0];
+            lines[1] = rhs1 - shr[1];
+            lines[2] = rhs2 - shr[2];
+
+            /* long after the SEF2 readout, SEF1 before RHS1, SEF2 between the readouts */
+            SENSOR_MOCK_CHECK(shr[0] >= rhs2 + IMX334_DOL_MARGIN && shr[0] < fsc);
+            SENSOR_MOCK_CHECK(shr[1] >= IMX334_DOL_MARGIN && shr[1] < rhs1);
+            SENSOR_MOCK_CHECK(shr[2] >= rhs1 + IMX334_DOL_MARGIN && shr[2] < rhs2);
+            SENSOR_MOCK_CHECK(lines[0] >= lines[1] && lines[1] >= lines[2]);
+
+            SENSOR_MOCK_CHECK(lines[0] == pCtx->OldIntegrationTime);
+            SENSOR_MOCK_CHECK(lines[1] == pCtx->OldIntegrationTimeSEF1);
+            SENSOR_MOCK_CHECK(lines[2] == pCtx->OldIntegrationTimeSEF2);
+            SENSOR_MOCK_CHECK(setIntegrationTime == SensorExposureLinesToTime(&pCtx->ExpTiming, lines[0]));
+            SENSOR_MOCK_CHECK(pCtx->CurHdrRatio == (float)lines[0] / (float)lines[1]);
+
+            /* what the long exposure gives up or gains, the gain makes up for */
+            SENSOR_MOCK_CHECK(fabsf(setGain * setIntegrationTime - 4.0f * times[t]) <
+                              4.0f * times[t] * 0.05f + setGain * pCtx->AecIntegrationTimeIncrement ||
+                              setGain >= pCtx->AecMaxGain - 0.5f || setGain <= pCtx->AecMinGain + 0.5f);
+            for (uint32_t i = 0; i < IMX334_DOL_FRAMES; i++) {
+                SENSOR_MOCK_CHECK((SensorMockReg(pMock, GainAddr[i]) | (SensorMockReg(pMock, GainAddr[i] + 1) << 8)) ==
+                                  pCtx->OldGain);
+            }
+        }
+    }
+
+    (void)IMX334_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* without a layout the exposures cannot be placed: the call fails and nothing goes out */
+static void TestDolNoLayout(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(SENSOR_MOCK_NO_PAGE);
+    IMX334_Context_t *pCtx;
+    float hdrRatio[2] = { 4.0f, 4.0f }, setGain, setIntegrationTime;
+    uint32_t oldIntegrationTime;
+    uint8_t skip;
+
+    SensorMockSetReg(pMock, 0x306c, IMX334_TEST_RHS2);
+    pCtx = Imx334Open(pMock, IMX334_DOL_MODE);
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    pCtx->DolLayout.count = 0;
+    oldIntegrationTime    = pCtx->OldIntegrationTime;
+    SensorMockClearLog(pMock);
+    SENSOR_MOCK_CHECK(IMX334_IsiExposureControlIss(pCtx, 4.0f, 0.01f, &skip, &setGain,
+                                                   &setIntegrationTime, hdrRatio) != RET_SUCCESS);
+    SENSOR_MOCK_CHECK(pMock->logCount == 0);
+    SENSOR_MOCK_CHECK(pCtx->OldIntegrationTime == oldIntegrationTime);
+
+    (void)IMX334_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* the stream layout follows WD_SET2 and OPB_SIZE_V as the sensor holds them */
+static void TestHdrLayout(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(SENSOR_MOCK_NO_PAGE);
+    IMX334_Context_t *pCtx;
+    SensorDolStreamLayout_t layout;
+
+    SensorMockSetReg(pMock, 0x306c, IMX334_TEST_RHS2);
+    pCtx = Imx334Open(pMock, IMX334_DOL_MODE);
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    /* the 3DOL set: virtual channels, 0x13 OB lines */
+    SENSOR_MOCK_CHECK(IMX334_IsiGetHdrLayoutIss(pCtx, &layout) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(layout.count == IMX334_DOL_FRAMES && layout.demux == SENSOR_DOL_DEMUX_VC);
+    for (uint32_t i = 0; i < IMX334_DOL_FRAMES; i++) {
+        SENSOR_MOCK_CHECK(layout.exposure[i].vc == i && layout.exposure[i].dt == 0x2c);
+        SENSOR_MOCK_CHECK(layout.exposure[i].embeddedLines == 0x13);
+    }
+    SENSOR_MOCK_CHECK(layout.exposure[1].lineOffset == pCtx->DolRhs1 &&
+                      layout.exposure[2].lineOffset == IMX334_TEST_RHS2);
+
+    /* line information output, other OB size */
+    SensorMockSetReg(pMock, IMX334_WD_SET2, 0x00);
+    SensorMockSetReg(pMock, IMX334_OPB_SIZE_V, 0x08);
+    SENSOR_MOCK_CHECK(IMX334_ReadDolLayout(pCtx) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(IMX334_IsiGetHdrLayoutIss(pCtx, &layout) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(layout.demux == SENSOR_DOL_DEMUX_LINE_INFO);
+    for (uint32_t i = 0; i < IMX334_DOL_FRAMES; i++) {
+        SENSOR_MOCK_CHECK(layout.exposure[i].vc == 0 && layout.exposure[i].embeddedLines == 0x08);
+    }
+
+    /* not a 3 frame DOL set */
+    SensorMockSetReg(pMock, IMX334_WDSEL, 0x01);
+    SENSOR_MOCK_CHECK(IMX334_ReadDolLayout(pCtx) != RET_SUCCESS);
+
+    (void)IMX334_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* registers the exposure writes, they differ from the register sets */
+static bool_t Imx334IsExposureReg(uint32_t addr)
+{
+    return (addr == IMX334_REGHOLD || (addr >= 0x3058 && addr <= 0x3062) || (addr >= 0x30e8 && addr <= 0x30ed));
+}
+
+/* the sensor holds what the set of mode programs, and the reset values of what only the set of other does */
+static void Imx334CheckModeRegs(SensorMock_t *pMock, uint32_t mode, uint32_t other)
+{
+    struct vvcam_sccb_array arry, otherArry;
+    SensorBundle_t bundle, otherBundle;
+    uint32_t value;
+
+    MEMSET(&bundle, 0, sizeof(bundle));
+    MEMSET(&otherBundle, 0, sizeof(otherBundle));
+    SENSOR_MOCK_CHECK(IMX334_LoadModeRegs(mode, &bundle, &arry) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(IMX334_LoadModeRegs(other, &otherBundle, &otherArry) == RET_SUCCESS);
+
+    for (uint32_t i = 0; i < arry.count; i++) {
+        uint32_t addr = arry.sccb_data[i].addr;
+
+        if (IMX334_IsStreamReg(addr) || Imx334IsExposureReg(addr)) {
+            continue;
+        }
+        (void)IMX334_RegArrayValue(&arry, addr, &value);
+        SENSOR_MOCK_CHECK(SensorMockReg(pMock, addr) == value);
+    }
+    for (uint32_t i = 0; i < otherArry.count; i++) {
+        uint32_t addr = otherArry.sccb_data[i].addr;
+
+        if (IMX334_IsStreamReg(addr) || Imx334IsExposureReg(addr) || IMX334_RegArrayValue(&arry, addr, &value)) {
+            continue;
+        }
+        SENSOR_MOCK_CHECK(SensorMockReg(pMock, addr) == pMock->resetRegs[addr]);
+    }
+
+    IMX334_ReleaseModeRegs(&otherBundle, &otherArry);
+    IMX334_ReleaseModeRegs(&bundle, &arry);
+}
+
+/* linear -> 3DOL -> linear: Init builds nothing, the first switch resets the
+   sensor and builds the deltas, the second only writes its delta */
+static void TestHdrSwitch(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(SENSOR_MOCK_NO_PAGE);
+    IMX334_Context_t *pCtx;
+    uint32_t resets;
+    uint8_t skip;
+
+    SensorMockSetReg(pMock, 0x306c, IMX334_TEST_RHS2);
+    pCtx = Imx334Open(pMock, IMX334_LINEAR_MODE);
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+    SENSOR_MOCK_CHECK(pCtx->HdrSwitchRegs[0] == NULL && pCtx->HdrSwitchRegs[1] == NULL);
+
+    pCtx->Configured = BOOL_TRUE;
+    SENSOR_MOCK_CHECK(IMX334_IsiSensorSetStreamingIss(pCtx, BOOL_TRUE) == RET_SUCCESS);
+    resets = pMock->resets;
+
+    SENSOR_MOCK_CHECK(IMX334_IsiSwitchHdrIss(pCtx, BOOL_TRUE, &skip) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(pMock->resets == resets + 1);
+    SENSOR_MOCK_CHECK(pCtx->enableHdr && pCtx->SensorMode.index == IMX334_DOL_MODE);
+    SENSOR_MOCK_CHECK(pCtx->HdrSwitchCount[0] != 0 && pCtx->HdrSwitchCount[1] != 0);
+    SENSOR_MOCK_CHECK(pCtx->DolRhs2 == IMX334_TEST_RHS2 && pCtx->DolRhs1 == Imx334Reg24(pMock, 0x3068));
+    SENSOR_MOCK_CHECK(pCtx->Streaming && SensorMockReg(pMock, 0x3000) == 0x00);
+    Imx334CheckModeRegs(pMock, IMX334_DOL_MODE, IMX334_LINEAR_MODE);
+
+    SensorMockClearLog(pMock);
+    SENSOR_MOCK_CHECK(IMX334_IsiSwitchHdrIss(pCtx, BOOL_FALSE, &skip) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(pMock->resets == resets + 1);
+    SENSOR_MOCK_CHECK(!pCtx->enableHdr && pCtx->SensorMode.index == IMX334_LINEAR_MODE);
+    SENSOR_MOCK_CHECK(pCtx->Streaming && SensorMockReg(pMock, 0x3000) == 0x00);
+    Imx334CheckModeRegs(pMock, IMX334_LINEAR_MODE, IMX334_DOL_MODE);
+
+    (void)IMX334_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* with the kernel driver the switch takes over the mode and limits it reports
+   for the new mode, and a failed request leaves the mode in force */
+static void TestKernelHdrSwitch(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(SENSOR_MOCK_NO_PAGE);
+    IMX334_Context_t *pCtx = Imx334Open(pMock, IMX334_LINEAR_MODE);
+    uint8_t skip;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    pCtx->KernelDriverFlag = 1;
+    pCtx->Configured       = BOOL_TRUE;
+    SENSOR_MOCK_CHECK(IMX334_IsiSensorSetStreamingIss(pCtx, BOOL_TRUE) == RET_SUCCESS);
+    MEMCPY(&pMock->kernelMode, IMX334_FindMode(IMX334_DOL_MODE), sizeof(pMock->kernelMode));
+    pMock->kernelAeInfo.one_line_exp_time_ns = 20000;
+    pMock->kernelAeInfo.max_integration_time = 1000;
+    pMock->kernelAeInfo.min_integration_time = 2;
+    pMock->kernelAeInfo.gain_accuracy        = 1024;
+
+    SENSOR_MOCK_CHECK(IMX334_IsiSwitchHdrIss(pCtx, BOOL_TRUE, &skip) == RET_SUCCESS);
+    SENSOR_MOCK_CHECK(pCtx->enableHdr && pCtx->SensorMode.hdr_mode == SENSOR_MODE_HDR_STITCH);
+    SENSOR_MOCK_CHECK(pCtx->MaxIntegrationLine == 1000 && pCtx->MinIntegrationLine == 2);
+    SENSOR_MOCK_CHECK(pCtx->ExpTiming.lineTimePs == 20000 * SENSOR_EXPOSURE_PS_PER_NS);
+    SENSOR_MOCK_CHECK(pCtx->Streaming && SensorMockReg(pMock, 0x3000) == 0x00);
+
+    pMock->failKernel = BOOL_TRUE;
+    SENSOR_MOCK_CHECK(IMX334_IsiSwitchHdrIss(pCtx, BOOL_FALSE, &skip) != RET_SUCCESS);
+    SENSOR_MOCK_CHECK(pCtx->enableHdr && pCtx->SensorMode.hdr_mode == SENSOR_MODE_HDR_STITCH);
+
+    (void)IMX334_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+/* linear mode: one exposure, the same REGHOLD batch */
+static void TestLinearExposure(void)
+{
+    SensorMock_t *pMock = SensorMockCreate(SENSOR_MOCK_NO_PAGE);
+    IMX334_Context_t *pCtx = Imx334Open(pMock, IMX334_LINEAR_MODE);
+    float hdrRatio[2] = { 1.0f, 1.0f }, setGain, setIntegrationTime;
+    uint8_t skip;
+
+    SENSOR_MOCK_CHECK(pCtx != NULL && !pCtx->enableHdr);
+    if (pCtx == NULL) {
+        SensorMockDestroy(pMock);
+        return;
+    }
+
+    SensorMockClearLog(pMock);
+    SENSOR_MOCK_CHECK(IMX334_IsiExposureControlIss(pCtx, 6.0f, 0.01f, &skip, &setGain,
+                                                   &setIntegrationTime, hdrRatio) == RET_SUCCESS);
+    Imx334CheckBatch(pMock, 1);
+    SENSOR_MOCK_CHECK(IMX334_LINEAR_EXP_END - Imx334Reg24(pMock, ShrAddr[0]) == pCtx->OldIntegrationTime);
+    SENSOR_MOCK_CHECK(SensorMockLastWrite(pMock, ShrAddr[1]) == NULL);
+
+    (void)IMX334_IsiReleaseSensorIss(pCtx);
+    SensorMockDestroy(pMock);
+}
+
+int main(void)
+{
+    TestDolExposure();
+    TestDolNoLayout();
+    TestLinearExposure();
+    TestHdrSwitch();
+    TestKernelHdrSwitch();
+    TestHdrLayout();
+
+    if (SensorMockFailures != 0) {
+        fprintf(stderr, "imx334_test: %u checks failed\n", SensorMockFailures);
+        return 1;
+    }
+
+    return 0;
+}
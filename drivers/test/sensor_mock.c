@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <ebase/builtins.h>
+#include <common/misc.h>
+#include "sensor_mock.h"
+
+uint32_t SensorMockFailures = 0;
+
+static pthread_mutex_t MockLock = PTHREAD_MUTEX_INITIALIZER;
+static SensorMock_t *MockDevice[SENSOR_MOCK_MAX];
+static const char *MockConfigPath = "";
+
+static SensorMock_t *MockFind(int fd)
+{
+    uint32_t slot = (uint32_t)(fd - SENSOR_MOCK_FD_BASE);
+    SensorMock_t *pMock;
+
+    if (fd < SENSOR_MOCK_FD_BASE || slot >= SENSOR_MOCK_MAX) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&MockLock);
+    pMock = MockDevice[slot];
+    pthread_mutex_unlock(&MockLock);
+    return pMock;
+}
+
+static uint32_t MockAddr(const SensorMock_t *pMock, uint32_t addr)
+{
+    if (pMock->pageReg == SENSOR_MOCK_NO_PAGE) {
+        return addr & (SENSOR_MOCK_REGS - 1);
+    }
+
+    return ((pMock->page << 8) | (addr & 0xff)) & (SENSOR_MOCK_REGS - 1);
+}
+
+static int MockWrite(SensorMock_t *pMock, uint32_t addr, uint32_t data)
+{
+    SensorMockWrite_t *pEntry;
+
+    if (pMock->failWrites) {
+        return -1;
+    }
+
+    if (pMock->pageReg != SENSOR_MOCK_NO_PAGE && addr == pMock->pageReg) {
+        pMock->page = data;
+        return 0;
+    }
+    addr = MockAddr(pMock, addr);
+    pMock->regs[addr] = data;
+
+    if (pMock->logCount == pMock->logSize) {
+        uint32_t size = (pMock->logSize != 0) ? 2 * pMock->logSize : 1024;
+        SensorMockWrite_t *pLog = realloc(pMock->pLog, size * sizeof(SensorMockWrite_t));
+
+        if (pLog == NULL) {
+            return -1;
+        }
+        pMock->pLog    = pLog;
+        pMock->logSize = size;
+    }
+    pEntry = &pMock->pLog[pMock->logCount++];
+    pEntry->frame = pMock->frame;
+    pEntry->batch = pMock->batch;
+    pEntry->addr  = addr;
+    pEntry->data  = data;
+    return 0;
+}
+
+static int MockIoctl(SensorMock_t *pMock, unsigned long request, void *pArg)
+{
+    struct vvcam_sccb_data *pData = (struct vvcam_sccb_data *)pArg;
+    struct vvcam_sccb_array *pArry = (struct vvcam_sccb_array *)pArg;
+    int ret = 0;
+
+    switch (request) {
+    case VVSENSORIOC_WRITE_REG:
+        pMock->batch++;
+        ret = MockWrite(pMock, pData->addr, pData->data);
+        break;
+    case VVSENSORIOC_WRITE_ARRAY:
+        pMock->batch++;
+        for (uint32_t i = 0; i < pArry->count && ret == 0; i++) {
+            ret = MockWrite(pMock, pArry->sccb_data[i].addr, pArry->sccb_data[i].data);
+        }
+        break;
+    case VVSENSORIOC_READ_REG:
+        pData->data = pMock->regs[MockAddr(pMock, pData->addr)];
+        break;
+    case VVSENSORIOC_SENSOR_SCCB_CFG:
+        MEMCPY(&pMock->sccb, pArg, sizeof(pMock->sccb));
+        break;
+    case VVSENSORIOC_S_POWER:
+        pMock->power = *(int32_t *)pArg;
+        break;
+    case VVSENSORIOC_S_STREAM:
+        pMock->stream = *(uint32_t *)pArg;
+        break;
+    case VVSENSORIOC_S_EXP:
+        pMock->kernelExp = *(uint32_t *)pArg;
+        pMock->kernelCalls++;
+        break;
+    case VVSENSORIOC_S_GAIN:
+        pMock->kernelGain = *(uint32_t *)pArg;
+        pMock->kernelCalls++;
+        break;
+    case VVSENSORIOC_RESET:
+        MEMCPY(pMock->regs, pMock->resetRegs, sizeof(pMock->regs));
+        pMock->page = 0;
+        pMock->resets++;
+        break;
+    case VVSENSORIOC_S_HDR_MODE:
+        if (pMock->failKernel) {
+            ret = -1;
+            break;
+        }
+        pMock->kernelMode.hdr_mode = *(uint32_t *)pArg;
+        break;
+    case VVSENSORIOC_G_SENSOR_MODE:
+        MEMCPY(pArg, &pMock->kernelMode, sizeof(pMock->kernelMode));
+        break;
+    case VVSENSORIOC_G_AE_INFO:
+        MEMCPY(pArg, &pMock->kernelAeInfo, sizeof(pMock->kernelAeInfo));
+        break;
+    default:
+        /* clock, reset and the kernel driver queries: nothing to emulate */
+        break;
+    }
+
+    return ret;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    SensorMock_t *pMock = MockFind(fd);
+    void *pArg;
+    va_list ap;
+    int ret;
+
+    va_start(ap, request);
+    pArg = va_arg(ap, void *);
+    va_end(ap);
+
+    if (pMock == NULL) {
+        return (int)syscall(SYS_ioctl, fd, request, pArg);
+    }
+
+    pthread_mutex_lock(&pMock->lock);
+    ret = MockIoctl(pMock, request, pArg);
+    pthread_mutex_unlock(&pMock->lock);
+    return ret;
+}
+
+RESULT HalAddRef(HalHandle_t HalHandle)
+{
+    return (HalHandle != NULL) ? RET_SUCCESS : RET_NULL_POINTER;
+}
+
+RESULT HalDelRef(HalHandle_t HalHandle)
+{
+    return (HalHandle != NULL) ? RET_SUCCESS : RET_NULL_POINTER;
+}
+
+const char *get_vi_config_path(void)
+{
+    return MockConfigPath;
+}
+
+void SensorMockSetConfigPath(const char *pPath)
+{
+    MockConfigPath = (pPath != NULL) ? pPath : "";
+}
+
+SensorMock_t *SensorMockCreate(uint32_t pageReg)
+{
+    SensorMock_t *pMock = calloc(1, sizeof(SensorMock_t));
+    uint32_t slot;
+
+    if (pMock == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&MockLock);
+    for (slot = 0; slot < SENSOR_MOCK_MAX && MockDevice[slot] != NULL; slot++) {
+        ;
+    }
+    if (slot == SENSOR_MOCK_MAX) {
+        pthread_mutex_unlock(&MockLock);
+        free(pMock);
+        return NULL;
+    }
+    MockDevice[slot] = pMock;
+    pthread_mutex_unlock(&MockLock);
+
+    pthread_mutex_init(&pMock->lock, NULL);
+    pMock->fd            = SENSOR_MOCK_FD_BASE + slot;
+    pMock->hal.sensor_fd = pMock->fd;
+    pMock->pageReg       = pageReg;
+    return pMock;
+}
+
+void SensorMockDestroy(SensorMock_t *pMock)
+{
+    if (pMock == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&MockLock);
+    MockDevice[pMock->fd - SENSOR_MOCK_FD_BASE] = NULL;
+    pthread_mutex_unlock(&MockLock);
+
+    pthread_mutex_destroy(&pMock->lock);
+    free(pMock->pLog);
+    free(pMock);
+}
+
+uint32_t SensorMockReg(SensorMock_t *pMock, uint32_t addr)
+{
+    uint32_t value;
+
+    pthread_mutex_lock(&pMock->lock);
+    value = pMock->regs[addr & (SENSOR_MOCK_REGS - 1)];
+    pthread_mutex_unlock(&pMock->lock);
+    return value;
+}
+
+void SensorMockSetReg(SensorMock_t *pMock, uint32_t addr, uint32_t value)
+{
+    pthread_mutex_lock(&pMock->lock);
+    pMock->regs[addr & (SENSOR_MOCK_REGS - 1)]      = value;
+    pMock->resetRegs[addr & (SENSOR_MOCK_REGS - 1)] = value;
+    pthread_mutex_unlock(&pMock->lock);
+}
+
+uint32_t SensorMockNextFrame(SensorMock_t *pMock)
+{
+    uint32_t frame;
+
+    pthread_mutex_lock(&pMock->lock);
+    frame = ++pMock->frame;
+    pthread_mutex_unlock(&pMock->lock);
+    return frame;
+}
+
+void SensorMockClearLog(SensorMock_t *pMock)
+{
+    pthread_mutex_lock(&pMock->lock);
+    pMock->logCount = 0;
+    pthread_mutex_unlock(&pMock->lock);
+}
+
+const SensorMockWrite_t *SensorMockLastWrite(SensorMock_t *pMock, uint32_t addr)
+{
+    const SensorMockWrite_t *pEntry = NULL;
+
+    pthread_mutex_lock(&pMock->lock);
+    for (uint32_t i = pMock->logCount; i > 0 && pEntry == NULL; i--) {
+        if (pMock->pLog[i - 1].addr == addr) {
+            pEntry = &pMock->pLog[i - 1];
+        }
+    }
+    pthread_mutex_unlock(&pMock->lock);
+    return pEntry;
+}
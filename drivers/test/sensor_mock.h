@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2020 Alibaba Group Holding Limited
+ */
+/**
+ * @file sensor_mock.h
+ *
+ * @brief Mock sensor device for the host tests of the drivers.
+ *
+ * A test links its driver source together with this file instead of a
+ * kernel: ioctl() on the fd of a SensorMock_t is served from a register
+ * file in memory, any other fd goes to the real ioctl. Every register
+ * write is logged with the frame it was written in and the ioctl it came
+ * with, so a test can check what went out in one batch and when.
+ *
+ * HalAddRef/HalDelRef are mocked as well; the HalHandle a driver is
+ * created with is &SensorMock_t.hal. So is get_vi_config_path(): it is
+ * empty until a test points it at a driver's source directory, where
+ * Create then finds the register files of the modes.
+ *
+ * @defgroup sensor_mock
+ * @{
+ *
+ */
+#ifndef __SENSOR_MOCK_H__
+#define __SENSOR_MOCK_H__
+
+#include <pthread.h>
+#include <stdio.h>
+#include <ebase/types.h>
+#include <common/return_codes.h>
+#include <hal/hal_api.h>
+#include <vvsensor.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SENSOR_MOCK_MAX             16          /**< devices open at a time */
+#define SENSOR_MOCK_FD_BASE         0x4000      /**< fd of the first device, far from real ones */
+#define SENSOR_MOCK_REGS            0x10000
+#define SENSOR_MOCK_NO_PAGE         0xffffffffU
+
+/**
+ * @brief One logged register write.
+ */
+typedef struct SensorMockWrite_s
+{
+    uint32_t    frame;                      /**< SensorMock_t.frame at the write */
+    uint32_t    batch;                      /**< ioctl it came with, counting from 1 */
+    uint32_t    addr;                       /**< with the page in bits 8.. for paged sensors */
+    uint32_t    data;
+} SensorMockWrite_t;
+
+typedef struct SensorMock_s
+{
+    HalContext_t            hal;            /**< HalHandle to create the driver with */
+    int                     fd;
+    pthread_mutex_t         lock;
+
+    uint32_t                pageReg;        /**< page select register, SENSOR_MOCK_NO_PAGE if none */
+    uint32_t                page;
+    uint32_t                regs[SENSOR_MOCK_REGS];
+    uint32_t                resetRegs[SENSOR_MOCK_REGS];    /**< regs after VVSENSORIOC_RESET */
+    uint32_t                resets;
+
+    uint32_t                frame;
+    uint32_t                batch;
+    uint32_t                logCount;
+    uint32_t                logSize;
+    SensorMockWrite_t       *pLog;
+
+    struct vvcam_sccb_cfg_s sccb;
+    int32_t                 power;
+    uint32_t                stream;
+    uint32_t                kernelExp;      /**< last VVSENSORIOC_S_EXP */
+    uint32_t                kernelGain;     /**< last VVSENSORIOC_S_GAIN */
+    uint32_t                kernelCalls;    /**< VVSENSORIOC_S_EXP and _S_GAIN */
+    struct vvcam_mode_info  kernelMode;     /**< VVSENSORIOC_G_SENSOR_MODE, hdr_mode set by _S_HDR_MODE */
+    struct vvcam_ae_info_s  kernelAeInfo;   /**< VVSENSORIOC_G_AE_INFO */
+    bool_t                  failKernel;     /**< VVSENSORIOC_S_HDR_MODE fails while set */
+    bool_t                  failWrites;     /**< register writes fail while set */
+} SensorMock_t;
+
+SensorMock_t *SensorMockCreate(uint32_t pageReg);
+void SensorMockDestroy(SensorMock_t *pMock);
+
+/**
+ * @brief Register value as the sensor holds it, addr with the page for paged sensors.
+ */
+uint32_t SensorMockReg(SensorMock_t *pMock, uint32_t addr);
+
+/**
+ * @brief Set a register, as its reset value too.
+ */
+void SensorMockSetReg(SensorMock_t *pMock, uint32_t addr, uint32_t value);
+
+/**
+ * @brief Directory get_vi_config_path() returns, with a trailing '/',
+ *        relative to the working directory of the test.
+ */
+void SensorMockSetConfigPath(const char *pPath);
+
+/**
+ * @brief Next frame: the writes from now on are logged with it.
+ */
+uint32_t SensorMockNextFrame(SensorMock_t *pMock);
+
+void SensorMockClearLog(SensorMock_t *pMock);
+
+/**
+ * @brief Last logged write to a register, NULL if there is none.
+ */
+const SensorMockWrite_t *SensorMockLastWrite(SensorMock_t *pMock, uint32_t addr);
+
+extern uint32_t SensorMockFailures;
+
+#define SENSOR_MOCK_CHECK(cond)                                                         \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);    \
+            SensorMockFailures++;                                                       \
+        }                                                                               \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} sensor_mock */
+
+#endif    /* __SENSOR_MOCK_H__ */
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+##
+ # Copyright (C) 2020 Alibaba Group Holding Limited
+##
+"""Compile calibration xml data into tables the runtime can use directly.
+
+awb-grid: evaluates every illuminant Gaussian (GMM invCovMatrix,
+GaussianMeanValue, GaussianScalingFactor) of the AWB calibration on a
+quantized (r/g, b/g) grid and stores the normalized illuminant weights, so
+AWB classification becomes one table read instead of one exp() per
+illuminant per frame. The layout must match drivers/common/sensor_awb_grid.h.
+
+gain-curve: packs a measured gain curve (requested,actual csv as written by
+gain_sweep.py, kept next to the xml as <xml name>.gain.csv) into 1/256
+fixed point points. The driver remaps its gain table through it, see
+SensorGainLutCalibrate() in drivers/common/sensor_gain_lut.h.
+
+Usage:
+    calib_compiler.py awb-grid GC5035_1920x1080.xml -o awb_grid.bin
+    calib_compiler.py awb-grid GC5035_1920x1080.xml --lookup 0.8 0.6
+    calib_compiler.py gain-curve GC5035_1920x1080.gain.csv -o gain_curve.bin
+"""
+
+import argparse
+import math
+import struct
+import sys
+import xml.etree.ElementTree as ET
+
+AWB_GRID_MAGIC = 0x44475741         # "AWGD"
+AWB_GRID_MAX_ILLU = 8
+AWB_GRID_NAME_LEN = 16
+
+# uint32 magic, uint16 illuCount, rgSteps, bgSteps, reserved,
+# float rgMin, rgStep, bgMin, bgStep, char name[8][16], float tau[8][2]
+AWB_GRID_HEADER = struct.Struct("<IHHHH4f%ds%df" % (AWB_GRID_MAX_ILLU * AWB_GRID_NAME_LEN,
+                                                   AWB_GRID_MAX_ILLU * 2))
+
+DEFAULT_STEPS = 64
+DEFAULT_MIN = 0.0
+DEFAULT_MAX = 2.0
+
+# weights below this total likelihood are left at zero (no illuminant fits)
+MIN_LIKELIHOOD = 1e-6
+
+GAIN_CURVE_MAGIC = 0x56524347       # "GCRV"
+GAIN_CURVE_MAX_POINTS = 256
+GAIN_ONE = 256
+
+# uint32 magic, uint16 count, uint16 reserved, then count x uint32 requested, actual
+GAIN_CURVE_HEADER = struct.Struct("<IHH")
+GAIN_CURVE_POINT = struct.Struct("<II")
+
+
+def values(node):
+    text = node.text.strip().strip("[]")
+    return [float(v) for v in text.split()]
+
+
+def text(node):
+    return node.text.strip()
+
+
+class AwbModel:
+    def __init__(self, xml_path):
+        root = ET.parse(xml_path).getroot()
+        awb = root.find("./sensor/AWB")
+        if awb is None:
+            raise ValueError("%s: no AWB calibration" % xml_path)
+
+        glob = awb.find("./globals/cell")
+        self.svd_mean = values(glob.find("SVDMeanValue"))
+        # [3 2] stored column by column: two projection vectors of 3
+        pca = values(glob.find("PCAMatrix"))
+        self.pca = (pca[0:3], pca[3:6])
+
+        self.illu = []
+        for cell in awb.findall("./illumination/cell"):
+            gmm = cell.find("GMM")
+            inv = values(gmm.find("invCovMatrix"))
+            self.illu.append({
+                "name": text(cell.find("name")),
+                "inv": ((inv[0], inv[1]), (inv[2], inv[3])),
+                "mean": values(gmm.find("GaussianMeanValue")),
+                "scale": values(gmm.find("GaussianScalingFactor"))[0],
+                "tau": values(gmm.find("tau")),
+            })
+
+        if not self.illu:
+            raise ValueError("%s: no illuminants" % xml_path)
+        if len(self.illu) > AWB_GRID_MAX_ILLU:
+            raise ValueError("%s: %d illuminants, at most %d supported"
+                             % (xml_path, len(self.illu), AWB_GRID_MAX_ILLU))
+
+    def project(self, rg, bg):
+        s = rg + 1.0 + bg
+        rgb = (rg / s - self.svd_mean[0], 1.0 / s - self.svd_mean[1], bg / s - self.svd_mean[2])
+        return tuple(sum(v[i] * rgb[i] for i in range(3)) for v in self.pca)
+
+    def likelihoods(self, rg, bg):
+        x = self.project(rg, bg)
+        out = []
+        for il in self.illu:
+            d0 = x[0] - il["mean"][0]
+            d1 = x[1] - il["mean"][1]
+            inv = il["inv"]
+            m = d0 * (inv[0][0] * d0 + inv[0][1] * d1) + d1 * (inv[1][0] * d0 + inv[1][1] * d1)
+            out.append(il["scale"] * math.exp(-0.5 * m))
+        return out
+
+    def weights(self, rg, bg):
+        p = self.likelihoods(rg, bg)
+        total = sum(p)
+        if total < MIN_LIKELIHOOD:
+            return [0] * len(p)
+        return [int(round(255.0 * v / total)) for v in p]
+
+
+def compile_awb_grid(xml_path, steps=DEFAULT_STEPS, lo=DEFAULT_MIN, hi=DEFAULT_MAX):
+    model = AwbModel(xml_path)
+    step = (hi - lo) / steps
+
+    names = b"".join(il["name"].encode()[:AWB_GRID_NAME_LEN - 1].ljust(AWB_GRID_NAME_LEN, b"\0")
+                     for il in model.illu)
+    names = names.ljust(AWB_GRID_MAX_ILLU * AWB_GRID_NAME_LEN, b"\0")
+    tau = []
+    for i in range(AWB_GRID_MAX_ILLU):
+        t = model.illu[i]["tau"] if i < len(model.illu) else [0.0, 0.0]
+        tau += (t + [0.0, 0.0])[:2]
+
+    blob = bytearray(AWB_GRID_HEADER.pack(AWB_GRID_MAGIC, len(model.illu), steps, steps, 0,
+                                          lo, step, lo, step, names, *tau))
+    # row major over b/g, sample at the cell centre
+    for j in range(steps):
+        bg = lo + (j + 0.5) * step
+        for i in range(steps):
+            rg = lo + (i + 0.5) * step
+            blob += bytes(model.weights(rg, bg))
+    return bytes(blob)
+
+
+def read_gain_curve(csv_path):
+    points = []
+    with open(csv_path, "r") as f:
+        for line in f:
+            fields = [v.strip() for v in line.split("#", 1)[0].split(",")]
+            try:
+                points.append((float(fields[0]), float(fields[1])))
+            except (ValueError, IndexError):
+                continue    # blank or column header
+    points.sort()
+
+    if not 2 <= len(points) <= GAIN_CURVE_MAX_POINTS:
+        raise ValueError("%s: need 2..%d points, got %d" % (csv_path, GAIN_CURVE_MAX_POINTS, len(points)))
+    fixed = [(int(round(r * GAIN_ONE)), int(round(a * GAIN_ONE))) for r, a in points]
+    for (r0, a0), (r1, a1) in zip(fixed, fixed[1:]):
+        if r1 <= r0 or a1 < a0:
+            raise ValueError("%s: curve must rise, check %.4f -> %.4f"
+                             % (csv_path, r1 / GAIN_ONE, a1 / GAIN_ONE))
+    if fixed[0][0] <= 0 or fixed[0][1] <= 0:
+        raise ValueError("%s: gains must be positive" % csv_path)
+    return fixed
+
+
+def compile_gain_curve(csv_path):
+    points = read_gain_curve(csv_path)
+
+    blob = bytearray(GAIN_CURVE_HEADER.pack(GAIN_CURVE_MAGIC, len(points), 0))
+    for requested, actual in points:
+        blob += GAIN_CURVE_POINT.pack(requested, actual)
+    return bytes(blob)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd")
+
+    g = sub.add_parser("awb-grid")
+    g.add_argument("xml")
+    g.add_argument("--steps", type=int, default=DEFAULT_STEPS)
+    g.add_argument("--min", type=float, default=DEFAULT_MIN)
+    g.add_argument("--max", type=float, default=DEFAULT_MAX)
+    g.add_argument("--lookup", type=float, nargs=2, metavar=("RG", "BG"),
+                   help="print the exact and gridded weights for one point")
+    g.add_argument("-o", "--output")
+
+    c = sub.add_parser("gain-curve")
+    c.add_argument("csv")
+    c.add_argument("-o", "--output")
+
+    args = parser.parse_args()
+    if args.cmd == "gain-curve":
+        blob = compile_gain_curve(args.csv)
+        if args.output:
+            with open(args.output, "wb") as f:
+                f.write(blob)
+        print("%s: %d points" % (args.output or args.csv, (len(blob) - GAIN_CURVE_HEADER.size)
+                                 // GAIN_CURVE_POINT.size))
+        return 0
+    if args.cmd != "awb-grid":
+        parser.print_help()
+        return 1
+
+    if args.lookup:
+        model = AwbModel(args.xml)
+        rg, bg = args.lookup
+        for il, w in zip(model.illu, model.weights(rg, bg)):
+            print("%-12s %3d" % (il["name"], w))
+        return 0
+
+    blob = compile_awb_grid(args.xml, args.steps, args.min, args.max)
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(blob)
+    print("%s: %d bytes" % (args.output or args.xml, len(blob)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
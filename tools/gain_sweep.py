@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+##
+ # Copyright (C) 2020 Alibaba Group Holding Limited
+##
+"""Build a measured gain curve from a gain sweep.
+
+Point the module at a flat, steady target, fix the integration time and
+step the requested gain over the sensor's range (on the target through the
+tuning tool, or by replaying a recorded session), logging one row per
+frame:
+
+    gain,integration_time,mean[,black]
+
+mean is the average raw level of a centre window, black the black level
+(0 if it is already subtracted). Frames are grouped by requested gain, the
+response (mean - black) / integration_time of each group is taken as its
+median, and the actual gain is the response relative to the lowest gain
+step, which is assumed to be exact. Clipped frames are dropped, so the
+integration time may change in the middle of the sweep to keep the signal
+in range.
+
+The result is a requested,actual csv. Saved next to the calibration xml as
+<xml name>.gain.csv it is packed into the mode bundle (see
+calib_compiler.py gain-curve) and the driver corrects its gain table with
+it.
+
+Usage:
+    gain_sweep.py sweep.csv -o GC5035_1920x1080.gain.csv
+    gain_sweep.py sweep.csv --white 4095 --step 0.25
+"""
+
+import argparse
+import statistics
+import sys
+
+DEFAULT_WHITE = 1023
+CLIP_FRACTION = 0.9
+MIN_SIGNAL = 16
+
+
+def read_sweep(path, white):
+    groups = {}
+    dropped = 0
+    with open(path, "r") as f:
+        for line in f:
+            fields = [v.strip() for v in line.split("#", 1)[0].split(",")]
+            try:
+                gain, time, mean = (float(v) for v in fields[:3])
+                black = float(fields[3]) if len(fields) > 3 and fields[3] else 0.0
+            except (ValueError, IndexError):
+                continue    # blank or column header
+            signal = mean - black
+            if gain <= 0 or time <= 0 or mean >= CLIP_FRACTION * white or signal < MIN_SIGNAL:
+                dropped += 1
+                continue
+            groups.setdefault(round(gain, 4), []).append(signal / time)
+    return groups, dropped
+
+
+def build_curve(groups, step):
+    gains = sorted(groups)
+    if len(gains) < 2:
+        raise ValueError("need at least two gain steps with usable frames")
+
+    ref_gain = gains[0]
+    ref = statistics.median(groups[ref_gain])
+    curve = []
+    last_actual = 0.0
+    last_requested = None
+    for gain in gains:
+        if last_requested is not None and gain - last_requested < step and gain != gains[-1]:
+            continue
+        actual = ref_gain * statistics.median(groups[gain]) / ref
+        if actual < last_actual:
+            # noise around a flat step, the table has to rise
+            print("gain %.4f measured %.4f below %.4f, held" % (gain, actual, last_actual),
+                  file=sys.stderr)
+            actual = last_actual
+        curve.append((gain, actual))
+        last_actual = actual
+        last_requested = gain
+    return curve
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("sweep")
+    parser.add_argument("--white", type=float, default=DEFAULT_WHITE,
+                        help="raw white level, frames above %d%% of it are dropped" % (CLIP_FRACTION * 100))
+    parser.add_argument("--step", type=float, default=0.0,
+                        help="minimum distance between curve points, 0 keeps every gain step")
+    parser.add_argument("-o", "--output")
+    args = parser.parse_args()
+
+    groups, dropped = read_sweep(args.sweep, args.white)
+    curve = build_curve(groups, args.step)
+
+    lines = ["# measured by gain_sweep.py from %s, %d frames dropped" % (args.sweep, dropped),
+             "requested,actual"]
+    lines += ["%.4f,%.4f" % point for point in curve]
+    worst = max(abs(a / r - 1.0) for r, a in curve)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write("\n".join(lines) + "\n")
+    else:
+        print("\n".join(lines))
+    print("%d points, worst deviation from nominal %.1f%%" % (len(curve), worst * 100), file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+##
+ # Copyright (C) 2020 Alibaba Group Holding Limited
+##
+"""Pack one sensor mode into a tuning bundle (.vsb).
+
+The layout must match drivers/common/sensor_bundle.h:
+
+    SensorBundleHeader_t    header
+    SensorBundleSection_t   index[sectionCount]
+    payloads, each aligned to SENSOR_BUNDLE_ALIGN
+
+When a calibration xml is given, the tables produced by calib_compiler.py
+are packed next to it, and so is a measured gain curve if given.
+
+Usage:
+    sensor_bundle.py pack --sensor GC5035 --mode 1 \
+        --regs GC5035_mipi2lane_1920x1080@30_gc.txt \
+        --config-3a 3aconfig_GC5035_1920x1080_raw10.json \
+        --calib GC5035_1920x1080.xml \
+        --gain-curve GC5035_1920x1080.gain.csv \
+        --profile night=3aconfig_GC5035_1920x1080_raw10_night.json \
+        -o GC5035_mode1.vsb
+    sensor_bundle.py dump GC5035_mode1.vsb
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import calib_compiler  # noqa: E402
+
+MAGIC = 0x4E425356
+VERSION = 1
+ALIGN = 8
+
+SECTION_REGS = 1
+SECTION_3A_CONFIG = 2
+SECTION_CALIB = 3
+SECTION_AWB_GRID = 4
+SECTION_3A_PROFILE = 5
+SECTION_GAIN_CURVE = 6
+
+PROFILE_NAME_LEN = 32
+
+SECTION_NAMES = {
+    SECTION_REGS: "regs",
+    SECTION_3A_CONFIG: "3a_config",
+    SECTION_CALIB: "calib",
+    SECTION_AWB_GRID: "awb_grid",
+    SECTION_3A_PROFILE: "3a_profile",
+    SECTION_GAIN_CURVE: "gain_curve",
+}
+
+HEADER = struct.Struct("<IHHII Q 16s")
+SECTION = struct.Struct("<IIII Q")
+
+FNV_SEED = 0xCBF29CE484222325
+FNV_PRIME = 0x100000001B3
+
+# same acceptance rule as the drivers' sscanf("0x%x 0x%x")
+REG_LINE = re.compile(r"^0x([0-9a-fA-F]+)\s*0x([0-9a-fA-F]+)")
+
+
+def fnv1a64(data, seed=FNV_SEED):
+    h = seed
+    for b in data:
+        h ^= b
+        h = (h * FNV_PRIME) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+
+def align(n):
+    return (n + ALIGN - 1) & ~(ALIGN - 1)
+
+
+def parse_regs(path):
+    out = bytearray()
+    with open(path, "r", errors="replace") as f:
+        for line in f:
+            m = REG_LINE.match(line)
+            if not m:
+                continue
+            out += struct.pack("<II", int(m.group(1), 16), int(m.group(2), 16))
+    return bytes(out)
+
+
+def read_text(path):
+    with open(path, "rb") as f:
+        return f.read() + b"\0"
+
+
+def read_profile(spec):
+    name, _, path = spec.partition("=")
+    if not name or not path or len(name) >= PROFILE_NAME_LEN:
+        raise ValueError("bad profile %r, expected NAME=FILE" % spec)
+    return name.encode().ljust(PROFILE_NAME_LEN, b"\0") + read_text(path)
+
+
+def pack(sensor, mode, sections, output):
+    count = len(sections)
+    offset = align(HEADER.size + count * SECTION.size)
+
+    index = []
+    payload = bytearray()
+    content_hash = FNV_SEED
+    for stype, data in sections:
+        index.append((stype, offset + len(payload), len(data), fnv1a64(data)))
+        content_hash = fnv1a64(data, content_hash)
+        payload += data
+        payload += b"\0" * (align(len(payload)) - len(payload))
+
+    total = offset + len(payload)
+    blob = bytearray(HEADER.pack(MAGIC, VERSION, count, mode, total,
+                                 content_hash, sensor.encode()[:15]))
+    for stype, off, size, h in index:
+        blob += SECTION.pack(stype, off, size, 0, h)
+    blob += b"\0" * (offset - len(blob))
+    blob += payload
+
+    with open(output, "wb") as f:
+        f.write(blob)
+    return content_hash
+
+
+def load(path):
+    with open(path, "rb") as f:
+        blob = f.read()
+    magic, version, count, mode, total, content_hash, name = HEADER.unpack_from(blob, 0)
+    if magic != MAGIC or version != VERSION or total != len(blob):
+        raise ValueError("%s: not a version %d bundle" % (path, VERSION))
+    sections = []
+    for i in range(count):
+        stype, off, size, _, h = SECTION.unpack_from(blob, HEADER.size + i * SECTION.size)
+        sections.append((stype, off, size, h))
+    return blob, name.rstrip(b"\0").decode(), mode, content_hash, sections
+
+
+def cmd_pack(args):
+    sections = [(SECTION_REGS, parse_regs(args.regs))]
+    if args.config_3a:
+        sections.append((SECTION_3A_CONFIG, read_text(args.config_3a)))
+    if args.calib:
+        sections.append((SECTION_CALIB, read_text(args.calib)))
+        sections.append((SECTION_AWB_GRID, calib_compiler.compile_awb_grid(args.calib)))
+    if args.gain_curve:
+        sections.append((SECTION_GAIN_CURVE, calib_compiler.compile_gain_curve(args.gain_curve)))
+    for spec in args.profile:
+        sections.append((SECTION_3A_PROFILE, read_profile(spec)))
+    h = pack(args.sensor, args.mode, sections, args.output)
+    print("%s: %s mode %d hash %016x" % (args.output, args.sensor, args.mode, h))
+
+
+def cmd_dump(args):
+    blob, name, mode, content_hash, sections = load(args.bundle)
+    print("%s mode %d, %d bytes, hash %016x" % (name, mode, len(blob), content_hash))
+    ok = True
+    for stype, off, size, h in sections:
+        good = fnv1a64(blob[off:off + size]) == h
+        ok = ok and good
+        print("  %-10s offset %8d size %8d hash %016x %s"
+              % (SECTION_NAMES.get(stype, str(stype)), off, size, h, "ok" if good else "BAD"))
+    return 0 if ok else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd")
+
+    p = sub.add_parser("pack")
+    p.add_argument("--sensor", required=True)
+    p.add_argument("--mode", type=int, required=True)
+    p.add_argument("--regs", required=True)
+    p.add_argument("--config-3a")
+    p.add_argument("--calib")
+    p.add_argument("--gain-curve", help="measured requested,actual gain csv, see gain_sweep.py")
+    p.add_argument("--profile", action="append", default=[], metavar="NAME=FILE",
+                   help="additional 3aconfig selectable at runtime, may repeat")
+    p.add_argument("-o", "--output", required=True)
+
+    d = sub.add_parser("dump")
+    d.add_argument("bundle")
+
+    args = parser.parse_args()
+    if args.cmd == "pack":
+        cmd_pack(args)
+        return 0
+    if args.cmd == "dump":
+        return cmd_dump(args)
+    parser.print_help()
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())